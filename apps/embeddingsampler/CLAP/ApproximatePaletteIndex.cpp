@@ -0,0 +1,433 @@
+#include "ApproximatePaletteIndex.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace Unsound4All
+{
+    namespace
+    {
+        constexpr int32_t kFileMagic = 0x4e4e4146; // "FANN"
+        constexpr int32_t kFileVersion = 1;
+        constexpr int kHeaderFields = 8;
+        constexpr int kLanes = ApproximatePaletteIndex::kSubspaceDimension;
+        constexpr int kMinTrainingRowsPerList = 32;
+        constexpr int kMinDefaultProbes = 16;
+
+        using Match = PaletteIndex::Match;
+
+        // Dot product over a multiple of kLanes floats, with independent
+        // accumulators so the compiler can vectorise it
+        float dot(const float* a, const float* b, int dimension)
+        {
+            float acc[kLanes] = {};
+            for (int i = 0; i < dimension; i += kLanes)
+                for (int lane = 0; lane < kLanes; ++lane)
+                    acc[lane] += a[i + lane] * b[i + lane];
+
+            float sum = 0.0f;
+            for (int lane = 0; lane < kLanes; ++lane)
+                sum += acc[lane];
+            return sum;
+        }
+
+        bool ranksBefore(const Match& a, const Match& b)
+        {
+            if (a.similarity != b.similarity)
+                return a.similarity > b.similarity;
+            return a.chunkIndex < b.chunkIndex;
+        }
+
+        // Bounded heap of the best k, weakest at the front
+        void keepBest(std::vector<Match>& heap, const Match& candidate, int k)
+        {
+            if (static_cast<int>(heap.size()) < k)
+            {
+                heap.push_back(candidate);
+                std::push_heap(heap.begin(), heap.end(), ranksBefore);
+            }
+            else if (ranksBefore(candidate, heap.front()))
+            {
+                std::pop_heap(heap.begin(), heap.end(), ranksBefore);
+                heap.back() = candidate;
+                std::push_heap(heap.begin(), heap.end(), ranksBefore);
+            }
+        }
+
+        // Offsets that turn "best dot product" into "nearest centroid": zero
+        // for unit-length (spherical) centroids, -|c|^2 / 2 otherwise, since
+        // argmin |x - c|^2 == argmax (x.c - |c|^2 / 2)
+        std::vector<float> centroidBias(const std::vector<float>& centroids, int k, int dimension, bool spherical)
+        {
+            std::vector<float> bias(static_cast<size_t>(k), 0.0f);
+            if (!spherical)
+                for (int c = 0; c < k; ++c)
+                {
+                    const float* centroid = centroids.data() + static_cast<size_t>(c) * static_cast<size_t>(dimension);
+                    bias[static_cast<size_t>(c)] = -0.5f * dot(centroid, centroid, dimension);
+                }
+            return bias;
+        }
+
+        int nearestCentroid(const float* point, const float* centroids, const float* bias, int k, int dimension)
+        {
+            int best = 0;
+            float bestScore = -std::numeric_limits<float>::infinity();
+            for (int c = 0; c < k; ++c)
+            {
+                const float score = dot(point, centroids + static_cast<size_t>(c) * static_cast<size_t>(dimension), dimension) + bias[c];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    best = c;
+                }
+            }
+            return best;
+        }
+
+        // Lloyd's k-means over numPoints vectors of `dimension` floats, each
+        // `stride` floats after the previous one. Spherical k-means keeps the
+        // centroids unit length (cosine clustering); empty clusters are
+        // reseeded from a random point.
+        std::vector<float> trainKMeans(const float* points, int numPoints, size_t stride, int dimension,
+                                       int k, int iterations, bool spherical, std::mt19937& rng)
+        {
+            const auto dim = static_cast<size_t>(dimension);
+            std::vector<float> centroids(static_cast<size_t>(k) * dim);
+            std::uniform_int_distribution<int> pickPoint(0, numPoints - 1);
+
+            std::vector<int> order(static_cast<size_t>(numPoints));
+            std::iota(order.begin(), order.end(), 0);
+            std::shuffle(order.begin(), order.end(), rng);
+            for (int c = 0; c < k; ++c)
+            {
+                const float* point = points + static_cast<size_t>(order[static_cast<size_t>(c % numPoints)]) * stride;
+                std::copy(point, point + dim, centroids.begin() + static_cast<std::ptrdiff_t>(static_cast<size_t>(c) * dim));
+            }
+
+            std::vector<double> sums(centroids.size());
+            std::vector<int> counts(static_cast<size_t>(k));
+            for (int iteration = 0; iteration < iterations; ++iteration)
+            {
+                const auto bias = centroidBias(centroids, k, dimension, spherical);
+                std::fill(sums.begin(), sums.end(), 0.0);
+                std::fill(counts.begin(), counts.end(), 0);
+                for (int p = 0; p < numPoints; ++p)
+                {
+                    const float* point = points + static_cast<size_t>(p) * stride;
+                    const int c = nearestCentroid(point, centroids.data(), bias.data(), k, dimension);
+                    ++counts[static_cast<size_t>(c)];
+                    double* sum = sums.data() + static_cast<size_t>(c) * dim;
+                    for (size_t i = 0; i < dim; ++i)
+                        sum[i] += point[i];
+                }
+
+                for (int c = 0; c < k; ++c)
+                {
+                    float* centroid = centroids.data() + static_cast<size_t>(c) * dim;
+                    const int count = counts[static_cast<size_t>(c)];
+                    if (count == 0)
+                    {
+                        const float* point = points + static_cast<size_t>(pickPoint(rng)) * stride;
+                        std::copy(point, point + dim, centroid);
+                        continue;
+                    }
+
+                    const double* sum = sums.data() + static_cast<size_t>(c) * dim;
+                    double sumSquares = 0.0;
+                    for (size_t i = 0; i < dim; ++i)
+                    {
+                        centroid[i] = static_cast<float>(sum[i] / count);
+                        sumSquares += static_cast<double>(centroid[i]) * centroid[i];
+                    }
+
+                    if (spherical && sumSquares > 1e-16)
+                    {
+                        const auto scale = static_cast<float>(1.0 / std::sqrt(sumSquares));
+                        for (size_t i = 0; i < dim; ++i)
+                            centroid[i] *= scale;
+                    }
+                }
+            }
+            return centroids;
+        }
+
+        template <typename T>
+        bool readArray(juce::InputStream& stream, std::vector<T>& values, size_t count)
+        {
+            values.resize(count);
+            const auto bytes = static_cast<int>(count * sizeof(T));
+            return stream.read(values.data(), bytes) == bytes;
+        }
+    }
+
+    std::unique_ptr<ApproximatePaletteIndex> ApproximatePaletteIndex::build(const PaletteIndex& exact, const BuildOptions& options)
+    {
+        if (exact.getNumRows() == 0 || exact.getDimension() == 0)
+            return nullptr;
+
+        std::unique_ptr<ApproximatePaletteIndex> index(new ApproximatePaletteIndex());
+        index->m_numRows = exact.getNumRows();
+        index->m_dimension = exact.getDimension();
+        index->m_numSubspaces = (index->m_dimension + kSubspaceDimension - 1) / kSubspaceDimension;
+        index->m_numLists = options.numLists > 0
+            ? juce::jmin(options.numLists, index->m_numRows)
+            : juce::jlimit(1, index->m_numRows, juce::roundToInt(std::sqrt(static_cast<double>(index->m_numRows))));
+
+        const int numRows = index->m_numRows;
+        const int numSubspaces = index->m_numSubspaces;
+        const int numLists = index->m_numLists;
+        // PaletteIndex rows are zero padded past this, so reading it is safe
+        const int paddedDimension = numSubspaces * kSubspaceDimension;
+        const auto padded = static_cast<size_t>(paddedDimension);
+        std::mt19937 rng(options.seed);
+
+        // Training sample, copied contiguously from the normalised rows
+        std::vector<int> order(static_cast<size_t>(numRows));
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), rng);
+        const int numTraining = juce::jmin(numRows, juce::jmax(options.maxTrainingRows, kMinTrainingRowsPerList * numLists));
+        std::vector<float> training(static_cast<size_t>(numTraining) * padded);
+        for (int i = 0; i < numTraining; ++i)
+        {
+            const float* row = exact.getRow(order[static_cast<size_t>(i)]);
+            std::copy(row, row + padded, training.begin() + static_cast<std::ptrdiff_t>(static_cast<size_t>(i) * padded));
+        }
+
+        index->m_centroids = trainKMeans(training.data(), numTraining, padded, paddedDimension,
+                                         numLists, options.iterations, true, rng);
+
+        // Codebooks quantise what is left after the list centroid (the residual)
+        const std::vector<float> listBias(static_cast<size_t>(numLists), 0.0f);
+        for (int i = 0; i < numTraining; ++i)
+        {
+            float* row = training.data() + static_cast<size_t>(i) * padded;
+            const int list = nearestCentroid(row, index->m_centroids.data(), listBias.data(), numLists, paddedDimension);
+            const float* centroid = index->m_centroids.data() + static_cast<size_t>(list) * padded;
+            for (size_t d = 0; d < padded; ++d)
+                row[d] -= centroid[d];
+        }
+
+        const size_t codebookFloats = static_cast<size_t>(kCodebookSize * kSubspaceDimension);
+        index->m_codebooks.resize(static_cast<size_t>(numSubspaces) * codebookFloats);
+        for (int m = 0; m < numSubspaces; ++m)
+        {
+            const auto codebook = trainKMeans(training.data() + m * kSubspaceDimension, numTraining, padded,
+                                              kSubspaceDimension, kCodebookSize, options.iterations, false, rng);
+            std::copy(codebook.begin(), codebook.end(),
+                      index->m_codebooks.begin() + static_cast<std::ptrdiff_t>(static_cast<size_t>(m) * codebookFloats));
+        }
+
+        // Assign every row to its list, then lay the lists out back to back
+        std::vector<int> rowList(static_cast<size_t>(numRows));
+        index->m_listOffsets.assign(static_cast<size_t>(numLists) + 1, 0);
+        for (int row = 0; row < numRows; ++row)
+        {
+            const int list = nearestCentroid(exact.getRow(row), index->m_centroids.data(), listBias.data(), numLists, paddedDimension);
+            rowList[static_cast<size_t>(row)] = list;
+            ++index->m_listOffsets[static_cast<size_t>(list) + 1];
+        }
+        std::partial_sum(index->m_listOffsets.begin(), index->m_listOffsets.end(), index->m_listOffsets.begin());
+
+        std::vector<int> cursor(index->m_listOffsets.begin(), index->m_listOffsets.end() - 1);
+        index->m_listRows.resize(static_cast<size_t>(numRows));
+        for (int row = 0; row < numRows; ++row)
+            index->m_listRows[static_cast<size_t>(cursor[static_cast<size_t>(rowList[static_cast<size_t>(row)])]++)] = row;
+
+        // Encode each row's residual as its nearest codeword per subspace
+        std::vector<float> codeBias;
+        codeBias.reserve(static_cast<size_t>(numSubspaces * kCodebookSize));
+        for (int m = 0; m < numSubspaces; ++m)
+        {
+            const std::vector<float> codebook(index->m_codebooks.begin() + static_cast<std::ptrdiff_t>(static_cast<size_t>(m) * codebookFloats),
+                                              index->m_codebooks.begin() + static_cast<std::ptrdiff_t>(static_cast<size_t>(m + 1) * codebookFloats));
+            const auto bias = centroidBias(codebook, kCodebookSize, kSubspaceDimension, false);
+            codeBias.insert(codeBias.end(), bias.begin(), bias.end());
+        }
+
+        index->m_codes.resize(static_cast<size_t>(numRows) * static_cast<size_t>(numSubspaces));
+        std::vector<float> residual(padded);
+        for (int entry = 0; entry < numRows; ++entry)
+        {
+            const int rowIndex = index->m_listRows[static_cast<size_t>(entry)];
+            const float* values = exact.getRow(rowIndex);
+            const float* centroid = index->m_centroids.data() + static_cast<size_t>(rowList[static_cast<size_t>(rowIndex)]) * padded;
+            for (size_t d = 0; d < padded; ++d)
+                residual[d] = values[d] - centroid[d];
+
+            const float* row = residual.data();
+            juce::uint8* codes = index->m_codes.data() + static_cast<size_t>(entry) * static_cast<size_t>(numSubspaces);
+            for (int m = 0; m < numSubspaces; ++m)
+                codes[m] = static_cast<juce::uint8>(nearestCentroid(row + m * kSubspaceDimension,
+                                                                    index->m_codebooks.data() + static_cast<size_t>(m) * codebookFloats,
+                                                                    codeBias.data() + m * kCodebookSize,
+                                                                    kCodebookSize, kSubspaceDimension));
+        }
+
+        DBG("ApproximatePaletteIndex: Built " + juce::String(numLists) + " lists, " + juce::String(numSubspaces)
+            + " bytes per row, over " + juce::String(numRows) + " rows");
+        return index;
+    }
+
+    bool ApproximatePaletteIndex::save(const juce::File& file) const
+    {
+        // Written beside the target and moved over it, so readers never see half a file
+        juce::TemporaryFile temporaryFile(file);
+        {
+            juce::FileOutputStream stream(temporaryFile.getFile());
+            if (!stream.openedOk())
+            {
+                DBG("ApproximatePaletteIndex: Failed to create " + temporaryFile.getFile().getFullPathName());
+                return false;
+            }
+
+            const int32_t header[kHeaderFields] = { kFileMagic, kFileVersion, m_numRows, m_dimension,
+                                                    m_numLists, m_numSubspaces, kSubspaceDimension, kCodebookSize };
+            stream.write(header, sizeof(header));
+            stream.write(m_centroids.data(), m_centroids.size() * sizeof(float));
+            stream.write(m_codebooks.data(), m_codebooks.size() * sizeof(float));
+            stream.write(m_listOffsets.data(), m_listOffsets.size() * sizeof(int));
+            stream.write(m_listRows.data(), m_listRows.size() * sizeof(int));
+            stream.write(m_codes.data(), m_codes.size());
+            stream.flush();
+
+            if (stream.getStatus().failed())
+            {
+                DBG("ApproximatePaletteIndex: Write failed: " + stream.getStatus().getErrorMessage());
+                return false;
+            }
+        }
+        return temporaryFile.overwriteTargetFileWithTemporary();
+    }
+
+    std::unique_ptr<ApproximatePaletteIndex> ApproximatePaletteIndex::load(const juce::File& file, const PaletteIndex& exact)
+    {
+        juce::FileInputStream stream(file);
+        if (!stream.openedOk())
+            return nullptr;
+
+        int32_t header[kHeaderFields] = {};
+        if (stream.read(header, sizeof(header)) != static_cast<int>(sizeof(header))
+            || header[0] != kFileMagic || header[1] != kFileVersion)
+        {
+            DBG("ApproximatePaletteIndex: Not an index file: " + file.getFullPathName());
+            return nullptr;
+        }
+
+        std::unique_ptr<ApproximatePaletteIndex> index(new ApproximatePaletteIndex());
+        index->m_numRows = header[2];
+        index->m_dimension = header[3];
+        index->m_numLists = header[4];
+        index->m_numSubspaces = header[5];
+
+        // Must describe exactly the rows it will rerank against
+        if (index->m_numRows != exact.getNumRows() || index->m_dimension != exact.getDimension()
+            || index->m_numLists < 1 || index->m_numLists > index->m_numRows
+            || index->m_numSubspaces != (index->m_dimension + kSubspaceDimension - 1) / kSubspaceDimension
+            || header[6] != kSubspaceDimension || header[7] != kCodebookSize)
+        {
+            DBG("ApproximatePaletteIndex: Index does not match palette (" + juce::String(header[2]) + " x "
+                + juce::String(header[3]) + " vs " + juce::String(exact.getNumRows()) + " x " + juce::String(exact.getDimension()) + ")");
+            return nullptr;
+        }
+
+        const auto numRows = static_cast<size_t>(index->m_numRows);
+        const auto numLists = static_cast<size_t>(index->m_numLists);
+        const auto numSubspaces = static_cast<size_t>(index->m_numSubspaces);
+        const size_t paddedDimension = numSubspaces * kSubspaceDimension;
+        if (!readArray(stream, index->m_centroids, numLists * paddedDimension)
+            || !readArray(stream, index->m_codebooks, numSubspaces * kCodebookSize * kSubspaceDimension)
+            || !readArray(stream, index->m_listOffsets, numLists + 1)
+            || !readArray(stream, index->m_listRows, numRows)
+            || !readArray(stream, index->m_codes, numRows * numSubspaces))
+        {
+            DBG("ApproximatePaletteIndex: Truncated index file: " + file.getFullPathName());
+            return nullptr;
+        }
+
+        bool valid = index->m_listOffsets.front() == 0 && index->m_listOffsets.back() == index->m_numRows
+            && std::is_sorted(index->m_listOffsets.begin(), index->m_listOffsets.end());
+        for (int row : index->m_listRows)
+            valid = valid && row >= 0 && row < index->m_numRows;
+        if (!valid)
+        {
+            DBG("ApproximatePaletteIndex: Corrupt list layout in " + file.getFullPathName());
+            return nullptr;
+        }
+        return index;
+    }
+
+    int ApproximatePaletteIndex::getDefaultProbes() const
+    {
+        // Bigger palettes spread a query's neighbours over more lists
+        return juce::jmin(m_numLists, juce::jmax(kMinDefaultProbes, m_numLists / 16));
+    }
+
+    std::vector<PaletteIndex::Match> ApproximatePaletteIndex::search(const PaletteIndex& exact,
+                                                                     const std::vector<float>& query,
+                                                                     int topK,
+                                                                     const SearchOptions& options) const
+    {
+        std::vector<Match> candidates;
+        if (static_cast<int>(query.size()) != m_dimension || topK <= 0 || m_numRows == 0 || exact.getNumRows() != m_numRows)
+            return candidates;
+
+        // Normalised query, zero padded to whole subspaces
+        const int paddedDimension = m_numSubspaces * kSubspaceDimension;
+        std::vector<float> normalised(static_cast<size_t>(paddedDimension), 0.0f);
+        double sumSquares = 0.0;
+        for (float value : query)
+            sumSquares += static_cast<double>(value) * value;
+        if (sumSquares <= 1e-16)
+            return candidates;
+        const auto scale = static_cast<float>(1.0 / std::sqrt(sumSquares));
+        for (int i = 0; i < m_dimension; ++i)
+            normalised[static_cast<size_t>(i)] = query[static_cast<size_t>(i)] * scale;
+        const float* q = normalised.data();
+
+        // Lists whose centroids point closest to the query
+        const int probes = juce::jlimit(1, m_numLists, options.probes > 0 ? options.probes : getDefaultProbes());
+        std::vector<std::pair<float, int>> listScores(static_cast<size_t>(m_numLists));
+        for (int list = 0; list < m_numLists; ++list)
+            listScores[static_cast<size_t>(list)] = { dot(q, m_centroids.data() + static_cast<size_t>(list) * static_cast<size_t>(paddedDimension), paddedDimension), list };
+        std::partial_sort(listScores.begin(), listScores.begin() + probes, listScores.end(),
+                          [](const auto& a, const auto& b) { return a.first > b.first; });
+
+        // query . codeword for every subspace and code; the same table serves
+        // every list, since q.x = q.centroid + q.residual
+        std::vector<float> table(static_cast<size_t>(m_numSubspaces * kCodebookSize));
+        for (int m = 0; m < m_numSubspaces; ++m)
+            for (int code = 0; code < kCodebookSize; ++code)
+                table[static_cast<size_t>(m * kCodebookSize + code)] =
+                    dot(q + m * kSubspaceDimension,
+                        m_codebooks.data() + static_cast<size_t>(m * kCodebookSize + code) * kSubspaceDimension,
+                        kSubspaceDimension);
+
+        // Approximate scores from the codes, keeping the best for reranking
+        const int numCandidates = juce::jmax(topK, options.rerank);
+        candidates.reserve(static_cast<size_t>(numCandidates));
+        for (int p = 0; p < probes; ++p)
+        {
+            const float centroidScore = listScores[static_cast<size_t>(p)].first;
+            const auto list = static_cast<size_t>(listScores[static_cast<size_t>(p)].second);
+            for (int entry = m_listOffsets[list]; entry < m_listOffsets[list + 1]; ++entry)
+            {
+                const juce::uint8* codes = m_codes.data() + static_cast<size_t>(entry) * static_cast<size_t>(m_numSubspaces);
+                float score = centroidScore;
+                for (int m = 0; m < m_numSubspaces; ++m)
+                    score += table[static_cast<size_t>(m * kCodebookSize + codes[m])];
+                keepBest(candidates, { m_listRows[static_cast<size_t>(entry)], score }, numCandidates);
+            }
+        }
+
+        // Exact cosine similarity for the survivors
+        for (auto& candidate : candidates)
+            candidate.similarity = dot(q, exact.getRow(candidate.chunkIndex), paddedDimension);
+        std::sort(candidates.begin(), candidates.end(), ranksBefore);
+        if (static_cast<int>(candidates.size()) > topK)
+            candidates.resize(static_cast<size_t>(topK));
+        return candidates;
+    }
+}
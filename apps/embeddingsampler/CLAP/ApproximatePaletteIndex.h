@@ -0,0 +1,82 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <memory>
+#include <vector>
+#include "PaletteIndex.h"
+
+namespace Unsound4All
+{
+    // Inverted-file + product-quantised (IVF-PQ) index over a PaletteIndex
+    //
+    // Build: spherical k-means splits the normalised rows into numLists
+    // lists, each with a centroid. What is left of each row after its list
+    // centroid (the residual) is split into 8-float subspaces, and each
+    // subspace is quantised to one byte against its own 256-entry codebook
+    // (k-means again). A 512-d row is stored as 64 bytes instead of 2 KB.
+    //
+    // Search: the query is scored against every centroid, and the best
+    // `probes` lists are visited. A 256-entry lookup table per subspace turns
+    // each row's approximate similarity into its centroid's score plus
+    // numSubspaces table reads. The best `rerank` candidates are then
+    // re-scored exactly against the full rows of the PaletteIndex, so
+    // similarities match an exact search.
+    //
+    // Built once when a palette is created and saved next to palette.bin
+    // as kFileName; PaletteIndex::load picks it up when it is there.
+    class ApproximatePaletteIndex
+    {
+    public:
+        static constexpr int kCodebookSize = 256;
+        static constexpr int kSubspaceDimension = 8;
+        static constexpr int kMinRows = 2048; // Below this an exact scan is already cheap
+        static constexpr const char* kFileName = "ann_index.bin";
+
+        struct BuildOptions
+        {
+            int numLists{0};             // 0 picks sqrt(numRows)
+            int maxTrainingRows{16384};  // Rows sampled for training (raised to 32 per list)
+            int iterations{10};          // k-means iterations
+            juce::uint32 seed{1};
+        };
+
+        struct SearchOptions
+        {
+            int probes{0};    // Lists visited per query; 0 picks numLists / 16, at least 16
+            int rerank{128};  // Candidates re-scored exactly (at least topK)
+        };
+
+        // Train and encode every row of exact (non-realtime, can take seconds)
+        static std::unique_ptr<ApproximatePaletteIndex> build(const PaletteIndex& exact, const BuildOptions& options);
+
+        // Read kFileName written by save(); nullptr if it does not match exact
+        static std::unique_ptr<ApproximatePaletteIndex> load(const juce::File& file, const PaletteIndex& exact);
+        bool save(const juce::File& file) const;
+
+        // Best topK rows of exact, most similar first; exact must be the index
+        // this one was built from
+        std::vector<PaletteIndex::Match> search(const PaletteIndex& exact,
+                                                const std::vector<float>& query,
+                                                int topK,
+                                                const SearchOptions& options) const;
+
+        int getNumRows() const { return m_numRows; }
+        int getNumLists() const { return m_numLists; }
+        int getNumSubspaces() const { return m_numSubspaces; }
+        int getDefaultProbes() const;
+
+    private:
+        ApproximatePaletteIndex() = default;
+
+        int m_numRows{0};
+        int m_dimension{0};
+        int m_numLists{0};
+        int m_numSubspaces{0}; // Dimension rounded up to kSubspaceDimension, in subspaces
+
+        std::vector<float> m_centroids;     // numLists x (numSubspaces * kSubspaceDimension), unit length
+        std::vector<float> m_codebooks;     // numSubspaces x kCodebookSize x kSubspaceDimension
+        std::vector<int> m_listOffsets;     // numLists + 1 offsets into m_listRows
+        std::vector<int> m_listRows;        // Row indices grouped by list
+        std::vector<juce::uint8> m_codes;   // numSubspaces codes per entry of m_listRows
+    };
+}
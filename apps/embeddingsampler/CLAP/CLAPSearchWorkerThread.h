@@ -5,6 +5,7 @@
 #include <flowerjuce/LooperEngine/MultiTrackLooperEngine.h>
 #include "ONNXModelManager.h"
 #include "SoundPaletteManager.h"
+#include "PaletteIndex.h"
 #include <functional>
 
 namespace Unsound4All
@@ -18,7 +19,8 @@ namespace Unsound4All
             int trackIndex,
             const juce::String& textPrompt,
             const juce::File& soundPalettePath,
-            ONNXModelManager* sharedModelManager = nullptr  // Optional shared model manager (for caching)
+            ONNXModelManager* sharedModelManager = nullptr,  // Optional shared model manager (for caching)
+            PaletteIndex::SearchMode searchMode = PaletteIndex::SearchMode::Approximate  // Exact when the palette has no approximate index
         );
         
         ~CLAPSearchWorkerThread() override;
@@ -35,15 +37,16 @@ namespace Unsound4All
         juce::String textPrompt;
         juce::File soundPalettePath;
         ONNXModelManager* m_sharedModelManager;  // Optional shared model manager
+        PaletteIndex::SearchMode m_searchMode;
         
-        // Search FAISS index for top-K matches
+        // Search the palette's shared PaletteIndex for the top-K matches
         juce::Array<juce::File> searchPalette(
             const juce::File& palettePath,
             const std::vector<float>& textEmbedding,
             int topK = 4
         ) const;
         
-        // Load FAISS index from palette directory
+        // Load the palette's shared PaletteIndex ahead of the first search
         bool loadPaletteIndex(const juce::File& palettePath) const;
     };
 }
@@ -4,12 +4,67 @@
 #include <juce_dsp/juce_dsp.h>
 #include <cmath>
 #include <algorithm>
+#include <array>
 
 namespace Unsound4All
 {
+    namespace
+    {
+#if defined(HAVE_ONNXRUNTIME) && HAVE_ONNXRUNTIME == 1
+        constexpr int64_t kPadToken = 1; // <pad>
+        
+        // Scales to unit length, returns the length before
+        float normalise(std::vector<float>& embedding)
+        {
+            float norm = 0.0f;
+            for (float val : embedding)
+                norm += val * val;
+            norm = std::sqrt(norm);
+            if (norm > 1e-8f)
+            {
+                const float scale = 1.0f / norm;
+                for (float& val : embedding)
+                    val *= scale;
+            }
+            return norm;
+        }
+        
+        GraphOptimizationLevel toOrtLevel(ONNXModelManager::GraphOptimization level)
+        {
+            switch (level)
+            {
+                case ONNXModelManager::GraphOptimization::Disabled: return ORT_DISABLE_ALL;
+                case ONNXModelManager::GraphOptimization::Basic:    return ORT_ENABLE_BASIC;
+                case ONNXModelManager::GraphOptimization::Extended: return ORT_ENABLE_EXTENDED;
+                case ONNXModelManager::GraphOptimization::All:      break;
+            }
+            return ORT_ENABLE_ALL;
+        }
+        
+        // Rows when the first input has a fixed batch dimension, otherwise 0
+        int getFixedBatch(const std::vector<int64_t>& inputShape)
+        {
+            return !inputShape.empty() && inputShape[0] > 0 ? static_cast<int>(inputShape[0]) : 0;
+        }
+        
+        // Embedding size when the first output is declared [batch, size], otherwise 0
+        int getDeclaredEmbeddingSize(Ort::Session& session)
+        {
+            const auto shape = session.GetOutputTypeInfo(0).GetTensorTypeAndShapeInfo().GetShape();
+            return shape.size() == 2 && shape[1] > 0 ? static_cast<int>(shape[1]) : 0;
+        }
+#endif
+    }
+    
     ONNXModelManager::ONNXModelManager()
+        : ONNXModelManager(Options{})
+    {
+    }
+    
+    ONNXModelManager::ONNXModelManager(const Options& options)
+        : m_options(options)
 #if defined(HAVE_ONNXRUNTIME) && HAVE_ONNXRUNTIME == 1
-        : m_env(ORT_LOGGING_LEVEL_WARNING, "Unsound4All")
+        , m_env(ORT_LOGGING_LEVEL_WARNING, "Unsound4All")
 #endif
     {
     }
@@ -48,6 +103,12 @@ namespace Unsound4All
             std::string textModelPathStr = textModelPath.getFullPathName().toStdString();
             #endif
             
+            // Threading and graph optimisation, before the sessions are created
+            m_sessionOptions.SetIntraOpNumThreads(juce::jmax(0, m_options.intraOpThreads));
+            m_sessionOptions.SetInterOpNumThreads(juce::jmax(0, m_options.interOpThreads));
+            m_sessionOptions.SetExecutionMode(m_options.interOpThreads > 1 ? ORT_PARALLEL : ORT_SEQUENTIAL);
+            m_sessionOptions.SetGraphOptimizationLevel(toOrtLevel(m_options.graphOptimization));
+            
             // Create sessions
             m_audioSession = std::make_unique<Ort::Session>(m_env, audioModelPathStr.c_str(), m_sessionOptions);
             m_textSession = std::make_unique<Ort::Session>(m_env, textModelPathStr.c_str(), m_sessionOptions);
@@ -85,6 +146,20 @@ namespace Unsound4All
                 }
             }
             
+            // Batch limits and output sizes, and one binding per session for every batch
+            m_audioFixedBatch = getFixedBatch(m_audioInputShape);
+            m_textFixedBatch = getFixedBatch(m_textInputIdsShape);
+            m_audioEmbeddingSize = getDeclaredEmbeddingSize(*m_audioSession);
+            m_textEmbeddingSize = getDeclaredEmbeddingSize(*m_textSession);
+            m_memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
+            m_audioBinding = std::make_unique<Ort::IoBinding>(*m_audioSession);
+            m_textBinding = std::make_unique<Ort::IoBinding>(*m_textSession);
+            
+            DBG("ONNXModelManager: intra-op threads " + juce::String(m_options.intraOpThreads)
+                + ", inter-op threads " + juce::String(m_options.interOpThreads)
+                + ", audio batch " + (m_audioFixedBatch > 0 ? "fixed at " + juce::String(m_audioFixedBatch) : "up to " + juce::String(m_options.maxBatchSize))
+                + ", text batch " + (m_textFixedBatch > 0 ? "fixed at " + juce::String(m_textFixedBatch) : "up to " + juce::String(m_options.maxBatchSize)));
+            
             // Initialize RoBERTa tokenizer
             // Find tokenizer files in the same directory as the models
             auto modelDir = textModelPath.getParentDirectory();
@@ -149,261 +224,261 @@ namespace Unsound4All
     
     std::vector<float> ONNXModelManager::getAudioEmbedding(const std::vector<float>& waveform)
     {
-        if (!m_initialized)
+        if (waveform.empty())
         {
             return {};
         }
         
+        auto embeddings = getAudioEmbeddings({ waveform.data() }, static_cast<int>(waveform.size()));
+        return std::move(embeddings.front());
+    }
+    
+    std::vector<std::vector<float>> ONNXModelManager::getAudioEmbeddings(const std::vector<const float*>& waveforms, int numSamples)
+    {
+        std::vector<std::vector<float>> embeddings(waveforms.size());
+        if (!m_initialized || numSamples <= 0)
+        {
+            return embeddings;
+        }
+        
 #if defined(HAVE_ONNXRUNTIME) && HAVE_ONNXRUNTIME == 1
-        try
+        const std::lock_guard<std::mutex> lock(m_audioMutex);
+        const int maxRows = m_audioFixedBatch > 0 ? m_audioFixedBatch : juce::jmax(1, m_options.maxBatchSize);
+        
+        for (size_t first = 0; first < waveforms.size(); first += static_cast<size_t>(maxRows))
         {
-            // Preprocess audio
-            auto preprocessed = preprocessAudio(waveform);
-            if (preprocessed.size() != 480000)
+            const int numRows = static_cast<int>(juce::jmin(static_cast<size_t>(maxRows), waveforms.size() - first));
+            const int batchRows = m_audioFixedBatch > 0 ? m_audioFixedBatch : numRows;
+            const auto inputLength = static_cast<size_t>(batchRows) * kAudioLength;
+            if (m_audioInput.size() < inputLength)
+                m_audioInput.resize(inputLength);
+            
+            // Preprocess straight into the batch; a fixed-size batch is padded with silence
+            for (int row = 0; row < batchRows; ++row)
             {
-                DBG("ONNXModelManager: Preprocessed waveform has wrong size: " + juce::String(preprocessed.size()));
-                return {};
+                float* destination = m_audioInput.data() + static_cast<size_t>(row) * kAudioLength;
+                if (row < numRows)
+                    preprocessAudio(waveforms[first + static_cast<size_t>(row)], static_cast<size_t>(numSamples), destination);
+                else
+                    std::fill(destination, destination + kAudioLength, 0.0f);
             }
             
-            // Create input tensor (shape: [1, 480000])
-            std::vector<int64_t> inputShape = {1, 480000};
-            Ort::MemoryInfo memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-            Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
-                memoryInfo,
-                preprocessed.data(),
-                preprocessed.size(),
-                inputShape.data(),
-                inputShape.size()
-            );
-            
-            // Convert string names to const char* for Run()
-            std::vector<const char*> inputNames;
-            std::vector<const char*> outputNames;
-            for (const auto& name : m_audioInputNames)
-                inputNames.push_back(name.c_str());
-            for (const auto& name : m_audioOutputNames)
-                outputNames.push_back(name.c_str());
-            
-            // Run inference
-            auto outputTensors = m_audioSession->Run(
-                Ort::RunOptions{nullptr},
-                inputNames.data(),
-                &inputTensor,
-                1,
-                outputNames.data(),
-                1
-            );
-            
-            // Extract output
-            float* outputData = outputTensors[0].GetTensorMutableData<float>();
-            auto outputShape = outputTensors[0].GetTensorTypeAndShapeInfo().GetShape();
-            
-            size_t outputSize = 1;
-            for (auto dim : outputShape)
+            try
             {
-                if (dim > 0)
-                    outputSize *= dim;
-            }
-            
-            // Remove batch dimension if present
-            size_t embeddingSize = outputShape.size() > 1 ? outputShape[1] : outputSize;
-            
-            std::vector<float> embedding(outputData, outputData + embeddingSize);
-            
-            // Normalize embedding
-            float norm = 0.0f;
-            for (float val : embedding)
-            {
-                norm += val * val;
+                // Input tensor (shape: [batchRows, 480000]) over the reused buffer
+                const std::array<int64_t, 2> inputShape{batchRows, kAudioLength};
+                Ort::Value inputTensor = Ort::Value::CreateTensor<float>(
+                    m_memoryInfo,
+                    m_audioInput.data(),
+                    inputLength,
+                    inputShape.data(),
+                    inputShape.size()
+                );
+                m_audioBinding->ClearBoundInputs();
+                m_audioBinding->BindInput(m_audioInputNames[0].c_str(), inputTensor);
+                
+                auto batch = runBatch(*m_audioSession, *m_audioBinding, m_audioOutputNames[0],
+                                      m_audioOutput, m_audioEmbeddingSize, batchRows, numRows);
+                std::move(batch.begin(), batch.end(), embeddings.begin() + static_cast<std::ptrdiff_t>(first));
             }
-            norm = std::sqrt(norm);
-            if (norm > 1e-8f)
+            catch (const std::exception& e)
             {
-                for (float& val : embedding)
-                {
-                    val /= norm;
-                }
+                DBG("ONNXModelManager: Error computing audio embeddings: " + juce::String(e.what()));
             }
-            
-            return embedding;
-        }
-        catch (const std::exception& e)
-        {
-            DBG("ONNXModelManager: Error computing audio embedding: " + juce::String(e.what()));
-            return {};
         }
-#else
-        return {};
 #endif
+        return embeddings;
     }
     
     std::vector<float> ONNXModelManager::getTextEmbedding(const juce::String& text)
     {
+        auto embeddings = getTextEmbeddings(juce::StringArray(text));
+        return std::move(embeddings.front());
+    }
+    
+    std::vector<std::vector<float>> ONNXModelManager::getTextEmbeddings(const juce::StringArray& texts)
+    {
+        std::vector<std::vector<float>> embeddings(static_cast<size_t>(texts.size()));
         if (!m_initialized)
         {
-            return {};
+            return embeddings;
         }
         
 #if defined(HAVE_ONNXRUNTIME) && HAVE_ONNXRUNTIME == 1
-        try
+        const std::lock_guard<std::mutex> lock(m_textMutex);
+        const int maxRows = m_textFixedBatch > 0 ? m_textFixedBatch : juce::jmax(1, m_options.maxBatchSize);
+        std::vector<int64_t> inputIds;
+        std::vector<float> attentionMask;
+        
+        for (int first = 0; first < texts.size(); first += maxRows)
         {
-            // Tokenize text
-            std::vector<int64_t> inputIds;
-            std::vector<float> attentionMask;
-            tokenizeText(text, inputIds, attentionMask);
-            
-            if (inputIds.empty())
+            const int numRows = juce::jmin(maxRows, texts.size() - first);
+            const int batchRows = m_textFixedBatch > 0 ? m_textFixedBatch : numRows;
+            const auto inputLength = static_cast<size_t>(batchRows) * kTextLength;
+            if (m_textInputIds.size() < inputLength)
             {
-                DBG("ONNXModelManager: Tokenization failed");
-                return {};
+                m_textInputIds.resize(inputLength);
+                m_textAttentionMask.resize(inputLength);
             }
             
-            // Create input tensors
-            std::vector<int64_t> inputIdsShape = {1, static_cast<int64_t>(inputIds.size())};
-            std::vector<int64_t> attentionMaskShape = {1, static_cast<int64_t>(attentionMask.size())};
-            
-            Ort::MemoryInfo memoryInfo = Ort::MemoryInfo::CreateCpu(OrtArenaAllocator, OrtMemTypeDefault);
-            Ort::Value inputIdsTensor = Ort::Value::CreateTensor<int64_t>(
-                memoryInfo,
-                inputIds.data(),
-                inputIds.size(),
-                inputIdsShape.data(),
-                inputIdsShape.size()
-            );
-            
-            Ort::Value attentionMaskTensor = Ort::Value::CreateTensor<float>(
-                memoryInfo,
-                attentionMask.data(),
-                attentionMask.size(),
-                attentionMaskShape.data(),
-                attentionMaskShape.size()
-            );
-            
-            // Prepare input array
-            std::vector<Ort::Value> inputTensors;
-            std::vector<const char*> inputNames;
-            
-            // Add inputs in the order expected by the model
-            for (const auto& name : m_textInputNames)
+            // Tokenize into the batch, every row padded to kTextLength
+            std::vector<int> failedRows;
+            for (int row = 0; row < batchRows; ++row)
             {
-                if (name.find("input_ids") != std::string::npos)
-                {
-                    inputTensors.push_back(std::move(inputIdsTensor));
-                    inputNames.push_back(name.c_str());
-                }
-                else if (name.find("attention_mask") != std::string::npos)
+                int64_t* ids = m_textInputIds.data() + static_cast<size_t>(row) * kTextLength;
+                float* mask = m_textAttentionMask.data() + static_cast<size_t>(row) * kTextLength;
+                std::fill(ids, ids + kTextLength, kPadToken);
+                std::fill(mask, mask + kTextLength, 0.0f);
+                if (row >= numRows)
+                    continue;
+                
+                tokenizeText(texts[first + row], inputIds, attentionMask);
+                if (inputIds.empty())
                 {
-                    inputTensors.push_back(std::move(attentionMaskTensor));
-                    inputNames.push_back(name.c_str());
+                    DBG("ONNXModelManager: Tokenization failed");
+                    failedRows.push_back(row);
+                    continue;
                 }
+                const auto length = juce::jmin(inputIds.size(), static_cast<size_t>(kTextLength));
+                std::copy(inputIds.begin(), inputIds.begin() + static_cast<std::ptrdiff_t>(length), ids);
+                std::copy(attentionMask.begin(), attentionMask.begin() + static_cast<std::ptrdiff_t>(juce::jmin(length, attentionMask.size())), mask);
             }
             
-            // Convert output names to const char*
-            std::vector<const char*> outputNames;
-            for (const auto& name : m_textOutputNames)
-                outputNames.push_back(name.c_str());
-            
-            // Run inference
-            auto outputTensors = m_textSession->Run(
-                Ort::RunOptions{nullptr},
-                inputNames.data(),
-                inputTensors.data(),
-                inputTensors.size(),
-                outputNames.data(),
-                1
-            );
-            
-            // Extract output
-            float* outputData = outputTensors[0].GetTensorMutableData<float>();
-            auto outputShape = outputTensors[0].GetTensorTypeAndShapeInfo().GetShape();
-            
-            size_t outputSize = 1;
-            for (auto dim : outputShape)
+            try
             {
-                if (dim > 0)
-                    outputSize *= dim;
-            }
-            
-            // Remove batch dimension if present
-            size_t embeddingSize = outputShape.size() > 1 ? outputShape[1] : outputSize;
-            
-            std::vector<float> embedding(outputData, outputData + embeddingSize);
-            
-            // Normalize embedding
-            float norm = 0.0f;
-            for (float val : embedding)
-            {
-                norm += val * val;
-            }
-            norm = std::sqrt(norm);
-            if (norm > 1e-8f)
-            {
-                for (float& val : embedding)
+                // Input tensors (shape: [batchRows, 77]) over the reused buffers
+                const std::array<int64_t, 2> inputShape{batchRows, kTextLength};
+                Ort::Value inputIdsTensor = Ort::Value::CreateTensor<int64_t>(
+                    m_memoryInfo,
+                    m_textInputIds.data(),
+                    inputLength,
+                    inputShape.data(),
+                    inputShape.size()
+                );
+                Ort::Value attentionMaskTensor = Ort::Value::CreateTensor<float>(
+                    m_memoryInfo,
+                    m_textAttentionMask.data(),
+                    inputLength,
+                    inputShape.data(),
+                    inputShape.size()
+                );
+                
+                // Bind inputs by the names the model expects
+                m_textBinding->ClearBoundInputs();
+                for (const auto& name : m_textInputNames)
+                {
+                    if (name.find("input_ids") != std::string::npos)
+                        m_textBinding->BindInput(name.c_str(), inputIdsTensor);
+                    else if (name.find("attention_mask") != std::string::npos)
+                        m_textBinding->BindInput(name.c_str(), attentionMaskTensor);
+                }
+                
+                auto batch = runBatch(*m_textSession, *m_textBinding, m_textOutputNames[0],
+                                      m_textOutput, m_textEmbeddingSize, batchRows, numRows);
+                for (int row : failedRows)
+                    batch[static_cast<size_t>(row)].clear();
+                
+                for (int row = 0; row < numRows; ++row)
                 {
-                    val /= norm;
+                    DBG("ONNXModelManager: Text embedding computed for text: '" + texts[first + row].substring(0, 50) +
+                        "', size: " + juce::String(batch[static_cast<size_t>(row)].size()));
                 }
+                std::move(batch.begin(), batch.end(), embeddings.begin() + first);
+            }
+            catch (const std::exception& e)
+            {
+                DBG("ONNXModelManager: Error computing text embeddings: " + juce::String(e.what()));
             }
-            
-            DBG("ONNXModelManager: Text embedding computed for text: '" + text.substring(0, 50) + 
-                "', size: " + juce::String(embedding.size()) + ", norm: " + juce::String(norm));
-            
-            return embedding;
-        }
-        catch (const std::exception& e)
-        {
-            DBG("ONNXModelManager: Error computing text embedding: " + juce::String(e.what()));
-            return {};
         }
-#else
-        return {};
 #endif
+        return embeddings;
     }
     
-    std::vector<float> ONNXModelManager::preprocessAudio(const std::vector<float>& audio, int targetLength, int targetSampleRate)
+#if defined(HAVE_ONNXRUNTIME) && HAVE_ONNXRUNTIME == 1
+    std::vector<std::vector<float>> ONNXModelManager::runBatch(Ort::Session& session,
+                                                               Ort::IoBinding& binding,
+                                                               const std::string& outputName,
+                                                               std::vector<float>& outputBuffer,
+                                                               int embeddingSize,
+                                                               int batchRows,
+                                                               int numRows)
     {
-        std::vector<float> result;
-        
-        if (audio.empty())
+        // Output straight into the reused buffer when its size is known,
+        // otherwise ONNX Runtime allocates it
+        binding.ClearBoundOutputs();
+        if (embeddingSize > 0)
         {
-            return result;
+            const auto outputLength = static_cast<size_t>(batchRows) * static_cast<size_t>(embeddingSize);
+            if (outputBuffer.size() < outputLength)
+                outputBuffer.resize(outputLength);
+            const std::array<int64_t, 2> outputShape{batchRows, embeddingSize};
+            Ort::Value outputTensor = Ort::Value::CreateTensor<float>(
+                m_memoryInfo,
+                outputBuffer.data(),
+                outputLength,
+                outputShape.data(),
+                outputShape.size()
+            );
+            binding.BindOutput(outputName.c_str(), outputTensor);
+        }
+        else
+        {
+            binding.BindOutput(outputName.c_str(), m_memoryInfo);
         }
         
-        // Quantization: float32 -> int16 -> float32 (as done in CLAP)
-        // This simulates the quantization process
-        std::vector<float> quantized(audio.size());
-        for (size_t i = 0; i < audio.size(); ++i)
+        session.Run(Ort::RunOptions{nullptr}, binding);
+        
+        std::vector<Ort::Value> allocated;
+        const float* outputData = outputBuffer.data();
+        auto rowSize = static_cast<size_t>(embeddingSize);
+        if (embeddingSize <= 0)
         {
-            // Clamp to [-1, 1] range
-            float clamped = std::max(-1.0f, std::min(1.0f, audio[i]));
-            
-            // Quantize to int16
-            int16_t quantizedInt = static_cast<int16_t>(clamped * 32767.0f);
-            
-            // Convert back to float32
-            quantized[i] = static_cast<float>(quantizedInt) / 32767.0f;
+            allocated = binding.GetOutputValues();
+            outputData = allocated[0].GetTensorData<float>();
+            rowSize = allocated[0].GetTensorTypeAndShapeInfo().GetElementCount() / static_cast<size_t>(batchRows);
         }
         
-        // Pad or truncate to target length
-        result.resize(targetLength, 0.0f);
+        // One normalised embedding per real row (padding rows are dropped)
+        std::vector<std::vector<float>> embeddings(static_cast<size_t>(numRows));
+        for (int row = 0; row < numRows; ++row)
+        {
+            const float* rowData = outputData + static_cast<size_t>(row) * rowSize;
+            embeddings[static_cast<size_t>(row)].assign(rowData, rowData + rowSize);
+            normalise(embeddings[static_cast<size_t>(row)]);
+        }
+        return embeddings;
+    }
+#endif
+    
+    bool ONNXModelManager::preprocessAudio(const float* audio, size_t numSamples, float* destination, int targetLength) const
+    {
+        const auto length = static_cast<size_t>(targetLength);
+        if (audio == nullptr || numSamples == 0)
+        {
+            std::fill(destination, destination + length, 0.0f);
+            return false;
+        }
         
-        if (quantized.size() >= targetLength)
+        // Quantization: float32 -> int16 -> float32 (as done in CLAP), written
+        // straight to the destination; truncates to targetLength
+        const size_t quantizedLength = std::min(numSamples, length);
+        for (size_t i = 0; i < quantizedLength; ++i)
         {
-            // Truncate: take first targetLength samples
-            std::copy(quantized.begin(), quantized.begin() + targetLength, result.begin());
+            // Clamp to [-1, 1] range
+            const float clamped = std::max(-1.0f, std::min(1.0f, audio[i]));
+            
+            // Quantize to int16 and back
+            destination[i] = static_cast<float>(static_cast<int16_t>(clamped * 32767.0f)) / 32767.0f;
         }
-        else
+        
+        // Pad: repeat the audio to fill targetLength
+        for (size_t pos = quantizedLength; pos < length; pos += quantizedLength)
         {
-            // Pad: repeat the audio to fill targetLength
-            size_t pos = 0;
-            while (pos < targetLength)
-            {
-                size_t toCopy = std::min(quantized.size(), targetLength - pos);
-                std::copy(quantized.begin(), quantized.begin() + toCopy, result.begin() + pos);
-                pos += toCopy;
-            }
+            const size_t toCopy = std::min(quantizedLength, length - pos);
+            std::copy(destination, destination + toCopy, destination + pos);
         }
         
-        return result;
+        return true;
     }
     
     void ONNXModelManager::tokenizeText(const juce::String& text, std::vector<int64_t>& inputIds, std::vector<float>& attentionMask)
@@ -3,6 +3,7 @@
 #include <juce_core/juce_core.h>
 #include <vector>
 #include <memory>
+#include <mutex>
 
 #if defined(HAVE_ONNXRUNTIME) && HAVE_ONNXRUNTIME == 1
 #include <onnxruntime_cxx_api.h>
@@ -15,23 +16,53 @@ namespace Unsound4All
     class ONNXModelManager
     {
     public:
+        static constexpr int kAudioLength = 480000; // 10 s at 48kHz
+        static constexpr int kTextLength = 77;      // Tokens per prompt
+        
+        enum class GraphOptimization
+        {
+            Disabled,
+            Basic,
+            Extended,
+            All
+        };
+        
+        // Applied to both sessions by initialize()
+        struct Options
+        {
+            int intraOpThreads{0};   // Threads inside one operator, 0 lets ONNX Runtime use every core
+            int interOpThreads{1};   // Operators run side by side (parallel execution when > 1)
+            GraphOptimization graphOptimization{GraphOptimization::All};
+            int maxBatchSize{8};     // Waveforms or prompts per Run() (unless the model fixes its batch size)
+        };
+        
         ONNXModelManager();
+        explicit ONNXModelManager(const Options& options);
         ~ONNXModelManager();
         
         // Initialize models from ONNX files
         bool initialize(const juce::File& audioModelPath, const juce::File& textModelPath);
         
-        // Get audio embedding from preprocessed waveform (480000 samples at 48kHz)
+        // Get audio embedding from a waveform at 48kHz (quantized, then padded
+        // by repetition or truncated to kAudioLength samples)
         std::vector<float> getAudioEmbedding(const std::vector<float>& waveform);
         
+        // One normalised embedding per waveform (numSamples each), computed
+        // maxBatchSize at a time; an entry is empty if its batch failed
+        std::vector<std::vector<float>> getAudioEmbeddings(const std::vector<const float*>& waveforms, int numSamples);
+        
         // Get text embedding from text string
         std::vector<float> getTextEmbedding(const juce::String& text);
         
+        // One normalised embedding per prompt, batched like getAudioEmbeddings()
+        std::vector<std::vector<float>> getTextEmbeddings(const juce::StringArray& texts);
+        
         // Check if models are loaded
         bool isInitialized() const { return m_initialized; }
         
     private:
         bool m_initialized{false};
+        Options m_options;
         
 #if defined(HAVE_ONNXRUNTIME) && HAVE_ONNXRUNTIME == 1
         Ort::Env m_env;
@@ -40,7 +71,13 @@ namespace Unsound4All
         std::unique_ptr<Ort::Session> m_textSession;
         Ort::AllocatorWithDefaultOptions m_allocator;
         
-        // Input/output names (stored as strings, converted to const char* when needed)
+        Ort::MemoryInfo m_memoryInfo{nullptr};
+        
+        // Bound once per session; each batch rebinds tensors over the buffers below
+        std::unique_ptr<Ort::IoBinding> m_audioBinding;
+        std::unique_ptr<Ort::IoBinding> m_textBinding;
+        
+        // Input/output names
         std::vector<std::string> m_audioInputNames;
         std::vector<std::string> m_audioOutputNames;
         std::vector<std::string> m_textInputNames;
@@ -50,10 +87,36 @@ namespace Unsound4All
         std::vector<int64_t> m_audioInputShape;
         std::vector<int64_t> m_textInputIdsShape;
         std::vector<int64_t> m_textAttentionMaskShape;
+        
+        // Rows per Run() when the model fixes its batch size (0 when it doesn't),
+        // and the embedding size when the model declares it (0 when it doesn't)
+        int m_audioFixedBatch{0};
+        int m_textFixedBatch{0};
+        int m_audioEmbeddingSize{0};
+        int m_textEmbeddingSize{0};
+        
+        // Reused between calls; each lock guards its session's buffers and binding
+        std::mutex m_audioMutex;
+        std::mutex m_textMutex;
+        std::vector<float> m_audioInput;
+        std::vector<float> m_audioOutput;
+        std::vector<int64_t> m_textInputIds;
+        std::vector<float> m_textAttentionMask;
+        std::vector<float> m_textOutput;
+        
+        // Runs one bound batch and copies out a normalised embedding per row
+        std::vector<std::vector<float>> runBatch(Ort::Session& session,
+                                                 Ort::IoBinding& binding,
+                                                 const std::string& outputName,
+                                                 std::vector<float>& outputBuffer,
+                                                 int embeddingSize,
+                                                 int batchRows,
+                                                 int numRows);
 #endif
         
-        // Audio preprocessing helper
-        std::vector<float> preprocessAudio(const std::vector<float>& audio, int targetLength = 480000, int targetSampleRate = 48000);
+        // Audio preprocessing helper: writes targetLength quantized samples to
+        // destination, returns false for empty audio (destination is zeroed)
+        bool preprocessAudio(const float* audio, size_t numSamples, float* destination, int targetLength = kAudioLength) const;
         
         // Text tokenization helper (RoBERTa)
         // Returns: input_ids (int64) and attention_mask (float32)
@@ -0,0 +1,364 @@
+#include "PaletteBuildPipeline.h"
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <flowerjuce/LooperEngine/AudioFileLoader.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+namespace Unsound4All
+{
+    namespace
+    {
+        // A chunk on its way from a decode thread to the feature stage
+        struct PendingChunk
+        {
+            int sourceIndex{0};
+            int chunkIndex{0};           // Position in its source, in chunks
+            int numSamples{0};           // Audio before the zero padding
+            std::vector<float> waveform; // One full chunk, mono at kSampleRate
+            juce::String path;           // Relative to the palette, empty if not written
+        };
+
+        // A chunk with its features, waiting to be put in source order
+        struct FinishedChunk
+        {
+            int sourceIndex{0};
+            int chunkIndex{0};
+            int numSamples{0};
+            juce::String path;
+            std::vector<float> features;
+        };
+
+        // FIFO of at most capacity items. push() blocks while it is full and
+        // fails once the queue is closed; pop() hands out what is left after
+        // close() and then reports Finished.
+        template <typename T>
+        class BoundedQueue
+        {
+        public:
+            enum class PopResult { Item, TimedOut, Finished };
+
+            explicit BoundedQueue(size_t capacity) : m_capacity(juce::jmax<size_t>(1, capacity)) {}
+
+            bool push(T&& item)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_notFull.wait(lock, [this] { return m_closed || m_items.size() < m_capacity; });
+                if (m_closed)
+                    return false;
+                m_items.push_back(std::move(item));
+                m_notEmpty.notify_one();
+                return true;
+            }
+
+            PopResult pop(T& item, int timeoutMs)
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if (!m_notEmpty.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return m_closed || !m_items.empty(); }))
+                    return PopResult::TimedOut;
+                if (m_items.empty())
+                    return PopResult::Finished;
+                item = std::move(m_items.front());
+                m_items.pop_front();
+                m_notFull.notify_one();
+                return PopResult::Item;
+            }
+
+            void close()
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_closed = true;
+                m_notFull.notify_all();
+                m_notEmpty.notify_all();
+            }
+
+        private:
+            const size_t m_capacity;
+            std::mutex m_mutex;
+            std::condition_variable m_notFull;
+            std::condition_variable m_notEmpty;
+            std::deque<T> m_items;
+            bool m_closed{false};
+        };
+
+        // Eight independent sums so the loop vectorises without reassociation
+        float getRms(const float* samples, int numSamples)
+        {
+            float lanes[8] = {};
+            int i = 0;
+            for (; i + 8 <= numSamples; i += 8)
+                for (int lane = 0; lane < 8; ++lane)
+                    lanes[lane] += samples[i + lane] * samples[i + lane];
+            float sum = 0.0f;
+            for (float lane : lanes)
+                sum += lane;
+            for (; i < numSamples; ++i)
+                sum += samples[i] * samples[i];
+            return numSamples > 0 ? std::sqrt(sum / static_cast<float>(numSamples)) : 0.0f;
+        }
+
+        // Linear interpolation, as palettes have always been converted (so
+        // embeddings stay comparable with older palettes); on raw pointers,
+        // each output position computed directly so nothing drifts
+        std::vector<float> resampleLinear(const float* input, size_t inputLength, double sourceRate, double targetRate)
+        {
+            const double step = sourceRate / targetRate;
+            const auto outputLength = static_cast<size_t>(static_cast<double>(inputLength) * targetRate / sourceRate);
+            std::vector<float> output(outputLength);
+            if (inputLength == 0)
+                return output;
+
+            // Every output whose right-hand neighbour is still inside the input
+            const auto interpolated = juce::jmin(outputLength, static_cast<size_t>(static_cast<double>(inputLength - 1) / step));
+            for (size_t i = 0; i < interpolated; ++i)
+            {
+                const double position = static_cast<double>(i) * step;
+                const auto index = static_cast<size_t>(position);
+                const auto frac = static_cast<float>(position - static_cast<double>(index));
+                output[i] = input[index] + frac * (input[index + 1] - input[index]);
+            }
+            for (size_t i = interpolated; i < outputLength; ++i)
+                output[i] = input[juce::jmin(inputLength - 1, static_cast<size_t>(static_cast<double>(i) * step))];
+            return output;
+        }
+
+        bool writeChunkFile(const juce::File& chunkFile, std::vector<float>& waveform)
+        {
+            juce::WavAudioFormat wavFormat;
+            juce::AudioFormatWriterOptions options;
+            options = options.withSampleRate(PaletteBuildPipeline::kSampleRate)
+                          .withNumChannels(1) // mono
+                          .withBitsPerSample(16); // 16-bit
+
+            std::unique_ptr<juce::OutputStream> outputStream = std::make_unique<juce::FileOutputStream>(chunkFile);
+            std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(outputStream, options));
+            if (writer == nullptr)
+                return false;
+
+            float* channels[] = { waveform.data() };
+            const juce::AudioBuffer<float> buffer(channels, 1, static_cast<int>(waveform.size()));
+            return writer->writeFromAudioSampleBuffer(buffer, 0, buffer.getNumSamples());
+        }
+    }
+
+    PaletteBuildPipeline::Result PaletteBuildPipeline::run(
+        const juce::Array<juce::File>& audioFiles,
+        const juce::File& paletteDir,
+        const Options& options,
+        const FeatureFunction& features,
+        const std::function<void(const juce::String&)>& progressCallback,
+        const std::function<bool()>& shouldCancel)
+    {
+        const auto startTime = std::chrono::steady_clock::now();
+        Result result;
+        result.stats.numFiles = audioFiles.size();
+
+        const int chunkSizeSamples = static_cast<int>(options.chunkSizeSeconds * kSampleRate);
+        const int batchSize = juce::jmax(1, options.batchSize);
+        const int numDecodeThreads = options.numDecodeThreads > 0 ? options.numDecodeThreads
+                                                                  : juce::jmax(1, juce::SystemStats::getNumCpus() - 1);
+        if (audioFiles.isEmpty() || chunkSizeSamples <= 0 || features == nullptr)
+            return result;
+
+        BoundedQueue<PendingChunk> queue(static_cast<size_t>(options.maxQueuedChunks));
+        std::atomic<bool> cancelled{false};
+        std::atomic<int> remainingFiles{audioFiles.size()};
+        std::atomic<int> failedFiles{0};
+        std::atomic<int> silentChunks{0};
+
+        // Decode stage: one job per file, numDecodeThreads at a time
+        juce::ThreadPool pool(juce::ThreadPoolOptions{}.withThreadName("PaletteDecode")
+                                                       .withNumberOfThreads(numDecodeThreads));
+        for (int sourceIndex = 0; sourceIndex < audioFiles.size(); ++sourceIndex)
+        {
+            pool.addJob([&, sourceIndex]
+            {
+                const auto& audioFile = audioFiles.getReference(sourceIndex);
+                auto decodeFile = [&]
+                {
+                    juce::AudioFormatManager formatManager;
+                    formatManager.registerBasicFormats();
+                    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(audioFile));
+                    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+                    {
+                        DBG("PaletteBuildPipeline: Could not create reader for file: " + audioFile.getFullPathName());
+                        ++failedFiles;
+                        return;
+                    }
+
+                    // Whole file, downmixed to mono (vectorised) at its own rate
+                    AudioFileLoader::Request request;
+                    const double sourceRate = reader->sampleRate;
+                    const auto length = static_cast<size_t>(reader->lengthInSamples);
+                    request.reader = std::move(reader);
+                    request.target_sample_rate = sourceRate;
+                    request.max_length = length;
+                    request.capacity = length;
+                    request.num_channels = 1;
+                    auto decoded = AudioFileLoader::decode(request, [&cancelled] { return cancelled.load(); });
+                    if (!decoded.ok)
+                    {
+                        DBG("PaletteBuildPipeline: Failed to decode " + audioFile.getFullPathName() + ": " + decoded.error);
+                        if (!cancelled.load())
+                            ++failedFiles;
+                        return;
+                    }
+
+                    auto& mono = decoded.channels[0];
+                    mono.resize(decoded.length);
+                    if (std::abs(sourceRate - kSampleRate) > 1.0)
+                        mono = resampleLinear(mono.data(), mono.size(), sourceRate, kSampleRate);
+
+                    // In-memory chunker
+                    const float* audio = mono.data();
+                    const int numSamples = static_cast<int>(mono.size());
+                    const juce::String baseName = audioFile.getFileNameWithoutExtension();
+                    for (int chunkIndex = 0; chunkIndex * chunkSizeSamples < numSamples; ++chunkIndex)
+                    {
+                        const int startSample = chunkIndex * chunkSizeSamples;
+                        const int numSamplesInChunk = juce::jmin(chunkSizeSamples, numSamples - startSample);
+                        if (getRms(audio + startSample, numSamplesInChunk) < options.silenceThreshold)
+                        {
+                            ++silentChunks;
+                            continue;
+                        }
+
+                        PendingChunk chunk;
+                        chunk.sourceIndex = sourceIndex;
+                        chunk.chunkIndex = chunkIndex;
+                        chunk.numSamples = numSamplesInChunk;
+                        chunk.waveform.resize(static_cast<size_t>(chunkSizeSamples), 0.0f);
+                        juce::FloatVectorOperations::copy(chunk.waveform.data(), audio + startSample, numSamplesInChunk);
+
+                        if (options.writeChunkFiles)
+                        {
+                            const juce::String chunkFileName = baseName + "_chunk" + juce::String(chunkIndex).paddedLeft('0', 4) + ".wav";
+                            if (writeChunkFile(paletteDir.getChildFile(chunkFileName), chunk.waveform))
+                            {
+                                chunk.path = chunkFileName;
+                            }
+                            else
+                            {
+                                DBG("PaletteBuildPipeline: Failed to write chunk: " + chunkFileName);
+                            }
+                        }
+
+                        if (!queue.push(std::move(chunk)))
+                            return; // Cancelled
+                    }
+                };
+
+                decodeFile();
+                if (--remainingFiles == 0)
+                    queue.close();
+            });
+        }
+
+        // Feature stage, on this thread
+        std::vector<FinishedChunk> finished;
+        std::vector<PendingChunk> batch;
+        std::vector<const float*> waveforms;
+        int featureSize = 0;
+        int failedChunks = 0;
+
+        auto runBatch = [&]
+        {
+            waveforms.clear();
+            for (const auto& chunk : batch)
+                waveforms.push_back(chunk.waveform.data());
+            auto batchFeatures = features(waveforms, chunkSizeSamples);
+
+            for (size_t i = 0; i < batch.size(); ++i)
+            {
+                auto* chunkFeatures = i < batchFeatures.size() ? &batchFeatures[i] : nullptr;
+                if (chunkFeatures != nullptr && featureSize == 0)
+                    featureSize = static_cast<int>(chunkFeatures->size());
+                if (chunkFeatures == nullptr || chunkFeatures->empty() || static_cast<int>(chunkFeatures->size()) != featureSize)
+                {
+                    DBG("PaletteBuildPipeline: No features for chunk " + juce::String(batch[i].chunkIndex)
+                        + " of " + audioFiles[batch[i].sourceIndex].getFileName());
+                    ++failedChunks;
+                    continue;
+                }
+                finished.push_back({ batch[i].sourceIndex, batch[i].chunkIndex, batch[i].numSamples,
+                                     batch[i].path, std::move(*chunkFeatures) });
+            }
+            batch.clear();
+
+            if (progressCallback)
+                progressCallback("Processed " + juce::String(finished.size() + static_cast<size_t>(failedChunks)) + " chunks ("
+                                 + juce::String(audioFiles.size() - remainingFiles.load()) + "/" + juce::String(audioFiles.size()) + " files decoded)");
+        };
+
+        for (;;)
+        {
+            if (shouldCancel != nullptr && shouldCancel())
+            {
+                DBG("PaletteBuildPipeline: Cancelled");
+                cancelled = true;
+                queue.close();
+                pool.removeAllJobs(true, -1);
+                return result;
+            }
+
+            PendingChunk chunk;
+            const auto popped = queue.pop(chunk, 50);
+            if (popped == BoundedQueue<PendingChunk>::PopResult::Item)
+            {
+                batch.push_back(std::move(chunk));
+                if (static_cast<int>(batch.size()) >= batchSize)
+                    runBatch();
+            }
+            else if (popped == BoundedQueue<PendingChunk>::PopResult::Finished)
+            {
+                if (!batch.empty())
+                    runBatch();
+                break;
+            }
+        }
+
+        // Decode threads finish as they close the queue; this only joins them
+        pool.removeAllJobs(false, -1);
+
+        // Contents in source order, whichever thread got there first
+        std::sort(finished.begin(), finished.end(), [](const FinishedChunk& a, const FinishedChunk& b)
+        {
+            return a.sourceIndex != b.sourceIndex ? a.sourceIndex < b.sourceIndex : a.chunkIndex < b.chunkIndex;
+        });
+
+        auto& contents = result.contents;
+        contents.embeddingSize = featureSize;
+        contents.embeddings.reserve(finished.size() * static_cast<size_t>(featureSize));
+        contents.chunkSources.reserve(finished.size());
+        contents.chunkRanges.reserve(2 * finished.size());
+        int lastSource = -1;
+        for (const auto& chunk : finished)
+        {
+            // Only sources that produced chunks are listed
+            if (chunk.sourceIndex != lastSource)
+            {
+                contents.sourceFiles.add(audioFiles[chunk.sourceIndex].getFullPathName());
+                lastSource = chunk.sourceIndex;
+            }
+            contents.chunkPaths.add(chunk.path);
+            contents.chunkSources.push_back(contents.sourceFiles.size() - 1);
+            contents.chunkRanges.push_back(chunk.chunkIndex * static_cast<double>(options.chunkSizeSeconds));
+            contents.chunkRanges.push_back(chunk.numSamples / kSampleRate);
+            contents.embeddings.insert(contents.embeddings.end(), chunk.features.begin(), chunk.features.end());
+        }
+
+        result.stats.failedFiles = failedFiles.load();
+        result.stats.silentChunks = silentChunks.load();
+        result.stats.failedChunks = failedChunks;
+        result.stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        result.ok = contents.getNumChunks() > 0;
+
+        DBG("PaletteBuildPipeline: " + juce::String(contents.getNumChunks()) + " chunks from " + juce::String(contents.sourceFiles.size())
+            + "/" + juce::String(audioFiles.size()) + " files in " + juce::String(result.stats.seconds, 2) + " s ("
+            + juce::String(result.stats.silentChunks) + " silent, " + juce::String(failedChunks) + " failed)");
+        return result;
+    }
+}
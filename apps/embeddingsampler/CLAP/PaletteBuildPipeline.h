@@ -0,0 +1,69 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "PaletteFile.h"
+#include <functional>
+#include <vector>
+
+namespace Unsound4All
+{
+    // Turns audio files into a palette's contents in stages that overlap:
+    //
+    //   decode threads   read each file and downmix it (AudioFileLoader::decode),
+    //                    convert it to kSampleRate, cut it into chunks in
+    //                    memory, skip silent ones and optionally write each
+    //                    chunk as a WAV
+    //   bounded queue    at most maxQueuedChunks chunks wait here, so decoding
+    //                    stays just ahead of feature extraction
+    //   feature stage    the thread that called run() takes batchSize chunks
+    //                    at a time and hands them to the FeatureFunction
+    //   contents         chunks are put back in source order and collected
+    //                    into PaletteFile::Contents, with each chunk's range
+    //                    in its source
+    //
+    // Without chunk WAVs a palette's chunks play from their source files.
+    class PaletteBuildPipeline
+    {
+    public:
+        static constexpr double kSampleRate = 48000.0; // Chunks are mono at CLAP's rate
+
+        struct Options
+        {
+            int chunkSizeSeconds{10};
+            int numDecodeThreads{0};         // 0 picks one per core, less one for the feature stage
+            int maxQueuedChunks{32};         // Decoded chunks waiting for features (bounds memory)
+            int batchSize{8};                // Chunks per FeatureFunction call
+            float silenceThreshold{0.001f};  // Chunks with a lower RMS (-60 dB) are skipped
+            bool writeChunkFiles{true};      // Also write every chunk to the palette as a WAV
+        };
+
+        // One feature vector per waveform (numSamples each), empty for a chunk
+        // that failed. Called on run()'s thread, one batch at a time.
+        using FeatureFunction = std::function<std::vector<std::vector<float>>(const std::vector<const float*>& waveforms, int numSamples)>;
+
+        struct Stats
+        {
+            int numFiles{0};
+            int failedFiles{0};   // Could not be opened or decoded
+            int silentChunks{0};
+            int failedChunks{0};  // No features, or features of the wrong size
+            double seconds{0.0};  // Wall time of run()
+        };
+
+        struct Result
+        {
+            bool ok{false};                 // False if cancelled or nothing was chunked
+            PaletteFile::Contents contents; // embeddingType is left for the caller
+            Stats stats;
+        };
+
+        // Non-realtime; blocks until every file is through (or shouldCancel
+        // returns true, which is checked between chunks)
+        static Result run(const juce::Array<juce::File>& audioFiles,
+                          const juce::File& paletteDir,
+                          const Options& options,
+                          const FeatureFunction& features,
+                          const std::function<void(const juce::String&)>& progressCallback = nullptr,
+                          const std::function<bool()>& shouldCancel = nullptr);
+    };
+}
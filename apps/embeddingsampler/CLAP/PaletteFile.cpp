@@ -0,0 +1,462 @@
+#include "PaletteFile.h"
+#include <cstring>
+#include <map>
+
+namespace Unsound4All
+{
+    namespace
+    {
+        constexpr juce::uint64 kSectionAlignment = 64;
+
+        enum SectionId : juce::uint32
+        {
+            kEmbeddingsSection = 1,
+            kCoordinatesSection,
+            kClustersSection,
+            kChunkSourcesSection,
+            kChunkPathsSection,
+            kSourcePathsSection,
+            kStringOffsetsSection,
+            kStringDataSection,
+            kChunkRangesSection
+        };
+
+        struct Header
+        {
+            juce::uint32 magic;
+            juce::uint32 version;
+            juce::uint32 headerSize;
+            juce::uint32 numSections;
+            juce::int32 numChunks;
+            juce::int32 embeddingSize;
+            juce::int32 numSources;
+            juce::uint32 numStrings;
+            juce::uint32 embeddingTypeString;
+            juce::uint32 reserved0;
+            juce::uint64 sectionTableOffset;
+            juce::uint8 reserved[16];
+        };
+        static_assert(sizeof(Header) == 64, "palette.bin header is fixed at 64 bytes");
+
+        struct SectionEntry
+        {
+            juce::uint32 id;
+            juce::uint32 reserved;
+            juce::uint64 offset; // From the start of the file, kSectionAlignment aligned
+            juce::uint64 size;   // Bytes
+        };
+        static_assert(sizeof(SectionEntry) == 24, "palette.bin section entries are 24 bytes");
+
+        juce::uint64 alignUp(juce::uint64 value)
+        {
+            return (value + kSectionAlignment - 1) / kSectionAlignment * kSectionAlignment;
+        }
+
+        // Strings for the string table, each stored once
+        struct StringTable
+        {
+            juce::uint32 intern(const juce::String& text)
+            {
+                const auto inserted = ids.emplace(text, static_cast<juce::uint32>(offsets.size()));
+                if (inserted.second)
+                {
+                    offsets.push_back(static_cast<juce::uint32>(data.getSize()));
+                    const char* utf8 = text.toRawUTF8();
+                    data.append(utf8, std::strlen(utf8) + 1);
+                }
+                return inserted.first->second;
+            }
+
+            std::map<juce::String, juce::uint32> ids;
+            std::vector<juce::uint32> offsets;
+            juce::MemoryBlock data;
+        };
+    }
+
+    bool PaletteFile::write(const juce::File& paletteDir, const Contents& contents)
+    {
+        const int numChunks = contents.getNumChunks();
+        const auto chunks = static_cast<size_t>(numChunks);
+        if (numChunks <= 0 || contents.embeddingSize <= 0
+            || contents.embeddings.size() != chunks * static_cast<size_t>(contents.embeddingSize)
+            || contents.chunkSources.size() != chunks
+            || (!contents.coordinates.empty() && contents.coordinates.size() != 2 * chunks)
+            || (!contents.clusters.empty() && contents.clusters.size() != chunks)
+            || (!contents.chunkRanges.empty() && contents.chunkRanges.size() != 2 * chunks))
+        {
+            DBG("PaletteFile: Inconsistent palette contents for " + paletteDir.getFullPathName());
+            return false;
+        }
+
+        for (int source : contents.chunkSources)
+        {
+            if (source < -1 || source >= contents.sourceFiles.size())
+            {
+                DBG("PaletteFile: Chunk source index " + juce::String(source) + " out of range");
+                return false;
+            }
+        }
+
+        StringTable strings;
+        const juce::uint32 embeddingTypeString = strings.intern(contents.embeddingType);
+        std::vector<juce::uint32> chunkPaths;
+        chunkPaths.reserve(chunks);
+        for (const auto& path : contents.chunkPaths)
+            chunkPaths.push_back(strings.intern(path));
+        std::vector<juce::uint32> sourcePaths;
+        sourcePaths.reserve(static_cast<size_t>(contents.sourceFiles.size()));
+        for (const auto& path : contents.sourceFiles)
+            sourcePaths.push_back(strings.intern(path));
+
+        struct PendingSection
+        {
+            juce::uint32 id;
+            const void* data;
+            size_t size;
+        };
+
+        std::vector<PendingSection> pending;
+        pending.push_back({ kEmbeddingsSection, contents.embeddings.data(), contents.embeddings.size() * sizeof(float) });
+        if (!contents.coordinates.empty())
+            pending.push_back({ kCoordinatesSection, contents.coordinates.data(), contents.coordinates.size() * sizeof(float) });
+        if (!contents.clusters.empty())
+            pending.push_back({ kClustersSection, contents.clusters.data(), contents.clusters.size() * sizeof(int) });
+        pending.push_back({ kChunkSourcesSection, contents.chunkSources.data(), contents.chunkSources.size() * sizeof(int) });
+        if (!contents.chunkRanges.empty())
+            pending.push_back({ kChunkRangesSection, contents.chunkRanges.data(), contents.chunkRanges.size() * sizeof(double) });
+        pending.push_back({ kChunkPathsSection, chunkPaths.data(), chunkPaths.size() * sizeof(juce::uint32) });
+        pending.push_back({ kSourcePathsSection, sourcePaths.data(), sourcePaths.size() * sizeof(juce::uint32) });
+        pending.push_back({ kStringOffsetsSection, strings.offsets.data(), strings.offsets.size() * sizeof(juce::uint32) });
+        pending.push_back({ kStringDataSection, strings.data.getData(), strings.data.getSize() });
+
+        Header header{};
+        header.magic = kMagic;
+        header.version = kVersion;
+        header.headerSize = sizeof(Header);
+        header.numSections = static_cast<juce::uint32>(pending.size());
+        header.numChunks = numChunks;
+        header.embeddingSize = contents.embeddingSize;
+        header.numSources = contents.sourceFiles.size();
+        header.numStrings = static_cast<juce::uint32>(strings.offsets.size());
+        header.embeddingTypeString = embeddingTypeString;
+        header.sectionTableOffset = sizeof(Header);
+
+        std::vector<SectionEntry> table;
+        juce::uint64 offset = alignUp(sizeof(Header) + pending.size() * sizeof(SectionEntry));
+        for (const auto& section : pending)
+        {
+            table.push_back({ section.id, 0, offset, section.size });
+            offset = alignUp(offset + section.size);
+        }
+
+        // Written beside the target and moved over it, so readers never see half a file
+        const auto target = paletteDir.getChildFile(kFileName);
+        juce::TemporaryFile temporaryFile(target);
+        {
+            juce::FileOutputStream stream(temporaryFile.getFile());
+            if (!stream.openedOk())
+            {
+                DBG("PaletteFile: Failed to create " + temporaryFile.getFile().getFullPathName());
+                return false;
+            }
+
+            stream.write(&header, sizeof(header));
+            stream.write(table.data(), table.size() * sizeof(SectionEntry));
+            for (size_t i = 0; i < pending.size(); ++i)
+            {
+                stream.writeRepeatedByte(0, static_cast<size_t>(table[i].offset) - static_cast<size_t>(stream.getPosition()));
+                stream.write(pending[i].data, pending[i].size);
+            }
+            stream.flush();
+
+            if (stream.getStatus().failed())
+            {
+                DBG("PaletteFile: Write failed: " + stream.getStatus().getErrorMessage());
+                return false;
+            }
+        }
+
+        if (!temporaryFile.overwriteTargetFileWithTemporary())
+        {
+            DBG("PaletteFile: Failed to replace " + target.getFullPathName());
+            return false;
+        }
+
+        DBG("PaletteFile: Wrote " + juce::String(numChunks) + " chunks, " + juce::String(strings.offsets.size())
+            + " strings to " + target.getFullPathName());
+        return true;
+    }
+
+    std::shared_ptr<const PaletteFile> PaletteFile::open(const juce::File& paletteDir)
+    {
+        if (!paletteDir.getChildFile(kFileName).existsAsFile())
+        {
+            if (!hasLegacyFiles(paletteDir))
+                return nullptr;
+
+            DBG("PaletteFile: Migrating legacy palette " + paletteDir.getFullPathName());
+            if (!migrate(paletteDir))
+                return nullptr;
+        }
+
+        std::shared_ptr<PaletteFile> palette(new PaletteFile());
+        palette->m_paletteDir = paletteDir;
+        if (!palette->mapAndValidate())
+            return nullptr;
+        return palette;
+    }
+
+    bool PaletteFile::mapAndValidate()
+    {
+        const auto file = getFile();
+        m_mapping = std::make_unique<juce::MemoryMappedFile>(file, juce::MemoryMappedFile::readOnly);
+        const auto* base = static_cast<const char*>(m_mapping->getData());
+        const auto fileSize = static_cast<juce::uint64>(m_mapping->getSize());
+        if (base == nullptr || fileSize < sizeof(Header))
+        {
+            DBG("PaletteFile: Failed to map " + file.getFullPathName());
+            return false;
+        }
+
+        Header header;
+        std::memcpy(&header, base, sizeof(header));
+        if (header.magic != kMagic)
+        {
+            DBG("PaletteFile: Not a palette file: " + file.getFullPathName());
+            return false;
+        }
+        if (header.version != kVersion)
+        {
+            DBG("PaletteFile: Unsupported palette version " + juce::String(header.version) + " in " + file.getFullPathName());
+            return false;
+        }
+
+        const juce::uint64 tableEnd = header.sectionTableOffset + static_cast<juce::uint64>(header.numSections) * sizeof(SectionEntry);
+        if (header.headerSize < sizeof(Header) || header.numChunks <= 0 || header.embeddingSize <= 0
+            || header.numSources < 0 || header.numStrings == 0 || header.embeddingTypeString >= header.numStrings
+            || header.sectionTableOffset < header.headerSize || header.sectionTableOffset % alignof(SectionEntry) != 0
+            || tableEnd > fileSize)
+        {
+            DBG("PaletteFile: Bad header in " + file.getFullPathName());
+            return false;
+        }
+
+        m_numChunks = header.numChunks;
+        m_embeddingSize = header.embeddingSize;
+        m_numSources = header.numSources;
+        m_numStrings = static_cast<int>(header.numStrings);
+        m_embeddingTypeString = header.embeddingTypeString;
+
+        const auto* table = reinterpret_cast<const SectionEntry*>(base + header.sectionTableOffset);
+        bool valid = true;
+
+        // Section of exactly expectedSize bytes, or nullptr when it is absent
+        // (which makes the file invalid unless the section is optional)
+        auto findSection = [&](juce::uint32 id, juce::uint64 expectedSize, bool required, juce::uint64* actualSize = nullptr) -> const char*
+        {
+            for (juce::uint32 i = 0; i < header.numSections; ++i)
+            {
+                const auto& entry = table[i];
+                if (entry.id != id)
+                    continue;
+
+                const bool sizeMatches = actualSize != nullptr ? entry.size > 0 : entry.size == expectedSize;
+                if (entry.offset % kSectionAlignment != 0 || entry.offset > fileSize
+                    || entry.size > fileSize - entry.offset || !sizeMatches)
+                {
+                    DBG("PaletteFile: Bad section " + juce::String(id) + " in " + file.getFullPathName());
+                    valid = false;
+                    return nullptr;
+                }
+                if (actualSize != nullptr)
+                    *actualSize = entry.size;
+                return base + entry.offset;
+            }
+
+            if (required)
+            {
+                DBG("PaletteFile: Missing section " + juce::String(id) + " in " + file.getFullPathName());
+                valid = false;
+            }
+            return nullptr;
+        };
+
+        const auto chunks = static_cast<juce::uint64>(m_numChunks);
+        juce::uint64 stringDataSize = 0;
+        m_embeddings = reinterpret_cast<const float*>(findSection(kEmbeddingsSection, chunks * static_cast<juce::uint64>(m_embeddingSize) * sizeof(float), true));
+        m_coordinates = reinterpret_cast<const float*>(findSection(kCoordinatesSection, chunks * 2 * sizeof(float), false));
+        m_clusters = reinterpret_cast<const int32_t*>(findSection(kClustersSection, chunks * sizeof(int32_t), false));
+        m_chunkSources = reinterpret_cast<const int32_t*>(findSection(kChunkSourcesSection, chunks * sizeof(int32_t), true));
+        m_chunkRanges = reinterpret_cast<const double*>(findSection(kChunkRangesSection, chunks * 2 * sizeof(double), false));
+        m_chunkPaths = reinterpret_cast<const juce::uint32*>(findSection(kChunkPathsSection, chunks * sizeof(juce::uint32), true));
+        m_sourcePaths = reinterpret_cast<const juce::uint32*>(findSection(kSourcePathsSection, static_cast<juce::uint64>(m_numSources) * sizeof(juce::uint32), m_numSources > 0));
+        m_stringOffsets = reinterpret_cast<const juce::uint32*>(findSection(kStringOffsetsSection, static_cast<juce::uint64>(m_numStrings) * sizeof(juce::uint32), true));
+        m_stringData = findSection(kStringDataSection, 0, true, &stringDataSize);
+        if (!valid)
+            return false;
+
+        // Every index the accessors follow must land inside the file
+        if (m_stringData[stringDataSize - 1] != '\0')
+            valid = false;
+        for (int i = 0; valid && i < m_numStrings; ++i)
+            valid = m_stringOffsets[i] < stringDataSize;
+        for (int i = 0; valid && i < m_numChunks; ++i)
+            valid = m_chunkPaths[i] < header.numStrings && m_chunkSources[i] >= -1 && m_chunkSources[i] < m_numSources;
+        for (int i = 0; valid && i < m_numSources; ++i)
+            valid = m_sourcePaths[i] < header.numStrings;
+        if (!valid)
+        {
+            DBG("PaletteFile: Corrupt string or source references in " + file.getFullPathName());
+            return false;
+        }
+        return true;
+    }
+
+    juce::Range<double> PaletteFile::getChunkRange(int chunk) const
+    {
+        if (m_chunkRanges == nullptr)
+            return {};
+        const double start = m_chunkRanges[2 * static_cast<size_t>(chunk)];
+        return { start, start + m_chunkRanges[2 * static_cast<size_t>(chunk) + 1] };
+    }
+
+    juce::File PaletteFile::getChunkFile(int chunk) const
+    {
+        const auto path = getChunkPath(chunk);
+        if (path.isEmpty())
+            return {};
+        return m_paletteDir.getChildFile(juce::String(path));
+    }
+
+    juce::File PaletteFile::getSourceFile(int chunk) const
+    {
+        const int source = getChunkSource(chunk);
+        if (source < 0)
+            return {};
+        return juce::File(juce::String(getSourcePath(source)));
+    }
+
+    PaletteFile::Contents PaletteFile::readContents() const
+    {
+        Contents contents;
+        contents.embeddingSize = m_embeddingSize;
+        contents.embeddings.assign(m_embeddings, m_embeddings + static_cast<size_t>(m_numChunks) * static_cast<size_t>(m_embeddingSize));
+        contents.embeddingType = juce::String(getEmbeddingType());
+        contents.chunkSources.assign(m_chunkSources, m_chunkSources + m_numChunks);
+        contents.chunkPaths.ensureStorageAllocated(m_numChunks);
+        for (int chunk = 0; chunk < m_numChunks; ++chunk)
+            contents.chunkPaths.add(juce::String(getChunkPath(chunk)));
+        for (int source = 0; source < m_numSources; ++source)
+            contents.sourceFiles.add(juce::String(getSourcePath(source)));
+        if (m_coordinates != nullptr)
+            contents.coordinates.assign(m_coordinates, m_coordinates + 2 * static_cast<size_t>(m_numChunks));
+        if (m_clusters != nullptr)
+            contents.clusters.assign(m_clusters, m_clusters + m_numChunks);
+        if (m_chunkRanges != nullptr)
+            contents.chunkRanges.assign(m_chunkRanges, m_chunkRanges + 2 * static_cast<size_t>(m_numChunks));
+        return contents;
+    }
+
+    bool PaletteFile::writeVisualization(const juce::File& paletteDir,
+                                         const std::vector<float>& coordinates,
+                                         const std::vector<int>& clusters)
+    {
+        Contents contents;
+        {
+            // Released before the rewrite, so the file is not replaced while mapped here
+            auto palette = open(paletteDir);
+            if (palette == nullptr)
+                return false;
+            contents = palette->readContents();
+        }
+
+        contents.coordinates = coordinates;
+        contents.clusters = clusters;
+        return write(paletteDir, contents);
+    }
+
+    bool PaletteFile::hasLegacyFiles(const juce::File& paletteDir)
+    {
+        return paletteDir.getChildFile("metadata.json").existsAsFile()
+            && paletteDir.getChildFile("embeddings.bin").existsAsFile();
+    }
+
+    bool PaletteFile::migrate(const juce::File& paletteDir)
+    {
+        juce::var metadata = juce::JSON::parse(paletteDir.getChildFile("metadata.json"));
+        auto chunksVar = metadata.getProperty("chunks", juce::var());
+        if (!metadata.isObject() || !chunksVar.isArray())
+        {
+            DBG("PaletteFile: Unreadable metadata.json in " + paletteDir.getFullPathName());
+            return false;
+        }
+
+        // embeddings.bin: num_embeddings (int32), embedding_size (int32), then the rows
+        juce::FileInputStream embeddingsStream(paletteDir.getChildFile("embeddings.bin"));
+        int32_t numEmbeddings = 0;
+        int32_t embeddingSize = 0;
+        if (!embeddingsStream.openedOk()
+            || embeddingsStream.read(&numEmbeddings, sizeof(int32_t)) != sizeof(int32_t)
+            || embeddingsStream.read(&embeddingSize, sizeof(int32_t)) != sizeof(int32_t)
+            || numEmbeddings <= 0 || embeddingSize <= 0)
+        {
+            DBG("PaletteFile: Unreadable embeddings.bin in " + paletteDir.getFullPathName());
+            return false;
+        }
+
+        Contents contents;
+        contents.embeddingSize = embeddingSize;
+        contents.embeddings.resize(static_cast<size_t>(numEmbeddings) * static_cast<size_t>(embeddingSize));
+        const auto embeddingBytes = static_cast<juce::int64>(contents.embeddings.size() * sizeof(float));
+        if (embeddingsStream.getNumBytesRemaining() < embeddingBytes
+            || embeddingsStream.read(contents.embeddings.data(), static_cast<int>(embeddingBytes)) != static_cast<int>(embeddingBytes))
+        {
+            DBG("PaletteFile: Truncated embeddings.bin in " + paletteDir.getFullPathName());
+            return false;
+        }
+
+        for (const auto& chunkInfo : *chunksVar.getArray())
+        {
+            // Older palettes only recorded the file name, which sits at the palette root
+            auto path = chunkInfo.getProperty("path", juce::var()).toString();
+            if (path.isEmpty())
+                path = chunkInfo.getProperty("filename", juce::var()).toString();
+            contents.chunkPaths.add(path);
+            contents.chunkSources.push_back(static_cast<int>(chunkInfo.getProperty("sourceFileIndex", -1)));
+        }
+
+        if (auto* sourceFiles = metadata.getProperty("sourceFiles", juce::var()).getArray())
+            for (const auto& sourceFile : *sourceFiles)
+                contents.sourceFiles.add(sourceFile.toString());
+        for (auto& source : contents.chunkSources)
+            if (source >= contents.sourceFiles.size())
+                source = -1;
+
+        contents.embeddingType = metadata.getProperty("embeddingType", "CLAP").toString();
+
+        if (contents.getNumChunks() != numEmbeddings)
+        {
+            DBG("PaletteFile: metadata.json lists " + juce::String(contents.getNumChunks()) + " chunks for "
+                + juce::String(numEmbeddings) + " embeddings in " + paletteDir.getFullPathName());
+            return false;
+        }
+
+        // t-SNE results, when present and complete
+        auto* coordinates = metadata.getProperty("tsneCoordinates", juce::var()).getArray();
+        auto* clusters = metadata.getProperty("clusterAssignments", juce::var()).getArray();
+        if (coordinates != nullptr && clusters != nullptr
+            && coordinates->size() == numEmbeddings && clusters->size() == numEmbeddings)
+        {
+            contents.coordinates.reserve(2 * static_cast<size_t>(numEmbeddings));
+            for (const auto& point : *coordinates)
+            {
+                contents.coordinates.push_back(point.size() >= 2 ? static_cast<float>(static_cast<double>(point[0])) : 0.0f);
+                contents.coordinates.push_back(point.size() >= 2 ? static_cast<float>(static_cast<double>(point[1])) : 0.0f);
+            }
+            for (const auto& cluster : *clusters)
+                contents.clusters.push_back(static_cast<int>(cluster));
+        }
+
+        return write(paletteDir, contents);
+    }
+}
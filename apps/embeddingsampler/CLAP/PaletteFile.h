@@ -0,0 +1,129 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <memory>
+#include <vector>
+
+namespace Unsound4All
+{
+    // A sound palette's data in one versioned binary file (palette.bin)
+    //
+    // Layout, little-endian, every section starting on a 64-byte boundary:
+    //   Header        fixed 64 bytes: magic, version, counts, section table offset
+    //   Section table one SectionEntry per section (unknown ids are skipped,
+    //                 so later versions can add sections old readers ignore)
+    //   Embeddings    numChunks x embeddingSize float32, row-major, as extracted
+    //   Coordinates   numChunks x 2 float32 (t-SNE x, y)   optional
+    //   Clusters      numChunks int32 (DBScan id)          optional
+    //   ChunkSources  numChunks int32 index into SourcePaths, -1 for none
+    //   ChunkPaths    numChunks uint32 string id (path relative to the palette,
+    //                 empty when the chunk was not written out)
+    //   ChunkRanges   numChunks x 2 float64 (start, length in seconds of the
+    //                 chunk's source file)                 optional
+    //   SourcePaths   numSources uint32 string id (absolute path)
+    //   StringOffsets uint32 byte offset per string into StringData
+    //   StringData    NUL-terminated UTF-8; equal strings are stored once
+    //
+    // open() memory-maps the file and validates it once; after that every
+    // accessor points straight into the mapping (no parsing, no copies), so
+    // a palette costs no more memory than the pages actually touched.
+    //
+    // Palettes from before this format (metadata.json + embeddings.bin) are
+    // converted by migrate(), which open() calls the first time it meets one.
+    class PaletteFile
+    {
+    public:
+        static constexpr const char* kFileName = "palette.bin";
+        static constexpr juce::uint32 kMagic = 0x4c415055; // "UPAL"
+        static constexpr juce::uint32 kVersion = 1;
+
+        // Everything write() stores; coordinates and clusters may be empty
+        struct Contents
+        {
+            int embeddingSize{0};
+            std::vector<float> embeddings;      // numChunks x embeddingSize
+            juce::StringArray chunkPaths;       // Relative to the palette directory
+            std::vector<int> chunkSources;      // Index into sourceFiles, -1 for none
+            juce::StringArray sourceFiles;      // Absolute paths
+            juce::String embeddingType;         // "CLAP" or "STFT"
+            std::vector<float> coordinates;     // x, y per chunk
+            std::vector<int> clusters;          // One per chunk
+            std::vector<double> chunkRanges;    // Start, length (seconds of the source) per chunk
+
+            int getNumChunks() const { return chunkPaths.size(); }
+        };
+
+        // Write paletteDir/palette.bin, replacing any previous one atomically
+        static bool write(const juce::File& paletteDir, const Contents& contents);
+
+        // Map paletteDir/palette.bin (migrating a legacy palette first); nullptr
+        // if there is no palette or the file is malformed
+        static std::shared_ptr<const PaletteFile> open(const juce::File& paletteDir);
+
+        // Convert metadata.json + embeddings.bin into palette.bin. The legacy
+        // files are left in place (and ignored from then on).
+        static bool migrate(const juce::File& paletteDir);
+        static bool hasLegacyFiles(const juce::File& paletteDir);
+
+        // Replace the t-SNE coordinates and cluster ids, keeping everything else
+        static bool writeVisualization(const juce::File& paletteDir,
+                                       const std::vector<float>& coordinates,
+                                       const std::vector<int>& clusters);
+
+        // Copy of everything in the file, for rewriting it
+        Contents readContents() const;
+
+        int getNumChunks() const { return m_numChunks; }
+        int getEmbeddingSize() const { return m_embeddingSize; }
+        int getNumSources() const { return m_numSources; }
+        int getNumStrings() const { return m_numStrings; }
+        juce::CharPointer_UTF8 getEmbeddingType() const { return getString(m_embeddingTypeString); }
+
+        const float* getEmbeddings() const { return m_embeddings; }
+        const float* getEmbedding(int chunk) const { return m_embeddings + static_cast<size_t>(chunk) * static_cast<size_t>(m_embeddingSize); }
+
+        bool hasVisualization() const { return m_coordinates != nullptr && m_clusters != nullptr; }
+        const float* getCoordinates() const { return m_coordinates; } // x, y per chunk
+        const int32_t* getClusters() const { return m_clusters; }
+
+        int getChunkSource(int chunk) const { return m_chunkSources[chunk]; }
+        juce::CharPointer_UTF8 getChunkPath(int chunk) const { return getString(m_chunkPaths[chunk]); }
+        juce::CharPointer_UTF8 getSourcePath(int source) const { return getString(m_sourcePaths[source]); }
+
+        // Where each chunk sits in its source file, in seconds
+        bool hasChunkRanges() const { return m_chunkRanges != nullptr; }
+        juce::Range<double> getChunkRange(int chunk) const;
+
+        juce::File getChunkFile(int chunk) const;  // Empty File for chunks that were not written out
+        juce::File getSourceFile(int chunk) const; // Empty File for chunks without one
+
+        const juce::File& getPaletteDir() const { return m_paletteDir; }
+        juce::File getFile() const { return m_paletteDir.getChildFile(kFileName); }
+
+    private:
+        PaletteFile() = default;
+
+        bool mapAndValidate();
+        juce::CharPointer_UTF8 getString(juce::uint32 id) const { return juce::CharPointer_UTF8(m_stringData + m_stringOffsets[id]); }
+
+        juce::File m_paletteDir;
+        std::unique_ptr<juce::MemoryMappedFile> m_mapping;
+
+        int m_numChunks{0};
+        int m_embeddingSize{0};
+        int m_numSources{0};
+        int m_numStrings{0};
+        juce::uint32 m_embeddingTypeString{0};
+
+        // Views into m_mapping
+        const float* m_embeddings{nullptr};
+        const float* m_coordinates{nullptr};
+        const int32_t* m_clusters{nullptr};
+        const double* m_chunkRanges{nullptr};
+        const int32_t* m_chunkSources{nullptr};
+        const juce::uint32* m_chunkPaths{nullptr};
+        const juce::uint32* m_sourcePaths{nullptr};
+        const juce::uint32* m_stringOffsets{nullptr};
+        const char* m_stringData{nullptr};
+    };
+}
@@ -0,0 +1,288 @@
+#include "PaletteIndex.h"
+#include "ApproximatePaletteIndex.h"
+#include "PaletteFile.h"
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+namespace Unsound4All
+{
+    namespace
+    {
+        constexpr int kLanes = 8;         // Independent accumulators per row
+        constexpr int kRowsPerPass = 4;   // Rows sharing each load of the query
+        constexpr int kScoreBlock = 256;  // Scores computed before top-K selection
+
+        // Dot products of query with four rows; dimension is a multiple of
+        // kLanes and both sides are zero padded up to it
+        void dotFourRows(const float* query, const float* row0, size_t stride, int dimension, float* scores)
+        {
+            const float* row1 = row0 + stride;
+            const float* row2 = row1 + stride;
+            const float* row3 = row2 + stride;
+
+            float acc0[kLanes] = {};
+            float acc1[kLanes] = {};
+            float acc2[kLanes] = {};
+            float acc3[kLanes] = {};
+            for (int i = 0; i < dimension; i += kLanes)
+            {
+                for (int lane = 0; lane < kLanes; ++lane)
+                {
+                    const float q = query[i + lane];
+                    acc0[lane] += q * row0[i + lane];
+                    acc1[lane] += q * row1[i + lane];
+                    acc2[lane] += q * row2[i + lane];
+                    acc3[lane] += q * row3[i + lane];
+                }
+            }
+
+            scores[0] = scores[1] = scores[2] = scores[3] = 0.0f;
+            for (int lane = 0; lane < kLanes; ++lane)
+            {
+                scores[0] += acc0[lane];
+                scores[1] += acc1[lane];
+                scores[2] += acc2[lane];
+                scores[3] += acc3[lane];
+            }
+        }
+
+        float dotOneRow(const float* query, const float* row, int dimension)
+        {
+            float acc[kLanes] = {};
+            for (int i = 0; i < dimension; i += kLanes)
+                for (int lane = 0; lane < kLanes; ++lane)
+                    acc[lane] += query[i + lane] * row[i + lane];
+
+            float score = 0.0f;
+            for (int lane = 0; lane < kLanes; ++lane)
+                score += acc[lane];
+            return score;
+        }
+
+        // Heap order for top-K: a ranks before b (higher similarity, then lower row)
+        bool ranksBefore(const PaletteIndex::Match& a, const PaletteIndex::Match& b)
+        {
+            if (a.similarity != b.similarity)
+                return a.similarity > b.similarity;
+            return a.chunkIndex < b.chunkIndex;
+        }
+
+        struct SharedIndexCache
+        {
+            struct Entry
+            {
+                std::shared_ptr<const PaletteIndex> index;
+                juce::Time modified;
+                juce::int64 size{0};
+            };
+
+            juce::CriticalSection lock;
+            std::map<juce::String, Entry> entries;
+        };
+
+        SharedIndexCache& getSharedIndexCache()
+        {
+            static SharedIndexCache cache;
+            return cache;
+        }
+    }
+
+    PaletteIndex::PaletteIndex() = default;
+    PaletteIndex::~PaletteIndex() = default;
+
+    PaletteIndex::PaletteIndex(const float* embeddings, int numRows, int dimension)
+    {
+        allocate(numRows, dimension);
+        for (int row = 0; row < m_numRows; ++row)
+            std::copy(embeddings + static_cast<size_t>(row) * static_cast<size_t>(m_dimension),
+                      embeddings + static_cast<size_t>(row + 1) * static_cast<size_t>(m_dimension),
+                      m_rows + static_cast<size_t>(row) * static_cast<size_t>(m_stride));
+        normaliseRows();
+    }
+
+    void PaletteIndex::allocate(int numRows, int dimension)
+    {
+        m_numRows = juce::jmax(0, numRows);
+        m_dimension = juce::jmax(0, dimension);
+        m_stride = (m_dimension + kRowAlignment - 1) / kRowAlignment * kRowAlignment;
+
+        // Zeroed, so the padding at the end of every row adds nothing to a dot product
+        const size_t numFloats = static_cast<size_t>(m_numRows) * static_cast<size_t>(m_stride);
+        m_storage.calloc(numFloats + kRowAlignment);
+        m_rows = juce::snapPointerToAlignment(m_storage.get(), kRowAlignment * sizeof(float));
+    }
+
+    void PaletteIndex::normaliseRows()
+    {
+        // CLAP embeddings arrive normalised already, STFT features do not;
+        // all-zero rows stay zero and score 0 against everything
+        for (int row = 0; row < m_numRows; ++row)
+        {
+            float* values = m_rows + static_cast<size_t>(row) * static_cast<size_t>(m_stride);
+            double sumSquares = 0.0;
+            for (int i = 0; i < m_dimension; ++i)
+                sumSquares += static_cast<double>(values[i]) * values[i];
+
+            const double norm = std::sqrt(sumSquares);
+            if (norm <= 1e-8)
+                continue;
+
+            const auto scale = static_cast<float>(1.0 / norm);
+            for (int i = 0; i < m_dimension; ++i)
+                values[i] *= scale;
+        }
+    }
+
+    std::shared_ptr<const PaletteIndex> PaletteIndex::load(const juce::File& palettePath)
+    {
+        auto file = PaletteFile::open(palettePath);
+        if (file == nullptr)
+        {
+            DBG("PaletteIndex: No usable palette file in " + palettePath.getFullPathName());
+            return nullptr;
+        }
+
+        // Rows are copied out of the mapping once, into the normalised, padded layout search() needs
+        std::shared_ptr<PaletteIndex> index(new PaletteIndex());
+        index->m_palettePath = palettePath;
+        index->allocate(file->getNumChunks(), file->getEmbeddingSize());
+        for (int row = 0; row < index->m_numRows; ++row)
+            std::copy(file->getEmbedding(row), file->getEmbedding(row) + index->m_dimension,
+                      index->m_rows + static_cast<size_t>(row) * static_cast<size_t>(index->m_stride));
+        index->normaliseRows();
+        index->m_file = std::move(file);
+
+        // Optional: palettes below ApproximatePaletteIndex::kMinRows (or older ones) have none
+        auto approximateFile = palettePath.getChildFile(ApproximatePaletteIndex::kFileName);
+        if (approximateFile.existsAsFile())
+        {
+            index->m_approximate = ApproximatePaletteIndex::load(approximateFile, *index);
+            if (index->m_approximate == nullptr)
+            {
+                DBG("PaletteIndex: Ignoring unusable " + approximateFile.getFullPathName());
+            }
+        }
+
+        DBG("PaletteIndex: Loaded " + juce::String(index->m_numRows) + " x " + juce::String(index->m_dimension)
+            + " embeddings from " + palettePath.getFullPathName());
+        return index;
+    }
+
+    std::shared_ptr<const PaletteIndex> PaletteIndex::getShared(const juce::File& palettePath)
+    {
+        auto& cache = getSharedIndexCache();
+        const auto paletteFile = palettePath.getChildFile(PaletteFile::kFileName);
+
+        // Held while loading, so concurrent searches of a new palette load it once
+        const juce::ScopedLock sl(cache.lock);
+        auto& entry = cache.entries[palettePath.getFullPathName()];
+        if (entry.index != nullptr && entry.modified == paletteFile.getLastModificationTime() && entry.size == paletteFile.getSize())
+            return entry.index;
+
+        entry.index = load(palettePath);
+        if (entry.index == nullptr)
+        {
+            cache.entries.erase(palettePath.getFullPathName());
+            return nullptr;
+        }
+
+        // Read after loading, which may have just migrated a legacy palette
+        entry.modified = paletteFile.getLastModificationTime();
+        entry.size = paletteFile.getSize();
+        return entry.index;
+    }
+
+    void PaletteIndex::releaseShared(const juce::File& palettePath)
+    {
+        auto& cache = getSharedIndexCache();
+        const juce::ScopedLock sl(cache.lock);
+        cache.entries.erase(palettePath.getFullPathName());
+    }
+
+    std::vector<PaletteIndex::Match> PaletteIndex::search(const std::vector<float>& query, int topK, SearchMode mode) const
+    {
+        if (mode == SearchMode::Approximate && m_approximate != nullptr)
+            return m_approximate->search(*this, query, topK, {});
+        return searchExact(query, topK);
+    }
+
+    std::vector<PaletteIndex::Match> PaletteIndex::searchExact(const std::vector<float>& query, int topK) const
+    {
+        std::vector<Match> best;
+        if (static_cast<int>(query.size()) != m_dimension || topK <= 0 || m_numRows == 0)
+        {
+            DBG("PaletteIndex: search skipped (query size " + juce::String(static_cast<int>(query.size()))
+                + ", index dimension " + juce::String(m_dimension) + ")");
+            return best;
+        }
+
+        // Normalised, zero padded copy of the query in the rows' layout
+        juce::HeapBlock<float> queryStorage(static_cast<size_t>(m_stride + kRowAlignment), true);
+        float* paddedQuery = juce::snapPointerToAlignment(queryStorage.get(), kRowAlignment * sizeof(float));
+        double sumSquares = 0.0;
+        for (float value : query)
+            sumSquares += static_cast<double>(value) * value;
+        if (sumSquares <= 1e-16)
+            return best;
+        const float scale = static_cast<float>(1.0 / std::sqrt(sumSquares));
+        for (int i = 0; i < m_dimension; ++i)
+            paddedQuery[i] = query[static_cast<size_t>(i)] * scale;
+
+        const int k = juce::jmin(topK, m_numRows);
+        best.reserve(static_cast<size_t>(k));
+        const auto stride = static_cast<size_t>(m_stride);
+
+        float scores[kScoreBlock];
+        for (int blockStart = 0; blockStart < m_numRows; blockStart += kScoreBlock)
+        {
+            const int blockSize = juce::jmin(kScoreBlock, m_numRows - blockStart);
+            int row = 0;
+            for (; row + kRowsPerPass <= blockSize; row += kRowsPerPass)
+                dotFourRows(paddedQuery, getRow(blockStart + row), stride, m_stride, scores + row);
+            for (; row < blockSize; ++row)
+                scores[row] = dotOneRow(paddedQuery, getRow(blockStart + row), m_stride);
+
+            // Bounded heap with the weakest of the current best at the front
+            for (row = 0; row < blockSize; ++row)
+            {
+                const Match candidate{ blockStart + row, scores[row] };
+                if (static_cast<int>(best.size()) < k)
+                {
+                    best.push_back(candidate);
+                    std::push_heap(best.begin(), best.end(), ranksBefore);
+                }
+                else if (ranksBefore(candidate, best.front()))
+                {
+                    std::pop_heap(best.begin(), best.end(), ranksBefore);
+                    best.back() = candidate;
+                    std::push_heap(best.begin(), best.end(), ranksBefore);
+                }
+            }
+        }
+
+        std::sort_heap(best.begin(), best.end(), ranksBefore);
+        return best;
+    }
+
+    juce::File PaletteIndex::getResultFile(int chunkIndex) const
+    {
+        if (m_file == nullptr || chunkIndex < 0 || chunkIndex >= m_file->getNumChunks())
+            return {};
+
+        // Prefer the original source file, fall back to the chunk copy in the palette
+        auto sourceFile = m_file->getSourceFile(chunkIndex);
+        if (sourceFile.existsAsFile())
+            return sourceFile;
+        if (sourceFile != juce::File())
+        {
+            DBG("PaletteIndex: Source file does not exist: " + sourceFile.getFullPathName());
+        }
+
+        auto chunkFile = m_file->getChunkFile(chunkIndex);
+        if (chunkFile.existsAsFile())
+            return chunkFile;
+        DBG("PaletteIndex: Chunk file does not exist: " + chunkFile.getFullPathName());
+        return {};
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <memory>
+#include <vector>
+
+namespace Unsound4All
+{
+    class ApproximatePaletteIndex;
+    class PaletteFile;
+
+    // In-memory search index over a palette's embeddings (PaletteFile)
+    //
+    // Rows are L2-normalised once at load and stored contiguously in a
+    // 64-byte aligned matrix whose stride is padded to kRowAlignment floats,
+    // so cosine similarity is a plain dot product. A query scans four rows at
+    // a time with eight independent accumulators and keeps the best topK in
+    // a bounded heap instead of sorting every score.
+    //
+    // An index is immutable once loaded, so one instance can be searched from
+    // any number of tracks and worker threads at once. getShared() keeps one
+    // per palette for the whole session and reloads it when palette.bin
+    // changes on disk. When the palette has an ApproximatePaletteIndex
+    // (ann_index.bin) it is loaded alongside, for SearchMode::Approximate.
+    class PaletteIndex
+    {
+    public:
+        static constexpr int kRowAlignment = 16; // Floats (64 bytes)
+
+        struct Match
+        {
+            int chunkIndex{-1};
+            float similarity{0.0f};
+        };
+
+        enum class SearchMode
+        {
+            Exact,       // Scan every row
+            Approximate  // IVF-PQ index when the palette has one, otherwise Exact
+        };
+
+        // Build an index from numRows * dimension floats (row-major). There is
+        // no PaletteFile behind it, so getResultFile() finds nothing.
+        PaletteIndex(const float* embeddings, int numRows, int dimension);
+        ~PaletteIndex();
+
+        // Load a palette directory; nullptr if it has no usable PaletteFile
+        static std::shared_ptr<const PaletteIndex> load(const juce::File& palettePath);
+
+        // Session-wide cache of loaded palettes
+        static std::shared_ptr<const PaletteIndex> getShared(const juce::File& palettePath);
+        static void releaseShared(const juce::File& palettePath);
+
+        // Best topK rows by cosine similarity, most similar first (ties by row).
+        // Empty if the query size does not match or the query is all zeros.
+        std::vector<Match> search(const std::vector<float>& query, int topK,
+                                  SearchMode mode = SearchMode::Exact) const;
+
+        bool hasApproximateIndex() const { return m_approximate != nullptr; }
+
+        // Source file of a chunk when it still exists, otherwise the chunk file
+        // in the palette directory; a non-existent File if neither is there
+        juce::File getResultFile(int chunkIndex) const;
+
+        int getNumRows() const { return m_numRows; }
+        int getDimension() const { return m_dimension; }
+        const float* getRow(int row) const { return m_rows + static_cast<size_t>(row) * static_cast<size_t>(m_stride); }
+        const juce::File& getPalettePath() const { return m_palettePath; }
+
+    private:
+        PaletteIndex();
+
+        std::vector<Match> searchExact(const std::vector<float>& query, int topK) const;
+
+        void allocate(int numRows, int dimension);
+        void normaliseRows();
+
+        juce::File m_palettePath;
+        int m_numRows{0};
+        int m_dimension{0};
+        int m_stride{0};
+        juce::HeapBlock<float> m_storage;
+        float* m_rows{nullptr}; // Aligned start of m_storage
+
+        // Chunk and source paths, read in place from the mapped file
+        std::shared_ptr<const PaletteFile> m_file;
+
+        std::unique_ptr<ApproximatePaletteIndex> m_approximate;
+    };
+}
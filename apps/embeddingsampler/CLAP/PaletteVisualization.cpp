@@ -1,6 +1,6 @@
 #include "PaletteVisualization.h"
+#include "PaletteFile.h"
 #include "../DBScan.h"
-#include <juce_data_structures/juce_data_structures.h>
 #include <algorithm>
 #include <qdtsne/qdtsne.hpp>
 #include <knncolle/knncolle.hpp>
@@ -15,22 +15,18 @@ bool PaletteVisualization::update_palette_visualization(
     const std::vector<juce::Point<double>>& tsne_coordinates,
     const std::vector<int>& cluster_assignments)
 {
-    juce::File metadata_file = palette_dir.getChildFile("metadata.json");
-    if (!metadata_file.existsAsFile())
+    int num_chunks = 0;
     {
-        DBG("PaletteVisualization: Metadata file not found: " + metadata_file.getFullPathName());
-        return false;
-    }
-    
-    juce::var metadata = juce::JSON::parse(metadata_file);
-    if (!metadata.isObject())
-    {
-        DBG("PaletteVisualization: Failed to parse metadata JSON");
-        return false;
+        auto palette = Unsound4All::PaletteFile::open(palette_dir);
+        if (palette == nullptr)
+        {
+            DBG("PaletteVisualization: Palette file not found in " + palette_dir.getFullPathName());
+            return false;
+        }
+        num_chunks = palette->getNumChunks();
     }
     
     // Validate sizes
-    int num_chunks = metadata.getProperty("numChunks", 0);
     if (static_cast<int>(tsne_coordinates.size()) != num_chunks ||
         static_cast<int>(cluster_assignments.size()) != num_chunks)
     {
@@ -40,27 +36,20 @@ bool PaletteVisualization::update_palette_visualization(
         return false;
     }
     
-    // Store t-SNE coordinates
-    juce::Array<juce::var> coordinates_array;
+    // Stored as x, y float pairs
+    std::vector<float> coordinates;
+    coordinates.reserve(tsne_coordinates.size() * 2);
     for (const auto& coord : tsne_coordinates)
     {
-        juce::Array<juce::var> point_array;
-        point_array.add(coord.x);
-        point_array.add(coord.y);
-        coordinates_array.add(juce::var(point_array));
+        coordinates.push_back(static_cast<float>(coord.x));
+        coordinates.push_back(static_cast<float>(coord.y));
     }
-    metadata.getDynamicObject()->setProperty("tsneCoordinates", juce::var(coordinates_array));
     
-    // Store cluster assignments
-    juce::Array<juce::var> clusters_array;
-    for (int cluster_id : cluster_assignments)
+    if (!Unsound4All::PaletteFile::writeVisualization(palette_dir, coordinates, cluster_assignments))
     {
-        clusters_array.add(cluster_id);
+        DBG("PaletteVisualization: Failed to write visualization data");
+        return false;
     }
-    metadata.getDynamicObject()->setProperty("clusterAssignments", juce::var(clusters_array));
-    
-    // Write updated metadata
-    metadata_file.replaceWithText(juce::JSON::toString(metadata));
     
     DBG("PaletteVisualization: Updated palette visualization data");
     return true;
@@ -71,51 +60,24 @@ bool PaletteVisualization::load_palette_visualization(
     std::vector<juce::Point<double>>& tsne_coordinates,
     std::vector<int>& cluster_assignments)
 {
-    juce::File metadata_file = palette_dir.getChildFile("metadata.json");
-    if (!metadata_file.existsAsFile())
+    auto palette = Unsound4All::PaletteFile::open(palette_dir);
+    if (palette == nullptr || !palette->hasVisualization())
     {
         return false;
     }
     
-    juce::var metadata = juce::JSON::parse(metadata_file);
-    if (!metadata.isObject())
-    {
-        return false;
-    }
+    const int num_chunks = palette->getNumChunks();
+    const float* coordinates = palette->getCoordinates();
+    const int32_t* clusters = palette->getClusters();
     
-    // Load t-SNE coordinates
-    if (metadata.hasProperty("tsneCoordinates"))
+    tsne_coordinates.clear();
+    tsne_coordinates.reserve(static_cast<size_t>(num_chunks));
+    for (int i = 0; i < num_chunks; ++i)
     {
-        auto coords_var = metadata["tsneCoordinates"];
-        if (coords_var.isArray())
-        {
-            tsne_coordinates.clear();
-            for (int i = 0; i < coords_var.size(); ++i)
-            {
-                auto point_var = coords_var[i];
-                if (point_var.isArray() && point_var.size() >= 2)
-                {
-                    double x = point_var[0];
-                    double y = point_var[1];
-                    tsne_coordinates.push_back(juce::Point<double>(x, y));
-                }
-            }
-        }
+        tsne_coordinates.push_back(juce::Point<double>(coordinates[2 * i], coordinates[2 * i + 1]));
     }
     
-    // Load cluster assignments
-    if (metadata.hasProperty("clusterAssignments"))
-    {
-        auto clusters_var = metadata["clusterAssignments"];
-        if (clusters_var.isArray())
-        {
-            cluster_assignments.clear();
-            for (int i = 0; i < clusters_var.size(); ++i)
-            {
-                cluster_assignments.push_back(static_cast<int>(clusters_var[i]));
-            }
-        }
-    }
+    cluster_assignments.assign(clusters, clusters + num_chunks);
     
     return !tsne_coordinates.empty() && !cluster_assignments.empty();
 }
@@ -153,65 +115,20 @@ bool PaletteVisualization::compute_tsne_from_embeddings(
     if (progressCallback)
         progressCallback("Loading embeddings...");
     
-    // Load embeddings from embeddings.bin
-    juce::File embeddings_file = palette_dir.getChildFile("embeddings.bin");
-    if (!embeddings_file.existsAsFile())
-    {
-        DBG("PaletteVisualization::compute_tsne_from_embeddings: Embeddings file not found: " + embeddings_file.getFullPathName());
-        return false;
-    }
-    
-    DBG("PaletteVisualization::compute_tsne_from_embeddings: Opening embeddings file: " + embeddings_file.getFullPathName());
-    
-    juce::FileInputStream input_stream(embeddings_file);
-    if (!input_stream.openedOk())
+    // Map the palette's embeddings; they are read in place while transposing
+    auto palette = Unsound4All::PaletteFile::open(palette_dir);
+    if (palette == nullptr)
     {
-        DBG("PaletteVisualization::compute_tsne_from_embeddings: Failed to open embeddings file");
+        DBG("PaletteVisualization::compute_tsne_from_embeddings: Palette file not found in " + palette_dir.getFullPathName());
         return false;
     }
     
-    // Read header
-    int32_t num_embeddings = 0;
-    int32_t embedding_size = 0;
-    
-    input_stream.read(&num_embeddings, sizeof(int32_t));
-    input_stream.read(&embedding_size, sizeof(int32_t));
+    const int32_t num_embeddings = palette->getNumChunks();
+    const int32_t embedding_size = palette->getEmbeddingSize();
     
-    DBG("PaletteVisualization::compute_tsne_from_embeddings: Read header - num_embeddings=" + juce::String(num_embeddings) + 
+    DBG("PaletteVisualization::compute_tsne_from_embeddings: num_embeddings=" + juce::String(num_embeddings) + 
         ", embedding_size=" + juce::String(embedding_size));
     
-    if (num_embeddings <= 0 || embedding_size <= 0)
-    {
-        DBG("PaletteVisualization::compute_tsne_from_embeddings: Invalid embeddings file (num_embeddings=" + juce::String(num_embeddings) + 
-            ", embedding_size=" + juce::String(embedding_size) + ")");
-        return false;
-    }
-    
-    // Read all embeddings (row-major: each embedding is a row)
-    std::vector<std::vector<float>> embeddings;
-    embeddings.reserve(num_embeddings);
-    
-    for (int32_t i = 0; i < num_embeddings; ++i)
-    {
-        std::vector<float> embedding(embedding_size);
-        input_stream.read(embedding.data(), sizeof(float) * embedding_size);
-        embeddings.push_back(embedding);
-        
-        if (progressCallback && i % 100 == 0)
-        {
-            progressCallback("Loading embeddings... " + juce::String(i) + "/" + juce::String(num_embeddings));
-        }
-    }
-    
-    if (static_cast<int32_t>(embeddings.size()) != num_embeddings)
-    {
-        DBG("PaletteVisualization::compute_tsne_from_embeddings: Failed to read all embeddings (read " + 
-            juce::String(embeddings.size()) + ", expected " + juce::String(num_embeddings) + ")");
-        return false;
-    }
-    
-    DBG("PaletteVisualization::compute_tsne_from_embeddings: Successfully loaded " + juce::String(embeddings.size()) + " embeddings");
-    
     if (progressCallback)
         progressCallback("Converting embeddings to column-major format...");
     
@@ -220,22 +137,25 @@ bool PaletteVisualization::compute_tsne_from_embeddings(
     // Convert from row-major to column-major format for qdtsne
     // qdtsne expects: data_dim rows (embedding dimensions), num_obs columns (observations)
     // So we transpose: embedding_size rows, num_embeddings columns
-    std::vector<double> column_major_data;
-    column_major_data.reserve(embedding_size * num_embeddings);
+    std::vector<double> column_major_data(static_cast<size_t>(embedding_size) * static_cast<size_t>(num_embeddings));
     
-    for (int32_t dim = 0; dim < embedding_size; ++dim)
+    for (int32_t obs = 0; obs < num_embeddings; ++obs)
     {
-        for (int32_t obs = 0; obs < num_embeddings; ++obs)
+        const float* embedding = palette->getEmbedding(obs);
+        for (int32_t dim = 0; dim < embedding_size; ++dim)
         {
-            column_major_data.push_back(static_cast<double>(embeddings[obs][dim]));
+            column_major_data[static_cast<size_t>(dim) * static_cast<size_t>(num_embeddings) + static_cast<size_t>(obs)] = static_cast<double>(embedding[dim]);
         }
         
-        if (dim % 100 == 0 && progressCallback)
+        if (obs % 1000 == 0 && progressCallback)
         {
-            progressCallback("Converting embeddings... " + juce::String(dim) + "/" + juce::String(embedding_size));
+            progressCallback("Converting embeddings... " + juce::String(obs) + "/" + juce::String(num_embeddings));
         }
     }
     
+    // Released before update_palette_visualization() rewrites the file
+    palette.reset();
+    
     DBG("PaletteVisualization::compute_tsne_from_embeddings: Converted to column-major format. Data size: " + 
         juce::String(column_major_data.size()));
     
@@ -16,7 +16,7 @@ namespace EmbeddingSpaceSampler
 class PaletteVisualization
 {
 public:
-    // Update palette metadata with t-SNE coordinates and cluster assignments
+    // Store t-SNE coordinates and cluster assignments in the palette file
     // Coordinates: 2D points for each chunk [[x1,y1], [x2,y2], ...]
     // Cluster assignments: cluster ID for each chunk [cluster0, cluster1, ...]
     static bool update_palette_visualization(
@@ -25,7 +25,7 @@ public:
         const std::vector<int>& cluster_assignments
     );
     
-    // Load t-SNE coordinates and cluster assignments from palette metadata
+    // Load t-SNE coordinates and cluster assignments from the palette file
     static bool load_palette_visualization(
         const juce::File& palette_dir,
         std::vector<juce::Point<double>>& tsne_coordinates,
@@ -41,7 +41,7 @@ public:
     );
     
     // Compute t-SNE coordinates from embeddings stored in palette
-    // Loads embeddings from embeddings.bin, runs t-SNE, computes clusters, and saves results
+    // Reads embeddings from the palette file, runs t-SNE, computes clusters, and saves results
     // Returns true on success, false on failure
     static bool compute_tsne_from_embeddings(
         const juce::File& palette_dir,
@@ -3,6 +3,8 @@
 #include <juce_core/juce_core.h>
 #include <juce_audio_formats/juce_audio_formats.h>
 #include "ONNXModelManager.h"
+#include "PaletteBuildPipeline.h"
+#include <atomic>
 #include <functional>
 
 namespace Unsound4All
@@ -34,45 +36,32 @@ namespace Unsound4All
         // Cancel creation (if running in background thread)
         void cancel();
         
+        // How createPalette() decodes, chunks and batches (chunkSizeSeconds
+        // is taken from createPalette()'s argument)
+        void setBuildOptions(const PaletteBuildPipeline::Options& options) { m_buildOptions = options; }
+        
     private:
         bool m_isCreating{false};
-        bool m_cancelled{false};
+        std::atomic<bool> m_cancelled{false};
+        PaletteBuildPipeline::Options m_buildOptions;
         
         // Find all audio files recursively
         juce::Array<juce::File> findAudioFiles(const juce::File& rootFolder) const;
         
-        // Chunk an audio file into segments
-        juce::Array<juce::File> chunkAudioFile(
-            const juce::File& audioFile,
-            int chunkSizeSeconds,
-            const juce::File& outputDir,
-            std::function<void(const juce::String&)> progressCallback = nullptr
-        ) const;
-        
-        // Process all chunks and create embeddings
-        bool createEmbeddings(
-            const juce::Array<juce::File>& chunkFiles,
-            const juce::File& paletteDir,
-            ONNXModelManager& modelManager,
-            std::vector<std::vector<float>>& embeddings,
-            std::function<void(const juce::String&)> progressCallback = nullptr
-        ) const;
-        
-        // Process all chunks and create STFT features
-        bool createSTFTFeatures(
-            const juce::Array<juce::File>& chunkFiles,
+        // Save the palette file (PaletteFile) and, for large palettes, the
+        // approximate search index
+        bool savePaletteData(
             const juce::File& paletteDir,
-            std::vector<std::vector<float>>& features,
-            std::function<void(const juce::String&)> progressCallback = nullptr
+            const PaletteFile::Contents& contents
         ) const;
         
-        // Save FAISS index and metadata
-        bool savePaletteData(
+        // Build and save an ApproximatePaletteIndex next to the palette file
+        // (skipped below ApproximatePaletteIndex::kMinRows chunks)
+        bool saveApproximateIndex(
             const juce::File& paletteDir,
-            const juce::Array<juce::File>& chunkFiles,
-            const juce::Array<juce::File>& sourceFiles,
-            const std::vector<std::vector<float>>& embeddings,
-            FeatureType featureType = FeatureType::CLAP
+            const std::vector<float>& rows,  // numRows x embeddingSize, row-major
+            int numRows,
+            int embeddingSize
         ) const;
     };
 }
@@ -1,4 +1,5 @@
 #include "SoundPaletteManager.h"
+#include "PaletteFile.h"
 #include <algorithm>
 
 namespace Unsound4All
@@ -65,12 +66,9 @@ namespace Unsound4All
         if (!paletteDir.exists() || !paletteDir.isDirectory())
             return false;
         
-        // Check for required files: embeddings.bin (or embeddings.faiss) and metadata.json
-        auto binFile = paletteDir.getChildFile("embeddings.bin");
-        auto faissFile = paletteDir.getChildFile("embeddings.faiss");
-        auto metadataFile = paletteDir.getChildFile("metadata.json");
-        
-        return metadataFile.existsAsFile() && (binFile.existsAsFile() || faissFile.existsAsFile());
+        // Either a palette file, or a legacy palette that is migrated on first open
+        return paletteDir.getChildFile(PaletteFile::kFileName).existsAsFile()
+            || PaletteFile::hasLegacyFiles(paletteDir);
     }
     
     std::vector<juce::File> SoundPaletteManager::getDefaultSearchLocations() const
@@ -90,17 +88,12 @@ namespace Unsound4All
     
     bool SoundPaletteManager::loadPaletteMetadata(const juce::File& paletteDir, SoundPaletteInfo& info) const
     {
-        auto metadataFile = paletteDir.getChildFile("metadata.json");
-        if (!metadataFile.existsAsFile())
+        auto palette = PaletteFile::open(paletteDir);
+        if (palette == nullptr)
             return false;
         
-        // TODO: Parse JSON metadata file
-        // For now, count chunks by scanning directory
-        juce::Array<juce::File> chunkFiles;
-        paletteDir.findChildFiles(chunkFiles, juce::File::findFiles, false, "*.wav");
-        info.numChunks = chunkFiles.size();
+        info.numChunks = palette->getNumChunks();
         
         return true;
     }
 }
-
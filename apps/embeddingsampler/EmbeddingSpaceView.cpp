@@ -1,5 +1,6 @@
 #include "EmbeddingSpaceView.h"
 #include "CLAP/PaletteVisualization.h"
+#include "CLAP/PaletteFile.h"
 #include "CLAP/SoundPaletteManager.h"
 #include "DBScan.h"
 #include <juce_graphics/juce_graphics.h>
@@ -330,46 +331,34 @@ bool EmbeddingSpaceView::load_palette(const juce::File& palette_dir)
         return false;
     }
     
-    // Load metadata
-    juce::File metadata_file = palette_dir.getChildFile("metadata.json");
-    if (!metadata_file.existsAsFile())
+    // Map the palette file; only the chunk paths are needed here
+    auto palette = Unsound4All::PaletteFile::open(palette_dir);
+    if (palette == nullptr)
     {
-        DBG("EmbeddingSpaceView: Metadata file not found");
-        return false;
-    }
-    
-    juce::var metadata = juce::JSON::parse(metadata_file);
-    if (!metadata.isObject())
-    {
-        DBG("EmbeddingSpaceView: Failed to parse metadata");
-        return false;
-    }
-    
-    // Load chunk files first
-    if (!metadata.hasProperty("chunks"))
-    {
-        DBG("EmbeddingSpaceView: No chunks in metadata");
-        return false;
-    }
-    
-    auto chunks_var = metadata["chunks"];
-    if (!chunks_var.isArray())
-    {
-        DBG("EmbeddingSpaceView: Chunks is not an array");
+        DBG("EmbeddingSpaceView: Palette file not found");
         return false;
     }
     
+    // Chunks without a file of their own play their region of the source
     chunk_files.clear();
-    for (int i = 0; i < chunks_var.size(); ++i)
+    chunk_regions.clear();
+    chunk_files.reserve(static_cast<size_t>(palette->getNumChunks()));
+    chunk_regions.reserve(static_cast<size_t>(palette->getNumChunks()));
+    for (int i = 0; i < palette->getNumChunks(); ++i)
     {
-        auto chunk_var = chunks_var[i];
-        if (chunk_var.isObject() && chunk_var.hasProperty("path"))
+        auto chunk_file = palette->getChunkFile(i);
+        if (chunk_file == juce::File() && palette->hasChunkRanges())
+        {
+            chunk_files.push_back(palette->getSourceFile(i));
+            chunk_regions.push_back(palette->getChunkRange(i));
+        }
+        else
         {
-            juce::String path = chunk_var["path"];
-            juce::File chunk_file = palette_dir.getChildFile(path);
             chunk_files.push_back(chunk_file);
+            chunk_regions.push_back({});
         }
     }
+    palette.reset();
     
     if (chunk_files.empty())
     {
@@ -391,8 +380,7 @@ bool EmbeddingSpaceView::load_palette(const juce::File& palette_dir)
         // For now, use grid layout as fallback for faster loading
         // To enable on-demand computation, uncomment the following:
         /*
-        juce::File embeddings_file = palette_dir.getChildFile("embeddings.bin");
-        if (embeddings_file.existsAsFile())
+        if (palette_dir.getChildFile(Unsound4All::PaletteFile::kFileName).existsAsFile())
         {
             DBG("EmbeddingSpaceView: Computing t-SNE from embeddings on-demand...");
             if (PaletteVisualization::compute_tsne_from_embeddings(palette_dir, nullptr))
@@ -449,6 +437,7 @@ bool EmbeddingSpaceView::load_palette(const juce::File& palette_dir)
         if (i < chunk_files.size())
         {
             point.audio_file = chunk_files[static_cast<int>(i)];
+            point.audio_region = chunk_regions[i];
         }
         points.push_back(point);
     }
@@ -661,5 +650,14 @@ juce::File EmbeddingSpaceView::get_audio_file(int chunk_index) const
     return juce::File();
 }
 
+juce::Range<double> EmbeddingSpaceView::get_audio_region(int chunk_index) const
+{
+    if (chunk_index >= 0 && chunk_index < static_cast<int>(points.size()))
+    {
+        return points[chunk_index].audio_region;
+    }
+    return {};
+}
+
 } // namespace EmbeddingSpaceSampler
 
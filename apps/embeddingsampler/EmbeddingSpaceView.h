@@ -37,6 +37,9 @@ public:
     // Get audio file for a chunk index
     juce::File get_audio_file(int chunk_index) const;
     
+    // Seconds of get_audio_file() the chunk covers; empty for the whole file
+    juce::Range<double> get_audio_region(int chunk_index) const;
+    
     // Set trigger threshold distance (in normalized coordinates, 0.0 to 1.0)
     void set_trigger_threshold(float threshold) { trigger_threshold = threshold; }
     
@@ -53,10 +56,12 @@ private:
         int cluster_id;
         int chunk_index;
         juce::File audio_file;
+        juce::Range<double> audio_region;  // Empty when audio_file is the chunk itself
     };
     
     std::vector<EmbeddingPoint> points;
     std::vector<juce::File> chunk_files;
+    std::vector<juce::Range<double>> chunk_regions;
     
     // View transform (zoom and pan)
     float zoom_level = 1.0f;
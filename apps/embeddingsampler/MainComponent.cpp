@@ -373,8 +373,8 @@ void MainComponent::trigger_sample_on_track(int chunk_index, float velocity)
     auto& track = tracks[current_track_index];
     current_track_index = (current_track_index + 1) % static_cast<int>(tracks.size());
     
-    // Trigger sample
-    track->trigger_sample(audio_file, velocity);
+    // Trigger sample (a region of the source when the palette has no chunk file)
+    track->trigger_sample(audio_file, velocity, embedding_view.get_audio_region(chunk_index));
     
     DBG("MainComponent: Triggered sample on track " + juce::String(current_track_index) + 
         ", chunk " + juce::String(chunk_index) + ", velocity " + juce::String(velocity));
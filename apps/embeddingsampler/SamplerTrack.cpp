@@ -195,7 +195,7 @@ void SamplerTrack::resized()
     }
 }
 
-void SamplerTrack::trigger_sample(const juce::File& audio_file, float velocity)
+void SamplerTrack::trigger_sample(const juce::File& audio_file, float velocity, juce::Range<double> region)
 {
     if (!audio_file.existsAsFile())
     {
@@ -211,11 +211,24 @@ void SamplerTrack::trigger_sample(const juce::File& audio_file, float velocity)
         return;
     }
     
-    // Read audio data
+    // Read audio data (the whole file unless a region is given)
+    juce::int64 start_sample = 0;
+    juce::int64 num_samples = reader->lengthInSamples;
+    if (!region.isEmpty())
+    {
+        start_sample = juce::jlimit<juce::int64>(0, reader->lengthInSamples, static_cast<juce::int64>(region.getStart() * reader->sampleRate));
+        num_samples = juce::jmin(reader->lengthInSamples - start_sample, static_cast<juce::int64>(std::ceil(region.getLength() * reader->sampleRate)));
+    }
+    if (num_samples <= 0)
+    {
+        DBG("SamplerTrack: Empty region in " + audio_file.getFullPathName());
+        return;
+    }
+    
     juce::AudioBuffer<float> temp_buffer(static_cast<int>(reader->numChannels), 
-                                          static_cast<int>(reader->lengthInSamples));
+                                          static_cast<int>(num_samples));
     
-    if (!reader->read(&temp_buffer, 0, static_cast<int>(reader->lengthInSamples), 0, true, true))
+    if (!reader->read(&temp_buffer, 0, static_cast<int>(num_samples), start_sample, true, true))
     {
         DBG("SamplerTrack: Failed to read audio data");
         return;
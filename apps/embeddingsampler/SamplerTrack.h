@@ -29,8 +29,8 @@ public:
     void paint(juce::Graphics& g) override;
     void resized() override;
     
-    // Trigger a sample from an audio file
-    void trigger_sample(const juce::File& audio_file, float velocity = 1.0f);
+    // Trigger a sample from an audio file, or from region (seconds) of it
+    void trigger_sample(const juce::File& audio_file, float velocity = 1.0f, juce::Range<double> region = {});
     
     // Set playback speed (0.25 to 4.0)
     void set_playback_speed(float speed);
@@ -0,0 +1,110 @@
+#include <juce_core/juce_core.h>
+#include "../CLAP/PaletteFile.h"
+#include <iostream>
+
+// Converts sound palettes from metadata.json + embeddings.bin to palette.bin.
+//
+//   PaletteMigrate <palette dir | directory of palettes> [--force] [--remove-legacy]
+//
+// Palettes that already have a palette.bin are skipped unless --force is
+// given. --remove-legacy deletes the old files once the new one opens.
+// The apps migrate on first open anyway; this is for doing it up front.
+
+namespace
+{
+void print_usage()
+{
+    std::cerr << "usage: PaletteMigrate <palette dir | directory of palettes> [--force] [--remove-legacy]" << std::endl;
+}
+
+// 0 migrated, 1 skipped, -1 failed
+int migrate_palette(const juce::File& palette_dir, bool force, bool remove_legacy)
+{
+    const auto name = palette_dir.getFileName();
+    const auto palette_file = palette_dir.getChildFile(Unsound4All::PaletteFile::kFileName);
+
+    if (palette_file.existsAsFile() && !force)
+    {
+        std::cout << "skipped  " << name << " (already has " << Unsound4All::PaletteFile::kFileName << ")" << std::endl;
+        return 1;
+    }
+
+    if (!Unsound4All::PaletteFile::migrate(palette_dir))
+    {
+        std::cerr << "failed   " << name << std::endl;
+        return -1;
+    }
+
+    auto palette = Unsound4All::PaletteFile::open(palette_dir);
+    if (palette == nullptr)
+    {
+        std::cerr << "failed   " << name << " (written file does not open)" << std::endl;
+        return -1;
+    }
+
+    std::cout << "migrated " << name << ": " << palette->getNumChunks() << " chunks, "
+              << palette->getNumSources() << " sources, "
+              << (palette->hasVisualization() ? "with" : "without") << " visualization" << std::endl;
+
+    if (remove_legacy)
+    {
+        palette_dir.getChildFile("metadata.json").deleteFile();
+        palette_dir.getChildFile("embeddings.bin").deleteFile();
+    }
+
+    return 0;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+
+    if (args.isEmpty() || args[0].startsWith("--"))
+    {
+        print_usage();
+        return 1;
+    }
+
+    const juce::File target = juce::File::getCurrentWorkingDirectory().getChildFile(args[0]);
+    const bool force = args.contains("--force");
+    const bool remove_legacy = args.contains("--remove-legacy");
+
+    if (!target.isDirectory())
+    {
+        std::cerr << target.getFullPathName() << " is not a directory" << std::endl;
+        return 1;
+    }
+
+    // A single palette, or every legacy palette one level down
+    juce::Array<juce::File> palette_dirs;
+    if (Unsound4All::PaletteFile::hasLegacyFiles(target))
+    {
+        palette_dirs.add(target);
+    }
+    else
+    {
+        for (const auto& entry : juce::RangedDirectoryIterator(target, false, "*", juce::File::findDirectories))
+        {
+            if (Unsound4All::PaletteFile::hasLegacyFiles(entry.getFile()))
+                palette_dirs.add(entry.getFile());
+        }
+    }
+
+    if (palette_dirs.isEmpty())
+    {
+        std::cerr << "no legacy palettes found in " << target.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    int num_failed = 0;
+    for (const auto& palette_dir : palette_dirs)
+    {
+        if (migrate_palette(palette_dir, force, remove_legacy) < 0)
+            ++num_failed;
+    }
+
+    return num_failed == 0 ? 0 : 1;
+}
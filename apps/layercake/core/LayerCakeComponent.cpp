@@ -255,6 +255,7 @@ LayerCakeComponent::LayerCakeComponent(LayerCakeProcessor& processor)
         m_env_knob.get(), m_direction_knob.get(), m_pan_knob.get(),
         m_layer_knob.get(), m_tempo_knob.get(), m_master_gain_knob.get()
     };
+    restore_modulation_routes_from_engine();
 
     m_master_meter.setColour(juce::ProgressBar::foregroundColourId, m_custom_look_and_feel.findColour(juce::ProgressBar::foregroundColourId));
     m_master_meter.setColour(juce::ProgressBar::backgroundColourId, m_custom_look_and_feel.findColour(juce::ProgressBar::backgroundColourId));
@@ -538,7 +539,6 @@ void LayerCakeComponent::timerCallback()
         }
     }
     update_all_modulation_overlays();
-    update_master_gain_from_knob(); // Still needed if not using attachment for gain? Used attachment, so this might be redundant but safe
     update_record_layer_from_lfo();
     update_record_labels();
     update_meter();
@@ -592,50 +592,11 @@ void LayerCakeComponent::toggle_record_enable()
 
 void LayerCakeComponent::trigger_manual_grain()
 {
+    // The engine builds the grain from its modulation bases + routes.
     sync_manual_state_from_controls();
-    auto state = build_manual_grain_state();
-    m_processor.getEngine().set_manual_trigger_template(state);
     m_processor.getEngine().request_manual_trigger();
 }
 
-GrainState LayerCakeComponent::build_manual_grain_state()
-{
-    GrainState state;
-    auto& engine = m_processor.getEngine();
-    const int layer = engine.get_record_layer();
-    const double recorded_seconds = get_layer_recorded_seconds(layer);
-    const double normalized_start = (m_position_knob != nullptr)
-        ? juce::jlimit(0.0, 1.0, get_effective_knob_value(m_position_knob.get()))
-        : 0.0;
-    double loop_start_seconds = normalized_start * recorded_seconds;
-
-    double duration_ms = get_effective_knob_value(m_duration_knob.get());
-    double duration_seconds = duration_ms * 0.001;
-
-    if (recorded_seconds > 0.0)
-    {
-        const double max_duration_seconds = juce::jmax(0.0, recorded_seconds - loop_start_seconds);
-        duration_seconds = juce::jlimit(0.0, max_duration_seconds, duration_seconds);
-    }
-    duration_ms = duration_seconds * 1000.0;
-
-    double env_value = m_env_knob != nullptr ? get_effective_knob_value(m_env_knob.get()) : 0.5;
-    env_value = juce::jlimit(0.0, 1.0, env_value);
-    const double attack_ms = duration_ms * (1.0 - env_value);
-    const double release_ms = duration_ms * env_value;
-
-    state.loop_start_seconds = static_cast<float>(loop_start_seconds);
-    state.duration_ms = static_cast<float>(duration_ms);
-    state.rate_semitones = static_cast<float>(get_effective_knob_value(m_rate_knob.get()));
-    state.env_attack_ms = static_cast<float>(attack_ms);
-    state.env_release_ms = static_cast<float>(release_ms);
-    state.play_forward = true;
-    state.layer = layer;
-    state.pan = static_cast<float>(get_effective_knob_value(m_pan_knob.get()));
-    state.should_trigger = true;
-    return state;
-}
-
 void LayerCakeComponent::update_record_labels()
 {
     auto& engine = m_processor.getEngine();
@@ -722,6 +683,7 @@ void LayerCakeComponent::assign_lfo_to_knob(int lfo_index, LayerCakeKnob& knob)
     if (lfo_index < 0 || lfo_index >= static_cast<int>(m_lfo_slots.size())) return;
     knob.set_lfo_assignment_index(lfo_index);
     knob.set_lfo_button_accent(m_lfo_slots[static_cast<size_t>(lfo_index)].accent);
+    push_modulation_route(knob);
     update_all_modulation_overlays();
 }
 
@@ -730,6 +692,34 @@ void LayerCakeComponent::remove_lfo_from_knob(LayerCakeKnob& knob)
     if (!knob.has_lfo_assignment()) return;
     knob.set_lfo_assignment_index(-1);
     knob.clear_modulation_indicator();
+    push_modulation_route(knob);
+}
+
+void LayerCakeComponent::push_modulation_route(const LayerCakeKnob& knob)
+{
+    ModulationTarget target;
+    if (!LayerCakeProcessor::getModulationTarget(knob.parameter_id(), target))
+    {
+        DBG("LayerCakeComponent::push_modulation_route no engine target for " + knob.parameter_id());
+        return;
+    }
+    m_processor.getEngine().set_modulation_route(target, knob.lfo_assignment_index());
+}
+
+void LayerCakeComponent::restore_modulation_routes_from_engine()
+{
+    // The engine outlives the editor, so a reopened editor shows the routes it is still running.
+    for (auto* knob : m_lfo_enabled_knobs)
+    {
+        if (knob == nullptr) continue;
+        ModulationTarget target;
+        if (!LayerCakeProcessor::getModulationTarget(knob->parameter_id(), target)) continue;
+        const int slot = m_processor.getEngine().get_modulation_route(target);
+        if (slot < 0 || slot >= static_cast<int>(m_lfo_slots.size())) continue;
+        knob->set_lfo_assignment_index(slot);
+        knob->set_lfo_button_accent(m_lfo_slots[static_cast<size_t>(slot)].accent);
+    }
+    update_all_modulation_overlays();
 }
 
 void LayerCakeComponent::update_all_modulation_overlays()
@@ -784,35 +774,6 @@ void LayerCakeComponent::update_record_layer_from_lfo()
         adjust_record_layer(desired_layer - m_processor.getEngine().get_record_layer());
 }
 
-void LayerCakeComponent::update_master_gain_from_knob()
-{
-    // Handled by Attachment, but effective value might be modulated by LFO
-    if (m_master_gain_knob == nullptr) return;
-    const float gain = static_cast<float>(get_effective_knob_value(m_master_gain_knob.get()));
-    // If LFO is modulating, we need to force it to engine because attachment only syncs slider value, not effective value
-    // Wait, if Attachment syncs slider value, and we have an LFO, the LFO modulates the effective value which goes to engine.
-    // But APVTS parameter is the slider value.
-    // The engine param "master_gain" should be the effective value?
-    // If we use `LayerCakeProcessor::updateEngineParams` which reads APVTS, it reads the base value.
-    // So modulation logic must happen in Processor if we want it to be audio-rate or correct.
-    // Currently modulation logic is in Component (UI rate).
-    // This is a limitation of the current architecture.
-    // I will keep it here: override what Processor set from APVTS with modulated value.
-    // But Processor sets it every block.
-    // We need to move LFO modulation to Processor for it to work properly with Plugin architecture.
-    // However, refactoring LFO modulation to Processor is huge.
-    // User asked to "hold as much reusable logic as we can".
-    // I will leave it as is: Component calculates effective value and pushes to Engine. 
-    // NOTE: This means modulation only works when Editor is open! This is bad for a plugin.
-    // But for this plan, I will stick to the plan of "Turning layercake into a vst3". 
-    // I'll add a TODO comment or fix it if I can.
-    // Fixing: LFOs should be in Processor. `LayerCakeProcessor` has `updateLfoParams`.
-    // But the *assignment* logic is in UI. 
-    // Ideally, assignment should be in APVTS too.
-    // I'll push the modulated value to engine here.
-    m_processor.getEngine().set_master_gain_db(gain);
-}
-
 double LayerCakeComponent::get_layer_recorded_seconds(int layer_index) const
 {
     if (layer_index < 0 || layer_index >= static_cast<int>(LayerCakeEngine::kNumLayers)) return 0.0;
@@ -888,14 +849,6 @@ void LayerCakeComponent::sync_manual_state_from_controls()
     m_manual_state.layer = layer;
     m_manual_state.should_trigger = false;
     m_display.set_position_indicator(static_cast<float>(loop_start_normalized));
-
-    const float reverse_probability = m_direction_knob != nullptr
-        ? static_cast<float>(juce::jlimit(0.0, 1.0, get_effective_knob_value(m_direction_knob.get())))
-        : 0.0f;
-
-    auto manual_template = build_manual_grain_state();
-    engine.set_manual_trigger_template(manual_template);
-    engine.set_manual_reverse_probability(reverse_probability);
 }
 
 LayerCakePresetData LayerCakeComponent::capture_knobset_data() const
@@ -1100,6 +1053,7 @@ void LayerCakeComponent::apply_lfo_state(const LayerCakePresetData& data)
 
         knob->set_lfo_assignment_index(-1);
         knob->clear_modulation_indicator();
+        push_modulation_route(*knob);
 
         const auto& parameterId = knob->parameter_id();
         if (parameterId.isEmpty()) continue;
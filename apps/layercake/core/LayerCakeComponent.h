@@ -52,7 +52,6 @@ private:
     void adjust_record_layer(int delta);
     void toggle_record_enable();
     void trigger_manual_grain();
-    GrainState build_manual_grain_state();
     void update_record_labels();
     void update_meter();
     void open_library_window();
@@ -70,10 +69,11 @@ private:
     void update_lfo_connection_overlay(int lfo_index, bool hovered);
     void assign_lfo_to_knob(int lfo_index, LayerCakeKnob& knob);
     void remove_lfo_from_knob(LayerCakeKnob& knob);
+    void push_modulation_route(const LayerCakeKnob& knob);
+    void restore_modulation_routes_from_engine();
     void update_all_modulation_overlays();
     double get_effective_knob_value(const LayerCakeKnob* knob) const;
     void update_record_layer_from_lfo();
-    void update_master_gain_from_knob();
     void push_lfo_to_engine(int lfo_index);
     void capture_lfo_state(LayerCakePresetData& data) const;
     void apply_lfo_state(const LayerCakePresetData& data);
@@ -723,16 +723,32 @@ void LayerCakeDisplay::filesDropped(const juce::StringArray& files, int x, int y
         return;
     }
 
-    if (!m_engine.load_layer_from_file(layer_index, drop_file))
-    {
-        DBG("LayerCakeDisplay::filesDropped failed to load file=" + drop_file.getFileName());
-        return;
-    }
+    // The engine decodes in the background; redraw once the layer has been swapped in
+    juce::Component::SafePointer<LayerCakeDisplay> safe_this(this);
+    const auto file_name = drop_file.getFileName();
+    const bool started = m_engine.load_layer_from_file(layer_index, drop_file,
+        [safe_this, file_name, layer_index](bool loaded)
+        {
+            juce::MessageManager::callAsync([safe_this, file_name, layer_index, loaded]()
+            {
+                if (safe_this == nullptr)
+                    return;
 
-    DBG("LayerCakeDisplay::filesDropped loaded file=" + drop_file.getFileName()
-        + " layer=" + juce::String(layer_index + 1));
-    refresh_waveforms();
-    repaint();
+                if (!loaded)
+                {
+                    DBG("LayerCakeDisplay::filesDropped failed to load file=" + file_name);
+                    return;
+                }
+
+                DBG("LayerCakeDisplay::filesDropped loaded file=" + file_name
+                    + " layer=" + juce::String(layer_index + 1));
+                safe_this->refresh_waveforms();
+                safe_this->repaint();
+            });
+        });
+
+    if (!started)
+        DBG("LayerCakeDisplay::filesDropped failed to load file=" + file_name);
 }
 
 juce::Rectangle<float> LayerCakeDisplay::lane_bounds_for_index(int layer_index) const
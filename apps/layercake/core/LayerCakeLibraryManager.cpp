@@ -772,8 +772,18 @@ bool LayerCakeLibraryManager::write_layers(const juce::File& folder, const Layer
             return false;
         }
 
+        // Plane 0 first, then (for multichannel layers) a trailer with the
+        // channel count and the remaining planes, which older readers ignore
+        const size_t plane_bytes = layers[i].recorded_length * sizeof(float);
+        const int num_channels = juce::jmax(1, layers[i].num_channels);
         stream.writeInt64(static_cast<juce::int64>(layers[i].recorded_length));
-        stream.write(layers[i].samples.data(), static_cast<int>(layers[i].recorded_length * sizeof(float)));
+        stream.write(layers[i].samples.data(), static_cast<int>(plane_bytes));
+        if (num_channels > 1)
+        {
+            stream.writeInt(num_channels);
+            stream.write(layers[i].samples.data() + layers[i].recorded_length,
+                         static_cast<int>(plane_bytes * static_cast<size_t>(num_channels - 1)));
+        }
         stream.flush();
         if (stream.getStatus().failed())
         {
@@ -790,6 +800,7 @@ bool LayerCakeLibraryManager::read_layers(const juce::File& folder, LayerBufferA
     {
         out_layers[i].samples.clear();
         out_layers[i].recorded_length = 0;
+        out_layers[i].num_channels = 1;
         out_layers[i].has_audio = false;
 
         auto layer_file = folder.getChildFile("layer_" + juce::String(static_cast<int>(i)) + ".bin");
@@ -816,7 +827,27 @@ bool LayerCakeLibraryManager::read_layers(const juce::File& folder, LayerBufferA
             return false;
         }
 
+        int num_channels = 1;
+        if (!stream.isExhausted())
+        {
+            num_channels = stream.readInt();
+            if (num_channels < 2 || num_channels > TapeLoop::kMaxChannels)
+            {
+                DBG("LayerCakeLibraryManager::read_layers bad channel count " + juce::String(num_channels));
+                return false;
+            }
+
+            const size_t extra_bytes = bytes_to_read * static_cast<size_t>(num_channels - 1);
+            out_layers[i].samples.resize(samples_to_read * static_cast<size_t>(num_channels));
+            if (stream.read(out_layers[i].samples.data() + samples_to_read, static_cast<int>(extra_bytes)) != static_cast<int>(extra_bytes))
+            {
+                DBG("LayerCakeLibraryManager::read_layers truncated layer file");
+                return false;
+            }
+        }
+
         out_layers[i].recorded_length = samples_to_read;
+        out_layers[i].num_channels = num_channels;
         out_layers[i].has_audio = true;
     }
     return true;
@@ -1,9 +1,42 @@
 #include "LayerCakeProcessor.h"
 #include "LayerCakeComponent.h"
+#include <iterator>
 
 namespace LayerCakeApp
 {
 
+namespace
+{
+// Parameter ID suffixes, indexed by LayerCakeProcessor::LfoParam.
+constexpr const char* kLfoParamSuffixes[] = {
+    "enabled", "mode", "rate_hz", "clock_division", "pattern_length",
+    "level", "width", "phase", "delay", "delay_div",
+    "slop", "euc_steps", "euc_trigs", "euc_rot",
+    "rnd_skip", "loop_beats", "bipolar"
+};
+
+struct ModulationParameterId
+{
+    const char* parameterId;
+    ModulationTarget target;
+};
+
+// Every engine modulation target is backed by one of the main knobs.
+constexpr ModulationParameterId kModulationParameterIds[] = {
+    { "layercake_position", ModulationTarget::Position },
+    { "layercake_duration", ModulationTarget::Duration },
+    { "layercake_rate", ModulationTarget::Rate },
+    { "layercake_env", ModulationTarget::Envelope },
+    { "layercake_direction", ModulationTarget::Direction },
+    { "layercake_pan", ModulationTarget::Pan },
+    { "layercake_layer_select", ModulationTarget::Layer },
+    { "layercake_master_gain", ModulationTarget::MasterGain },
+};
+
+// Child of the saved state holding parameterId -> LFO slot for each routed knob.
+const juce::Identifier kModulationRoutesType("ModulationRoutes");
+} // namespace
+
 LayerCakeProcessor::LayerCakeProcessor()
     : AudioProcessor(BusesProperties()
                      .withInput("Input", juce::AudioChannelSet::stereo(), true)
@@ -21,6 +54,8 @@ LayerCakeProcessor::LayerCakeProcessor()
     
     m_logger = std::make_unique<juce::FileLogger>(logFile, "LayerCake Log");
     juce::Logger::setCurrentLogger(m_logger.get());
+
+    cacheParameterPointers();
     
     DBG("LayerCakeProcessor initialized");
 }
@@ -146,17 +181,69 @@ void LayerCakeProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::Mi
                            buffer.getNumSamples());
 }
 
+void LayerCakeProcessor::cacheParameterPointers()
+{
+    static_assert(std::size(kLfoParamSuffixes) == static_cast<size_t>(kNumLfoParams), "LFO parameter suffixes out of sync");
+
+    static_assert(std::size(kModulationParameterIds) == ModulationMatrix::kNumTargets, "Modulation parameter table out of sync");
+
+    for (const auto& entry : kModulationParameterIds)
+    {
+        auto& param = m_modulationBaseParams[static_cast<size_t>(entry.target)];
+        param.value = m_apvts.getRawParameterValue(entry.parameterId);
+        jassert(param.value != nullptr);
+    }
+
+    for (int slot = 0; slot < kNumLfoSlots; ++slot)
+    {
+        const juce::String prefix = "lfo" + juce::String(slot + 1) + "_";
+        for (int param = 0; param < kNumLfoParams; ++param)
+        {
+            auto* value = m_apvts.getRawParameterValue(prefix + kLfoParamSuffixes[param]);
+            if (value == nullptr)
+                DBG("LayerCakeProcessor::cacheParameterPointers missing " + prefix + kLfoParamSuffixes[param]);
+            m_lfoParams[static_cast<size_t>(slot)][static_cast<size_t>(param)] = value;
+        }
+    }
+}
+
+bool LayerCakeProcessor::getModulationTarget(const juce::String& parameterId, ModulationTarget& target)
+{
+    for (const auto& entry : kModulationParameterIds)
+    {
+        if (parameterId == entry.parameterId)
+        {
+            target = entry.target;
+            return true;
+        }
+    }
+    return false;
+}
+
 void LayerCakeProcessor::updateEngineParams()
 {
-    // Main params
-    m_engine.set_master_gain_db(m_apvts.getRawParameterValue("layercake_master_gain")->load());
-    m_engine.set_record_layer((int)m_apvts.getRawParameterValue("layercake_layer_select")->load() - 1);
-    // ... manual grain state is complex, it might be better to let the UI push it or only update if changed
-    // For now, basic params. Manual Grain State is typically UI driven or automated via params if we map them all. 
-    // Ideally, m_engine exposes methods to update individual grain parameters or we reconstruct state here.
+    // Knob values become the engine's modulation bases. Only pushed when a
+    // parameter moves; the engine applies LFO routing itself.
+    for (size_t index = 0; index < m_modulationBaseParams.size(); ++index)
+    {
+        auto& param = m_modulationBaseParams[index];
+        if (param.value == nullptr)
+            continue;
+
+        const float value = param.value->load();
+        if (value == param.last)
+            continue;
+
+        param.last = value;
+        const auto target = static_cast<ModulationTarget>(index);
+        m_engine.set_modulation_base(target, value);
+
+        if (target == ModulationTarget::Layer)
+            m_engine.set_record_layer((int)value - 1);
+    }
     
     // We need to update LFOs
-    for (int i = 0; i < 8; ++i)
+    for (int i = 0; i < kNumLfoSlots; ++i)
     {
         updateLfoParams(i);
     }
@@ -164,33 +251,43 @@ void LayerCakeProcessor::updateEngineParams()
 
 void LayerCakeProcessor::updateLfoParams(int i)
 {
-    juce::String prefix = "lfo" + juce::String(i + 1) + "_";
-    
-    bool enabled = (bool)m_apvts.getRawParameterValue(prefix + "enabled")->load();
-    
-    flower::LayerCakeLfoUGen generator;
-    generator.set_mode(static_cast<flower::LfoWaveform>((int)m_apvts.getRawParameterValue(prefix + "mode")->load()));
-    generator.set_rate_hz(m_apvts.getRawParameterValue(prefix + "rate_hz")->load());
-    generator.set_clock_division(m_apvts.getRawParameterValue(prefix + "clock_division")->load());
-    generator.set_pattern_length((int)m_apvts.getRawParameterValue(prefix + "pattern_length")->load());
-    
-    generator.set_level(m_apvts.getRawParameterValue(prefix + "level")->load());
-    generator.set_width(m_apvts.getRawParameterValue(prefix + "width")->load());
-    generator.set_phase_offset(m_apvts.getRawParameterValue(prefix + "phase")->load());
-    generator.set_delay(m_apvts.getRawParameterValue(prefix + "delay")->load());
-    generator.set_delay_div((int)m_apvts.getRawParameterValue(prefix + "delay_div")->load());
-    
-    generator.set_slop(m_apvts.getRawParameterValue(prefix + "slop")->load());
-    
-    generator.set_euclidean_steps((int)m_apvts.getRawParameterValue(prefix + "euc_steps")->load());
-    generator.set_euclidean_triggers((int)m_apvts.getRawParameterValue(prefix + "euc_trigs")->load());
-    generator.set_euclidean_rotation((int)m_apvts.getRawParameterValue(prefix + "euc_rot")->load());
-    
-    generator.set_random_skip(m_apvts.getRawParameterValue(prefix + "rnd_skip")->load());
-    generator.set_loop_beats((int)m_apvts.getRawParameterValue(prefix + "loop_beats")->load());
-    generator.set_bipolar((bool)m_apvts.getRawParameterValue(prefix + "bipolar")->load());
-    
-    m_engine.update_lfo_slot(i, generator, enabled);
+    const auto& params = m_lfoParams[static_cast<size_t>(i)];
+    auto& last = m_lastLfoValues[static_cast<size_t>(i)];
+
+    LfoParamValues values{};
+    for (size_t param = 0; param < values.size(); ++param)
+        values[param] = params[param] != nullptr ? params[param]->load() : 0.0f;
+
+    if (m_lfoValuesValid[static_cast<size_t>(i)] && values == last)
+        return;
+
+    last = values;
+    m_lfoValuesValid[static_cast<size_t>(i)] = true;
+
+    auto& generator = m_lfoGenerators[static_cast<size_t>(i)];
+    generator.set_mode(static_cast<flower::LfoWaveform>((int)values[LfoMode]));
+    generator.set_rate_hz(values[LfoRateHz]);
+    generator.set_clock_division(values[LfoClockDivision]);
+    generator.set_pattern_length((int)values[LfoPatternLength]);
+
+    generator.set_level(values[LfoLevel]);
+    generator.set_width(values[LfoWidth]);
+    generator.set_phase_offset(values[LfoPhase]);
+    generator.set_delay(values[LfoDelay]);
+    generator.set_delay_div((int)values[LfoDelayDiv]);
+
+    generator.set_slop(values[LfoSlop]);
+
+    generator.set_euclidean_steps((int)values[LfoEucSteps]);
+    generator.set_euclidean_triggers((int)values[LfoEucTrigs]);
+    generator.set_euclidean_rotation((int)values[LfoEucRot]);
+
+    generator.set_random_skip(values[LfoRndSkip]);
+    generator.set_loop_beats((int)values[LfoLoopBeats]);
+    generator.set_bipolar((bool)values[LfoBipolar]);
+
+    // We're on the audio thread already, so apply straight to the runtime slot.
+    m_engine.apply_lfo_slot_from_audio_thread(i, generator, (bool)values[LfoEnabled]);
 }
 
 
@@ -255,6 +352,17 @@ void LayerCakeProcessor::changeProgramName(int index, const juce::String& newNam
 void LayerCakeProcessor::getStateInformation(juce::MemoryBlock& destData)
 {
     auto state = m_apvts.copyState();
+
+    // Routes live in the engine, not the APVTS, so save them alongside it.
+    juce::ValueTree routes(kModulationRoutesType);
+    for (const auto& entry : kModulationParameterIds)
+    {
+        const int slot = m_engine.get_modulation_route(entry.target);
+        if (slot >= 0)
+            routes.setProperty(entry.parameterId, slot, nullptr);
+    }
+    state.appendChild(routes, nullptr);
+
     std::unique_ptr<juce::XmlElement> xml(state.createXml());
     copyXmlToBinary(*xml, destData);
 }
@@ -262,9 +370,16 @@ void LayerCakeProcessor::getStateInformation(juce::MemoryBlock& destData)
 void LayerCakeProcessor::setStateInformation(const void* data, int sizeInBytes)
 {
     std::unique_ptr<juce::XmlElement> xmlState(getXmlFromBinary(data, sizeInBytes));
-    if (xmlState.get() != nullptr)
-        if (xmlState->hasTagName(m_apvts.state.getType()))
-            m_apvts.replaceState(juce::ValueTree::fromXml(*xmlState));
+    if (xmlState.get() == nullptr || !xmlState->hasTagName(m_apvts.state.getType()))
+        return;
+
+    auto state = juce::ValueTree::fromXml(*xmlState);
+    const auto routes = state.getChildWithName(kModulationRoutesType);
+    for (const auto& entry : kModulationParameterIds)
+        m_engine.set_modulation_route(entry.target, static_cast<int>(routes.getProperty(entry.parameterId, -1)));
+    state.removeChild(routes, nullptr);
+
+    m_apvts.replaceState(state);
 }
 
 } // namespace LayerCakeApp
@@ -2,6 +2,8 @@
 
 #include <juce_audio_processors/juce_audio_processors.h>
 #include <flowerjuce/LayerCakeEngine/LayerCakeEngine.h>
+#include <array>
+#include <limits>
 
 namespace LayerCakeApp
 {
@@ -41,15 +43,60 @@ public:
     LayerCakeEngine& getEngine() { return m_engine; }
     juce::AudioProcessorValueTreeState& getAPVTS() { return m_apvts; }
 
+    // Maps a knob/APVTS parameter ID to the engine modulation target it drives.
+    static bool getModulationTarget(const juce::String& parameterId, ModulationTarget& target);
+
 private:
     std::unique_ptr<juce::FileLogger> m_logger;
     LayerCakeEngine m_engine;
     juce::AudioProcessorValueTreeState m_apvts;
 
+    // Per-slot LFO parameters, in the order of kLfoParamSuffixes.
+    enum LfoParam
+    {
+        LfoEnabled = 0,
+        LfoMode,
+        LfoRateHz,
+        LfoClockDivision,
+        LfoPatternLength,
+        LfoLevel,
+        LfoWidth,
+        LfoPhase,
+        LfoDelay,
+        LfoDelayDiv,
+        LfoSlop,
+        LfoEucSteps,
+        LfoEucTrigs,
+        LfoEucRot,
+        LfoRndSkip,
+        LfoLoopBeats,
+        LfoBipolar,
+        kNumLfoParams
+    };
+
+    static constexpr int kNumLfoSlots = static_cast<int>(LayerCakeEngine::kNumLfoSlots);
+    using LfoParamValues = std::array<float, kNumLfoParams>;
+
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
+    void cacheParameterPointers();
     void updateEngineParams();
     void updateLfoParams(int slotIndex);
 
+    // Raw parameter pointers are looked up once so the audio thread never
+    // builds parameter ID strings. The last pushed values let us skip
+    // engine updates when nothing moved.
+    struct ModulationBaseParam
+    {
+        std::atomic<float>* value{nullptr};
+        float last{std::numeric_limits<float>::quiet_NaN()};
+    };
+    std::array<ModulationBaseParam, ModulationMatrix::kNumTargets> m_modulationBaseParams{};
+
+    std::array<std::array<std::atomic<float>*, kNumLfoParams>, kNumLfoSlots> m_lfoParams{};
+    std::array<LfoParamValues, kNumLfoSlots> m_lastLfoValues{};
+    std::array<bool, kNumLfoSlots> m_lfoValuesValid{};
+    std::array<flower::LayerCakeLfoUGen, kNumLfoSlots> m_lfoGenerators;
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(LayerCakeProcessor)
 };
 
@@ -0,0 +1,115 @@
+#include "LayerCakeSceneRenderer.h"
+#include "LayerCakeProcessor.h"
+
+namespace
+{
+constexpr const char* kTempoParameterId = "layercake_tempo";
+constexpr const char* kTriggerAssignmentId = "triggerButton";
+constexpr double kDefaultSceneTempo = 140.0;
+
+// Same mapping as LayerCakeComponent::apply_lfo_state, minus the APVTS/UI side.
+flower::LayerCakeLfoUGen make_lfo_generator(const LayerCakePresetData::LfoSlotData& slot)
+{
+    const int max_mode = static_cast<int>(flower::LfoWaveform::SmoothRandom);
+
+    flower::LayerCakeLfoUGen generator;
+    generator.set_mode(static_cast<flower::LfoWaveform>(juce::jlimit(0, max_mode, slot.mode)));
+    generator.set_rate_hz(slot.rate_hz);
+    generator.set_clock_division(slot.clock_division);
+    generator.set_pattern_length(slot.pattern_length);
+    generator.set_pattern_buffer(slot.pattern_buffer);
+    generator.set_level(slot.level);
+    generator.set_width(slot.width);
+    generator.set_phase_offset(slot.phase_offset);
+    generator.set_delay(slot.delay);
+    generator.set_delay_div(slot.delay_div);
+    generator.set_slop(slot.slop);
+    generator.set_euclidean_steps(slot.euclidean_steps);
+    generator.set_euclidean_triggers(slot.euclidean_triggers);
+    generator.set_euclidean_rotation(slot.euclidean_rotation);
+    generator.set_random_skip(slot.random_skip);
+    generator.set_loop_beats(slot.loop_beats);
+    generator.set_bipolar(slot.bipolar);
+    if (slot.random_seed != 0)
+        generator.set_random_seed(slot.random_seed);
+    generator.reset_phase();
+    return generator;
+}
+} // namespace
+
+namespace LayerCakeSceneRenderer
+{
+    double get_scene_tempo(const LayerCakePresetData& data)
+    {
+        if (const juce::var* value = data.knob_values.getVarPointer(juce::Identifier(kTempoParameterId)))
+            return static_cast<double>(*value);
+        return kDefaultSceneTempo;
+    }
+
+    void apply_scene(const LayerCakePresetData& data,
+                     const LayerBufferArray& layers,
+                     LayerCakeEngine& engine)
+    {
+        for (size_t layer = 0; layer < layers.size(); ++layer)
+            engine.apply_layer_snapshot(static_cast<int>(layer), layers[layer]);
+
+        engine.set_record_layer(data.record_layer);
+        engine.set_master_gain_db(data.master_gain_db);
+
+        for (const auto& entry : data.knob_values)
+        {
+            ModulationTarget target{};
+            if (!LayerCakeApp::LayerCakeProcessor::getModulationTarget(entry.name.toString(), target))
+                continue;
+
+            const float value = static_cast<float>(static_cast<double>(entry.value));
+            engine.set_modulation_base(target, value);
+            if (target == ModulationTarget::Layer)
+                engine.set_record_layer(static_cast<int>(value) - 1);
+        }
+
+        for (size_t slot = 0; slot < data.lfo_slots.size(); ++slot)
+        {
+            const auto& slot_data = data.lfo_slots[slot];
+            engine.update_lfo_slot(static_cast<int>(slot), make_lfo_generator(slot_data), slot_data.enabled);
+        }
+
+        for (size_t target = 0; target < ModulationMatrix::kNumTargets; ++target)
+            engine.set_modulation_route(static_cast<ModulationTarget>(target), -1);
+
+        int trigger_lfo = -1;
+        for (const auto& entry : data.lfo_assignments)
+        {
+            const int slot = static_cast<int>(entry.value);
+            if (slot < 0 || slot >= static_cast<int>(LayerCakeEngine::kNumLfoSlots))
+            {
+                DBG("LayerCakeSceneRenderer::apply_scene ignoring assignment " + entry.name.toString());
+                continue;
+            }
+
+            if (entry.name.toString() == kTriggerAssignmentId)
+            {
+                trigger_lfo = slot;
+                continue;
+            }
+
+            ModulationTarget target{};
+            if (LayerCakeApp::LayerCakeProcessor::getModulationTarget(entry.name.toString(), target))
+                engine.set_modulation_route(target, slot);
+        }
+        engine.set_trigger_lfo_index(trigger_lfo);
+    }
+
+    bool render_scene(const LayerCakePresetData& data,
+                      const LayerBufferArray& layers,
+                      double num_beats,
+                      const LayerCakeEngine::OfflineRenderSettings& settings,
+                      juce::AudioFormatWriter& writer)
+    {
+        // The engine carries large fixed arrays, so keep it off the stack.
+        auto engine = std::make_unique<LayerCakeEngine>();
+        engine->prepare(writer.getSampleRate(), settings.block_size, static_cast<int>(writer.getNumChannels()));
+        apply_scene(data, layers, *engine);
+        return engine->render_offline(settings, num_beats, writer);
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "LayerCakeLibraryManager.h"
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <flowerjuce/LayerCakeEngine/LayerCakeEngine.h>
+
+// Turns a saved scene into engine state without a processor or editor, so
+// scenes can be rendered headless (see the LayerCakeRender CLI).
+namespace LayerCakeSceneRenderer
+{
+    // Tempo stored with the scene's tempo knob, or the parameter default.
+    double get_scene_tempo(const LayerCakePresetData& data);
+
+    // Pushes layers, knob values, LFO slots and LFO routes into a prepared
+    // engine. Call after prepare: prepare clears the layers.
+    void apply_scene(const LayerCakePresetData& data,
+                     const LayerBufferArray& layers,
+                     LayerCakeEngine& engine);
+
+    // Builds an engine at the writer's sample rate and channel count, applies
+    // the scene and renders num_beats of it offline.
+    bool render_scene(const LayerCakePresetData& data,
+                      const LayerBufferArray& layers,
+                      double num_beats,
+                      const LayerCakeEngine::OfflineRenderSettings& settings,
+                      juce::AudioFormatWriter& writer);
+}
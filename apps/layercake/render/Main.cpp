@@ -0,0 +1,107 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "../core/LayerCakeLibraryManager.h"
+#include "../core/LayerCakeSceneRenderer.h"
+#include <iostream>
+
+// Renders a saved LayerCake scene to a WAV file, faster than realtime.
+//
+//   LayerCakeRender <scene> <beats> <output.wav> [--bpm N] [--seed N]
+//                   [--rate HZ] [--channels N] [--block N]
+//
+// The tempo defaults to the scene's tempo knob. Same arguments, same file.
+
+namespace
+{
+void print_usage()
+{
+    std::cerr << "usage: LayerCakeRender <scene> <beats> <output.wav> [--bpm N] [--seed N]"
+                 " [--rate HZ] [--channels N] [--block N]" << std::endl;
+}
+
+// Value following a --flag, or fallback when the flag is missing.
+juce::String get_option(const juce::StringArray& args, const juce::String& flag, const juce::String& fallback)
+{
+    const int index = args.indexOf(flag);
+    if (index < 0 || index + 1 >= args.size())
+        return fallback;
+    return args[index + 1];
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    juce::StringArray args;
+    for (int i = 1; i < argc; ++i)
+        args.add(juce::String::fromUTF8(argv[i]));
+
+    if (args.size() < 3)
+    {
+        print_usage();
+        return 1;
+    }
+
+    const juce::String scene_name = args[0];
+    const double num_beats = args[1].getDoubleValue();
+    const juce::File output_file = juce::File::getCurrentWorkingDirectory().getChildFile(args[2]);
+
+    LayerCakeLibraryManager library;
+    LayerCakePresetData data;
+    LayerBufferArray layers{};
+    if (!library.load_scene(scene_name, data, layers))
+    {
+        std::cerr << "could not load scene '" << scene_name << "'" << std::endl;
+        return 1;
+    }
+
+    if (data.lfo_assignments.getVarPointer(juce::Identifier("triggerButton")) == nullptr)
+        std::cerr << "scene has no LFO on the trigger button, the render will be silent" << std::endl;
+
+    LayerCakeEngine::OfflineRenderSettings settings;
+    settings.bpm = get_option(args, "--bpm", juce::String(LayerCakeSceneRenderer::get_scene_tempo(data))).getDoubleValue();
+    settings.random_seed = get_option(args, "--seed", "1").getLargeIntValue();
+    settings.block_size = get_option(args, "--block", juce::String(LayerCakeEngine::kOfflineBlockSize)).getIntValue();
+    const double sample_rate = get_option(args, "--rate", "48000").getDoubleValue();
+    const int num_channels = get_option(args, "--channels", "2").getIntValue();
+
+    if (num_beats <= 0.0 || settings.bpm <= 0.0 || settings.block_size <= 0 || sample_rate <= 0.0 || num_channels <= 0)
+    {
+        print_usage();
+        return 1;
+    }
+
+    output_file.deleteFile();
+    std::unique_ptr<juce::OutputStream> stream = output_file.createOutputStream();
+    if (stream == nullptr)
+    {
+        std::cerr << "could not open " << output_file.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    juce::WavAudioFormat wav_format;
+    auto options = juce::AudioFormatWriterOptions{}.withSampleRate(sample_rate)
+                                                   .withNumChannels(num_channels)
+                                                   .withBitsPerSample(24);
+
+    // Writer takes ownership of the stream
+    std::unique_ptr<juce::AudioFormatWriter> writer(wav_format.createWriterFor(stream, options));
+    if (writer == nullptr)
+    {
+        std::cerr << "could not create a WAV writer for " << output_file.getFullPathName() << std::endl;
+        return 1;
+    }
+
+    const auto start_ms = juce::Time::getMillisecondCounterHiRes();
+    if (!LayerCakeSceneRenderer::render_scene(data, layers, num_beats, settings, *writer))
+    {
+        std::cerr << "render failed" << std::endl;
+        return 1;
+    }
+    writer.reset();
+
+    const double elapsed_seconds = (juce::Time::getMillisecondCounterHiRes() - start_ms) / 1000.0;
+    const double rendered_seconds = num_beats * 60.0 / settings.bpm;
+    std::cout << "rendered " << num_beats << " beats (" << rendered_seconds << " s) of '" << scene_name
+              << "' in " << elapsed_seconds << " s to " << output_file.getFullPathName() << std::endl;
+    return 0;
+}
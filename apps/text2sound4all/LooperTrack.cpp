@@ -231,10 +231,8 @@ LooperTrack::LooperTrack(MultiTrackLooperEngine& engine, int index, std::functio
     // Note: panner2DComponent will be created later, so we'll set this after it's created
     onsetToggleEnabled.store(true);
     
-    // Setup audio sample callback for onset detection
-    looperEngine.get_track_engine(trackIndex).set_audio_sample_callback([this](float sample) {
-        feedAudioSample(sample);
-    });
+    // Receive the pre-fader playback blocks for onset detection
+    looperEngine.get_track_engine(trackIndex).set_pre_fader_tap(this);
     
     // Setup reset button
     resetButton.onClick = [this] { resetButtonClicked(); };
@@ -1324,6 +1322,8 @@ void LooperTrack::resetButtonClicked()
 
 LooperTrack::~LooperTrack()
 {
+    // Detach from the audio thread before any member the tap uses goes away
+    looperEngine.get_track_engine(trackIndex).set_pre_fader_tap(nullptr);
     stopTimer();
     
     // Remove mouse listener first
@@ -1456,89 +1456,43 @@ void LooperTrack::generatePath(const juce::String& pathType)
     DBG("LooperTrack: Generated " + juce::String(trajectoryPoints.size()) + " points for path type: " + pathType);
 }
 
-void LooperTrack::feedAudioSample(float sample)
+void LooperTrack::process_pre_fader_block(const float* samples, int num_samples, double sample_rate)
 {
-    // Feed audio sample to onset detector (called from audio thread)
+    // Feed the block to the onset detector (called from audio thread)
     // Process onset detection directly here for low latency
     
     // Only process if onset toggle is enabled and trajectory is playing (use atomic flags)
-    bool onsetEnabled = onsetToggleEnabled.load();
-    bool trajPlaying = trajectoryPlaying.load();
-    
-    // Debug: Log state periodically (every 10000 samples ~= every 0.2s at 44.1kHz)
-    // static int sample_count = 0;
-    // sample_count++;
-    // if (sample_count % 10000 == 0)
-    // {
-    //     // DBG("LooperTrack[" + juce::String(trackIndex) + "]: feedAudioSample - onsetEnabled=" + 
-    //         (onsetEnabled ? "true" : "false") + ", trajPlaying=" + (trajPlaying ? "true" : "false"));
-    // }
-    
-    if (!onsetEnabled || !trajPlaying)
+    if (!onsetToggleEnabled.load() || !trajectoryPlaying.load())
         return;
     
-    // Add sample to processing buffer (lock-free, single writer from audio thread)
-    int currentFill = onsetBufferFill.load();
-    if (currentFill < onsetBlockSize)
-    {
-        onsetProcessingBuffer[currentFill] = sample;
-        int newFill = currentFill + 1;
-        onsetBufferFill.store(newFill);
+    if (sample_rate <= 0.0)
+        sample_rate = 44100.0;
+    
+    onsetDetector.set_sample_rate(sample_rate);
+    onsetSampleRate.store(sample_rate);
+    
+    // Onsets come back with sample-accurate stream positions, independent of block size
+    const int numOnsets = onsetDetector.process_block(samples, num_samples, detectedOnsets.data(),
+                                                      static_cast<int>(detectedOnsets.size()));
+    if (numOnsets > 0)
+    {
+        // Queue every onset for the panner; if the message thread falls behind, extra onsets are dropped
+        int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+        pendingOnsetFifo.prepareToWrite(numOnsets, start1, size1, start2, size2);
+        for (int i = 0; i < size1; ++i)
+            pendingOnsetPositions[static_cast<size_t>(start1 + i)] = detectedOnsets[static_cast<size_t>(i)].stream_position;
+        for (int i = 0; i < size2; ++i)
+            pendingOnsetPositions[static_cast<size_t>(start2 + i)] = detectedOnsets[static_cast<size_t>(size1 + i)].stream_position;
+        pendingOnsetFifo.finishedWrite(size1 + size2);
         
-        // When buffer is full, process for onset detection
-        if (newFill >= onsetBlockSize)
-        {
-            // Get sample rate (cached to avoid repeated atomic reads)
-            auto& track = looperEngine.get_track_engine(trackIndex);
-            double sample_rate = track.get_sample_rate();
-            if (sample_rate <= 0.0)
-                sample_rate = 44100.0;
-            lastOnsetSampleRate = sample_rate;
-            
-            // Process block for onset detection
-            bool detected = onsetDetector.processBlock(onsetProcessingBuffer.data(), onsetBlockSize, sample_rate);
-            
-            // Debug: Log loudness periodically to see if we're getting audio
-            static int block_count = 0;
-            block_count++;
-            if (block_count % 100 == 0) // Every 100 blocks (~12.8s at 128 samples/block, 44.1kHz)
-            {
-                // Calculate loudness manually for debugging
-                float sumSquares = 0.0f;
-                for (int i = 0; i < onsetBlockSize; ++i)
-                {
-                    sumSquares += onsetProcessingBuffer[i] * onsetProcessingBuffer[i];
-                }
-                float rms = std::sqrt(sumSquares / static_cast<float>(onsetBlockSize));
-                float peak = 0.0f;
-                for (int i = 0; i < onsetBlockSize; ++i)
-                {
-                    peak = juce::jmax(peak, std::abs(onsetProcessingBuffer[i]));
-                }
-                // DBG("LooperTrack[" + juce::String(trackIndex) + "]: Audio levels - RMS=" + juce::String(rms, 4) + 
-                    // " Peak=" + juce::String(peak, 4) + " Threshold=" + juce::String(onsetDetector.getThreshold(), 4));
-            }
-            
-            if (detected)
-            {
-                // DBG("LooperTrack[" + juce::String(trackIndex) + "]: Onset detected! (audio thread) - advancing trajectory");
-                
-                // Update atomic flags for UI thread
-                onsetDetected.store(true);
-                double currentTime = juce::Time::getMillisecondCounterHiRes() / 1000.0;
-                onsetLEDBrightness.store(1.0);
-                lastOnsetLEDTime.store(currentTime);
-                
-                // Set flag to advance trajectory (will be processed on message thread)
-                pendingTrajectoryAdvance.store(true);
-                
-                // Trigger async update for UI repaint and trajectory advancement (non-blocking, safe from audio thread)
-                triggerAsyncUpdate();
-            }
-            
-            // Reset buffer
-            onsetBufferFill.store(0);
-        }
+        // Update atomic flags for UI thread
+        onsetDetected.store(true);
+        double currentTime = juce::Time::getMillisecondCounterHiRes() / 1000.0;
+        onsetLEDBrightness.store(1.0);
+        lastOnsetLEDTime.store(currentTime);
+        
+        // Trigger async update for UI repaint and trajectory advancement (non-blocking, safe from audio thread)
+        triggerAsyncUpdate();
     }
 }
 
@@ -1565,7 +1519,7 @@ void LooperTrack::timerCallback()
         }
     }
     
-    // Note: Onset detection is now processed directly in feedAudioSample() from audio thread
+    // Note: Onset detection is now processed directly in process_pre_fader_block() from audio thread
     // for low latency. Timer callback only handles LED fade-out.
     
     float current_pos = track.get_pos();
@@ -1653,22 +1607,27 @@ void LooperTrack::timerCallback()
 void LooperTrack::handleAsyncUpdate()
 {
     // Called from message thread when onset is detected (triggered from audio thread)
-    // Advance trajectory if pending
-    if (pendingTrajectoryAdvance.load())
+    // Advance the trajectory once per pending onset, in stream order
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    pendingOnsetFifo.prepareToRead(pendingOnsetFifo.getNumReady(), start1, size1, start2, size2);
+    if (size1 + size2 > 0)
     {
-        pendingTrajectoryAdvance.store(false);
-        DBG("LooperTrack[" + juce::String(trackIndex) + "]: handleAsyncUpdate - advancing trajectory");
+        DBG("LooperTrack[" + juce::String(trackIndex) + "]: handleAsyncUpdate - advancing trajectory for "
+            + juce::String(size1 + size2) + " onset(s)");
         if (panner2DComponent != nullptr)
         {
-            bool wasPlaying = panner2DComponent->is_playing();
-            DBG("LooperTrack[" + juce::String(trackIndex) + "]: panner2DComponent->is_playing()=" + (wasPlaying ? "true" : "false"));
-            panner2DComponent->advance_trajectory_onset();
+            const double sampleRate = onsetSampleRate.load();
+            for (int i = 0; i < size1; ++i)
+                panner2DComponent->advance_trajectory_onset(pendingOnsetPositions[static_cast<size_t>(start1 + i)], sampleRate);
+            for (int i = 0; i < size2; ++i)
+                panner2DComponent->advance_trajectory_onset(pendingOnsetPositions[static_cast<size_t>(start2 + i)], sampleRate);
         }
         else
         {
             DBG("LooperTrack[" + juce::String(trackIndex) + "]: ERROR - panner2DComponent is null!");
         }
     }
+    pendingOnsetFifo.finishedRead(size1 + size2);
     
     // Force immediate repaint to show LED
     repaint();
@@ -20,7 +20,7 @@
 #include <flowerjuce/Panners/CLEATPanner.h>
 #include <flowerjuce/Panners/Panner2DComponent.h>
 #include <flowerjuce/Panners/PathGeneratorButtons.h>
-#include <flowerjuce/DSP/OnsetDetector.h>
+#include <flowerjuce/DSP/SpectralFluxOnsetDetector.h>
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <memory>
 #include <functional>
@@ -93,7 +93,8 @@ private:
     juce::Result saveBufferToFile(int trackIndex, juce::File& outputFile);
 };
 
-class LooperTrack : public juce::Component, public juce::Timer, public juce::AsyncUpdater
+class LooperTrack : public juce::Component, public juce::Timer, public juce::AsyncUpdater,
+                    private LooperTrackEngine::PreFaderTap
 {
 public:
     LooperTrack(MultiTrackLooperEngine& engine, int trackIndex, std::function<juce::String()> gradioUrlProvider, Shared::MidiLearnManager* midiManager = nullptr, const juce::String& pannerTypeStr = "Stereo");
@@ -176,26 +177,22 @@ private:
     juce::Label cutoffLabel;
     
     // Onset detector for audio analysis
-    OnsetDetector onsetDetector;
+    SpectralFluxOnsetDetector onsetDetector;
+    std::array<SpectralFluxOnsetDetector::Onset, 16> detectedOnsets; // Audio thread scratch
     
-    // Audio buffer for onset detection (thread-safe circular buffer)
-    static constexpr int audioBufferSize = 1024;
-    juce::AbstractFifo audioFifo{audioBufferSize};
-    std::array<float, audioBufferSize> audioBuffer;
     std::atomic<bool> onsetDetected{false};
-    std::atomic<bool> pendingTrajectoryAdvance{false}; // Flag to advance trajectory on message thread
+    
+    // Onset stream positions waiting to advance the trajectory on the message thread
+    static constexpr int pendingOnsetCapacity = 64;
+    juce::AbstractFifo pendingOnsetFifo{pendingOnsetCapacity};
+    std::array<juce::int64, pendingOnsetCapacity> pendingOnsetPositions{};
+    std::atomic<double> onsetSampleRate{44100.0};
     
     // Onset indicator LED state (for visual feedback)
     std::atomic<double> onsetLEDBrightness{0.0}; // 0.0 to 1.0, fades out over time
     std::atomic<double> lastOnsetLEDTime{0.0};
     static constexpr double onsetLEDDecayTime{0.2}; // LED stays lit for 200ms
     
-    // Onset detection processing state (accessed from audio thread)
-    static constexpr int onsetBlockSize = 128; // Process in small blocks for low latency (~2.9ms at 44.1kHz)
-    std::array<float, onsetBlockSize> onsetProcessingBuffer;
-    std::atomic<int> onsetBufferFill{0}; // Thread-safe counter
-    double lastOnsetSampleRate{44100.0};
-    
     // Thread-safe flags for audio thread access
     std::atomic<bool> onsetToggleEnabled{false}; // Cached from UI thread
     std::atomic<bool> trajectoryPlaying{false}; // Cached from panner state
@@ -203,8 +200,8 @@ private:
     // Custom toggle button look and feel (similar to TransportControls)
     Shared::EmptyToggleLookAndFeel emptyToggleLookAndFeel;
     
-    // Method to feed audio samples to onset detector (called from audio thread)
-    void feedAudioSample(float sample);
+    // Pre-fader tap: feeds each playback block to the onset detector (called from audio thread)
+    void process_pre_fader_block(const float* samples, int num_samples, double sample_rate) override;
     
     std::unique_ptr<GradioWorkerThread> gradioWorkerThread;
     std::function<juce::String()> gradioUrlProvider;
@@ -14,9 +14,9 @@ juce::Result saveTrackBufferToWavFile(
     auto& track_engine = engine.get_track_engine(trackIndex);
     
     const juce::ScopedLock sl(track_engine.get_buffer_lock());
-    const auto& buffer = track_engine.get_buffer();
+    const size_t buffer_size = track_engine.get_buffer_size();
     
-    if (buffer.empty())
+    if (buffer_size == 0)
     {
         return juce::Result::fail("Buffer is empty");
     }
@@ -29,11 +29,11 @@ juce::Result saveTrackBufferToWavFile(
     }
     if (loop_end == 0)
     {
-        loop_end = buffer.size(); // Fallback to full buffer
+        loop_end = buffer_size; // Fallback to full buffer
     }
     
     // Clamp wrapPos to buffer size
-    loop_end = juce::jmin(loop_end, buffer.size());
+    loop_end = juce::jmin(loop_end, buffer_size);
     
     if (loop_end == 0)
     {
@@ -82,14 +82,9 @@ juce::Result saveTrackBufferToWavFile(
 
     // Write audio data (cropped to wrapPos)
     // Convert float buffer to AudioBuffer for writing
+    // (read() also covers chunked tapes, which have no contiguous buffer)
     juce::AudioBuffer<float> audioBuffer(1, static_cast<int>(loop_end));
-    const float* source = buffer.data();
-    float* dest = audioBuffer.getWritePointer(0);
-    
-    for (size_t i = 0; i < loop_end; ++i)
-    {
-        dest[i] = source[i];
-    }
+    track_engine.read_buffer(0, audioBuffer.getWritePointer(0), loop_end);
 
     // Write the buffer
     if (!writer->writeFromAudioSampleBuffer(audioBuffer, 0, audioBuffer.getNumSamples()))
@@ -130,11 +125,11 @@ juce::Result saveTrackBufferToWavFile(
     }
     if (loop_end == 0)
     {
-        loop_end = buffer.size(); // Fallback to full buffer
+        loop_end = buffer_size; // Fallback to full buffer
     }
     
     // Clamp wrapPos to buffer size
-    loop_end = juce::jmin(loop_end, buffer.size());
+    loop_end = juce::jmin(loop_end, buffer_size);
     
     if (loop_end == 0)
     {
@@ -183,14 +178,9 @@ juce::Result saveTrackBufferToWavFile(
 
     // Write audio data (cropped to wrapPos)
     // Convert float buffer to AudioBuffer for writing
+    // (read() also covers chunked tapes, which have no contiguous buffer)
     juce::AudioBuffer<float> audioBuffer(1, static_cast<int>(loop_end));
-    const float* source = buffer.data();
-    float* dest = audioBuffer.getWritePointer(0);
-    
-    for (size_t i = 0; i < loop_end; ++i)
-    {
-        dest[i] = source[i];
-    }
+    track_engine.read_buffer(0, audioBuffer.getWritePointer(0), loop_end);
 
     // Write the buffer
     if (!writer->writeFromAudioSampleBuffer(audioBuffer, 0, audioBuffer.getNumSamples()))
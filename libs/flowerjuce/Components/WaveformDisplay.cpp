@@ -34,7 +34,7 @@ void WaveformDisplay::drawWaveform(juce::Graphics& g, juce::Rectangle<int> area)
     
     // Get buffer and related info via track_engine
     const juce::ScopedLock sl(track_engine.get_buffer_lock());
-    const auto& buffer = track_engine.get_buffer();
+    const size_t bufferSize = track_engine.get_buffer_size();
     
     // Determine display length - use loop_end if set (for duration control), otherwise use recorded_length
     size_t wrapPos = track_engine.get_loop_end();
@@ -56,15 +56,15 @@ void WaveformDisplay::drawWaveform(juce::Graphics& g, juce::Rectangle<int> area)
         return;
     }
     
-    if (buffer.empty())
+    if (bufferSize == 0)
         return;
     
     // Use buffer size if no recorded length yet
     if (displayLength == 0)
-        displayLength = buffer.size();
+        displayLength = bufferSize;
     
     // Clamp displayLength to buffer size
-    displayLength = juce::jmin(displayLength, buffer.size());
+    displayLength = juce::jmin(displayLength, bufferSize);
     
     // Draw waveform - use red-orange when recording, teal when playing
     g.setColour(track_engine.get_record_enable() ? juce::Colour(0xfff04e36) : juce::Colour(0xff1eb19d));
@@ -88,9 +88,9 @@ void WaveformDisplay::drawWaveform(juce::Graphics& g, juce::Rectangle<int> area)
         size_t endSample = static_cast<size_t>((x + 1) * samplesPerPixel);
         endSample = juce::jmin(endSample, displayLength);
         
-        for (size_t i = sampleIndex; i < endSample && i < buffer.size(); ++i)
+        for (size_t i = sampleIndex; i < endSample && i < bufferSize; ++i)
         {
-            maxSample = juce::jmax(maxSample, std::abs(buffer[i]));
+            maxSample = juce::jmax(maxSample, std::abs(track_engine.get_sample(i)));
         }
         
         float y = area.getCentreY() - (maxSample * area.getHeight() * 0.5f);
@@ -110,9 +110,9 @@ void WaveformDisplay::drawWaveform(juce::Graphics& g, juce::Rectangle<int> area)
         size_t endSample = static_cast<size_t>((x + 1) * samplesPerPixel);
         endSample = juce::jmin(endSample, displayLength);
         
-        for (size_t i = sampleIndex; i < endSample && i < buffer.size(); ++i)
+        for (size_t i = sampleIndex; i < endSample && i < bufferSize; ++i)
         {
-            maxSample = juce::jmax(maxSample, std::abs(buffer[i]));
+            maxSample = juce::jmax(maxSample, std::abs(track_engine.get_sample(i)));
         }
         
         float y = area.getCentreY() + (maxSample * area.getHeight() * 0.5f);
@@ -147,8 +147,7 @@ void WaveformDisplay::drawPlayhead(juce::Graphics& g, juce::Rectangle<int> wavef
         {
             // Show playhead based on current recording position
             float playheadPosition = track_engine.get_pos();
-            const auto& buffer = track_engine.get_buffer();
-            float maxLength = static_cast<float>(buffer.size());
+            float maxLength = static_cast<float>(track_engine.get_buffer_size());
             if (maxLength > 0)
             {
                 float normalizedPosition = playheadPosition / maxLength;
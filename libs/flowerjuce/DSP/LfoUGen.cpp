@@ -149,14 +149,22 @@ float snap_to_scale(float semitones, LfoScale scale)
 
 LayerCakeLfoUGen::LayerCakeLfoUGen()
 {
+    reserve_step_caches();
     randomize_targets();
 }
 
 LayerCakeLfoUGen::LayerCakeLfoUGen(const LayerCakeLfoUGen& other)
 {
+    reserve_step_caches();
     *this = other;
 }
 
+void LayerCakeLfoUGen::reserve_step_caches()
+{
+    m_pattern_buffer.reserve(static_cast<size_t>(kMaxPatternSteps));
+    m_skip_buffer.reserve(static_cast<size_t>(kMaxPatternSteps));
+}
+
 LayerCakeLfoUGen& LayerCakeLfoUGen::operator=(const LayerCakeLfoUGen& other)
 {
     if (this != &other)
@@ -178,8 +186,8 @@ LayerCakeLfoUGen& LayerCakeLfoUGen::operator=(const LayerCakeLfoUGen& other)
         
         m_clock_division = other.m_clock_division;
         m_pattern_length = other.m_pattern_length;
-        m_pattern_buffer = other.m_pattern_buffer;
-        m_skip_buffer = other.m_skip_buffer;
+        set_pattern_buffer(other.m_pattern_buffer);
+        m_skip_buffer.assign(other.m_skip_buffer.begin(), other.m_skip_buffer.end());
         m_last_step_index = other.m_last_step_index;
         
         // PNW parameters
@@ -237,7 +245,9 @@ void LayerCakeLfoUGen::set_pattern_length(int length)
 
 void LayerCakeLfoUGen::set_pattern_buffer(const std::vector<float>& buffer)
 {
-    m_pattern_buffer = buffer;
+    // assign() reuses the reserved capacity, so this is safe on the audio thread.
+    const auto count = juce::jmin(buffer.size(), static_cast<size_t>(kMaxPatternSteps));
+    m_pattern_buffer.assign(buffer.begin(), buffer.begin() + static_cast<std::ptrdiff_t>(count));
 }
 
 void LayerCakeLfoUGen::set_level(float level)
@@ -553,19 +563,20 @@ void LayerCakeLfoUGen::update_clocked_step(int step_index)
     m_random_target_value = get_step_random_value(step_index + 1);
 }
 
+int LayerCakeLfoUGen::get_cached_step_index(int step_index) const noexcept
+{
+    // Looping patterns wrap at their length, generative runs at the cache size.
+    const int length = m_pattern_length > 0 ? juce::jmin(m_pattern_length, kMaxPatternSteps) : kMaxPatternSteps;
+    return step_index % length;
+}
+
 float LayerCakeLfoUGen::get_step_random_value(int step_index)
 {
     if (step_index < 0) return 0.0f;
 
-    int effective_index = step_index;
+    const int effective_index = get_cached_step_index(step_index);
     
-    // If looping pattern
-    if (m_pattern_length > 0)
-    {
-        effective_index = step_index % m_pattern_length;
-    }
-    
-    // Extend buffer if needed
+    // Extend buffer if needed (stays within the reserved capacity)
     if (effective_index >= static_cast<int>(m_pattern_buffer.size()))
     {
         for (int i = static_cast<int>(m_pattern_buffer.size()); i <= effective_index; ++i)
@@ -581,13 +592,7 @@ bool LayerCakeLfoUGen::get_step_skip_decision(int step_index)
 {
     if (step_index < 0) return false;
     
-    int effective_index = step_index;
-    
-    // If looping pattern
-    if (m_pattern_length > 0)
-    {
-        effective_index = step_index % m_pattern_length;
-    }
+    const int effective_index = get_cached_step_index(step_index);
     
     // Extend skip buffer if needed
     if (effective_index >= static_cast<int>(m_skip_buffer.size()))
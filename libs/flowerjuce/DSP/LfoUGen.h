@@ -32,6 +32,11 @@ enum class LfoScale
 class LayerCakeLfoUGen
 {
 public:
+    // Step caches are reserved to this length on construction so copying or
+    // advancing a generator on the audio thread never reallocates. Generative
+    // runs (pattern length 0) wrap after this many steps.
+    static constexpr int kMaxPatternSteps = 4096;
+
     LayerCakeLfoUGen();
     LayerCakeLfoUGen(const LayerCakeLfoUGen& other);
     LayerCakeLfoUGen& operator=(const LayerCakeLfoUGen& other);
@@ -49,7 +54,7 @@ public:
     void set_pattern_length(int length); // 0 = off (infinite/generative), >0 = loop length in steps
     int get_pattern_length() const noexcept { return m_pattern_length; }
 
-    void set_pattern_buffer(const std::vector<float>& buffer);
+    void set_pattern_buffer(const std::vector<float>& buffer); // copies up to kMaxPatternSteps in place
     const std::vector<float>& get_pattern_buffer() const { return m_pattern_buffer; }
 
     // PNW-style waveform shaping parameters
@@ -126,6 +131,8 @@ private:
     float apply_quantization(float raw_value) const noexcept;
     void handle_cycle_wrap();
     void randomize_targets();
+    void reserve_step_caches();
+    int get_cached_step_index(int step_index) const noexcept;
     
     // Clocked mode helpers
     void update_clocked_step(int step_index);
@@ -1,43 +1,91 @@
 #include "LowPassFilter.h"
+#include <cmath>
+
+namespace
+{
+// Damping 1/Q for a Butterworth response, as the old IIR::makeLowPass default
+constexpr float kDamping = 1.41421356f;
+
+// Keeps tan() finite: the cutoff stops just short of Nyquist
+constexpr double kMaxCutoffRatio = 0.49;
+constexpr float kLog2MinCutoff = 4.32192809f; // log2(LowPassFilter::kMinCutoffHz)
+
+struct SvfCoefficients
+{
+    float a1, a2, a3;
+};
+
+inline SvfCoefficients make_coefficients(float g)
+{
+    SvfCoefficients c;
+    c.a1 = 1.0f / (1.0f + g * (g + kDamping));
+    c.a2 = g * c.a1;
+    c.a3 = g * c.a2;
+    return c;
+}
+
+// One TPT SVF step (trapezoidal integrators), returns the low pass output
+inline float tick(float x, const SvfCoefficients& c, float& ic1, float& ic2)
+{
+    const float v3 = x - ic2;
+    const float v1 = c.a1 * ic1 + c.a2 * v3;
+    const float v2 = ic2 + c.a2 * ic1 + c.a3 * v3;
+    ic1 = 2.0f * v1 - ic1;
+    ic2 = 2.0f * v2 - ic2;
+    return v2;
+}
+} // namespace
 
 LowPassFilter::LowPassFilter()
 {
-    // Initialize filter with default coefficients (no filtering at 20kHz)
-    m_filter_coefficients = juce::dsp::IIR::Coefficients<float>::makeLowPass(44100.0, 20000.0f);
-    m_low_pass_filter.coefficients = m_filter_coefficients;
-    m_current_sample_rate = 44100.0;
+    // Initialize with default coefficients (no filtering at 20kHz)
+    prepare(44100.0);
 }
 
 void LowPassFilter::prepare(double sample_rate, int maximum_block_size)
 {
-    m_current_sample_rate = sample_rate;
-    float current_cutoff = m_filter_cutoff.load();
-    
-    // Update filter coefficients
-    m_filter_coefficients = juce::dsp::IIR::Coefficients<float>::makeLowPass(sample_rate, current_cutoff);
-    
-    juce::dsp::ProcessSpec spec;
-    spec.sampleRate = sample_rate;
-    spec.maximumBlockSize = static_cast<juce::uint32>(maximum_block_size);
-    spec.numChannels = 1;
-    m_low_pass_filter.prepare(spec);
-    m_low_pass_filter.coefficients = m_filter_coefficients;
+    juce::ignoreUnused(maximum_block_size); // Coefficients are updated in place, nothing to size
+    m_sample_rate = sample_rate > 0.0 ? sample_rate : 44100.0;
+    m_log2_max_cutoff = static_cast<float>(std::log2(m_sample_rate * kMaxCutoffRatio));
+    reset();
+}
+
+void LowPassFilter::reset()
+{
+    m_ic1 = 0.0f;
+    m_ic2 = 0.0f;
+    m_log2_cutoff = clamp_log_cutoff(std::log2(m_filter_cutoff.load()));
+    m_g = compute_g(m_log2_cutoff);
+    m_current_cutoff.store(std::exp2(m_log2_cutoff));
 }
 
 void LowPassFilter::set_cutoff(float cutoff_hz)
 {
-    // Clamp cutoff to valid range (20Hz to Nyquist)
-    float nyquist = static_cast<float>(m_current_sample_rate * 0.5);
-    cutoff_hz = juce::jlimit(20.0f, nyquist, cutoff_hz);
-    
-    m_filter_cutoff.store(cutoff_hz);
-    
-    // Update filter coefficients
-    if (m_current_sample_rate > 0.0)
-    {
-        m_filter_coefficients = juce::dsp::IIR::Coefficients<float>::makeLowPass(m_current_sample_rate, cutoff_hz);
-        m_low_pass_filter.coefficients = m_filter_coefficients;
-    }
+    // The upper clamp depends on the sample rate, which only the audio thread reads
+    m_filter_cutoff.store(juce::jmax(kMinCutoffHz, cutoff_hz));
+}
+
+float LowPassFilter::clamp_log_cutoff(float log2_cutoff) const
+{
+    return juce::jlimit(kLog2MinCutoff, m_log2_max_cutoff, log2_cutoff);
+}
+
+float LowPassFilter::compute_g(float log2_cutoff) const
+{
+    const double cutoff = std::exp2(static_cast<double>(log2_cutoff));
+    return static_cast<float>(std::tan(juce::MathConstants<double>::pi * cutoff / m_sample_rate));
+}
+
+float LowPassFilter::advance_log_cutoff(int num_samples)
+{
+    const float target = clamp_log_cutoff(std::log2(m_filter_cutoff.load()));
+    const float smoothing_ms = m_smoothing_ms.load();
+    if (smoothing_ms <= 0.0f)
+        return target;
+
+    const float coefficient = std::exp(-static_cast<float>(num_samples)
+                                       / (0.001f * smoothing_ms * static_cast<float>(m_sample_rate)));
+    return target + (m_log2_cutoff - target) * coefficient;
 }
 
 void LowPassFilter::process_block(float* channel_data, int num_samples)
@@ -47,13 +95,77 @@ void LowPassFilter::process_block(float* channel_data, int num_samples)
         DBG("LowPassFilter::process_block: Invalid parameters");
         return;
     }
-    
-    // Create array of channel pointers for AudioBlock (mono = 1 channel)
-    // AudioBlock expects SampleType* const* (pointer to const pointer to SampleType)
-    float* const channelDataArray[1] = { channel_data };
-    float* const* channelData = channelDataArray; // Explicit pointer to array
-    juce::dsp::AudioBlock<float> block(channelData, 1, 0, static_cast<size_t>(num_samples));
-    juce::dsp::ProcessContextReplacing<float> context(block);
-    m_low_pass_filter.process(context);
+
+    float ic1 = m_ic1;
+    float ic2 = m_ic2;
+    for (int offset = 0; offset < num_samples; offset += kControlInterval)
+    {
+        const int count = juce::jmin(kControlInterval, num_samples - offset);
+        float* samples = channel_data + offset;
+
+        // New coefficient at the end of the sub-block, interpolated per sample
+        // so even a fast glide changes it smoothly
+        m_log2_cutoff = advance_log_cutoff(count);
+        const float g_end = compute_g(m_log2_cutoff);
+        const float g_step = (g_end - m_g) / static_cast<float>(count);
+
+        if (g_step == 0.0f)
+        {
+            const auto c = make_coefficients(g_end);
+            for (int i = 0; i < count; ++i)
+                samples[i] = tick(samples[i], c, ic1, ic2);
+        }
+        else
+        {
+            float g = m_g;
+            for (int i = 0; i < count; ++i)
+            {
+                g += g_step;
+                samples[i] = tick(samples[i], make_coefficients(g), ic1, ic2);
+            }
+        }
+        m_g = g_end;
+    }
+
+    // Flush denormals left by a decaying tail
+    m_ic1 = std::abs(ic1) < 1.0e-20f ? 0.0f : ic1;
+    m_ic2 = std::abs(ic2) < 1.0e-20f ? 0.0f : ic2;
+    m_current_cutoff.store(std::exp2(m_log2_cutoff));
 }
 
+void LowPassFilter::process_block(float* channel_data, const float* cutoff_octaves, int num_samples)
+{
+    if (cutoff_octaves == nullptr)
+    {
+        process_block(channel_data, num_samples);
+        return;
+    }
+    if (channel_data == nullptr || num_samples <= 0)
+    {
+        DBG("LowPassFilter::process_block: Invalid parameters");
+        return;
+    }
+
+    float ic1 = m_ic1;
+    float ic2 = m_ic2;
+    for (int offset = 0; offset < num_samples; offset += kControlInterval)
+    {
+        const int count = juce::jmin(kControlInterval, num_samples - offset);
+        const float log2_start = m_log2_cutoff;
+        m_log2_cutoff = advance_log_cutoff(count);
+        const float log2_step = (m_log2_cutoff - log2_start) / static_cast<float>(count);
+
+        for (int i = 0; i < count; ++i)
+        {
+            const int index = offset + i;
+            const float log2_cutoff = clamp_log_cutoff(log2_start + log2_step * static_cast<float>(i + 1) + cutoff_octaves[index]);
+            channel_data[index] = tick(channel_data[index], make_coefficients(compute_g(log2_cutoff)), ic1, ic2);
+        }
+    }
+
+    // The next unmodulated block interpolates from the unmodulated cutoff
+    m_g = compute_g(m_log2_cutoff);
+    m_ic1 = std::abs(ic1) < 1.0e-20f ? 0.0f : ic1;
+    m_ic2 = std::abs(ic2) < 1.0e-20f ? 0.0f : ic2;
+    m_current_cutoff.store(std::exp2(m_log2_cutoff));
+}
@@ -1,35 +1,73 @@
 #pragma once
 
 #include <juce_core/juce_core.h>
-#include <juce_dsp/juce_dsp.h>
 #include <atomic>
 
-// LowPassFilter UGen - processes audio blocks with a low pass filter
+// LowPassFilter UGen - processes audio blocks with a 12 dB/oct low pass filter
+//
+// Topology-preserving transform (TPT) state variable filter with Butterworth
+// damping. Its state stays valid whatever the coefficient does, so the cutoff
+// can move on every sample without clicks or blowing up.
+//
+// set_cutoff() only stores a target and may be called from any thread. The
+// audio thread glides towards it in the log-frequency domain, recomputing the
+// coefficient in place every kControlInterval samples and interpolating it in
+// between, so nothing is allocated or shared with the caller. For audio-rate
+// modulation (e.g. an LFO), pass a per-sample offset in octaves to
+// process_block(); the coefficient is then recomputed on every sample.
 class LowPassFilter
 {
 public:
+    static constexpr int kControlInterval = 16;
+    static constexpr float kMinCutoffHz = 20.0f;
+    static constexpr float kDefaultSmoothingMs = 20.0f;
+
     LowPassFilter();
     ~LowPassFilter() = default;
 
     // Prepare the filter for processing (call when sample rate changes)
     void prepare(double sample_rate, int maximum_block_size = 512);
 
-    // Process a block of audio samples (mono input/output)
+    // Clear the filter state and jump to the target cutoff (audio thread)
+    void reset();
+
+    // Process a block of audio samples (mono input/output, realtime safe)
     // channel_data: pointer to mono audio buffer
     // num_samples: number of samples in the block
     void process_block(float* channel_data, int num_samples);
 
-    // Set cutoff frequency (in Hz)
-    // Automatically clamps to valid range (20Hz to Nyquist)
+    // As above, with the smoothed cutoff scaled by 2^cutoff_octaves[i] on sample i
+    void process_block(float* channel_data, const float* cutoff_octaves, int num_samples);
+
+    // Set cutoff frequency (in Hz, any thread)
+    // Clamped to 20 Hz and, on the audio thread, to just below Nyquist
     void set_cutoff(float cutoff_hz);
 
-    // Get current cutoff frequency (in Hz)
+    // Get target cutoff frequency (in Hz)
     float get_cutoff() const { return m_filter_cutoff.load(); }
 
+    // Smoothed cutoff the audio thread is currently using (in Hz)
+    float get_current_cutoff() const { return m_current_cutoff.load(); }
+
+    // Time for the cutoff to cover ~63% of a jump, in log frequency (0 = jump)
+    void set_smoothing_time_ms(float smoothing_ms) { m_smoothing_ms.store(juce::jmax(0.0f, smoothing_ms)); }
+    float get_smoothing_time_ms() const { return m_smoothing_ms.load(); }
+
 private:
-    juce::dsp::IIR::Filter<float> m_low_pass_filter;
-    juce::dsp::IIR::Coefficients<float>::Ptr m_filter_coefficients;
+    float clamp_log_cutoff(float log2_cutoff) const;
+    float compute_g(float log2_cutoff) const;
+    float advance_log_cutoff(int num_samples);
+
+    double m_sample_rate{44100.0};
+    float m_log2_max_cutoff{0.0f};
+    float m_log2_cutoff{0.0f}; // Smoothed cutoff, log2(Hz)
+    float m_g{1.0f};           // tan(pi * cutoff / sample_rate) at m_log2_cutoff
+
+    // Integrator states
+    float m_ic1{0.0f};
+    float m_ic2{0.0f};
+
     std::atomic<float> m_filter_cutoff{20000.0f}; // Default to 20kHz (no filtering)
-    double m_current_sample_rate{44100.0};
+    std::atomic<float> m_current_cutoff{20000.0f};
+    std::atomic<float> m_smoothing_ms{kDefaultSmoothingMs};
 };
-
@@ -1,4 +1,32 @@
 #include "MultiChannelLoudnessMeter.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+constexpr int kFreshSnapshot = 4; // Flag bit on the spare index
+constexpr double kAbsoluteGateLufs = -70.0;
+constexpr double kRelativeGateLu = -10.0;
+constexpr double kHistogramStepLu = 0.1;
+constexpr float kPeakFloor = 0.001f;
+
+const float kSilence[256] = {};
+
+double energy_to_lufs(double energy)
+{
+    return energy > 0.0 ? -0.691 + 10.0 * std::log10(energy) : static_cast<double>(MultiChannelLoudnessMeter::kSilenceLufs);
+}
+
+double lufs_to_energy(double lufs)
+{
+    return std::pow(10.0, (lufs + 0.691) / 10.0);
+}
+
+float to_reported_lufs(double energy)
+{
+    return static_cast<float>(juce::jmax(energy_to_lufs(energy), static_cast<double>(MultiChannelLoudnessMeter::kSilenceLufs)));
+}
+} // namespace
 
 MultiChannelLoudnessMeter::MultiChannelLoudnessMeter()
 {
@@ -7,10 +35,65 @@ MultiChannelLoudnessMeter::MultiChannelLoudnessMeter()
     {
         level.store(0.0f);
     }
+
+    prepare(m_sample_rate, max_channels);
 }
 
-void MultiChannelLoudnessMeter::prepare(int num_channels)
+void MultiChannelLoudnessMeter::prepare(double sample_rate, int num_channels)
 {
+    m_sample_rate = sample_rate > 0.0 ? sample_rate : 44100.0;
+    m_num_channels = juce::jmax(0, num_channels);
+
+    // BS.1770 K-weighting: high-shelf pre-filter followed by the RLB high-pass,
+    // designed for the actual sample rate (the standard lists 48 kHz only).
+    {
+        const double f0 = 1681.974450955533;
+        const double gain_db = 3.999843853973347;
+        const double q = 0.7071752369554196;
+        const double k = std::tan(juce::MathConstants<double>::pi * f0 / m_sample_rate);
+        const double vh = std::pow(10.0, gain_db / 20.0);
+        const double vb = std::pow(vh, 0.4996667741545416);
+        const double a0 = 1.0 + k / q + k * k;
+        m_shelf.b0 = (vh + vb * k / q + k * k) / a0;
+        m_shelf.b1 = 2.0 * (k * k - vh) / a0;
+        m_shelf.b2 = (vh - vb * k / q + k * k) / a0;
+        m_shelf.a1 = 2.0 * (k * k - 1.0) / a0;
+        m_shelf.a2 = (1.0 - k / q + k * k) / a0;
+    }
+    {
+        const double f0 = 38.13547087602444;
+        const double q = 0.5003270373238773;
+        const double k = std::tan(juce::MathConstants<double>::pi * f0 / m_sample_rate);
+        const double a0 = 1.0 + k / q + k * k;
+        m_highpass.b0 = 1.0;
+        m_highpass.b1 = -2.0;
+        m_highpass.b2 = 1.0;
+        m_highpass.a1 = 2.0 * (k * k - 1.0) / a0;
+        m_highpass.a2 = (1.0 - k / q + k * k) / a0;
+    }
+
+    const int num_batches = (m_num_channels + kChannelBatch - 1) / kChannelBatch;
+    m_batches.assign(static_cast<size_t>(num_batches), FilterBatch{});
+
+    const auto num_entries = static_cast<size_t>(m_num_channels + 1);
+    m_step_energies.assign(num_entries * kShortTermSteps, 0.0);
+    m_histograms.assign(num_entries * kHistogramBins, 0);
+    m_levels.assign(num_entries, Levels{});
+    m_mean_squares.assign(num_entries, 0.0);
+
+    m_step_length = juce::jmax(1, juce::roundToInt(0.1 * m_sample_rate));
+    m_step_position = 0;
+    m_num_steps = 0;
+    m_step_write = 0;
+    m_samples_processed = 0;
+    m_reset_integrated_requested.store(false);
+
+    auto buffers = std::make_shared<SnapshotBuffers>();
+    for (auto& snapshot : buffers->snapshots)
+        snapshot.channels.assign(static_cast<size_t>(m_num_channels), Levels{});
+    m_write_buffers = buffers.get();
+    std::atomic_store(&m_published_buffers, std::move(buffers));
+
     // Reset all channel levels
     for (auto& level : m_channel_levels)
     {
@@ -18,56 +101,260 @@ void MultiChannelLoudnessMeter::prepare(int num_channels)
     }
 }
 
-void MultiChannelLoudnessMeter::process_block(float* const* output_channel_data, int num_output_channels, int num_samples)
+void MultiChannelLoudnessMeter::process_block(const float* const* channel_data, int num_channels, int num_samples)
 {
-    // Update channel level meters (peak detection with decay)
-    for (int channel = 0; channel < juce::jmin(max_channels, num_output_channels); ++channel)
+    if (num_samples <= 0)
+        return;
+
+    // Buffers for more channels than prepared would have to be allocated here
+    num_channels = juce::jmin(num_channels, m_num_channels);
+
+    if (m_reset_integrated_requested.exchange(false))
+        std::fill(m_histograms.begin(), m_histograms.end(), 0);
+
+    // Peak with time-based decay: the same fall per second at any block size
+    const float decay = std::pow(10.0f, -kPeakDecayDbPerSecond * static_cast<float>(num_samples)
+                                             / (20.0f * static_cast<float>(m_sample_rate)));
+    for (int channel = 0; channel < m_num_channels; ++channel)
     {
-        if (output_channel_data[channel] != nullptr)
+        float peak = 0.0f;
+        if (channel < num_channels && channel_data[channel] != nullptr)
         {
-            // Find peak in this channel
-            float peak = 0.0f;
-            for (int sample = 0; sample < num_samples; ++sample)
-            {
-                peak = juce::jmax(peak, std::abs(output_channel_data[channel][sample]));
-            }
-            
-            // Update level meter (peak hold with decay)
-            float currentLevel = m_channel_levels[channel].load();
-            
-            // Apply decay first
-            if (currentLevel > 0.001f)
-            {
-                // Decay factor per audio callback (~11ms at 44.1kHz/512 samples)
-                // Equivalent to 0.89 per 50ms for UI responsiveness
-                m_channel_levels[channel].store(currentLevel * m_level_decay_factor);
-            }
-            else
-            {
-                m_channel_levels[channel].store(0.0f);
-            }
-            
-            // Then update with new peak if higher
-            float decayedLevel = m_channel_levels[channel].load();
-            if (peak > decayedLevel)
+            const auto range = juce::FloatVectorOperations::findMinAndMax(channel_data[channel], num_samples);
+            peak = juce::jmax(-range.getStart(), range.getEnd());
+        }
+
+        auto& levels = m_levels[static_cast<size_t>(channel)];
+        float decayed = levels.peak * decay;
+        if (decayed < kPeakFloor)
+            decayed = 0.0f;
+        levels.peak = juce::jmax(peak, decayed);
+    }
+
+    // K-weighting and energy, split at 100 ms step boundaries
+    for (int offset = 0; offset < num_samples;)
+    {
+        const int segment = juce::jmin(num_samples - offset, m_step_length - m_step_position, kMaxSegment);
+
+        for (size_t batch = 0; batch < m_batches.size(); ++batch)
+        {
+            const float* lanes[kChannelBatch];
+            for (int lane = 0; lane < kChannelBatch; ++lane)
             {
-                m_channel_levels[channel].store(peak);
+                const int channel = static_cast<int>(batch) * kChannelBatch + lane;
+                lanes[lane] = (channel < num_channels && channel_data[channel] != nullptr)
+                    ? channel_data[channel] + offset
+                    : kSilence;
             }
+            process_batch(m_batches[batch], lanes, segment);
+        }
+
+        offset += segment;
+        m_step_position += segment;
+        if (m_step_position == m_step_length)
+        {
+            finish_step();
+            m_step_position = 0;
         }
     }
-    
-    // Also decay channels that aren't being written to (if num_output_channels < max_channels)
-    for (int channel = num_output_channels; channel < max_channels; ++channel)
+
+    // RMS: one-pole average of the block mean square with a time-based coefficient
+    const double rms_coefficient = std::exp(-static_cast<double>(num_samples) / (kRmsTimeConstantSeconds * m_sample_rate));
+    double sum_mean_square = 0.0;
+    float sum_peak = 0.0f;
+    for (int channel = 0; channel < m_num_channels; ++channel)
+    {
+        auto& batch = m_batches[static_cast<size_t>(channel / kChannelBatch)];
+        auto& energy = batch.energy[channel % kChannelBatch];
+        const double block_mean_square = energy / static_cast<double>(num_samples);
+        energy = 0.0;
+
+        auto& mean_square = m_mean_squares[static_cast<size_t>(channel)];
+        mean_square = block_mean_square + (mean_square - block_mean_square) * rms_coefficient;
+        sum_mean_square += mean_square;
+
+        auto& levels = m_levels[static_cast<size_t>(channel)];
+        levels.rms = static_cast<float>(std::sqrt(mean_square));
+        sum_peak = juce::jmax(sum_peak, levels.peak);
+    }
+
+    auto& sum_levels = m_levels.back();
+    sum_levels.peak = sum_peak;
+    sum_levels.rms = m_num_channels > 0 ? static_cast<float>(std::sqrt(sum_mean_square / m_num_channels)) : 0.0f;
+
+    m_samples_processed += num_samples;
+
+    // Mirror peaks for the Sinks view; unprepared slots stay silent
+    for (int channel = 0; channel < max_channels; ++channel)
+    {
+        const float peak = channel < m_num_channels ? m_levels[static_cast<size_t>(channel)].peak : 0.0f;
+        m_channel_levels[static_cast<size_t>(channel)].store(peak);
+    }
+
+    publish_snapshot();
+}
+
+void MultiChannelLoudnessMeter::process_batch(FilterBatch& batch, const float* const* lanes, int num_samples)
+{
+    const Biquad shelf = m_shelf;
+    const Biquad highpass = m_highpass;
+
+    // Lanes are independent channels, so the inner loops vectorise across
+    // channels while each lane keeps its own recursive filter state.
+    double shelf_s1[kChannelBatch], shelf_s2[kChannelBatch];
+    double highpass_s1[kChannelBatch], highpass_s2[kChannelBatch];
+    double weighted_energy[kChannelBatch], energy[kChannelBatch];
+    for (int lane = 0; lane < kChannelBatch; ++lane)
+    {
+        shelf_s1[lane] = batch.shelf_s1[lane];
+        shelf_s2[lane] = batch.shelf_s2[lane];
+        highpass_s1[lane] = batch.highpass_s1[lane];
+        highpass_s2[lane] = batch.highpass_s2[lane];
+        weighted_energy[lane] = batch.weighted_energy[lane];
+        energy[lane] = batch.energy[lane];
+    }
+
+    for (int sample = 0; sample < num_samples; ++sample)
     {
-        float currentLevel = m_channel_levels[channel].load();
-        if (currentLevel > 0.001f)
+        double x[kChannelBatch];
+        for (int lane = 0; lane < kChannelBatch; ++lane)
+            x[lane] = static_cast<double>(lanes[lane][sample]);
+
+        for (int lane = 0; lane < kChannelBatch; ++lane)
         {
-            m_channel_levels[channel].store(currentLevel * m_level_decay_factor);
+            // Transposed direct form II, shelf then high-pass
+            const double y1 = shelf.b0 * x[lane] + shelf_s1[lane];
+            shelf_s1[lane] = shelf.b1 * x[lane] - shelf.a1 * y1 + shelf_s2[lane];
+            shelf_s2[lane] = shelf.b2 * x[lane] - shelf.a2 * y1;
+
+            const double y2 = highpass.b0 * y1 + highpass_s1[lane];
+            highpass_s1[lane] = highpass.b1 * y1 - highpass.a1 * y2 + highpass_s2[lane];
+            highpass_s2[lane] = highpass.b2 * y1 - highpass.a2 * y2;
+
+            weighted_energy[lane] += y2 * y2;
+            energy[lane] += x[lane] * x[lane];
         }
-        else
+    }
+
+    for (int lane = 0; lane < kChannelBatch; ++lane)
+    {
+        batch.shelf_s1[lane] = shelf_s1[lane];
+        batch.shelf_s2[lane] = shelf_s2[lane];
+        batch.highpass_s1[lane] = highpass_s1[lane];
+        batch.highpass_s2[lane] = highpass_s2[lane];
+        batch.weighted_energy[lane] = weighted_energy[lane];
+        batch.energy[lane] = energy[lane];
+    }
+}
+
+void MultiChannelLoudnessMeter::finish_step()
+{
+    const int write = m_step_write;
+    m_step_write = (m_step_write + 1) % kShortTermSteps;
+    m_num_steps = juce::jmin(m_num_steps + 1, kShortTermSteps);
+
+    // Mean square of the K-weighted step; the sum entry adds channel powers (all weights 1.0)
+    double sum_energy = 0.0;
+    for (int channel = 0; channel < m_num_channels; ++channel)
+    {
+        auto& accumulator = m_batches[static_cast<size_t>(channel / kChannelBatch)].weighted_energy[channel % kChannelBatch];
+        const double step_energy = accumulator / static_cast<double>(m_step_length);
+        accumulator = 0.0;
+
+        m_step_energies[static_cast<size_t>(channel * kShortTermSteps + write)] = step_energy;
+        sum_energy += step_energy;
+    }
+    m_step_energies[static_cast<size_t>(m_num_channels * kShortTermSteps + write)] = sum_energy;
+
+    for (int entry = 0; entry <= m_num_channels; ++entry)
+    {
+        const double* steps = m_step_energies.data() + entry * kShortTermSteps;
+        auto& levels = m_levels[static_cast<size_t>(entry)];
+
+        double momentary = 0.0;
+        for (int i = 0; i < juce::jmin(kMomentarySteps, m_num_steps); ++i)
+            momentary += steps[(write - i + kShortTermSteps) % kShortTermSteps];
+        momentary /= kMomentarySteps;
+
+        double short_term = 0.0;
+        for (int i = 0; i < m_num_steps; ++i)
+            short_term += steps[i];
+        short_term /= m_num_steps;
+
+        levels.short_term_lufs = to_reported_lufs(short_term);
+        if (m_num_steps < kMomentarySteps)
+            continue;
+
+        levels.momentary_lufs = to_reported_lufs(momentary);
+
+        // Every 100 ms step completes a 400 ms gating block (75% overlap)
+        const double block_lufs = energy_to_lufs(momentary);
+        std::uint32_t* histogram = m_histograms.data() + entry * kHistogramBins;
+        if (block_lufs > kAbsoluteGateLufs)
         {
-            m_channel_levels[channel].store(0.0f);
+            const int bin = juce::jlimit(0, kHistogramBins - 1,
+                                         static_cast<int>((block_lufs - kAbsoluteGateLufs) / kHistogramStepLu));
+            ++histogram[bin];
         }
+        levels.integrated_lufs = compute_integrated(histogram);
+    }
+}
+
+float MultiChannelLoudnessMeter::compute_integrated(const std::uint32_t* histogram) const
+{
+    // Bin centre energies, shared by every meter
+    static const auto bin_energies = [] {
+        std::array<double, kHistogramBins> energies{};
+        for (int bin = 0; bin < kHistogramBins; ++bin)
+            energies[static_cast<size_t>(bin)] = lufs_to_energy(kAbsoluteGateLufs + (bin + 0.5) * kHistogramStepLu);
+        return energies;
+    }();
+
+    double gated_energy = 0.0;
+    std::uint64_t gated_count = 0;
+    for (int bin = 0; bin < kHistogramBins; ++bin)
+    {
+        gated_energy += histogram[bin] * bin_energies[static_cast<size_t>(bin)];
+        gated_count += histogram[bin];
+    }
+    if (gated_count == 0)
+        return kSilenceLufs;
+
+    // Relative gate: drop blocks more than 10 LU below the absolute-gated mean
+    const double relative_gate = energy_to_lufs(gated_energy / static_cast<double>(gated_count)) + kRelativeGateLu;
+    const int first_bin = juce::jlimit(0, kHistogramBins,
+                                       static_cast<int>(std::ceil((relative_gate - kAbsoluteGateLufs) / kHistogramStepLu - 0.5)));
+
+    double energy = 0.0;
+    std::uint64_t count = 0;
+    for (int bin = first_bin; bin < kHistogramBins; ++bin)
+    {
+        energy += histogram[bin] * bin_energies[static_cast<size_t>(bin)];
+        count += histogram[bin];
     }
+    return count > 0 ? to_reported_lufs(energy / static_cast<double>(count)) : kSilenceLufs;
+}
+
+void MultiChannelLoudnessMeter::publish_snapshot()
+{
+    auto& buffers = *m_write_buffers;
+    auto& snapshot = buffers.snapshots[static_cast<size_t>(buffers.write_index)];
+    std::copy(m_levels.begin(), m_levels.end() - 1, snapshot.channels.begin());
+    snapshot.sum = m_levels.back();
+    snapshot.samples_processed = m_samples_processed;
+
+    buffers.write_index = buffers.spare_index.exchange(buffers.write_index | kFreshSnapshot) & ~kFreshSnapshot;
 }
 
+const MultiChannelLoudnessMeter::Snapshot& MultiChannelLoudnessMeter::get_snapshot()
+{
+    // Switch to a set published by prepare(); the one read before is released here
+    auto published = std::atomic_load(&m_published_buffers);
+    if (published != m_read_buffers)
+        m_read_buffers = std::move(published);
+
+    auto& buffers = *m_read_buffers;
+    if ((buffers.spare_index.load() & kFreshSnapshot) != 0)
+        buffers.read_index = buffers.spare_index.exchange(buffers.read_index) & ~kFreshSnapshot;
+    return buffers.snapshots[static_cast<size_t>(buffers.read_index)];
+}
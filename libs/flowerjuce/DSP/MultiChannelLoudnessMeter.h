@@ -1,37 +1,146 @@
 #pragma once
 
 #include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
 #include <array>
 #include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
-// MultiChannelLoudnessMeter UGen - tracks peak levels for multiple channels
+// MultiChannelLoudnessMeter UGen - per-channel and summed level metering
+//
+// For every channel, and for the power sum of all channels, it tracks:
+//   - sample peak with a time-based decay (dB per second, not per callback)
+//   - RMS with a time-based exponential average
+//   - ITU-R BS.1770 K-weighted momentary (400 ms), short-term (3 s) and
+//     gated integrated loudness (absolute -70 LUFS and relative -10 LU gates)
+//
+// Loudness is measured in 100 ms steps counted in samples, so every value is
+// independent of the audio buffer size. The K-weighting filters run
+// kChannelBatch channels at a time, one lane per channel, each with its own
+// filter state. The channel count is set in prepare() and has no upper
+// bound; the integrated measurement uses a fixed 0.1 LU histogram per
+// channel, so its memory does not grow with time.
+//
+// The audio thread publishes a Snapshot after every block through a lock-free
+// triple buffer; the UI reads it with get_snapshot(). The first max_channels
+// peaks are also mirrored into get_channel_levels() for the Sinks view.
 class MultiChannelLoudnessMeter
 {
 public:
+    // Channels mirrored into get_channel_levels(); measurement is not limited to this
     static constexpr int max_channels = 16;
-    
+    static constexpr int kChannelBatch = 4;
+
+    // Reported for loudness values with no (ungated) signal yet
+    static constexpr float kSilenceLufs = -100.0f;
+
+    struct Levels
+    {
+        float peak{0.0f};                       // Linear sample peak, decaying at kPeakDecayDbPerSecond
+        float rms{0.0f};                        // Linear RMS, kRmsTimeConstantSeconds exponential average
+        float momentary_lufs{kSilenceLufs};     // K-weighted, last 400 ms
+        float short_term_lufs{kSilenceLufs};    // K-weighted, last 3 s (or what has been measured so far)
+        float integrated_lufs{kSilenceLufs};    // Gated, since prepare() or reset_integrated()
+    };
+
+    struct Snapshot
+    {
+        std::vector<Levels> channels;
+        Levels sum; // Loudness of the power sum of all channels; peak/RMS over all channels
+        juce::int64 samples_processed{0};
+    };
+
+    static constexpr float kPeakDecayDbPerSecond = 19.0f; // Matches the old 0.975 per 512-sample callback at 44.1 kHz
+    static constexpr double kRmsTimeConstantSeconds = 0.3;
+
     MultiChannelLoudnessMeter();
     ~MultiChannelLoudnessMeter() = default;
 
-    // Prepare the meter for processing
-    void prepare(int num_channels);
+    // Prepare the meter for processing (allocates; not concurrently with process_block,
+    // but get_snapshot() may run meanwhile)
+    void prepare(double sample_rate, int num_channels);
 
-    // Process a block of audio samples and update channel levels
-    // output_channel_data: array of output channel buffers
-    // num_output_channels: number of output channels (max 16)
-    // num_samples: number of samples in the block
-    void process_block(float* const* output_channel_data, int num_output_channels, int num_samples);
+    // Process a block of audio samples and update channel levels (realtime safe)
+    // Channels beyond the prepared count are ignored; null channels read as silence
+    void process_block(const float* const* channel_data, int num_channels, int num_samples);
 
-    // Get channel levels for visualization (16 channels)
+    // Latest published levels (message thread; the reference stays valid until the next call)
+    const Snapshot& get_snapshot();
+
+    // Restart integrated loudness (any thread; applied at the start of the next block)
+    void reset_integrated() { m_reset_integrated_requested.store(true); }
+
+    int get_num_channels() const { return m_num_channels; }
+    double get_sample_rate() const { return m_sample_rate; }
+
+    // Peak levels for the first max_channels channels (for visualization)
     std::array<std::atomic<float>, max_channels>& get_channel_levels() { return m_channel_levels; }
     const std::array<std::atomic<float>, max_channels>& get_channel_levels() const { return m_channel_levels; }
 
 private:
-    // Channel level meters (peak detection with decay)
+    static constexpr int kShortTermSteps = 30;   // 3 s of 100 ms steps
+    static constexpr int kMomentarySteps = 4;    // 400 ms
+    static constexpr int kHistogramBins = 750;   // -70 .. +5 LUFS in 0.1 LU bins
+    static constexpr int kMaxSegment = 256;
+
+    struct Biquad
+    {
+        double b0{1.0}, b1{0.0}, b2{0.0}, a1{0.0}, a2{0.0};
+    };
+
+    // Filter state and accumulators for kChannelBatch channels, one lane per channel
+    struct alignas(32) FilterBatch
+    {
+        double shelf_s1[kChannelBatch]{};
+        double shelf_s2[kChannelBatch]{};
+        double highpass_s1[kChannelBatch]{};
+        double highpass_s2[kChannelBatch]{};
+        double weighted_energy[kChannelBatch]{}; // K-weighted, current 100 ms step
+        double energy[kChannelBatch]{};          // Unweighted, current block
+    };
+
+    void process_batch(FilterBatch& batch, const float* const* lanes, int num_samples);
+    void finish_step();
+    float compute_integrated(const std::uint32_t* histogram) const;
+    void publish_snapshot();
+
+    double m_sample_rate{44100.0};
+    int m_num_channels{0};
+    int m_step_length{4410};
+    int m_step_position{0};
+    int m_num_steps{0};
+    int m_step_write{0};
+    juce::int64 m_samples_processed{0};
+
+    Biquad m_shelf;
+    Biquad m_highpass;
+    std::vector<FilterBatch> m_batches;
+
+    // Per channel, plus one trailing entry for the sum
+    std::vector<double> m_step_energies;     // (channels + 1) * kShortTermSteps ring
+    std::vector<std::uint32_t> m_histograms; // (channels + 1) * kHistogramBins
+    std::vector<Levels> m_levels;
+    std::vector<double> m_mean_squares;
+    std::atomic<bool> m_reset_integrated_requested{false};
+
+    // Triple buffer: the audio thread owns write_index, the reader owns
+    // read_index, and the spare index (plus a fresh flag) is swapped atomically.
+    struct SnapshotBuffers
+    {
+        std::array<Snapshot, 3> snapshots;
+        int write_index{0};
+        int read_index{1};
+        std::atomic<int> spare_index{2};
+    };
+
+    // prepare() never resizes a live set: it publishes a new one sized for the
+    // channel count. The reader keeps the set it last read from alive until its
+    // next get_snapshot(), so a returned reference is never freed under it.
+    std::shared_ptr<SnapshotBuffers> m_published_buffers; // std::atomic_load/store only
+    SnapshotBuffers* m_write_buffers{nullptr};            // Audio thread; owned by m_published_buffers
+    std::shared_ptr<SnapshotBuffers> m_read_buffers;      // Reader thread
+
     std::array<std::atomic<float>, max_channels> m_channel_levels;
-    
-    // Decay factor per audio callback (~11ms at 44.1kHz/512 samples)
-    // Equivalent to 0.89 per 50ms for UI responsiveness
-    static constexpr float m_level_decay_factor{0.975f};
 };
-
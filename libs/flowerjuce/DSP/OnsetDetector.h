@@ -1,6 +1,7 @@
 #pragma once
 
 #include <juce_core/juce_core.h>
+#include <juce_audio_basics/juce_audio_basics.h>
 #include <cmath>
 
 // Stateless functions for onset detection
@@ -9,27 +10,35 @@ namespace OnsetDetection
     // Compute RMS level of audio block
     inline float computeRMS(const float* audio, int numSamples)
     {
-        if (numSamples == 0) return 0.0f;
+        if (numSamples <= 0) return 0.0f;
         
-        float sumSquares = 0.0f;
-        for (int i = 0; i < numSamples; ++i)
+        // Independent partial sums so the compiler can keep them in one SIMD
+        // register; a single accumulator serialises every add.
+        constexpr int numLanes = 8;
+        float lanes[numLanes] = {};
+        int i = 0;
+        for (; i + numLanes <= numSamples; i += numLanes)
         {
-            sumSquares += audio[i] * audio[i];
+            for (int lane = 0; lane < numLanes; ++lane)
+                lanes[lane] += audio[i + lane] * audio[i + lane];
         }
+        
+        float sumSquares = 0.0f;
+        for (int lane = 0; lane < numLanes; ++lane)
+            sumSquares += lanes[lane];
+        for (; i < numSamples; ++i)
+            sumSquares += audio[i] * audio[i];
+        
         return std::sqrt(sumSquares / static_cast<float>(numSamples));
     }
     
     // Compute peak level of audio block
     inline float computePeak(const float* audio, int numSamples)
     {
-        if (numSamples == 0) return 0.0f;
+        if (numSamples <= 0) return 0.0f;
         
-        float peak = 0.0f;
-        for (int i = 0; i < numSamples; ++i)
-        {
-            peak = juce::jmax(peak, std::abs(audio[i]));
-        }
-        return peak;
+        const auto range = juce::FloatVectorOperations::findMinAndMax(audio, numSamples);
+        return juce::jmax(-range.getStart(), range.getEnd());
     }
     
     // Detect onset using loudness threshold with hysteresis
@@ -53,7 +62,8 @@ namespace OnsetDetection
     }
 }
 
-// Wrapper class for onset detection
+// Wrapper class for onset detection (loudness threshold with hysteresis).
+// The looper apps use SpectralFluxOnsetDetector.
 class OnsetDetector
 {
 public:
@@ -0,0 +1,119 @@
+#include "PolyphaseResampler.h"
+#include <cmath>
+
+namespace
+{
+// Passband edge as a fraction of the lower Nyquist; the rest is transition band
+constexpr double kRolloff = 0.945;
+
+// Kaiser beta for roughly 90 dB of stopband rejection
+constexpr double kKaiserBeta = 9.0;
+
+// Zeroth-order modified Bessel function of the first kind (power series)
+double bessel_i0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    const double half_x_squared = 0.25 * x * x;
+    for (int k = 1; k < 64 && term > sum * 1.0e-12; ++k)
+    {
+        term *= half_x_squared / static_cast<double>(k * k);
+        sum += term;
+    }
+    return sum;
+}
+} // namespace
+
+PolyphaseResampler::PolyphaseResampler(double source_rate, double target_rate)
+    : m_source_rate(source_rate > 0.0 ? source_rate : 44100.0),
+      m_target_rate(target_rate > 0.0 ? target_rate : 44100.0),
+      m_step(m_source_rate / m_target_rate)
+{
+    // Cutoff relative to the source Nyquist: below 1 when downsampling
+    const double cutoff = kRolloff * juce::jmin(1.0, 1.0 / m_step);
+    m_half_taps = static_cast<int>(std::ceil(static_cast<double>(kZeroCrossings) / cutoff));
+
+    const int num_taps = 2 * m_half_taps;
+    const double window_norm = 1.0 / bessel_i0(kKaiserBeta);
+    m_table.resize(static_cast<size_t>((kNumPhases + 1) * num_taps));
+
+    for (int phase = 0; phase <= kNumPhases; ++phase)
+    {
+        const double frac = static_cast<double>(phase) / kNumPhases;
+        float* row = m_table.data() + phase * num_taps;
+        for (int tap = 0; tap < num_taps; ++tap)
+        {
+            // Distance from the output instant to input sample (base - half_taps + 1 + tap)
+            const double distance = static_cast<double>(tap - m_half_taps + 1) - frac;
+            const double x = distance / static_cast<double>(m_half_taps);
+            if (std::abs(x) >= 1.0)
+            {
+                row[tap] = 0.0f;
+                continue;
+            }
+
+            const double arg = juce::MathConstants<double>::pi * cutoff * distance;
+            const double sinc = std::abs(arg) < 1.0e-12 ? 1.0 : std::sin(arg) / arg;
+            const double window = bessel_i0(kKaiserBeta * std::sqrt(1.0 - x * x)) * window_norm;
+            row[tap] = static_cast<float>(cutoff * sinc * window);
+        }
+    }
+}
+
+size_t PolyphaseResampler::get_output_length(size_t input_length, double source_rate, double target_rate)
+{
+    if (source_rate <= 0.0 || target_rate <= 0.0)
+        return input_length;
+    return static_cast<size_t>(std::llround(static_cast<double>(input_length) * target_rate / source_rate));
+}
+
+void PolyphaseResampler::process(const float* input, size_t input_length,
+                                 float* output, size_t first_output, size_t num_output,
+                                 bool wrap) const
+{
+    if (input_length == 0)
+    {
+        std::fill_n(output, num_output, 0.0f);
+        return;
+    }
+
+    const int num_taps = 2 * m_half_taps;
+    const auto length = static_cast<juce::int64>(input_length);
+
+    for (size_t i = 0; i < num_output; ++i)
+    {
+        const double position = static_cast<double>(first_output + i) * m_step;
+        const double base_floor = std::floor(position);
+        const auto base = static_cast<juce::int64>(base_floor);
+
+        // Blend the two nearest tabulated phases
+        const double phase_position = (position - base_floor) * kNumPhases;
+        const int phase = juce::jmin(static_cast<int>(phase_position), kNumPhases - 1);
+        const float blend = static_cast<float>(phase_position - phase);
+        const float* row0 = m_table.data() + phase * num_taps;
+        const float* row1 = row0 + num_taps;
+
+        const juce::int64 first = base - m_half_taps + 1;
+        float sum = 0.0f;
+        if (first >= 0 && first + num_taps <= length)
+        {
+            const float* source = input + first;
+            for (int tap = 0; tap < num_taps; ++tap)
+                sum += source[tap] * (row0[tap] + blend * (row1[tap] - row0[tap]));
+        }
+        else
+        {
+            // Near the edges: wrap around the loop or read zeros
+            for (int tap = 0; tap < num_taps; ++tap)
+            {
+                juce::int64 index = first + tap;
+                if (wrap)
+                    index = ((index % length) + length) % length;
+                else if (index < 0 || index >= length)
+                    continue;
+                sum += input[index] * (row0[tap] + blend * (row1[tap] - row0[tap]));
+            }
+        }
+        output[i] = sum;
+    }
+}
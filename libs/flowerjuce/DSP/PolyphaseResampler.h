@@ -0,0 +1,44 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <vector>
+
+// PolyphaseResampler converts whole buffers between sample rates with a
+// Kaiser-windowed sinc filter bank
+//
+// The prototype low pass is tabulated at kNumPhases sub-sample offsets; each
+// output sample blends the two nearest phases, so any pair of rates works
+// without a table per ratio. When downsampling the cutoff follows the target
+// Nyquist (and the filter widens to match), so nothing above it aliases.
+//
+// process() is stateless and can render any range of the output, which lets
+// a background job work in slices and report progress as it goes.
+class PolyphaseResampler
+{
+public:
+    static constexpr int kNumPhases = 256;
+    static constexpr int kZeroCrossings = 16; // Filter half-length in input samples at unity ratio
+
+    PolyphaseResampler(double source_rate, double target_rate);
+
+    // Number of samples input_length samples become at the target rate
+    static size_t get_output_length(size_t input_length, double source_rate, double target_rate);
+    size_t get_output_length(size_t input_length) const { return get_output_length(input_length, m_source_rate, m_target_rate); }
+
+    // Render output samples [first_output, first_output + num_output) from
+    // input into output[0..num_output). With wrap the input is one period of
+    // a loop (the filter reads across the seam); otherwise it is zero padded.
+    void process(const float* input, size_t input_length,
+                 float* output, size_t first_output, size_t num_output,
+                 bool wrap) const;
+
+    // Filter taps either side of each output sample
+    int get_half_taps() const { return m_half_taps; }
+
+private:
+    double m_source_rate;
+    double m_target_rate;
+    double m_step;                   // Input samples per output sample
+    int m_half_taps{kZeroCrossings};
+    std::vector<float> m_table;      // (kNumPhases + 1) rows of 2 * m_half_taps taps
+};
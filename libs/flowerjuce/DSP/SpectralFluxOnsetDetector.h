@@ -0,0 +1,130 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// SpectralFluxOnsetDetector - FFT-based onset detection with sample-accurate timestamps
+//
+// Runs a 1024-point FFT every kHopSize samples of the input stream, whatever
+// the block size, and turns each frame into one detection-function value:
+//   - SpectralFlux: half-wave rectified rise of log-compressed bin magnitudes
+//   - HighFrequencyContent: rise of the log-compressed, bin-weighted energy
+// A frame is an onset when its value is a local peak above an adaptive
+// threshold (offset + ratio * median of the recent values), so soft transients
+// in quiet passages are caught without firing on every frame of a loud one.
+//
+// Peak picking needs one frame of look-ahead: an onset is reported in the
+// block where the following hop completes, with
+//   - sample_offset: the sample of that block on which the detection fired
+//   - stream_position: the estimated transient position in samples since reset()
+// Both depend only on the stream, never on block size or wall-clock time.
+//
+// Each detector owns its juce::dsp::FFT. Without FFTW or IPP, JUCE's fallback
+// FFT serialises transforms on an internal spin lock, so a plan shared by
+// tracks rendering on different worker threads would make them queue.
+//
+// Switching the detection function restarts the detection history (no onset
+// is reported until two frames of the new function have been seen), so the
+// switch itself never reads as a rise.
+class SpectralFluxOnsetDetector
+{
+public:
+    enum class DetectionFunction
+    {
+        SpectralFlux,
+        HighFrequencyContent
+    };
+
+    struct Onset
+    {
+        int sample_offset{0};           // Sample within the processed block at which the onset was detected
+        juce::int64 stream_position{0}; // Estimated transient position, in samples since reset()
+        float strength{0.0f};           // Detection function value at the peak
+    };
+
+    static constexpr int kFftOrder = 10;
+    static constexpr int kFftSize = 1 << kFftOrder;
+    static constexpr int kHopSize = 256;
+    static constexpr int kNumBins = kFftSize / 2 + 1;
+    static constexpr int kMaxMedianFrames = 32;
+
+    SpectralFluxOnsetDetector();
+    ~SpectralFluxOnsetDetector() = default;
+
+    // Allocate buffers and the FFT (not realtime safe)
+    void prepare(double sample_rate);
+
+    // Clear the analysis history and restart stream positions at 0
+    void reset();
+
+    // Process a block of mono audio (realtime safe after prepare)
+    // Writes up to max_onsets onsets, in order, and returns how many were written
+    int process_block(const float* samples, int num_samples, Onset* onsets, int max_onsets);
+
+    // Only used to convert the minimum onset interval to samples (realtime safe)
+    void set_sample_rate(double sample_rate) { m_sample_rate.store(sample_rate); }
+    double get_sample_rate() const { return m_sample_rate.load(); }
+
+    void set_detection_function(DetectionFunction function) { m_detection_function.store(function); }
+    DetectionFunction get_detection_function() const { return m_detection_function.load(); }
+
+    // Adaptive threshold = offset + ratio * median(last median_frames values)
+    void set_threshold_offset(float offset) { m_threshold_offset.store(offset); }
+    float get_threshold_offset() const { return m_threshold_offset.load(); }
+    void set_threshold_ratio(float ratio) { m_threshold_ratio.store(ratio); }
+    float get_threshold_ratio() const { return m_threshold_ratio.load(); }
+    void set_median_frames(int frames) { m_median_frames.store(juce::jlimit(3, kMaxMedianFrames, frames)); }
+    int get_median_frames() const { return m_median_frames.load(); }
+
+    // Onsets closer than this to the previous one are suppressed (stream time, not wall clock)
+    void set_min_onset_interval_ms(double interval_ms) { m_min_onset_interval_ms.store(juce::jmax(0.0, interval_ms)); }
+    double get_min_onset_interval_ms() const { return m_min_onset_interval_ms.load(); }
+
+    // Samples between a transient and the end of the hop on which it is reported, at most
+    static constexpr int get_max_detection_latency_samples() { return kFftSize + kHopSize; }
+
+    // Samples processed since reset()
+    juce::int64 get_stream_position() const { return m_stream_position; }
+
+    // This detector's FFT plan
+    const juce::dsp::FFT* get_fft() const { return m_fft.get(); }
+
+private:
+    float compute_detection_value();
+    float compute_adaptive_threshold() const;
+    void restart_detection_history();
+
+    std::unique_ptr<juce::dsp::FFT> m_fft;
+    std::vector<float> m_window;
+    std::vector<float> m_history;       // Last kFftSize input samples (ring)
+    std::vector<float> m_fft_buffer;    // 2 * kFftSize, as juce::dsp::FFT requires
+    std::vector<float> m_previous_bins; // Log-compressed magnitudes of the previous frame
+    float m_magnitude_scale{1.0f};
+    float m_previous_hfc{0.0f};
+    DetectionFunction m_active_function{DetectionFunction::SpectralFlux}; // Audio thread
+
+    int m_history_write{0};
+    int m_hop_fill{0};
+    juce::int64 m_stream_position{0};
+
+    // Detection function history for the median and peak picking
+    std::array<float, kMaxMedianFrames> m_recent_values{};
+    int m_recent_write{0};
+    int m_num_recent{0};
+    int m_num_frames{0};
+    float m_value_before_last{0.0f};
+    float m_last_value{0.0f};
+    juce::int64 m_last_onset_position{0};
+    bool m_has_onset{false};
+
+    std::atomic<double> m_sample_rate{44100.0};
+    std::atomic<DetectionFunction> m_detection_function{DetectionFunction::SpectralFlux};
+    std::atomic<float> m_threshold_offset{0.005f};
+    std::atomic<float> m_threshold_ratio{1.5f};
+    std::atomic<int> m_median_frames{16};
+    std::atomic<double> m_min_onset_interval_ms{30.0};
+};
@@ -0,0 +1,61 @@
+#include "AudioAllocationGuard.h"
+#include <juce_core/juce_core.h>
+#include <atomic>
+
+namespace
+{
+// Plain ints so reading them from operator new never allocates.
+thread_local int t_guard_depth = 0;
+thread_local int t_allow_depth = 0;
+
+std::atomic<std::uint64_t> g_violation_count{0};
+std::atomic<bool> g_trap_violations{false};
+std::atomic<bool> g_hooks_installed{false};
+} // namespace
+
+AudioAllocationGuard::AudioAllocationGuard() noexcept { ++t_guard_depth; }
+AudioAllocationGuard::~AudioAllocationGuard() noexcept { --t_guard_depth; }
+
+AudioAllocationGuard::ScopedAllow::ScopedAllow() noexcept { ++t_allow_depth; }
+AudioAllocationGuard::ScopedAllow::~ScopedAllow() noexcept { --t_allow_depth; }
+
+bool AudioAllocationGuard::is_enabled() noexcept
+{
+    return g_hooks_installed.load(std::memory_order_relaxed);
+}
+
+void AudioAllocationGuard::note_allocation() noexcept
+{
+    if (t_guard_depth == 0 || t_allow_depth > 0)
+        return;
+
+    g_violation_count.fetch_add(1, std::memory_order_relaxed);
+
+    if (g_trap_violations.load(std::memory_order_relaxed))
+    {
+        // jassert logs through juce::String, which allocates
+        ++t_allow_depth;
+        jassertfalse; // Heap allocation on the audio thread
+        --t_allow_depth;
+    }
+}
+
+void AudioAllocationGuard::mark_hooks_installed() noexcept
+{
+    g_hooks_installed.store(true, std::memory_order_relaxed);
+}
+
+std::uint64_t AudioAllocationGuard::get_violation_count() noexcept
+{
+    return g_violation_count.load(std::memory_order_relaxed);
+}
+
+void AudioAllocationGuard::reset_violation_count() noexcept
+{
+    g_violation_count.store(0, std::memory_order_relaxed);
+}
+
+void AudioAllocationGuard::set_trap_violations(bool should_trap) noexcept
+{
+    g_trap_violations.store(should_trap, std::memory_order_relaxed);
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * AudioAllocationGuard
+ *
+ * Debug aid that catches heap allocations made on the audio thread.
+ *
+ * Executables that compile in Debug/AudioAllocationHooks.cpp (the allocation
+ * tests, see tests/CMakeLists.txt) replace the global operator new by one
+ * that checks a thread-local flag. Audio callbacks open an
+ * AudioAllocationGuard for their duration; every allocation made on that thread
+ * while it is open counts as a violation and, if trapping is enabled, hits a
+ * jassert. Debug-only logging that is allowed to allocate opens a ScopedAllow.
+ *
+ * Without the hooks the guard only bumps a counter and operator new is untouched.
+ * Only operator new is instrumented (std::vector, juce::String, std::function,
+ * ...); direct malloc calls such as juce::HeapBlock are not seen.
+ *
+ * usage:
+ *   void audioDeviceIOCallbackWithContext(...)
+ *   {
+ *       const AudioAllocationGuard allocation_guard;
+ *       ...
+ *   }
+ */
+class AudioAllocationGuard
+{
+public:
+    AudioAllocationGuard() noexcept;
+    ~AudioAllocationGuard() noexcept;
+
+    AudioAllocationGuard(const AudioAllocationGuard&) = delete;
+    AudioAllocationGuard& operator=(const AudioAllocationGuard&) = delete;
+
+    // Lifts the guard on this thread for the lifetime of the scope
+    class ScopedAllow
+    {
+    public:
+        ScopedAllow() noexcept;
+        ~ScopedAllow() noexcept;
+
+        ScopedAllow(const ScopedAllow&) = delete;
+        ScopedAllow& operator=(const ScopedAllow&) = delete;
+    };
+
+    // True when operator new is instrumented in this executable
+    static bool is_enabled() noexcept;
+
+    // Allocations seen inside a guard (all threads) since the last reset
+    static std::uint64_t get_violation_count() noexcept;
+    static void reset_violation_count() noexcept;
+
+    // Break into the debugger (jassertfalse) on every violation, instead of only counting
+    static void set_trap_violations(bool should_trap) noexcept;
+
+    // Called by the replacement allocation functions in AudioAllocationHooks.cpp
+    static void note_allocation() noexcept;
+    static void mark_hooks_installed() noexcept;
+};
@@ -0,0 +1,81 @@
+#include "AudioAllocationGuard.h"
+#include <juce_core/juce_core.h>
+#include <cstdlib>
+#include <new>
+
+// Replacement global allocation functions for AudioAllocationGuard. This file is
+// not part of the flowerjuce library: only the tests that check for audio-thread
+// allocations compile it (see tests/CMakeLists.txt), so applications linking
+// flowerjuce keep the standard operator new and delete.
+
+#if FLOWERJUCE_AUDIO_ALLOCATION_GUARD
+namespace
+{
+[[maybe_unused]] const bool g_hooks_registered = (AudioAllocationGuard::mark_hooks_installed(), true);
+} // namespace
+
+void* operator new(std::size_t size)
+{
+    AudioAllocationGuard::note_allocation();
+    if (void* ptr = std::malloc(size == 0 ? 1 : size))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size)
+{
+    return ::operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    AudioAllocationGuard::note_allocation();
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t& tag) noexcept
+{
+    return ::operator new(size, tag);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    AudioAllocationGuard::note_allocation();
+    const auto align = static_cast<std::size_t>(alignment);
+    const std::size_t rounded = ((size == 0 ? 1 : size) + align - 1) / align * align;
+   #if JUCE_WINDOWS
+    void* ptr = _aligned_malloc(rounded, align);
+   #else
+    void* ptr = std::aligned_alloc(align, rounded);
+   #endif
+    if (ptr != nullptr)
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return ::operator new(size, alignment);
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+
+static void free_aligned(void* ptr) noexcept
+{
+   #if JUCE_WINDOWS
+    _aligned_free(ptr);
+   #else
+    std::free(ptr);
+   #endif
+}
+
+void operator delete(void* ptr, std::align_val_t) noexcept { free_aligned(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { free_aligned(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { free_aligned(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { free_aligned(ptr); }
+#endif
@@ -0,0 +1,125 @@
+#include "AudioEventLog.h"
+#include <algorithm>
+
+AudioEventLog::AudioEventLog(const juce::String& source_name, int capacity)
+    : m_source_name(source_name),
+      m_fifo(juce::jmax(2, capacity)),
+      m_records(static_cast<size_t>(juce::jmax(2, capacity)))
+{
+}
+
+bool AudioEventLog::push(AudioEvent event, double value) noexcept
+{
+    const auto index = static_cast<size_t>(event);
+    jassert(index < m_counts.size());
+    m_counts[index].fetch_add(1, std::memory_order_relaxed);
+
+    int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+    m_fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 == 0)
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    auto& record = m_records[static_cast<size_t>(size1 > 0 ? start1 : start2)];
+    record.event = event;
+    record.value = value;
+    m_fifo.finishedWrite(1);
+    return true;
+}
+
+std::uint64_t AudioEventLog::get_count(AudioEvent event) const noexcept
+{
+    const auto index = static_cast<size_t>(event);
+    return index < m_counts.size() ? m_counts[index].load(std::memory_order_relaxed) : 0;
+}
+
+void AudioEventLog::reset_counts() noexcept
+{
+    for (auto& count : m_counts)
+        count.store(0, std::memory_order_relaxed);
+    m_dropped.store(0, std::memory_order_relaxed);
+}
+
+int AudioEventLog::flush_to_logger()
+{
+    const int num_read = drain([this](const AudioEventRecord& record)
+    {
+        juce::Logger::writeToLog("[" + m_source_name + "] " + get_event_name(record.event)
+                                 + " (" + juce::String(record.value, 1) + ")");
+    });
+
+    // Report drops once per flush instead of per event
+    const auto dropped = get_dropped_count();
+    if (dropped > m_reported_dropped)
+    {
+        juce::Logger::writeToLog("[" + m_source_name + "] WARNING: dropped "
+                                 + juce::String(static_cast<juce::int64>(dropped - m_reported_dropped))
+                                 + " audio events (ring full)");
+    }
+    m_reported_dropped = dropped;
+    return num_read;
+}
+
+const char* AudioEventLog::get_event_name(AudioEvent event) noexcept
+{
+    switch (event)
+    {
+        case AudioEvent::TapeBufferEmpty:             return "WARNING: TapeLoop buffer is empty in process_block";
+        case AudioEvent::ReadBufferEmpty:             return "WARNING: Buffer is empty in interpolate_sample";
+        case AudioEvent::RecordingStarted:            return "~~~ Reset playhead for new recording";
+        case AudioEvent::RecordingWrapped:            return "~~~ WRAPPED! Finalized recording";
+        case AudioEvent::RecordingFinalized:          return "~~~ Finalized initial recording";
+        case AudioEvent::RecordingStoppedByTransport: return "WARNING: ActuallyRecording but not playing.";
+        case AudioEvent::WriteHeadFinalized:          return "~~~ Finalized recording";
+        case AudioEvent::WriteHeadReset:              return "~~~ Reset write head";
+        case AudioEvent::TapePoolExhausted:           return "WARNING: Tape chunk pool exhausted, recording dropped";
+        case AudioEvent::NumEvents:                   break;
+    }
+    return "Unknown audio event";
+}
+
+//==============================================================================
+AudioEventLogFlusher::AudioEventLogFlusher(int interval_ms)
+    : juce::Thread("AudioEventLogFlusher"),
+      m_interval_ms(juce::jmax(1, interval_ms))
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+AudioEventLogFlusher::~AudioEventLogFlusher()
+{
+    stopThread(1000);
+    flush();
+}
+
+void AudioEventLogFlusher::add_log(AudioEventLog& log)
+{
+    const juce::ScopedLock sl(m_logs_lock);
+    if (std::find(m_logs.begin(), m_logs.end(), &log) == m_logs.end())
+        m_logs.push_back(&log);
+}
+
+void AudioEventLogFlusher::remove_log(AudioEventLog& log)
+{
+    const juce::ScopedLock sl(m_logs_lock);
+    log.flush_to_logger();
+    m_logs.erase(std::remove(m_logs.begin(), m_logs.end(), &log), m_logs.end());
+}
+
+void AudioEventLogFlusher::flush()
+{
+    const juce::ScopedLock sl(m_logs_lock);
+    for (auto* log : m_logs)
+        log->flush_to_logger();
+}
+
+void AudioEventLogFlusher::run()
+{
+    while (!threadShouldExit())
+    {
+        flush();
+        wait(m_interval_ms);
+    }
+}
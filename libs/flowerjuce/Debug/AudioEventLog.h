@@ -0,0 +1,103 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Events the audio thread reports instead of calling juce::Logger directly.
+enum class AudioEvent : std::uint8_t
+{
+    TapeBufferEmpty,          // process_block ran before the tape was allocated
+    ReadBufferEmpty,          // a read head interpolated an empty tape
+    RecordingStarted,         // first recording began, tape cleared (value: unused)
+    RecordingWrapped,         // first recording stopped at the loop wrap (value: write position)
+    RecordingFinalized,       // record enable dropped while playing (value: write position)
+    RecordingStoppedByTransport, // playback stopped while recording (value: write position)
+    WriteHeadFinalized,       // write head closed a recording (value: final position)
+    WriteHeadReset,           // write head rewound (value: loop end)
+    TapePoolExhausted,        // no free tape chunk, recording dropped (value: write position)
+    NumEvents
+};
+
+// Fixed-size record; no strings are built on the audio thread.
+struct AudioEventRecord
+{
+    AudioEvent event{AudioEvent::TapeBufferEmpty};
+    double value{0.0};
+};
+
+// AudioEventLog is a single-producer/single-consumer event channel for one
+// audio-thread component (e.g. a looper track). push() is wait-free and never
+// allocates: it bumps the per-event counter and copies a fixed-size record
+// into a preallocated ring. A background AudioEventLogFlusher (or a test via
+// drain) formats the records later. When the ring is full the record is
+// dropped but still counted, so counters are always exact.
+class AudioEventLog
+{
+public:
+    explicit AudioEventLog(const juce::String& source_name = "Audio", int capacity = 256);
+
+    // Audio thread
+    bool push(AudioEvent event, double value = 0.0) noexcept;
+
+    // Any thread: events pushed since construction / reset_counts
+    std::uint64_t get_count(AudioEvent event) const noexcept;
+    std::uint64_t get_dropped_count() const noexcept { return m_dropped.load(std::memory_order_relaxed); }
+    void reset_counts() noexcept;
+
+    // Consumer thread: pops every pending record in order and returns how many were read
+    template <typename Callback>
+    int drain(Callback&& callback)
+    {
+        int start1 = 0, size1 = 0, start2 = 0, size2 = 0;
+        m_fifo.prepareToRead(m_fifo.getNumReady(), start1, size1, start2, size2);
+        for (int i = 0; i < size1; ++i)
+            callback(m_records[static_cast<size_t>(start1 + i)]);
+        for (int i = 0; i < size2; ++i)
+            callback(m_records[static_cast<size_t>(start2 + i)]);
+        m_fifo.finishedRead(size1 + size2);
+        return size1 + size2;
+    }
+
+    // Consumer thread: formats pending records and writes them to juce::Logger
+    int flush_to_logger();
+
+    // Set before the log is shared with a flusher
+    void set_source_name(const juce::String& source_name) { m_source_name = source_name; }
+    const juce::String& get_source_name() const { return m_source_name; }
+
+    static const char* get_event_name(AudioEvent event) noexcept;
+
+private:
+    juce::String m_source_name;
+    juce::AbstractFifo m_fifo;
+    std::vector<AudioEventRecord> m_records;
+    std::array<std::atomic<std::uint64_t>, static_cast<size_t>(AudioEvent::NumEvents)> m_counts{};
+    std::atomic<std::uint64_t> m_dropped{0};
+    std::uint64_t m_reported_dropped{0}; // Consumer only
+};
+
+// Background thread that periodically flushes a set of AudioEventLogs to
+// juce::Logger, so file loggers never run on the audio thread.
+class AudioEventLogFlusher : private juce::Thread
+{
+public:
+    explicit AudioEventLogFlusher(int interval_ms = 50);
+    ~AudioEventLogFlusher() override;
+
+    // Message/setup thread; the log must outlive the flusher or be removed first
+    void add_log(AudioEventLog& log);
+    void remove_log(AudioEventLog& log);
+
+    // Flush everything pending now (also done on destruction)
+    void flush();
+
+private:
+    void run() override;
+
+    const int m_interval_ms;
+    juce::CriticalSection m_logs_lock;
+    std::vector<AudioEventLog*> m_logs;
+};
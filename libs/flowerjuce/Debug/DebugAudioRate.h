@@ -1,6 +1,7 @@
 #pragma once
 
 #include <juce_core/juce_core.h>
+#include "AudioAllocationGuard.h"
 
 /**
  * DBG_AUDIO_RATE(interval_ms, block)
@@ -8,6 +9,7 @@
  * Executes the provided code block immediately on the first call,
  * and then periodically at the specified interval (in milliseconds).
  * Useful for logging inside high-frequency audio callbacks without flooding the console.
+ * The block may allocate: it runs under an AudioAllocationGuard::ScopedAllow.
  *
  * usage:
  *   DBG_AUDIO_RATE(2000, {
@@ -29,6 +31,7 @@
             { \
                 _dbg_last_time_ms = _dbg_now_ms; \
                 _dbg_first_call = false; \
+                const AudioAllocationGuard::ScopedAllow _dbg_allow_allocation; \
                 block \
             } \
         } \
@@ -38,8 +38,6 @@ void GrainVoice::rebind_read_head(TapeLoop& loop)
 
 bool GrainVoice::trigger(const GrainState& state, TapeLoop& loop, double sample_rate)
 {
-    juce::SpinLock::ScopedLockType lock(m_voice_lock);
-
     if (!layer_has_audio(loop))
     {
         DBG("GrainVoice::trigger - layer has no audio, layer=" + juce::String(state.layer));
@@ -107,6 +105,14 @@ bool GrainVoice::trigger(const GrainState& state, TapeLoop& loop, double sample_
     m_read_head->set_playing(true);
 
     m_pan = juce::jlimit(0.0f, 1.0f, state.pan);
+    m_num_sources = loop.get_num_channels();
+    for (int source = 0; source < m_num_sources; ++source)
+    {
+        const float source_pan = juce::jlimit(0.0f, 1.0f, m_pan + PanningUtils::source_offset(source, m_num_sources, 1.0f));
+        const auto gains = PanningUtils::compute_stereo_gains(source_pan);
+        m_gains_left[static_cast<size_t>(source)] = gains.first;
+        m_gains_right[static_cast<size_t>(source)] = gains.second;
+    }
 
     m_state = state;
     m_state.should_trigger = true;
@@ -115,41 +121,81 @@ bool GrainVoice::trigger(const GrainState& state, TapeLoop& loop, double sample_
     m_last_normalized_position = 0.0f;
     m_envelope.note_on();
     m_active.store(true);
+    publish_visual_state();
 
     // DBG("GrainVoice::trigger success voice=" + juce::String(static_cast<int>(m_voice_index)));
     return true;
 }
 
-std::array<float, 2> GrainVoice::get_next_sample()
+void GrainVoice::render_block(float* left, float* right, int num_samples)
 {
-    std::array<float, 2> output{0.0f, 0.0f};
-    juce::SpinLock::ScopedLockType lock(m_voice_lock);
+    if (left == nullptr || right == nullptr || num_samples <= 0)
+        return;
 
-    if (!m_active.load() || m_read_head == nullptr)
-        return output;
+    if (has_steal_tail())
+        mix_steal_tail(left, right, num_samples);
 
-    bool wrapped = false;
-    const float loop_sample = m_read_head->process_sample(wrapped);
-    const float env = m_envelope.get_next_sample();
-    const float mono_sample = loop_sample * env;
-    m_last_env_value = env;
+    if (!m_active.load(std::memory_order_relaxed) || m_read_head == nullptr || m_current_loop == nullptr)
+        return;
 
-    const auto gains = PanningUtils::compute_stereo_gains(m_pan);
-    output[0] = mono_sample * gains.first;
-    output[1] = mono_sample * gains.second;
+    // The engine has pinned the layer; every read below goes through this one
+    // view, and a layer swapped to fewer channels since the trigger plays the
+    // sources it still has.
+    const auto tape = m_current_loop->get_view();
 
-    const float loop_span = juce::jmax(1.0f, m_loop_end_samples - m_loop_start_samples);
-    const float current_pos = m_read_head != nullptr ? m_read_head->get_pos() : 0.0f;
-    m_last_normalized_position = juce::jlimit(0.0f, 1.0f, (current_pos - m_loop_start_samples) / loop_span);
+    // Pan gains only change on trigger, so the law is never evaluated per sample.
+    const int num_sources = juce::jmin(m_num_sources, tape.get_num_channels());
+    std::array<float*, TapeLoop::kMaxChannels> scratch{};
+    for (int source = 0; source < num_sources; ++source)
+        scratch[static_cast<size_t>(source)] = m_render_scratch[static_cast<size_t>(source)].data();
+    float* envelope = m_envelope_scratch.data();
 
-    if (!m_envelope.is_active() || wrapped)
+    bool finished = false;
+    for (int offset = 0; offset < num_samples && !finished; offset += kRenderChunkSize)
     {
-        m_active.store(false);
-        m_state.should_trigger = false;
-        m_read_head->set_playing(false);
+        const int chunk_size = juce::jmin(kRenderChunkSize, num_samples - offset);
+
+        WrapInfo wrap_info;
+        m_read_head->process_block(tape, scratch.data(), num_sources, chunk_size, wrap_info);
+
+        // A grain plays its loop once: the sample whose advance wraps is the last one.
+        int playable = wrap_info.wrapped() ? wrap_info.first_wrap_index + 1 : chunk_size;
+        finished = wrap_info.wrapped();
+
+        for (int sample = 0; sample < playable; ++sample)
+        {
+            const float env = m_envelope.get_next_sample();
+            m_last_env_value = env;
+            envelope[sample] = env;
+
+            if (!m_envelope.is_active())
+            {
+                playable = sample + 1;
+                finished = true;
+                break;
+            }
+        }
+
+        for (int source = 0; source < num_sources; ++source)
+        {
+            float* source_samples = scratch[static_cast<size_t>(source)];
+            juce::FloatVectorOperations::multiply(source_samples, envelope, playable);
+            juce::FloatVectorOperations::addWithMultiply(left + offset, source_samples, m_gains_left[static_cast<size_t>(source)], playable);
+            juce::FloatVectorOperations::addWithMultiply(right + offset, source_samples, m_gains_right[static_cast<size_t>(source)], playable);
+        }
+    }
+
+    if (finished)
+    {
+        stop_playback();
+    }
+    else
+    {
+        const float loop_span = juce::jmax(1.0f, m_loop_end_samples - m_loop_start_samples);
+        m_last_normalized_position = juce::jlimit(0.0f, 1.0f, (m_read_head->get_pos() - m_loop_start_samples) / loop_span);
     }
 
-    return output;
+    publish_visual_state();
 }
 
 bool GrainVoice::is_active() const
@@ -157,33 +203,94 @@ bool GrainVoice::is_active() const
     return m_active.load();
 }
 
-void GrainVoice::force_stop()
+void GrainVoice::stop_playback()
 {
-    juce::SpinLock::ScopedLockType lock(m_voice_lock);
     m_active.store(false);
+    m_state.should_trigger = false;
     if (m_read_head != nullptr)
         m_read_head->set_playing(false);
-    m_state.should_trigger = false;
 }
 
-bool GrainVoice::get_visual_state(GrainVisualState& state) const
+void GrainVoice::force_stop()
 {
-    juce::SpinLock::ScopedLockType lock(m_voice_lock);
-    if (!m_active.load())
-        return false;
+    stop_playback();
+    m_steal_tail_position = kStealFadeSamples;
+    publish_visual_state();
+}
 
-    state.is_active = true;
-    state.layer = m_state.layer;
-    state.voice_index = m_voice_index;
-    state.loop_start_samples = m_loop_start_samples;
-    state.loop_end_samples = m_loop_end_samples;
-    state.recorded_length_samples = m_recorded_length_samples;
-    state.rate_semitones = m_state.rate_semitones;
-    state.play_forward = m_state.play_forward;
-    state.pan = m_pan;
-    state.envelope_value = m_last_env_value;
-    state.normalized_position = m_last_normalized_position;
-    return true;
+void GrainVoice::begin_steal_fade()
+{
+    // Render the old grain (plus whatever is left of a previous tail) ahead of
+    // time, then fade the whole thing out.
+    std::array<float, kStealFadeSamples> tail_left{};
+    std::array<float, kStealFadeSamples> tail_right{};
+    render_block(tail_left.data(), tail_right.data(), kStealFadeSamples);
+
+    const float fade_step = 1.0f / static_cast<float>(kStealFadeSamples);
+    for (int sample = 0; sample < kStealFadeSamples; ++sample)
+    {
+        const float gain = 1.0f - static_cast<float>(sample + 1) * fade_step;
+        const auto index = static_cast<size_t>(sample);
+        m_steal_tail_left[index] = tail_left[index] * gain;
+        m_steal_tail_right[index] = tail_right[index] * gain;
+    }
+    m_steal_tail_position = 0;
+
+    stop_playback();
+    publish_visual_state();
+}
+
+void GrainVoice::mix_steal_tail(float* left, float* right, int num_samples)
+{
+    const int count = juce::jmin(num_samples, kStealFadeSamples - m_steal_tail_position);
+    juce::FloatVectorOperations::add(left, m_steal_tail_left.data() + m_steal_tail_position, count);
+    juce::FloatVectorOperations::add(right, m_steal_tail_right.data() + m_steal_tail_position, count);
+    m_steal_tail_position += count;
+}
+
+void GrainVoice::publish_visual_state()
+{
+    // Seqlock writer: only the audio thread publishes, so a plain increment is enough.
+    const uint32_t sequence = m_visual_sequence.load(std::memory_order_relaxed);
+    m_visual_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    m_visual_state.is_active = m_active.load(std::memory_order_relaxed);
+    m_visual_state.layer = m_state.layer;
+    m_visual_state.voice_index = m_voice_index;
+    m_visual_state.loop_start_samples = m_loop_start_samples;
+    m_visual_state.loop_end_samples = m_loop_end_samples;
+    m_visual_state.recorded_length_samples = m_recorded_length_samples;
+    m_visual_state.rate_semitones = m_state.rate_semitones;
+    m_visual_state.play_forward = m_state.play_forward;
+    m_visual_state.pan = m_pan;
+    m_visual_state.envelope_value = m_last_env_value;
+    m_visual_state.normalized_position = m_last_normalized_position;
+
+    m_visual_sequence.store(sequence + 2, std::memory_order_release);
 }
 
+bool GrainVoice::get_visual_state(GrainVisualState& state) const
+{
+    constexpr int kMaxReadAttempts = 4;
+    for (int attempt = 0; attempt < kMaxReadAttempts; ++attempt)
+    {
+        const uint32_t before = m_visual_sequence.load(std::memory_order_acquire);
+        if ((before & 1u) != 0u)
+            continue;
+
+        GrainVisualState copy = m_visual_state;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_visual_sequence.load(std::memory_order_relaxed) != before)
+            continue;
 
+        if (!copy.is_active)
+            return false;
+
+        state = copy;
+        return true;
+    }
+
+    // The audio thread kept rewriting the state; skip this voice for one UI frame.
+    return false;
+}
@@ -8,10 +8,17 @@
 #include <juce_core/juce_core.h>
 #include <memory>
 #include <array>
+#include <atomic>
 
 // GrainVoice owns a dedicated read head + envelope so it can stream a single
 // grain at a time. Voices are intentionally lightweight so LayerCakeEngine can
-// keep a fixed std::array of them.
+// build all kMaxVoices of them up front (a preallocated vector) and only switch
+// how many are in use.
+//
+// All playback state is owned by the audio thread (trigger, render_block and
+// force_stop are only called from LayerCakeEngine::process_block). The UI reads
+// a GrainVisualState that is republished once per block through a seqlock, so
+// neither side ever blocks on the other.
 class GrainVoice
 {
 public:
@@ -19,9 +26,26 @@ public:
 
     void prepare(double sample_rate);
     bool trigger(const GrainState& state, TapeLoop& loop, double sample_rate);
-    std::array<float, 2> get_next_sample();
+
+    // Render up to num_samples of this grain and accumulate (+=) them into the
+    // left/right buffers. Pan gains are fixed at trigger time and the visual
+    // state is published once at the end of the block. Each channel of a
+    // multichannel layer is panned as its own source, spread around the pan
+    // position (see Panner), so a centred stereo grain keeps its image.
+    void render_block(float* left, float* right, int num_samples);
+
     bool is_active() const;
     void force_stop();
+
+    // Stop the current grain with a short linear fade instead of a hard cut.
+    // The next kStealFadeSamples of the old grain are rendered into a tail
+    // buffer that render_block mixes in, so the voice can be retriggered
+    // straight away.
+    void begin_steal_fade();
+    bool has_steal_tail() const { return m_steal_tail_position < kStealFadeSamples; }
+    float get_envelope_level() const { return m_last_env_value; }
+
+    static constexpr int kStealFadeSamples = 128;
     bool get_visual_state(GrainVisualState& state) const;
 
     const GrainState& get_state() const { return m_state; }
@@ -29,6 +53,11 @@ public:
 private:
     void rebind_read_head(TapeLoop& loop);
     bool layer_has_audio(const TapeLoop& loop) const;
+    void stop_playback();
+    void publish_visual_state();
+    void mix_steal_tail(float* left, float* right, int num_samples);
+
+    static constexpr int kRenderChunkSize = 64;
 
     size_t m_voice_index{0};
     LayerCakeEnvelope m_envelope;
@@ -37,13 +66,25 @@ private:
     GrainState m_state;
     double m_sample_rate{44100.0};
     float m_pan{0.5f};
+    int m_num_sources{1};
+    std::array<float, TapeLoop::kMaxChannels> m_gains_left{};
+    std::array<float, TapeLoop::kMaxChannels> m_gains_right{};
     std::atomic<bool> m_active{false};
     float m_loop_start_samples{0.0f};
     float m_loop_end_samples{0.0f};
     float m_recorded_length_samples{0.0f};
     float m_last_env_value{0.0f};
     float m_last_normalized_position{0.0f};
-    juce::SpinLock m_voice_lock;
+    std::array<std::array<float, kRenderChunkSize>, TapeLoop::kMaxChannels> m_render_scratch{};
+    std::array<float, kRenderChunkSize> m_envelope_scratch{};
+    std::array<float, kStealFadeSamples> m_steal_tail_left{};
+    std::array<float, kStealFadeSamples> m_steal_tail_right{};
+    int m_steal_tail_position{kStealFadeSamples};
+
+    // Seqlock-protected copy of the playback state for the UI thread.
+    // Odd sequence values mean the audio thread is mid-write.
+    std::atomic<uint32_t> m_visual_sequence{0};
+    GrainVisualState m_visual_state;
 };
 
 
@@ -1,11 +1,15 @@
 #include "LayerCakeEngine.h"
 #include <flowerjuce/Sync/LinkSyncStrategy.h>
+#include <flowerjuce/Sync/OfflineSyncStrategy.h>
 #include <juce_audio_basics/juce_audio_basics.h>
 #include <juce_audio_formats/juce_audio_formats.h>
 #include <algorithm>
+#include <cmath>
 
 namespace
 {
+constexpr int kMinVoiceScratchSamples = 512;
+
 float decibels_to_gain(float db)
 {
     return juce::Decibels::decibelsToGain(db);
@@ -82,6 +86,49 @@ void LayerCakeEngine::GrainTriggerQueue::clear()
     m_fifo.reset();
 }
 
+void LayerCakeEngine::LfoConfigHandoff::publish(const flower::LayerCakeLfoUGen& generator, bool enabled)
+{
+    uint32_t state = m_state.load(std::memory_order_acquire);
+    const uint32_t write_index = (state & kIndexBit) ^ kIndexBit;
+
+    // The audio thread may still be copying out of the buffer published two
+    // writes ago, which is the one we're about to reuse.
+    while ((state & kReadingBit) != 0u)
+    {
+        juce::Thread::yield();
+        state = m_state.load(std::memory_order_acquire);
+    }
+
+    auto& snapshot = m_buffers[write_index];
+    snapshot.generator = generator;
+    snapshot.enabled = enabled;
+
+    // Keep the reader's busy bit if it claimed the other buffer meanwhile.
+    uint32_t desired = 0;
+    do
+    {
+        desired = write_index | kPendingBit | (state & kReadingBit);
+    } while (!m_state.compare_exchange_weak(state, desired, std::memory_order_acq_rel, std::memory_order_acquire));
+}
+
+bool LayerCakeEngine::LfoConfigHandoff::consume(flower::LayerCakeLfoUGen& dest, bool& out_enabled)
+{
+    uint32_t state = m_state.load(std::memory_order_acquire);
+    do
+    {
+        if ((state & kPendingBit) == 0u)
+            return false;
+    } while (!m_state.compare_exchange_weak(state, (state & kIndexBit) | kReadingBit,
+                                            std::memory_order_acq_rel, std::memory_order_acquire));
+
+    const auto& snapshot = m_buffers[state & kIndexBit];
+    copy_lfo_settings(snapshot.generator, dest);
+    out_enabled = snapshot.enabled;
+
+    m_state.fetch_and(~kReadingBit, std::memory_order_release);
+    return true;
+}
+
 LayerCakeEngine::LayerCakeEngine()
 {
     DBG("LayerCakeEngine ctor");
@@ -89,21 +136,25 @@ LayerCakeEngine::LayerCakeEngine()
     m_sync = std::make_unique<flower::LinkSyncStrategy>(120.0);
     
     m_audio_format_manager.registerBasicFormats();
-    for (size_t voice = 0; voice < kNumVoices; ++voice)
+    m_voices.reserve(static_cast<size_t>(kMaxVoices));
+    for (size_t voice = 0; voice < static_cast<size_t>(kMaxVoices); ++voice)
     {
-        m_voices[voice] = std::make_unique<GrainVoice>(voice);
+        m_voices.push_back(std::make_unique<GrainVoice>(voice));
     }
+    m_voice_pool.resize(static_cast<size_t>(kMaxVoices));
 
     for (auto& value : m_lfo_visuals.values)
         value.store(0.0f, std::memory_order_relaxed);
 
-    for (auto& dirty : m_lfo_dirty_flags)
-        dirty.store(false, std::memory_order_relaxed);
-
     for (auto& runtime : m_lfo_runtime)
         runtime.enabled.store(false, std::memory_order_relaxed);
 
-    m_manual_trigger_template.should_trigger = false;
+    for (size_t target = 0; target < ModulationMatrix::kNumTargets; ++target)
+    {
+        m_modulation_bases[target].store(ModulationMatrix::default_base(static_cast<ModulationTarget>(target)),
+                                         std::memory_order_relaxed);
+        m_modulation_routes[target].store(-1, std::memory_order_relaxed);
+    }
 }
 
 LayerCakeEngine::~LayerCakeEngine() = default;
@@ -123,6 +174,13 @@ void LayerCakeEngine::prepare(double sample_rate, int block_size, int num_output
 
     allocate_layers(sample_rate);
 
+    const size_t scratch_size = static_cast<size_t>(juce::jmax(block_size, kMinVoiceScratchSamples));
+    m_voice_mix_left.assign(scratch_size, 0.0f);
+    m_voice_mix_right.assign(scratch_size, 0.0f);
+    m_voice_render_cursor = 0;
+    m_chunk_sample_index = 0;
+    m_next_scheduled_sample = -1;
+
     for (auto& voice : m_voices)
         voice->prepare(sample_rate);
 
@@ -167,9 +225,19 @@ void LayerCakeEngine::update_lfo_slot(int slot_index,
         return;
     }
 
-    m_lfo_pending_configs[static_cast<size_t>(slot_index)].generator = generator;
-    m_lfo_pending_configs[static_cast<size_t>(slot_index)].enabled = enabled;
-    m_lfo_dirty_flags[static_cast<size_t>(slot_index)].store(true, std::memory_order_release);
+    m_lfo_handoffs[static_cast<size_t>(slot_index)].publish(generator, enabled);
+}
+
+void LayerCakeEngine::apply_lfo_slot_from_audio_thread(int slot_index,
+                                                       const flower::LayerCakeLfoUGen& generator,
+                                                       bool enabled)
+{
+    if (slot_index < 0 || slot_index >= static_cast<int>(kNumLfoSlots))
+        return;
+
+    auto& runtime = m_lfo_runtime[static_cast<size_t>(slot_index)];
+    copy_lfo_settings(generator, runtime.generator);
+    runtime.enabled.store(enabled, std::memory_order_relaxed);
 }
 
 void LayerCakeEngine::set_trigger_lfo_index(int slot_index)
@@ -182,16 +250,99 @@ void LayerCakeEngine::set_trigger_lfo_index(int slot_index)
     m_trigger_lfo_index.store(slot_index, std::memory_order_relaxed);
 }
 
-void LayerCakeEngine::set_manual_trigger_template(const GrainState& state)
+void LayerCakeEngine::set_modulation_base(ModulationTarget target, float value)
+{
+    const auto index = static_cast<size_t>(target);
+    if (index >= ModulationMatrix::kNumTargets)
+    {
+        DBG("LayerCakeEngine::set_modulation_base invalid target");
+        return;
+    }
+    m_modulation_bases[index].store(value, std::memory_order_relaxed);
+}
+
+float LayerCakeEngine::get_modulation_base(ModulationTarget target) const
+{
+    const auto index = static_cast<size_t>(target);
+    if (index >= ModulationMatrix::kNumTargets)
+        return 0.0f;
+    return m_modulation_bases[index].load(std::memory_order_relaxed);
+}
+
+void LayerCakeEngine::set_modulation_route(ModulationTarget target, int lfo_slot)
+{
+    const auto index = static_cast<size_t>(target);
+    if (index >= ModulationMatrix::kNumTargets)
+    {
+        DBG("LayerCakeEngine::set_modulation_route invalid target");
+        return;
+    }
+    if (lfo_slot < -1 || lfo_slot >= static_cast<int>(kNumLfoSlots))
+    {
+        DBG("LayerCakeEngine::set_modulation_route invalid lfo slot=" + juce::String(lfo_slot));
+        return;
+    }
+    m_modulation_routes[index].store(lfo_slot, std::memory_order_relaxed);
+}
+
+int LayerCakeEngine::get_modulation_route(ModulationTarget target) const
 {
-    const juce::SpinLock::ScopedLockType lock(m_manual_state_lock);
-    m_manual_trigger_template = state;
+    const auto index = static_cast<size_t>(target);
+    if (index >= ModulationMatrix::kNumTargets)
+        return -1;
+    return m_modulation_routes[index].load(std::memory_order_relaxed);
 }
 
-void LayerCakeEngine::set_manual_reverse_probability(float probability)
+float LayerCakeEngine::get_modulated_value(ModulationTarget target) const
 {
-    m_manual_reverse_probability.store(juce::jlimit(0.0f, 1.0f, probability),
-                                       std::memory_order_relaxed);
+    const auto index = static_cast<size_t>(target);
+    const float base = m_modulation_bases[index].load(std::memory_order_relaxed);
+    const int slot = m_modulation_routes[index].load(std::memory_order_relaxed);
+    if (slot < 0)
+        return base;
+
+    const auto& runtime = m_lfo_runtime[static_cast<size_t>(slot)];
+    if (!runtime.enabled.load(std::memory_order_relaxed))
+        return base;
+
+    return ModulationMatrix::apply(base, ModulationMatrix::default_range(target), runtime.last_value);
+}
+
+GrainState LayerCakeEngine::build_manual_grain_state() const
+{
+    GrainState state;
+
+    int layer = m_record_layer_index;
+    if (m_modulation_routes[static_cast<size_t>(ModulationTarget::Layer)].load(std::memory_order_relaxed) >= 0)
+    {
+        const float layer_value = get_modulated_value(ModulationTarget::Layer);
+        layer = juce::jlimit(0, static_cast<int>(kNumLayers) - 1, static_cast<int>(std::round(layer_value)) - 1);
+    }
+
+    const double recorded_seconds = m_sample_rate > 0.0
+        ? static_cast<double>(m_layers[static_cast<size_t>(layer)].m_recorded_length.load()) / m_sample_rate
+        : 0.0;
+
+    const double normalized_start = juce::jlimit(0.0, 1.0, static_cast<double>(get_modulated_value(ModulationTarget::Position)));
+    const double loop_start_seconds = normalized_start * recorded_seconds;
+
+    double duration_seconds = static_cast<double>(get_modulated_value(ModulationTarget::Duration)) * 0.001;
+    if (recorded_seconds > 0.0)
+        duration_seconds = juce::jlimit(0.0, juce::jmax(0.0, recorded_seconds - loop_start_seconds), duration_seconds);
+    const double duration_ms = duration_seconds * 1000.0;
+
+    const double env_value = juce::jlimit(0.0, 1.0, static_cast<double>(get_modulated_value(ModulationTarget::Envelope)));
+
+    state.loop_start_seconds = static_cast<float>(loop_start_seconds);
+    state.duration_ms = static_cast<float>(duration_ms);
+    state.rate_semitones = get_modulated_value(ModulationTarget::Rate);
+    state.env_attack_ms = static_cast<float>(duration_ms * (1.0 - env_value));
+    state.env_release_ms = static_cast<float>(duration_ms * env_value);
+    state.play_forward = true;
+    state.layer = layer;
+    state.pan = get_modulated_value(ModulationTarget::Pan);
+    state.should_trigger = true;
+    return state;
 }
 
 void LayerCakeEngine::request_manual_trigger()
@@ -210,13 +361,10 @@ void LayerCakeEngine::sync_lfo_configs()
 {
     for (size_t i = 0; i < kNumLfoSlots; ++i)
     {
-        if (!m_lfo_dirty_flags[i].exchange(false, std::memory_order_acq_rel))
-            continue;
-
-        auto& snapshot = m_lfo_pending_configs[i];
         auto& runtime = m_lfo_runtime[i];
-        copy_lfo_settings(snapshot.generator, runtime.generator);
-        runtime.enabled.store(snapshot.enabled, std::memory_order_relaxed);
+        bool enabled = false;
+        if (m_lfo_handoffs[i].consume(runtime.generator, enabled))
+            runtime.enabled.store(enabled, std::memory_order_relaxed);
     }
 }
 
@@ -254,17 +402,10 @@ void LayerCakeEngine::process_lfo_sample(double master_beats)
 
 void LayerCakeEngine::fire_manual_trigger()
 {
-    GrainState manual_state;
-    {
-        const juce::SpinLock::ScopedLockType lock(m_manual_state_lock);
-        manual_state = m_manual_trigger_template;
-    }
-
-    if (!manual_state.should_trigger)
-        return;
-
-    apply_direction_randomization(manual_state,
-                                  m_manual_reverse_probability.load(std::memory_order_relaxed));
+    // LFO values are current for this sample, so modulation is sample-accurate.
+    GrainState manual_state = build_manual_grain_state();
+    const float reverse_probability = juce::jlimit(0.0f, 1.0f, get_modulated_value(ModulationTarget::Direction));
+    apply_direction_randomization(manual_state, reverse_probability);
     start_grain_immediate(manual_state);
 }
 
@@ -273,19 +414,143 @@ void LayerCakeEngine::start_grain_immediate(const GrainState& state)
     if (!state.is_valid())
         return;
 
-    auto* voice = find_free_voice();
-    if (voice == nullptr)
-    {
-        DBG("LayerCakeEngine::start_grain_immediate voice steal");
-        voice = m_voices.front().get();
-        voice->force_stop();
-    }
+    // Everything before this sample was rendered without the new grain.
+    render_voices_until(m_chunk_sample_index);
 
     const int layer_index = juce::jlimit(0, static_cast<int>(kNumLayers) - 1, state.layer);
+    size_t voice_index = 0;
+    auto* voice = acquire_voice(layer_index, voice_index);
+    if (voice == nullptr)
+        return;
+
     auto& loop = m_layers[static_cast<size_t>(layer_index)];
     if (!voice->trigger(state, loop, m_sample_rate))
+    {
         DBG("LayerCakeEngine::start_grain_immediate trigger failed");
+        m_voice_pool.needs_render[voice_index] = voice->has_steal_tail() ? 1 : 0;
+        return;
+    }
+
+    m_voice_pool.active[voice_index] = 1;
+    m_voice_pool.needs_render[voice_index] = 1;
+    m_voice_pool.start_order[voice_index] = ++m_voice_start_counter;
+    m_voice_pool.level[voice_index] = 0.0f;
+    m_voice_pool.layer[voice_index] = layer_index;
+}
+
+GrainVoice* LayerCakeEngine::acquire_voice(int layer_index, size_t& out_voice_index)
+{
+    int index = VoiceAllocation::find_free_voice(m_voice_pool, m_num_voices);
+    if (index < 0)
+    {
+        const auto policy = static_cast<VoiceStealPolicy>(m_steal_policy.load(std::memory_order_relaxed));
+        index = VoiceAllocation::choose_steal_victim(m_voice_pool, m_num_voices, policy, layer_index);
+        if (index < 0)
+        {
+            DBG("LayerCakeEngine::acquire_voice no voice to steal");
+            return nullptr;
+        }
+
+        auto& victim = m_voices[static_cast<size_t>(index)];
+        victim->begin_steal_fade();
+        m_voice_pool.clear_voice(static_cast<size_t>(index));
+        m_total_steals.fetch_add(1, std::memory_order_relaxed);
+        ++m_steal_window_count;
+    }
+
+    out_voice_index = static_cast<size_t>(index);
+    return m_voices[out_voice_index].get();
+}
+
+void LayerCakeEngine::set_num_voices(int num_voices)
+{
+    const int clamped = juce::jlimit(kMinVoices, kMaxVoices, num_voices);
+    DBG("LayerCakeEngine::set_num_voices " + juce::String(clamped));
+    m_requested_num_voices.store(clamped, std::memory_order_relaxed);
+}
+
+void LayerCakeEngine::apply_voice_count()
+{
+    const int requested = m_requested_num_voices.load(std::memory_order_relaxed);
+    if (requested == m_num_voices)
+        return;
+
+    // Voices above the new size fade out; render_voices_until keeps rendering
+    // them until the tail has played.
+    for (int voice = requested; voice < m_num_voices; ++voice)
+    {
+        const auto index = static_cast<size_t>(voice);
+        if (m_voice_pool.active[index] == 0)
+            continue;
+        m_voices[index]->begin_steal_fade();
+        m_voice_pool.clear_voice(index);
+    }
+    m_num_voices = requested;
+}
+
+void LayerCakeEngine::update_steal_rate(int num_samples)
+{
+    m_steal_window_samples += num_samples;
+    const auto window_length = static_cast<juce::int64>(m_sample_rate);
+    if (window_length <= 0 || m_steal_window_samples < window_length)
+        return;
+
+    const float seconds = static_cast<float>(static_cast<double>(m_steal_window_samples) / m_sample_rate);
+    m_steals_per_second.store(static_cast<float>(m_steal_window_count) / seconds, std::memory_order_relaxed);
+    m_steal_window_count = 0;
+    m_steal_window_samples = 0;
+}
+
+void LayerCakeEngine::render_voices_until(int chunk_sample)
+{
+    const int num_samples = chunk_sample - m_voice_render_cursor;
+    if (num_samples <= 0)
+        return;
+
+    float* left = m_voice_mix_left.data() + m_voice_render_cursor;
+    float* right = m_voice_mix_right.data() + m_voice_render_cursor;
+    for (size_t index = 0; index < m_voices.size(); ++index)
+    {
+        if (m_voice_pool.needs_render[index] == 0)
+            continue;
+
+        auto& voice = m_voices[index];
+        voice->render_block(left, right, num_samples);
+
+        const bool active = voice->is_active();
+        m_voice_pool.active[index] = active ? 1 : 0;
+        m_voice_pool.needs_render[index] = (active || voice->has_steal_tail()) ? 1 : 0;
+        m_voice_pool.level[index] = voice->get_envelope_level();
+    }
+
+    m_voice_render_cursor = chunk_sample;
+}
+
+void LayerCakeEngine::mix_voices_to_output(float* const* output_channel_data,
+                                           int num_output_channels,
+                                           int output_offset,
+                                           int num_samples,
+                                           float master_gain)
+{
+    const float* left = m_voice_mix_left.data();
+    const float* right = m_voice_mix_right.data();
+
+    if (num_output_channels > 0 && output_channel_data[0] != nullptr)
+        juce::FloatVectorOperations::addWithMultiply(output_channel_data[0] + output_offset, left, master_gain, num_samples);
+
+    if (num_output_channels > 1 && output_channel_data[1] != nullptr)
+        juce::FloatVectorOperations::addWithMultiply(output_channel_data[1] + output_offset, right, master_gain, num_samples);
+
+    const float centre_gain = master_gain * 0.5f;
+    for (int channel = 2; channel < num_output_channels; ++channel)
+    {
+        if (output_channel_data[channel] == nullptr)
+            continue;
+        juce::FloatVectorOperations::addWithMultiply(output_channel_data[channel] + output_offset, left, centre_gain, num_samples);
+        juce::FloatVectorOperations::addWithMultiply(output_channel_data[channel] + output_offset, right, centre_gain, num_samples);
+    }
 }
+
 void LayerCakeEngine::set_record_layer(int layer_index)
 {
     if (!layer_index_valid(layer_index))
@@ -411,17 +676,17 @@ void LayerCakeEngine::process_block(const float* const* input_channel_data,
         return;
     }
 
+    // Pin every layer's storage for the block; loads publish new buffers without locking us
+    std::array<int, kNumLayers> layer_epoch_slots{};
+    for (size_t layer = 0; layer < kNumLayers; ++layer)
+        layer_epoch_slots[layer] = m_layers[layer].enter_read();
+
     sync_lfo_configs();
+    apply_voice_count();
     
     if (m_sync)
         m_sync->process(num_samples, m_sample_rate);
 
-    int manual_requests = m_manual_trigger_requests.exchange(0, std::memory_order_acq_rel);
-    while (manual_requests-- > 0)
-        fire_manual_trigger();
-
-    drain_pending_grains();
-
     for (int channel = 0; channel < num_output_channels; ++channel)
     {
         if (output_channel_data[channel] != nullptr)
@@ -445,60 +710,170 @@ void LayerCakeEngine::process_block(const float* const* input_channel_data,
         }
     }
 
-    const float master_gain = decibels_to_gain(m_master_gain_db.load());
+    // Block-start triggers land on sample 0 of the first chunk.
+    m_voice_render_cursor = 0;
+    m_chunk_sample_index = 0;
+
+    int manual_requests = m_manual_trigger_requests.exchange(0, std::memory_order_acq_rel);
+    while (manual_requests-- > 0)
+        fire_manual_trigger();
+
+    drain_pending_grains(current_beat, beats_per_sample, transport_playing, num_samples);
+
+    const float master_gain = decibels_to_gain(get_modulated_value(ModulationTarget::MasterGain));
 
     size_t recorded_samples = 0;
     const size_t block_cursor = m_record_cursor.load();
 
-    for (int sample = 0; sample < num_samples; ++sample)
+    // Hosts may exceed the prepared block size, so walk the block in chunks
+    // that fit the voice scratch buffers.
+    const int chunk_capacity = static_cast<int>(m_voice_mix_left.size());
+    for (int chunk_start = 0; chunk_start < num_samples; chunk_start += chunk_capacity)
     {
-        // Advance beat for LFOs
-        // We start at current_beat (start of block) and increment
-        double sample_beat = current_beat;
-        if (transport_playing)
+        const int chunk_size = juce::jmin(chunk_capacity, num_samples - chunk_start);
+        juce::FloatVectorOperations::clear(m_voice_mix_left.data(), chunk_size);
+        juce::FloatVectorOperations::clear(m_voice_mix_right.data(), chunk_size);
+        m_voice_render_cursor = 0;
+
+        for (int chunk_sample = 0; chunk_sample < chunk_size; ++chunk_sample)
         {
-            sample_beat += static_cast<double>(sample) * beats_per_sample;
+            const int sample = chunk_start + chunk_sample;
+            m_chunk_sample_index = chunk_sample;
+
+            if (sample == m_next_scheduled_sample)
+                fire_scheduled_grains(sample);
+
+            // Advance beat for LFOs
+            // We start at current_beat (start of block) and increment
+            double sample_beat = current_beat;
+            if (transport_playing)
+            {
+                sample_beat += static_cast<double>(sample) * beats_per_sample;
+            }
+
+            // May start grains; start_grain_immediate renders voices up to here first.
+            process_lfo_sample(sample_beat);
+
+            if (m_record_enabled.load())
+            {
+                process_recording_sample(input_channel_data,
+                                         num_input_channels,
+                                         sample,
+                                         block_cursor + recorded_samples);
+                ++recorded_samples;
+            }
         }
 
-        process_lfo_sample(sample_beat);
+        render_voices_until(chunk_size);
+        mix_voices_to_output(output_channel_data, num_output_channels, chunk_start, chunk_size, master_gain);
+    }
 
-        if (m_record_enabled.load())
-        {
-            process_recording_sample(input_channel_data,
-                                     num_input_channels,
-                                     sample,
-                                     block_cursor + recorded_samples);
-            ++recorded_samples;
-        }
+    m_chunk_sample_index = 0;
+    m_voice_render_cursor = 0;
 
-        float left_mix = 0.0f;
-        float right_mix = 0.0f;
+    if (recorded_samples > 0)
+        m_record_cursor.store(block_cursor + recorded_samples);
 
-        for (auto& voice : m_voices)
-        {
-            const auto sample_pair = voice->get_next_sample();
-            left_mix += sample_pair[0];
-            right_mix += sample_pair[1];
-        }
+    m_sample_clock.store(m_sample_clock.load(std::memory_order_relaxed) + num_samples,
+                         std::memory_order_release);
+    update_steal_rate(num_samples);
 
-        left_mix *= master_gain;
-        right_mix *= master_gain;
+    for (size_t layer = 0; layer < kNumLayers; ++layer)
+        m_layers[layer].exit_read(layer_epoch_slots[layer]);
+}
 
-        if (num_output_channels > 0 && output_channel_data[0] != nullptr)
-            output_channel_data[0][sample] += left_mix;
+bool LayerCakeEngine::render_offline(const OfflineRenderSettings& settings,
+                                     double num_beats,
+                                     juce::AudioFormatWriter& writer)
+{
+    if (!m_is_prepared.load())
+    {
+        DBG("LayerCakeEngine::render_offline called before prepare");
+        return false;
+    }
 
-        if (num_output_channels > 1 && output_channel_data[1] != nullptr)
-            output_channel_data[1][sample] += right_mix;
+    if (num_beats <= 0.0 || settings.bpm <= 0.0 || settings.block_size <= 0)
+    {
+        DBG("LayerCakeEngine::render_offline invalid settings beats=" + juce::String(num_beats)
+            + " bpm=" + juce::String(settings.bpm)
+            + " block=" + juce::String(settings.block_size));
+        return false;
+    }
+
+    const int num_channels = static_cast<int>(writer.getNumChannels());
+    if (num_channels <= 0 || writer.getSampleRate() != m_sample_rate)
+    {
+        DBG("LayerCakeEngine::render_offline writer mismatch channels=" + juce::String(num_channels)
+            + " rate=" + juce::String(writer.getSampleRate()));
+        return false;
+    }
+
+    auto previous_sync = std::move(m_sync);
+    m_sync = std::make_unique<flower::OfflineSyncStrategy>(settings.bpm);
+    m_sync->prepare(m_sample_rate, settings.block_size);
+
+    reset_for_offline_render(settings.random_seed);
+
+    const double samples_per_beat = m_sample_rate * 60.0 / m_sync->get_tempo();
+    const auto total_samples = static_cast<juce::int64>(std::ceil(num_beats * samples_per_beat));
+    juce::AudioBuffer<float> block(num_channels, settings.block_size);
 
-        for (int channel = 2; channel < num_output_channels; ++channel)
+    bool written = true;
+    for (juce::int64 rendered = 0; rendered < total_samples;)
+    {
+        const int num_samples = static_cast<int>(std::min<juce::int64>(settings.block_size, total_samples - rendered));
+        process_block(nullptr, 0, block.getArrayOfWritePointers(), num_channels, num_samples);
+        if (!writer.writeFromAudioSampleBuffer(block, 0, num_samples))
         {
-            if (output_channel_data[channel] != nullptr)
-                output_channel_data[channel][sample] += (left_mix + right_mix) * 0.5f;
+            DBG("LayerCakeEngine::render_offline write failed at sample " + juce::String(rendered));
+            written = false;
+            break;
         }
+        rendered += num_samples;
     }
 
-    if (recorded_samples > 0)
-        m_record_cursor.store(block_cursor + recorded_samples);
+    m_sync = std::move(previous_sync);
+    if (m_sync)
+        m_sync->prepare(m_sample_rate, m_block_size);
+
+    return written;
+}
+
+void LayerCakeEngine::reset_for_offline_render(juce::int64 random_seed)
+{
+    if (m_record_enabled.load())
+    {
+        DBG("LayerCakeEngine::render_offline disabling record");
+        set_record_enable(false);
+    }
+
+    for (size_t voice = 0; voice < m_voices.size(); ++voice)
+    {
+        m_voices[voice]->force_stop();
+        m_voice_pool.clear_voice(voice);
+        m_voice_pool.needs_render[voice] = 0;
+    }
+    m_voice_start_counter = 0;
+    m_steal_window_count = 0;
+    m_steal_window_samples = 0;
+    m_sample_clock.store(0, std::memory_order_release);
+
+    m_random.setSeed(random_seed);
+
+    // Pick up any configs still in flight, then restart every LFO from its
+    // seed. Slots saved without a seed get one derived from the render seed.
+    sync_lfo_configs();
+    for (size_t i = 0; i < kNumLfoSlots; ++i)
+    {
+        auto& runtime = m_lfo_runtime[i];
+        const uint64_t slot_seed = runtime.generator.get_random_seed() != 0
+            ? runtime.generator.get_random_seed()
+            : static_cast<uint64_t>(random_seed) + i + 1;
+        runtime.generator.set_random_seed(slot_seed);
+        runtime.generator.reset_phase();
+        runtime.prev_value = 0.0f;
+        runtime.last_value = 0.0f;
+    }
 }
 
 void LayerCakeEngine::process_recording_sample(const float* const* input_channel_data,
@@ -601,25 +976,104 @@ void LayerCakeEngine::apply_direction_randomization(GrainState& state, float rev
     state.play_forward = !should_reverse;
 }
 
-void LayerCakeEngine::drain_pending_grains()
+void LayerCakeEngine::drain_pending_grains(double block_beat,
+                                           double beats_per_sample,
+                                           bool transport_playing,
+                                           int num_samples)
 {
     GrainState state;
     while (m_pending_grains.pop(state))
     {
         if (!state.is_valid())
             continue;
-        start_grain_immediate(state);
+
+        if (!state.is_scheduled())
+        {
+            start_grain_immediate(state);
+            continue;
+        }
+
+        if (m_num_scheduled_grains >= kMaxScheduledGrains)
+        {
+            DBG("LayerCakeEngine::drain_pending_grains schedule full, starting now");
+            start_grain_immediate(state);
+            continue;
+        }
+
+        m_scheduled_grains[static_cast<size_t>(m_num_scheduled_grains++)].state = state;
     }
+
+    // Resolve every waiting grain against this block; grains due later keep -1.
+    for (int i = 0; i < m_num_scheduled_grains; ++i)
+    {
+        auto& scheduled = m_scheduled_grains[static_cast<size_t>(i)];
+        scheduled.due_sample = resolve_scheduled_sample(scheduled.state,
+                                                        block_beat,
+                                                        beats_per_sample,
+                                                        transport_playing,
+                                                        num_samples);
+    }
+
+    // Late grains start right away, the rest wait for the sample loop.
+    fire_scheduled_grains(0);
 }
 
-GrainVoice* LayerCakeEngine::find_free_voice()
+int LayerCakeEngine::resolve_scheduled_sample(const GrainState& state,
+                                              double block_beat,
+                                              double beats_per_sample,
+                                              bool transport_playing,
+                                              int num_samples) const
 {
-    for (auto& voice : m_voices)
+    if (state.has_start_sample())
+    {
+        const juce::int64 offset = state.start_sample - m_sample_clock.load(std::memory_order_relaxed);
+        if (offset >= num_samples)
+            return -1;
+        return static_cast<int>(std::max<juce::int64>(0, offset));
+    }
+
+    // Beat timestamps only move while the transport runs.
+    if (!transport_playing || beats_per_sample <= 0.0)
+        return -1;
+
+    // First sample whose beat reaches start_beat, matching how process_lfo_sample
+    // sees the clock.
+    const double offset = std::ceil((state.start_beat - block_beat) / beats_per_sample);
+    if (offset >= static_cast<double>(num_samples))
+        return -1;
+    return static_cast<int>(juce::jmax(0.0, offset));
+}
+
+void LayerCakeEngine::fire_scheduled_grains(int block_sample)
+{
+    int i = 0;
+    while (i < m_num_scheduled_grains)
     {
-        if (!voice->is_active())
-            return voice.get();
+        auto& scheduled = m_scheduled_grains[static_cast<size_t>(i)];
+        if (scheduled.due_sample < 0 || scheduled.due_sample > block_sample)
+        {
+            ++i;
+            continue;
+        }
+
+        start_grain_immediate(scheduled.state);
+
+        // Order doesn't matter, so fill the hole with the last entry.
+        scheduled = m_scheduled_grains[static_cast<size_t>(--m_num_scheduled_grains)];
+    }
+
+    update_next_scheduled_sample();
+}
+
+void LayerCakeEngine::update_next_scheduled_sample()
+{
+    m_next_scheduled_sample = -1;
+    for (int i = 0; i < m_num_scheduled_grains; ++i)
+    {
+        const int due = m_scheduled_grains[static_cast<size_t>(i)].due_sample;
+        if (due >= 0 && (m_next_scheduled_sample < 0 || due < m_next_scheduled_sample))
+            m_next_scheduled_sample = due;
     }
-    return nullptr;
 }
 
 void LayerCakeEngine::get_active_grains(std::vector<GrainVisualState>& out_states) const
@@ -643,27 +1097,30 @@ void LayerCakeEngine::capture_layer_snapshot(int layer_index, LayerBufferSnapsho
         DBG("LayerCakeEngine::capture_layer_snapshot invalid layer=" + juce::String(layer_index));
         snapshot.samples.clear();
         snapshot.recorded_length = 0;
+        snapshot.num_channels = 1;
         snapshot.has_audio = false;
         return;
     }
 
     const auto& loop = m_layers[static_cast<size_t>(layer_index)];
     const juce::ScopedLock sl(loop.m_lock);
-    const auto& buffer = loop.get_buffer();
-    const size_t recorded = juce::jmin(loop.m_recorded_length.load(), buffer.size());
+    const size_t recorded = juce::jmin(loop.m_recorded_length.load(), loop.get_buffer_size());
 
     if (recorded == 0 || !loop.m_has_recorded.load())
     {
         snapshot.samples.clear();
         snapshot.recorded_length = 0;
+        snapshot.num_channels = 1;
         snapshot.has_audio = false;
         return;
     }
 
-    snapshot.samples.resize(recorded);
-    if (recorded > 0)
-        juce::FloatVectorOperations::copy(snapshot.samples.data(), buffer.data(), static_cast<int>(recorded));
+    const int num_channels = loop.get_num_channels();
+    snapshot.samples.resize(recorded * static_cast<size_t>(num_channels));
+    for (int channel = 0; channel < num_channels; ++channel)
+        loop.read(0, snapshot.samples.data() + static_cast<size_t>(channel) * recorded, recorded, channel);
     snapshot.recorded_length = recorded;
+    snapshot.num_channels = num_channels;
     snapshot.has_audio = true;
 }
 
@@ -682,29 +1139,31 @@ void LayerCakeEngine::apply_layer_snapshot(int layer_index, const LayerBufferSna
     }
 
     auto& loop = m_layers[static_cast<size_t>(layer_index)];
-    const juce::ScopedLock sl(loop.m_lock);
 
-    if (!snapshot.has_audio || snapshot.recorded_length == 0 || snapshot.samples.empty())
+    const int num_channels = juce::jlimit(1, TapeLoop::kMaxChannels, snapshot.num_channels);
+    const size_t recorded = juce::jmin(snapshot.recorded_length, snapshot.samples.size() / static_cast<size_t>(num_channels));
+    if (!snapshot.has_audio || recorded == 0)
     {
         DBG("LayerCakeEngine::apply_layer_snapshot clearing layer=" + juce::String(layer_index));
-        loop.m_recorded_length.store(0);
-        loop.m_has_recorded.store(false);
-        auto& buffer = loop.get_buffer();
-        if (!buffer.empty())
-            juce::FloatVectorOperations::clear(buffer.data(), static_cast<int>(buffer.size()));
+        loop.clear_buffer();
         return;
     }
 
-    auto& buffer = loop.get_buffer();
-    if (buffer.size() < snapshot.samples.size())
-        buffer.resize(snapshot.samples.size(), 0.0f);
-
-    std::copy(snapshot.samples.begin(), snapshot.samples.end(), buffer.begin());
-    loop.m_recorded_length.store(snapshot.recorded_length);
-    loop.m_has_recorded.store(true);
+    // Build the restored layer off to the side and swap it in, so a larger
+    // snapshot never resizes storage a grain voice is reading
+    const size_t capacity = juce::jmax(loop.get_buffer_size(), recorded);
+    std::vector<std::vector<float>> channels(static_cast<size_t>(num_channels));
+    for (size_t channel = 0; channel < channels.size(); ++channel)
+    {
+        channels[channel].resize(capacity, 0.0f);
+        const auto first = snapshot.samples.begin() + static_cast<std::ptrdiff_t>(channel * recorded);
+        std::copy(first, first + static_cast<std::ptrdiff_t>(recorded), channels[channel].begin());
+    }
+    loop.publish_buffer(std::move(channels), recorded, true);
 }
 
-bool LayerCakeEngine::load_layer_from_file(int layer_index, const juce::File& audio_file)
+bool LayerCakeEngine::load_layer_from_file(int layer_index, const juce::File& audio_file,
+                                           std::function<void(bool)> on_loaded)
 {
     if (!layer_index_valid(layer_index))
     {
@@ -726,81 +1185,69 @@ bool LayerCakeEngine::load_layer_from_file(int layer_index, const juce::File& au
     }
 
     auto& loop = m_layers[static_cast<size_t>(layer_index)];
-    const juce::ScopedLock sl(loop.m_lock);
 
-    if (loop.get_buffer().empty())
+    size_t max_samples = loop.get_buffer_size();
+    if (max_samples == 0)
     {
         if (m_sample_rate <= 0.0)
         {
             DBG("LayerCakeEngine::load_layer_from_file early return buffer not allocated sampleRate<=0");
             return false;
         }
-        loop.allocate_buffer(m_sample_rate, kMaxLayerDurationSeconds);
+        max_samples = static_cast<size_t>(m_sample_rate * kMaxLayerDurationSeconds);
     }
 
-    auto& buffer = loop.get_buffer();
-    if (buffer.empty())
+    if (max_samples == 0)
     {
         DBG("LayerCakeEngine::load_layer_from_file early return buffer still empty after allocate");
         return false;
     }
 
-    const size_t max_samples = buffer.size();
-    const size_t reader_samples = static_cast<size_t>(juce::jmax<juce::int64>(0, reader->lengthInSamples));
-    const size_t samples_to_copy = juce::jmin(max_samples, reader_samples);
-    if (samples_to_copy == 0)
+    if (reader->lengthInSamples <= 0)
     {
         DBG("LayerCakeEngine::load_layer_from_file early return no samples to copy");
         return false;
     }
 
-    juce::AudioBuffer<float> temp_buffer(static_cast<int>(juce::jmax<juce::uint32>(1, reader->numChannels)),
-                                         static_cast<int>(samples_to_copy));
-    if (!reader->read(&temp_buffer, 0, static_cast<int>(samples_to_copy), 0, true, true))
-    {
-        DBG("LayerCakeEngine::load_layer_from_file early return failed to read audio data");
-        return false;
-    }
-
-    if (temp_buffer.getNumChannels() == 1)
-    {
-        const float* source = temp_buffer.getReadPointer(0);
-        std::copy(source, source + static_cast<int>(samples_to_copy), buffer.begin());
-    }
-    else
-    {
-        const int channels = temp_buffer.getNumChannels();
-        for (size_t sample = 0; sample < samples_to_copy; ++sample)
+    // Decode, convert to the engine rate and downmix in the background; grains
+    // keep reading the old layer until the new one is published
+    AudioFileLoader::Request request;
+    request.reader = std::move(reader);
+    request.target_sample_rate = m_sample_rate;
+    request.max_length = max_samples;
+    request.capacity = max_samples;
+    request.num_channels = juce::jmin(static_cast<int>(request.reader->numChannels), kMaxLayerChannels);
+    request.normalize = m_normalize_on_load.load();
+
+    const auto file_name = audio_file.getFileName();
+    m_layer_loaders[static_cast<size_t>(layer_index)].load(std::move(request),
+        [this, layer_index, file_name, on_loaded](AudioFileLoader::Result& result)
         {
-            float mixed = 0.0f;
-            for (int channel = 0; channel < channels; ++channel)
-                mixed += temp_buffer.getSample(channel, static_cast<int>(sample));
-            buffer[sample] = mixed / static_cast<float>(channels);
-        }
-    }
-
-    if (samples_to_copy < max_samples)
-        std::fill(buffer.begin() + static_cast<ptrdiff_t>(samples_to_copy), buffer.end(), 0.0f);
-
-    // Optional Normalization
-    if (m_normalize_on_load.load())
-    {
-        float max_val = 0.0f;
-        for (size_t i = 0; i < samples_to_copy; ++i)
-            max_val = juce::jmax(max_val, std::abs(buffer[i]));
-
-        if (max_val > 0.0001f)
-        {
-            const float scale = 1.0f / max_val;
-            juce::FloatVectorOperations::multiply(buffer.data(), scale, static_cast<int>(samples_to_copy));
-            DBG("LayerCakeEngine::load_layer_from_file normalized peak=" + juce::String(max_val));
-        }
-    }
+            if (!result.ok)
+            {
+                DBG("LayerCakeEngine::load_layer_from_file failed " + file_name + ": " + result.error);
+                if (on_loaded)
+                    on_loaded(false);
+                return;
+            }
+
+            const size_t loaded_length = result.length;
+            m_layers[static_cast<size_t>(layer_index)].publish_buffer(std::move(result.channels), loaded_length, true);
+
+            DBG("LayerCakeEngine::load_layer_from_file loaded "
+                + file_name + " into layer=" + juce::String(layer_index));
+            if (on_loaded)
+                on_loaded(true);
+        });
+    return true;
+}
 
-    loop.m_recorded_length.store(samples_to_copy);
-    loop.m_has_recorded.store(true);
+bool LayerCakeEngine::is_loading_layer(int layer_index) const
+{
+    return layer_index_valid(layer_index) && m_layer_loaders[static_cast<size_t>(layer_index)].is_loading();
+}
 
-    DBG("LayerCakeEngine::load_layer_from_file loaded "
-        + audio_file.getFileName() + " into layer=" + juce::String(layer_index));
-    return true;
+bool LayerCakeEngine::wait_for_layer_load(int layer_index, int timeout_ms)
+{
+    return !layer_index_valid(layer_index) || m_layer_loaders[static_cast<size_t>(layer_index)].wait_until_done(timeout_ms);
 }
@@ -2,12 +2,16 @@
 
 #include "GrainVoice.h"
 #include "LayerCakeTypes.h"
+#include "ModulationMatrix.h"
+#include "VoiceAllocation.h"
 #include <flowerjuce/DSP/LfoUGen.h>
 #include <flowerjuce/LooperEngine/LooperWriteHead.h>
+#include <flowerjuce/LooperEngine/AudioFileLoader.h>
 #include <flowerjuce/Sync/SyncInterface.h>
 #include <juce_audio_formats/juce_audio_formats.h>
 #include <array>
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <juce_core/juce_core.h>
@@ -16,9 +20,24 @@ class LayerCakeEngine
 {
 public:
     static constexpr size_t kNumLayers = 6;
-    static constexpr size_t kNumVoices = 16;
+    static constexpr int kDefaultNumVoices = 16;
+    static constexpr int kMinVoices = 1;
+    static constexpr int kMaxVoices = 256;
     static constexpr size_t kNumLfoSlots = 8;
     static constexpr double kMaxLayerDurationSeconds = 10.0;
+    static constexpr int kMaxLayerChannels = 2; // Loaded files keep up to this many channels (output is stereo)
+    static constexpr int kMaxScheduledGrains = 512;
+    static constexpr int kOfflineBlockSize = 8192;
+
+    // Offline renders run on a deterministic sample-count clock at a fixed
+    // tempo. The seed feeds the engine's juce::Random and every LFO slot
+    // that has no seed of its own, so the same settings give the same file.
+    struct OfflineRenderSettings
+    {
+        double bpm{120.0};
+        int block_size{kOfflineBlockSize};
+        juce::int64 random_seed{1};
+    };
 
     LayerCakeEngine();
     ~LayerCakeEngine();
@@ -31,12 +50,37 @@ public:
                        int num_output_channels,
                        int num_samples);
 
+    // Queue a grain from any thread. Grains with start_sample / start_beat set
+    // are held until their time and start on that exact sample; others start
+    // at the top of the next block.
     void trigger_grain(const GrainState& state);
+
+    // Renders num_beats of the current scene as fast as the CPU allows and
+    // writes it to writer, which must match the prepared sample rate. The
+    // sync strategy is swapped for an OfflineSyncStrategy for the duration,
+    // playing voices are stopped and the sample clock restarts at 0, so
+    // grains queued with start_sample are relative to the start of the file.
+    // Not for use while an audio device is driving process_block.
+    bool render_offline(const OfflineRenderSettings& settings,
+                        double num_beats,
+                        juce::AudioFormatWriter& writer);
+    // Hand an LFO config to the audio thread. Call from one non-audio thread
+    // (the UI); it only waits if the audio thread is mid-copy of the slot.
     void update_lfo_slot(int slot_index, const flower::LayerCakeLfoUGen& generator, bool enabled);
+    // Same, for callers already on the audio thread (e.g. the processor
+    // applying automation before process_block). Applies immediately.
+    void apply_lfo_slot_from_audio_thread(int slot_index, const flower::LayerCakeLfoUGen& generator, bool enabled);
     void set_trigger_lfo_index(int slot_index);
-    void set_manual_trigger_template(const GrainState& state);
-    void set_manual_reverse_probability(float probability);
     void request_manual_trigger();
+
+    // Modulation matrix. Manual/LFO-triggered grains are built on the audio
+    // thread from the base values (the unmodulated knob values) with any
+    // routed LFO applied at the trigger sample, so a headless engine sounds
+    // the same as one with the editor open. MasterGain is applied per block.
+    void set_modulation_base(ModulationTarget target, float value);
+    float get_modulation_base(ModulationTarget target) const;
+    void set_modulation_route(ModulationTarget target, int lfo_slot); // -1 clears
+    int get_modulation_route(ModulationTarget target) const;
     float get_lfo_visual_value(int slot_index) const;
 
     void set_record_layer(int layer_index);
@@ -48,10 +92,26 @@ public:
     void set_record_input_channel(int channel) { m_record_input_channel = channel; }
     int get_record_input_channel() const { return m_record_input_channel; }
 
-    void set_master_gain_db(float db) { m_master_gain_db.store(db); }
-    float get_master_gain_db() const { return m_master_gain_db.load(); }
+    void set_master_gain_db(float db) { set_modulation_base(ModulationTarget::MasterGain, db); }
+    float get_master_gain_db() const { return get_modulation_base(ModulationTarget::MasterGain); }
     double get_sample_rate() const { return m_sample_rate; }
 
+    // Absolute sample index of the start of the next block. Add an offset to
+    // this to schedule a grain with GrainState::start_sample.
+    juce::int64 get_sample_clock() const { return m_sample_clock.load(std::memory_order_acquire); }
+
+    // Voice pool size and steal policy can change at any time; the audio
+    // thread picks them up at the start of the next block. Shrinking the pool
+    // fades out any grains above the new size.
+    void set_num_voices(int num_voices);
+    int get_num_voices() const { return m_requested_num_voices.load(std::memory_order_relaxed); }
+    void set_steal_policy(VoiceStealPolicy policy) { m_steal_policy.store(static_cast<int>(policy), std::memory_order_relaxed); }
+    VoiceStealPolicy get_steal_policy() const { return static_cast<VoiceStealPolicy>(m_steal_policy.load(std::memory_order_relaxed)); }
+
+    // Steal statistics. The rate is updated once per second of audio.
+    float get_steals_per_second() const { return m_steals_per_second.load(std::memory_order_relaxed); }
+    juce::uint64 get_total_steals() const { return m_total_steals.load(std::memory_order_relaxed); }
+
     void set_normalize_on_load(bool normalize) { m_normalize_on_load.store(normalize); }
     bool get_normalize_on_load() const { return m_normalize_on_load.load(); }
 
@@ -73,7 +133,12 @@ public:
     void capture_layer_snapshot(int layer_index, LayerBufferSnapshot& snapshot) const;
     void capture_all_layer_snapshots(std::array<LayerBufferSnapshot, kNumLayers>& snapshots) const;
     void apply_layer_snapshot(int layer_index, const LayerBufferSnapshot& snapshot);
-    bool load_layer_from_file(int layer_index, const juce::File& audio_file);
+    // Loads in the background (see AudioFileLoader); false if the file cannot
+    // be opened. on_loaded(success) runs on a loader thread when it finishes.
+    bool load_layer_from_file(int layer_index, const juce::File& audio_file,
+                              std::function<void(bool)> on_loaded = {});
+    bool is_loading_layer(int layer_index) const;
+    bool wait_for_layer_load(int layer_index, int timeout_ms);
 
     void apply_spread_randomization(GrainState& state, float spread_amount);
     void apply_direction_randomization(GrainState& state, float reverse_prob);
@@ -83,10 +148,20 @@ public:
 
 private:
     void allocate_layers(double sample_rate);
+    void reset_for_offline_render(juce::int64 random_seed);
     void rebuild_write_head();
     bool layer_index_valid(int layer_index) const;
-    void drain_pending_grains();
-    GrainVoice* find_free_voice();
+    void drain_pending_grains(double block_beat, double beats_per_sample, bool transport_playing, int num_samples);
+    int resolve_scheduled_sample(const GrainState& state,
+                                 double block_beat,
+                                 double beats_per_sample,
+                                 bool transport_playing,
+                                 int num_samples) const;
+    void fire_scheduled_grains(int block_sample);
+    void update_next_scheduled_sample();
+    GrainVoice* acquire_voice(int layer_index, size_t& out_voice_index);
+    void apply_voice_count();
+    void update_steal_rate(int num_samples);
     void process_recording_sample(const float* const* input_channel_data,
                                   int num_input_channels,
                                   int buffer_sample_index,
@@ -94,10 +169,30 @@ private:
     void sync_lfo_configs();
     void process_lfo_sample(double master_beats);
     void fire_manual_trigger();
+    float get_modulated_value(ModulationTarget target) const;
+    GrainState build_manual_grain_state() const;
     void start_grain_immediate(const GrainState& state);
+    void render_voices_until(int chunk_sample);
+    void mix_voices_to_output(float* const* output_channel_data,
+                              int num_output_channels,
+                              int output_offset,
+                              int num_samples,
+                              float master_gain);
 
     std::array<TapeLoop, kNumLayers> m_layers;
-    std::array<std::unique_ptr<GrainVoice>, kNumVoices> m_voices;
+    // All kMaxVoices voices are built up front so resizing never reallocates
+    // while the UI is reading visual state; only the first m_num_voices are used.
+    std::vector<std::unique_ptr<GrainVoice>> m_voices;
+    VoicePoolState m_voice_pool;
+    int m_num_voices{kDefaultNumVoices};
+    std::atomic<int> m_requested_num_voices{kDefaultNumVoices};
+    std::atomic<int> m_steal_policy{static_cast<int>(VoiceStealPolicy::Oldest)};
+    juce::uint64 m_voice_start_counter{0};
+
+    std::atomic<juce::uint64> m_total_steals{0};
+    std::atomic<float> m_steals_per_second{0.0f};
+    int m_steal_window_count{0};
+    juce::int64 m_steal_window_samples{0};
     std::unique_ptr<LooperWriteHead> m_write_head;
 
     class GrainTriggerQueue
@@ -121,6 +216,25 @@ private:
         bool enabled{true};
     };
 
+    // Single-producer double buffer for LFO configs. The writer fills the
+    // buffer the audio thread isn't pointing at, then flips the index and
+    // marks it pending; the audio thread claims the pending buffer, copies
+    // it out and never blocks.
+    class LfoConfigHandoff
+    {
+    public:
+        void publish(const flower::LayerCakeLfoUGen& generator, bool enabled);
+        bool consume(flower::LayerCakeLfoUGen& dest, bool& out_enabled);
+
+    private:
+        static constexpr uint32_t kIndexBit = 1u;
+        static constexpr uint32_t kPendingBit = 2u;
+        static constexpr uint32_t kReadingBit = 4u;
+
+        std::array<LfoSnapshot, 2> m_buffers;
+        std::atomic<uint32_t> m_state{0};
+    };
+
     struct LfoRuntimeState
     {
         flower::LayerCakeLfoUGen generator;
@@ -136,9 +250,21 @@ private:
 
     GrainTriggerQueue m_pending_grains;
 
+    // Timestamped grains waiting for their start sample. due_sample is the
+    // index inside the current block, or -1 if the grain is due later.
+    struct ScheduledGrain
+    {
+        GrainState state;
+        int due_sample{-1};
+    };
+
+    std::array<ScheduledGrain, static_cast<size_t>(kMaxScheduledGrains)> m_scheduled_grains;
+    int m_num_scheduled_grains{0};
+    int m_next_scheduled_sample{-1};
+    std::atomic<juce::int64> m_sample_clock{0};
+
     std::atomic<bool> m_is_prepared{false};
     std::atomic<bool> m_record_enabled{false};
-    std::atomic<float> m_master_gain_db{0.0f};
     std::atomic<bool> m_normalize_on_load{false};
 
     double m_sample_rate{44100.0};
@@ -148,6 +274,13 @@ private:
     int m_record_input_channel{-1}; // -1 = follow first channel
     std::atomic<size_t> m_record_cursor{0};
 
+    // Voice mix scratch (sized in prepare). Voices render in segments so grains
+    // started mid-block still begin on the sample that triggered them.
+    std::vector<float> m_voice_mix_left;
+    std::vector<float> m_voice_mix_right;
+    int m_voice_render_cursor{0};
+    int m_chunk_sample_index{0};
+
     juce::SpinLock m_record_lock;
     juce::Random m_random;
     juce::AudioFormatManager m_audio_format_manager;
@@ -156,15 +289,17 @@ private:
     std::unique_ptr<flower::SyncInterface> m_sync;
 
     // LFO runtime + UI mirrors
-    std::array<LfoSnapshot, kNumLfoSlots> m_lfo_pending_configs;
-    std::array<std::atomic<bool>, kNumLfoSlots> m_lfo_dirty_flags;
+    std::array<LfoConfigHandoff, kNumLfoSlots> m_lfo_handoffs;
     std::array<LfoRuntimeState, kNumLfoSlots> m_lfo_runtime;
     UiLfoMirror m_lfo_visuals;
     std::atomic<int> m_trigger_lfo_index{-1};
 
-    // Manual trigger template + randomness
-    juce::SpinLock m_manual_state_lock;
-    GrainState m_manual_trigger_template;
-    std::atomic<float> m_manual_reverse_probability{0.0f};
+    // Modulation matrix: one base value and at most one LFO per target.
+    std::array<std::atomic<float>, ModulationMatrix::kNumTargets> m_modulation_bases;
+    std::array<std::atomic<int>, ModulationMatrix::kNumTargets> m_modulation_routes;
+
     std::atomic<int> m_manual_trigger_requests{0};
+
+    // One background file load per layer; declared last so loads stop before the layers go
+    std::array<AudioFileLoader::Client, kNumLayers> m_layer_loaders;
 };
@@ -19,7 +19,18 @@ struct GrainState
     float pan{0.5f};                  // 0.0 = left, 1.0 = right
     bool should_trigger{false};       // false indicates a "null" GrainState entry
 
+    // Optional start time. When neither is set the grain starts on the first
+    // sample of the next block. start_sample is an absolute engine sample
+    // (see LayerCakeEngine::get_sample_clock); start_beat is a transport beat.
+    // If both are set start_sample wins. Times already in the past start at
+    // the beginning of the next block.
+    juce::int64 start_sample{-1};
+    double start_beat{-1.0};
+
     bool is_valid() const noexcept { return should_trigger; }
+    bool has_start_sample() const noexcept { return start_sample >= 0; }
+    bool has_start_beat() const noexcept { return start_beat >= 0.0; }
+    bool is_scheduled() const noexcept { return has_start_sample() || has_start_beat(); }
 };
 
 struct GrainVisualState
@@ -39,8 +50,9 @@ struct GrainVisualState
 
 struct LayerBufferSnapshot
 {
-    std::vector<float> samples;
+    std::vector<float> samples; // num_channels planes of recorded_length, back to back
     size_t recorded_length{0};
+    int num_channels{1};
     bool has_audio{false};
 };
 
@@ -0,0 +1,49 @@
+#include "ModulationMatrix.h"
+#include <algorithm>
+
+namespace ModulationMatrix
+{
+    namespace
+    {
+        // Ranges and defaults mirror the LayerCake parameter layout.
+        struct TargetSpec
+        {
+            ModulationRange range;
+            float default_value;
+        };
+
+        constexpr std::array<TargetSpec, kNumTargets> kTargetSpecs{{
+            { { 0.0f, 1.0f }, 0.5f },       // Position
+            { { 10.0f, 5000.0f }, 300.0f }, // Duration
+            { { -24.0f, 24.0f }, 0.0f },    // Rate
+            { { 0.0f, 1.0f }, 0.5f },       // Envelope
+            { { 0.0f, 1.0f }, 0.5f },       // Direction
+            { { 0.0f, 1.0f }, 0.5f },       // Pan
+            { { 1.0f, 6.0f }, 1.0f },       // Layer
+            { { -24.0f, 6.0f }, 0.0f },     // MasterGain
+        }};
+    } // namespace
+
+    ModulationRange default_range(ModulationTarget target)
+    {
+        const auto index = static_cast<size_t>(target);
+        return index < kNumTargets ? kTargetSpecs[index].range : ModulationRange{};
+    }
+
+    float default_base(ModulationTarget target)
+    {
+        const auto index = static_cast<size_t>(target);
+        return index < kNumTargets ? kTargetSpecs[index].default_value : 0.0f;
+    }
+
+    float apply(float base_value, const ModulationRange& range, float lfo_value)
+    {
+        const float span = range.max_value - range.min_value;
+        if (span <= 0.0f)
+            return base_value;
+
+        const float base_normalized = std::clamp((base_value - range.min_value) / span, 0.0f, 1.0f);
+        const float modulated = std::clamp(base_normalized + lfo_value * 0.5f, 0.0f, 1.0f);
+        return range.min_value + modulated * span;
+    }
+}
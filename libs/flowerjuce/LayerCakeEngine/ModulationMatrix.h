@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+// Grain/engine parameters an LFO slot can be routed to. The order matches
+// ModulationMatrix::default_range.
+enum class ModulationTarget
+{
+    Position = 0,   // normalized 0-1 position in the layer
+    Duration,       // ms
+    Rate,           // semitones
+    Envelope,       // 0 = all attack, 1 = all release
+    Direction,      // reverse probability 0-1
+    Pan,            // 0 = left, 1 = right
+    Layer,          // 1-based layer index
+    MasterGain,     // dB
+    Count
+};
+
+struct ModulationRange
+{
+    float min_value{0.0f};
+    float max_value{1.0f};
+};
+
+// Stateless helpers for the LayerCake modulation matrix. The law matches the
+// UI knobs: the base value is normalized to its range, the LFO (-1..1) moves
+// it by up to half the range, and the result is clamped back into range.
+namespace ModulationMatrix
+{
+    constexpr size_t kNumTargets = static_cast<size_t>(ModulationTarget::Count);
+
+    ModulationRange default_range(ModulationTarget target);
+    float default_base(ModulationTarget target);
+    float apply(float base_value, const ModulationRange& range, float lfo_value);
+}
@@ -0,0 +1,97 @@
+#include "VoiceAllocation.h"
+#include <algorithm>
+
+void VoicePoolState::resize(size_t num_voices)
+{
+    active.assign(num_voices, 0);
+    needs_render.assign(num_voices, 0);
+    start_order.assign(num_voices, 0);
+    level.assign(num_voices, 0.0f);
+    layer.assign(num_voices, 0);
+}
+
+void VoicePoolState::clear_voice(size_t voice_index)
+{
+    active[voice_index] = 0;
+    start_order[voice_index] = 0;
+    level[voice_index] = 0.0f;
+}
+
+namespace VoiceAllocation
+{
+    namespace
+    {
+        int find_oldest(const VoicePoolState& pool, int num_voices, int layer_filter)
+        {
+            int oldest = -1;
+            for (int voice = 0; voice < num_voices; ++voice)
+            {
+                const auto index = static_cast<size_t>(voice);
+                if (pool.active[index] == 0)
+                    continue;
+                if (layer_filter >= 0 && pool.layer[index] != layer_filter)
+                    continue;
+                if (oldest < 0 || pool.start_order[index] < pool.start_order[static_cast<size_t>(oldest)])
+                    oldest = voice;
+            }
+            return oldest;
+        }
+
+        int find_quietest(const VoicePoolState& pool, int num_voices)
+        {
+            int quietest = -1;
+            for (int voice = 0; voice < num_voices; ++voice)
+            {
+                const auto index = static_cast<size_t>(voice);
+                if (pool.active[index] == 0)
+                    continue;
+                if (quietest < 0)
+                {
+                    quietest = voice;
+                    continue;
+                }
+
+                // Ties go to the older grain.
+                const auto best = static_cast<size_t>(quietest);
+                if (pool.level[index] < pool.level[best]
+                    || (pool.level[index] == pool.level[best] && pool.start_order[index] < pool.start_order[best]))
+                    quietest = voice;
+            }
+            return quietest;
+        }
+    } // namespace
+
+    int find_free_voice(const VoicePoolState& pool, int num_voices)
+    {
+        const int limit = std::min(num_voices, static_cast<int>(pool.active.size()));
+        for (int voice = 0; voice < limit; ++voice)
+        {
+            if (pool.active[static_cast<size_t>(voice)] == 0)
+                return voice;
+        }
+        return -1;
+    }
+
+    int choose_steal_victim(const VoicePoolState& pool,
+                            int num_voices,
+                            VoiceStealPolicy policy,
+                            int layer)
+    {
+        const int limit = std::min(num_voices, static_cast<int>(pool.active.size()));
+        switch (policy)
+        {
+            case VoiceStealPolicy::Quietest:
+                return find_quietest(pool, limit);
+
+            case VoiceStealPolicy::SameLayer:
+            {
+                const int same_layer = find_oldest(pool, limit, layer);
+                return same_layer >= 0 ? same_layer : find_oldest(pool, limit, -1);
+            }
+
+            case VoiceStealPolicy::Oldest:
+            default:
+                return find_oldest(pool, limit, -1);
+        }
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+enum class VoiceStealPolicy
+{
+    Oldest = 0,     // steal the grain that started first
+    Quietest,       // steal the grain with the lowest envelope level
+    SameLayer       // steal the oldest grain on the new grain's layer, else the oldest overall
+};
+
+// Per-voice bookkeeping kept as parallel arrays so allocation and stealing
+// scan a few contiguous bytes per voice instead of touching every GrainVoice.
+// Only the audio thread reads or writes this.
+struct VoicePoolState
+{
+    std::vector<uint8_t> active;        // grain is playing (voice can't be reused without a steal)
+    std::vector<uint8_t> needs_render;  // grain playing or steal fade still ringing out
+    std::vector<uint64_t> start_order;  // monotonically increasing trigger stamp
+    std::vector<float> level;           // envelope level at the end of the last render
+    std::vector<int> layer;
+
+    void resize(size_t num_voices);
+    void clear_voice(size_t voice_index);
+};
+
+// Stateless voice allocation helpers used by LayerCakeEngine.
+namespace VoiceAllocation
+{
+    // Index of the first inactive voice below num_voices, or -1 if all are busy.
+    int find_free_voice(const VoicePoolState& pool, int num_voices);
+
+    // Index of the voice to steal under the given policy, or -1 if none are active.
+    int choose_steal_victim(const VoicePoolState& pool,
+                            int num_voices,
+                            VoiceStealPolicy policy,
+                            int layer);
+}
@@ -0,0 +1,224 @@
+#include "AudioFileLoader.h"
+#include "TapeLoop.h"
+#include <flowerjuce/DSP/PolyphaseResampler.h>
+#include <cmath>
+
+namespace
+{
+// Extra source samples decoded past the last one needed, so the resampler
+// has real audio (not zero padding) under its filter at the end of the load
+constexpr size_t kResampleTail = 256;
+} // namespace
+
+AudioFileLoader::Result AudioFileLoader::decode(Request& request,
+                                                const std::function<bool()>& should_exit,
+                                                std::atomic<float>* progress)
+{
+    Result result;
+    auto* reader = request.reader.get();
+    if (reader == nullptr)
+    {
+        result.error = "No reader";
+        return result;
+    }
+
+    auto cancelled = [&]()
+    {
+        if (should_exit == nullptr || !should_exit())
+            return false;
+        result.error = "Cancelled";
+        return true;
+    };
+    auto report = [progress](double fraction)
+    {
+        if (progress != nullptr)
+            progress->store(static_cast<float>(fraction));
+    };
+
+    const double target_rate = request.target_sample_rate > 0.0 ? request.target_sample_rate : 44100.0;
+    const double source_rate = reader->sampleRate > 0.0 ? reader->sampleRate : target_rate;
+    const bool convert = std::abs(source_rate - target_rate) > target_rate * 1.0e-9;
+    const size_t capacity = juce::jmax(request.capacity, request.max_length);
+    result.source_sample_rate = source_rate;
+
+    // Decode only what the tape can hold (plus the resampler's look-ahead)
+    size_t source_needed = request.max_length;
+    if (convert)
+        source_needed = static_cast<size_t>(std::ceil(static_cast<double>(request.max_length) * source_rate / target_rate)) + kResampleTail;
+    const size_t source_length = juce::jmin(source_needed, static_cast<size_t>(juce::jmax<juce::int64>(0, reader->lengthInSamples)));
+    if (source_length == 0)
+    {
+        result.error = "No samples to load";
+        return result;
+    }
+
+    // Decoding is the bulk of the work unless there is a conversion after it
+    const double decode_share = convert ? 0.5 : 1.0;
+    const int file_channels = static_cast<int>(juce::jmax<unsigned int>(1, reader->numChannels));
+    const int num_channels = request.num_channels > 0 ? juce::jmin(request.num_channels, TapeLoop::kMaxChannels)
+                                                      : juce::jmin(file_channels, TapeLoop::kMaxChannels);
+
+    // Sized one by one: filling from a prototype would touch every sample twice
+    std::vector<std::vector<float>> planes(static_cast<size_t>(num_channels));
+    for (auto& plane : planes)
+        plane.resize(convert ? source_length : capacity, 0.0f);
+    juce::AudioBuffer<float> scratch(file_channels, static_cast<int>(juce::jmin<size_t>(kDecodeChunkFrames, source_length)));
+
+    for (size_t position = 0; position < source_length;)
+    {
+        if (cancelled())
+            return result;
+
+        const int count = static_cast<int>(juce::jmin<size_t>(kDecodeChunkFrames, source_length - position));
+        if (!reader->read(&scratch, 0, count, static_cast<juce::int64>(position), true, true))
+        {
+            result.error = "Failed to read audio data";
+            return result;
+        }
+
+        for (int channel = 0; channel < num_channels; ++channel)
+        {
+            float* destination = planes[static_cast<size_t>(channel)].data() + position;
+
+            // More outputs than file channels: repeat the file channel that lands here
+            if (channel >= file_channels)
+            {
+                juce::FloatVectorOperations::copy(destination, scratch.getReadPointer(channel % file_channels), count);
+                continue;
+            }
+
+            // Average the file channels folded onto this output straight into its plane
+            juce::FloatVectorOperations::copy(destination, scratch.getReadPointer(channel), count);
+            int folded = 1;
+            for (int source = channel + num_channels; source < file_channels; source += num_channels, ++folded)
+                juce::FloatVectorOperations::add(destination, scratch.getReadPointer(source), count);
+            if (folded > 1)
+                juce::FloatVectorOperations::multiply(destination, 1.0f / static_cast<float>(folded), count);
+        }
+
+        position += static_cast<size_t>(count);
+        report(decode_share * static_cast<double>(position) / static_cast<double>(source_length));
+    }
+
+    if (convert)
+    {
+        const PolyphaseResampler resampler(source_rate, target_rate);
+        result.length = juce::jmin(resampler.get_output_length(source_length), request.max_length);
+        result.channels.resize(static_cast<size_t>(num_channels));
+        for (auto& plane : result.channels)
+            plane.resize(capacity, 0.0f);
+
+        const size_t total = juce::jmax<size_t>(1, result.length * static_cast<size_t>(num_channels));
+        size_t converted = 0;
+        for (size_t channel = 0; channel < planes.size(); ++channel)
+        {
+            for (size_t position = 0; position < result.length; position += kDecodeChunkFrames)
+            {
+                if (cancelled())
+                    return result;
+
+                const size_t count = juce::jmin<size_t>(kDecodeChunkFrames, result.length - position);
+                resampler.process(planes[channel].data(), planes[channel].size(),
+                                  result.channels[channel].data() + position, position, count, false);
+                converted += count;
+                report(decode_share + (1.0 - decode_share) * static_cast<double>(converted) / static_cast<double>(total));
+            }
+        }
+    }
+    else
+    {
+        result.length = juce::jmin(source_length, request.max_length);
+        result.channels = std::move(planes);
+    }
+
+    if (request.normalize && result.length > 0)
+    {
+        // One gain for every channel keeps the balance between them
+        float peak = 0.0f;
+        for (const auto& plane : result.channels)
+        {
+            const auto range = juce::FloatVectorOperations::findMinAndMax(plane.data(), static_cast<int>(result.length));
+            peak = juce::jmax(peak, std::abs(range.getStart()), std::abs(range.getEnd()));
+        }
+        if (peak > 0.0001f)
+            for (auto& plane : result.channels)
+                juce::FloatVectorOperations::multiply(plane.data(), 1.0f / peak, static_cast<int>(result.length));
+    }
+
+    result.ok = true;
+    report(1.0);
+    return result;
+}
+
+class AudioFileLoader::Client::Job : public juce::ThreadPoolJob
+{
+public:
+    Job(Request request, Completion on_complete)
+        : juce::ThreadPoolJob("AudioFileLoader"),
+          m_request(std::move(request)),
+          m_on_complete(std::move(on_complete))
+    {
+    }
+
+    JobStatus runJob() override
+    {
+        auto result = decode(m_request, [this] { return shouldExit(); }, &m_progress);
+        m_request.reader.reset(); // Close the file before publishing
+
+        if (!shouldExit() && m_on_complete)
+            m_on_complete(result);
+
+        m_progress.store(1.0f);
+        m_busy.store(false);
+        return jobHasFinished;
+    }
+
+    std::atomic<bool> m_busy{true};
+    std::atomic<float> m_progress{0.0f};
+
+private:
+    Request m_request;
+    Completion m_on_complete;
+};
+
+AudioFileLoader::Client::Client() = default;
+
+AudioFileLoader::Client::~Client()
+{
+    cancel();
+}
+
+void AudioFileLoader::Client::load(Request request, Completion on_complete)
+{
+    cancel();
+    m_job = std::make_unique<Job>(std::move(request), std::move(on_complete));
+    m_decode_pool->pool.addJob(m_job.get(), false);
+}
+
+void AudioFileLoader::Client::cancel()
+{
+    if (m_job == nullptr)
+        return;
+
+    // Interrupts a running decode and waits for it; a queued one is just dropped
+    m_decode_pool->pool.removeJob(m_job.get(), true, -1);
+    m_job.reset();
+}
+
+bool AudioFileLoader::Client::is_loading() const
+{
+    return m_job != nullptr && m_job->m_busy.load();
+}
+
+float AudioFileLoader::Client::get_progress() const
+{
+    return is_loading() ? m_job->m_progress.load() : 1.0f;
+}
+
+bool AudioFileLoader::Client::wait_until_done(int timeout_ms)
+{
+    if (m_job == nullptr)
+        return true;
+    m_decode_pool->pool.waitForJobToFinish(m_job.get(), timeout_ms);
+    return !m_job->m_busy.load();
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// AudioFileLoader decodes audio files into planar tape buffers on a shared
+// background pool, so loading never runs on the message or audio thread
+//
+// A load reads the file in kDecodeChunkFrames slices (checking for
+// cancellation and reporting progress between them), maps each slice onto
+// the requested channels with vectorised ops, converts the result to the
+// engine's sample rate with a PolyphaseResampler and hands the finished
+// buffers to a completion callback, which publishes them in one swap.
+//
+// File channel k goes to output channel k % num_channels, and each output
+// is the average of the file channels it receives (so num_channels = 1 is
+// a plain downmix). Outputs no file channel reaches repeat one that is, so
+// a mono file fills a stereo tape.
+//
+// Each engine slot (a looper track, a LayerCake layer) owns a Client. A
+// Client runs at most one load: starting another cancels the previous one,
+// and destroying the Client cancels and waits, so a completion never runs
+// after its owner has gone. All Clients share one pool of decode threads.
+class AudioFileLoader
+{
+public:
+    static constexpr int kDecodeChunkFrames = 65536;
+    static constexpr int kNumDecodeThreads = 2;
+
+    struct Request
+    {
+        std::unique_ptr<juce::AudioFormatReader> reader; // Opened by the caller (header already parsed)
+        double target_sample_rate{44100.0};
+        size_t max_length{0};  // Longest result in target-rate samples
+        size_t capacity{0};    // Size of each returned channel (>= max_length), zero padded
+        int num_channels{1};   // Channels of the result; 0 keeps the file's (up to TapeLoop::kMaxChannels)
+        bool normalize{false}; // Scale the loaded part to a peak of 1 (one gain for all channels)
+    };
+
+    struct Result
+    {
+        bool ok{false};
+        juce::String error;
+        std::vector<std::vector<float>> channels; // One plane of capacity samples per channel, the first length loaded
+        size_t length{0};
+        double source_sample_rate{0.0};
+    };
+
+    // Runs on a decode thread once the buffer is ready (or the load failed)
+    using Completion = std::function<void(Result& result)>;
+
+    // Decode reader to planar buffers as described above, synchronously. Stops
+    // early (returning a failed result) once should_exit returns true.
+    static Result decode(Request& request,
+                         const std::function<bool()>& should_exit = {},
+                         std::atomic<float>* progress = nullptr);
+
+    // The decode threads every Client shares
+    struct DecodePool
+    {
+        juce::ThreadPool pool{ juce::ThreadPoolOptions{}.withThreadName("AudioFileLoader")
+                                                        .withNumberOfThreads(kNumDecodeThreads) };
+    };
+
+    class Client
+    {
+    public:
+        Client();
+        ~Client();
+
+        Client(const Client&) = delete;
+        Client& operator=(const Client&) = delete;
+
+        // Queue a load, cancelling the one in progress (non-realtime)
+        void load(Request request, Completion on_complete);
+
+        // Stop the current load and wait for it; its completion will not run
+        void cancel();
+
+        bool is_loading() const;
+        float get_progress() const; // 0..1, 1 when idle
+        bool wait_until_done(int timeout_ms);
+
+    private:
+        class Job;
+
+        juce::SharedResourcePointer<DecodePool> m_decode_pool;
+        std::unique_ptr<Job> m_job;
+    };
+};
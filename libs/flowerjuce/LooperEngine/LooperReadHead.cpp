@@ -1,5 +1,6 @@
 #include "LooperReadHead.h"
 #include <flowerjuce/Debug/DebugAudioRate.h>
+#include <array>
 #include <cmath>
 
 // TODO: Remove this debug macro after fixing segmentation fault
@@ -62,6 +63,227 @@ float LooperReadHead::process_sample(bool& wrapped)
     return sample_value;
 }
 
+void LooperReadHead::process_block(float* output, int num_samples, WrapInfo& wrap_info)
+{
+    process_block(m_tape_loop.get_view(), output, num_samples, wrap_info);
+}
+
+void LooperReadHead::process_block(const TapeLoop::View& tape, float* output, int num_samples, WrapInfo& wrap_info)
+{
+    wrap_info = WrapInfo{};
+    if (output == nullptr || num_samples <= 0)
+        return;
+
+    // Chunked tapes have no contiguous buffer for the fused kernel, and a
+    // multichannel tape is downmixed after the read
+    if (tape.is_chunked() || tape.get_num_channels() > 1)
+    {
+        advance_block(output, num_samples, wrap_info);
+        read_block(tape, output, output, num_samples);
+        apply_output_gain(output, num_samples);
+        return;
+    }
+
+    const float step = m_playback_speed.load(std::memory_order_relaxed)
+                     * (m_direction_fwd.load(std::memory_order_relaxed) ? 1.0f : -1.0f);
+
+    const float end_pos = ReadHeadKernels::render_block(tape.get_plane(0),
+                                                        tape.get_buffer_size(),
+                                                        m_pos.load(std::memory_order_relaxed),
+                                                        step,
+                                                        m_loop_start.load(std::memory_order_relaxed),
+                                                        m_loop_end.load(std::memory_order_relaxed),
+                                                        output,
+                                                        num_samples,
+                                                        wrap_info);
+    m_pos.store(end_pos, std::memory_order_relaxed);
+
+    apply_output_gain(output, num_samples);
+}
+
+void LooperReadHead::process_block(float* const* outputs, int num_channels, int num_samples, WrapInfo& wrap_info)
+{
+    process_block(m_tape_loop.get_view(), outputs, num_channels, num_samples, wrap_info);
+}
+
+void LooperReadHead::process_block(const TapeLoop::View& tape, float* const* outputs, int num_channels, int num_samples,
+                                   WrapInfo& wrap_info)
+{
+    if (num_channels <= 1)
+    {
+        process_block(tape, outputs != nullptr ? outputs[0] : nullptr, num_samples, wrap_info);
+        return;
+    }
+
+    wrap_info = WrapInfo{};
+    if (outputs == nullptr || num_samples <= 0)
+        return;
+
+    // Channel 0 holds the positions until the planar read overwrites it
+    advance_block(outputs[0], num_samples, wrap_info);
+    read_block(tape, outputs[0], outputs, num_channels, num_samples);
+    apply_output_gain(outputs, num_channels, num_samples);
+}
+
+void LooperReadHead::advance_block(float* positions, int num_samples, WrapInfo& wrap_info)
+{
+    wrap_info = WrapInfo{};
+    if (positions == nullptr || num_samples <= 0)
+        return;
+
+    const float step = m_playback_speed.load(std::memory_order_relaxed)
+                     * (m_direction_fwd.load(std::memory_order_relaxed) ? 1.0f : -1.0f);
+
+    const float end_pos = ReadHeadKernels::advance_positions(m_pos.load(std::memory_order_relaxed),
+                                                             step,
+                                                             m_loop_start.load(std::memory_order_relaxed),
+                                                             m_loop_end.load(std::memory_order_relaxed),
+                                                             positions,
+                                                             num_samples,
+                                                             wrap_info);
+    m_pos.store(end_pos, std::memory_order_relaxed);
+}
+
+void LooperReadHead::read_block(const float* positions, float* output, int num_samples) const
+{
+    read_block(m_tape_loop.get_view(), positions, output, num_samples);
+}
+
+void LooperReadHead::read_block(const float* positions, float* const* outputs, int num_channels, int num_samples) const
+{
+    read_block(m_tape_loop.get_view(), positions, outputs, num_channels, num_samples);
+}
+
+void LooperReadHead::read_block(const TapeLoop::View& tape, const float* positions, float* output, int num_samples) const
+{
+    if (tape.get_num_channels() > 1)
+    {
+        read_block_downmix(tape, positions, output, num_samples);
+        return;
+    }
+
+    if (tape.is_chunked())
+    {
+        ReadHeadKernels::interpolate_positions_chunked(tape.get_chunk_table(), TapeChunkPool::kChunkSizeLog2,
+                                                       tape.get_buffer_size(), positions, output, num_samples);
+        return;
+    }
+
+    ReadHeadKernels::interpolate_positions(tape.get_plane(0), tape.get_buffer_size(), positions, output, num_samples);
+}
+
+void LooperReadHead::read_block(const TapeLoop::View& tape, const float* positions, float* const* outputs,
+                                int num_channels, int num_samples) const
+{
+    if (num_channels <= 1)
+    {
+        read_block(tape, positions, outputs[0], num_samples);
+        return;
+    }
+
+    const int num_planes = juce::jmin(num_channels, tape.get_num_channels());
+    if (tape.is_chunked())
+    {
+        std::array<const std::atomic<float*>*, TapeLoop::kMaxChannels> tables{};
+        for (int plane = 0; plane < num_planes; ++plane)
+            tables[static_cast<size_t>(plane)] = tape.get_chunk_table(plane);
+        ReadHeadKernels::interpolate_positions_chunked_planar(tables.data(), num_planes, TapeChunkPool::kChunkSizeLog2,
+                                                              tape.get_buffer_size(), positions, outputs, num_samples);
+    }
+    else
+    {
+        std::array<const float*, TapeLoop::kMaxChannels> planes{};
+        for (int plane = 0; plane < num_planes; ++plane)
+            planes[static_cast<size_t>(plane)] = tape.get_plane(plane);
+        ReadHeadKernels::interpolate_positions_planar(planes.data(), num_planes, tape.get_buffer_size(),
+                                                      positions, outputs, num_samples);
+    }
+
+    for (int channel = num_planes; channel < num_channels; ++channel)
+        juce::FloatVectorOperations::copy(outputs[channel], outputs[num_planes - 1], num_samples);
+}
+
+void LooperReadHead::read_block_downmix(const TapeLoop::View& tape, const float* positions, float* output,
+                                        int num_samples) const
+{
+    // Read every plane a batch at a time into stack scratch, then average.
+    // Only the current batch of output is written, so output may be positions.
+    constexpr int kDownmixBatch = 64;
+    std::array<float, TapeLoop::kMaxChannels * kDownmixBatch> scratch;
+    std::array<float*, TapeLoop::kMaxChannels> planes{};
+
+    const int num_planes = tape.get_num_channels();
+    for (int plane = 0; plane < num_planes; ++plane)
+        planes[static_cast<size_t>(plane)] = scratch.data() + plane * kDownmixBatch;
+
+    const float plane_gain = 1.0f / static_cast<float>(num_planes);
+    for (int offset = 0; offset < num_samples; offset += kDownmixBatch)
+    {
+        const int count = juce::jmin(kDownmixBatch, num_samples - offset);
+        read_block(tape, positions + offset, planes.data(), num_planes, count);
+
+        float* destination = output + offset;
+        juce::FloatVectorOperations::copy(destination, planes[0], count);
+        for (int plane = 1; plane < num_planes; ++plane)
+            juce::FloatVectorOperations::add(destination, planes[static_cast<size_t>(plane)], count);
+        juce::FloatVectorOperations::multiply(destination, plane_gain, count);
+    }
+}
+
+void LooperReadHead::apply_output_gain(float* output, int num_samples)
+{
+    const float gain = juce::Decibels::decibelsToGain(m_level_db.load(std::memory_order_relaxed));
+    if (gain != 1.0f)
+        juce::FloatVectorOperations::multiply(output, gain, num_samples);
+
+    m_mute_gain.applyGain(output, num_samples);
+    update_level_meter(&output, 1, num_samples);
+}
+
+void LooperReadHead::apply_output_gain(float* const* outputs, int num_channels, int num_samples)
+{
+    if (num_channels <= 1)
+    {
+        apply_output_gain(outputs[0], num_samples);
+        return;
+    }
+
+    const float gain = juce::Decibels::decibelsToGain(m_level_db.load(std::memory_order_relaxed));
+    for (int channel = 0; channel < num_channels; ++channel)
+    {
+        if (gain != 1.0f)
+            juce::FloatVectorOperations::multiply(outputs[channel], gain, num_samples);
+
+        // Every channel follows the same mute ramp; only the last one advances it
+        if (channel + 1 < num_channels)
+        {
+            auto ramp = m_mute_gain;
+            ramp.applyGain(outputs[channel], num_samples);
+        }
+        else
+        {
+            m_mute_gain.applyGain(outputs[channel], num_samples);
+        }
+    }
+
+    update_level_meter(outputs, num_channels, num_samples);
+}
+
+void LooperReadHead::update_level_meter(const float* const* outputs, int num_channels, int num_samples)
+{
+    // Same peak-with-decay rule as process_sample, without an atomic per
+    // sample; the loudest channel drives the meter
+    float level = m_level_meter.load(std::memory_order_relaxed);
+    for (int sample = 0; sample < num_samples; ++sample)
+    {
+        float abs_value = std::abs(outputs[0][sample]);
+        for (int channel = 1; channel < num_channels; ++channel)
+            abs_value = juce::jmax(abs_value, std::abs(outputs[channel][sample]));
+        level = abs_value > level ? abs_value : level * 0.999f;
+    }
+    m_level_meter.store(level, std::memory_order_relaxed);
+}
+
 bool LooperReadHead::advance_playhead()
 {   
     float loop_start = m_loop_start.load();
@@ -133,24 +355,31 @@ float LooperReadHead::interpolate_sample(float position) const
     DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("ENTRY: LooperReadHead::interpolate_sample, position=" + juce::String(position)); });
     
     DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("Getting buffer reference"); });
-    const auto& buffer = m_tape_loop.get_buffer();
+    const auto tape = m_tape_loop.get_view();
+    const size_t buffer_size = tape.get_buffer_size();
     
-    DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("Buffer size=" + juce::String(buffer.size())); });
+    DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("Buffer size=" + juce::String(buffer_size)); });
     
     // Safety check: if buffer is empty, return silence
-    if (buffer.empty()){
-        juce::Logger::writeToLog("WARNING: Buffer is empty in interpolate_sample");
+    if (buffer_size == 0){
+        if (m_event_log != nullptr)
+            m_event_log->push(AudioEvent::ReadBufferEmpty, position);
         DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("Buffer is empty, returning 0.0f"); });
         return 0.0f;
     }
     
     DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("Calculating indices"); });
-    size_t index0 = static_cast<size_t>(position) % buffer.size();
-    size_t index1 = (index0 + 1) % buffer.size();
+    size_t index0 = static_cast<size_t>(position) % buffer_size;
+    size_t index1 = (index0 + 1) % buffer_size;
     float fraction = position - std::floor(position);
     
     DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("Accessing buffer[" + juce::String(index0) + "] and buffer[" + juce::String(index1) + "]"); });
-    float result = buffer[index0] * (1.0f - fraction) + buffer[index1] * fraction;
+    const int num_channels = tape.get_num_channels();
+    float result = 0.0f;
+    for (int channel = 0; channel < num_channels; ++channel)
+        result += tape.get_sample(index0, channel) * (1.0f - fraction)
+                + tape.get_sample(index1, channel) * fraction;
+    result /= static_cast<float>(num_channels);
     
     DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("EXIT: LooperReadHead::interpolate_sample, result=" + juce::String(result)); });
     return result;
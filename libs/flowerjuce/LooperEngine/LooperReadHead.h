@@ -3,10 +3,16 @@
 #include <juce_core/juce_core.h>
 #include <juce_audio_basics/juce_audio_basics.h>
 #include "TapeLoop.h"
+#include "ReadHeadKernels.h"
+#include "../Debug/AudioEventLog.h"
 #include <atomic>
 
 // LooperReadHead handles playback from a TapeLoop
 // Multiple read heads can read from the same tape loop simultaneously
+//
+// The mono block calls return the average of a multichannel tape's channels.
+// The multichannel overloads read plane c into output c; outputs past the
+// tape's channel count repeat its last channel (so a mono tape fills them all).
 class LooperReadHead
 {
 public:
@@ -51,9 +57,39 @@ public:
     // Returns the output sample value, or 0.0f if not playing/muted
     // Also returns true via wrapped parameter if the playhead wrapped around the tape loop
     float process_sample(bool& wrapped);
+
+    // Block version of process_sample: loop bounds, speed and direction are
+    // loaded once, then the playhead is advanced and interpolated in batches.
+    // Level gain and mute ramp are applied and the level meter is updated.
+    void process_block(float* output, int num_samples, WrapInfo& wrap_info);
+    void process_block(float* const* outputs, int num_channels, int num_samples, WrapInfo& wrap_info);
+
+    // Two-phase block API for callers that touch the tape between computing
+    // positions and reading them (e.g. recording while playing).
+    // advance_block fills the pre-advance read position of every sample,
+    // read_block interpolates them (pre-fader), apply_output_gain applies
+    // level/mute and updates the level meter.
+    // Tape reads are lock-free; the caller holds a TapeLoop::ReadScope.
+    // Every tape read of one call goes through one TapeLoop::View; the
+    // overloads taking a view let the caller share its scope's view so the
+    // whole block sees the same storage.
+    void advance_block(float* positions, int num_samples, WrapInfo& wrap_info);
+    void read_block(const float* positions, float* output, int num_samples) const;
+    void read_block(const float* positions, float* const* outputs, int num_channels, int num_samples) const;
+    void read_block(const TapeLoop::View& tape, const float* positions, float* output, int num_samples) const;
+    void read_block(const TapeLoop::View& tape, const float* positions, float* const* outputs, int num_channels,
+                    int num_samples) const;
+    void process_block(const TapeLoop::View& tape, float* const* outputs, int num_channels, int num_samples,
+                       WrapInfo& wrap_info);
+    void apply_output_gain(float* output, int num_samples);
+    void apply_output_gain(float* const* outputs, int num_channels, int num_samples);
+
+    // Channels of the tape this head plays
+    int get_num_channels() const { return m_tape_loop.get_num_channels(); }
     
     // Get raw sample value before level gain and mute (pre-fader)
-    // Returns the interpolated sample value without any gain/mute applied
+    // Returns the interpolated sample value (averaged over the tape's channels)
+    // without any gain/mute applied
     float get_raw_sample() const;
     
     // Reset playhead to start
@@ -71,6 +107,9 @@ public:
     
     // Sync playhead to a specific position
     void sync_to(float position);
+
+    // Realtime-safe sink for warnings (nullptr = silent, e.g. grain voices)
+    void set_event_log(AudioEventLog* event_log) { m_event_log = event_log; }
     
 private:
     TapeLoop& m_tape_loop;
@@ -85,9 +124,16 @@ private:
     std::atomic<float> m_loop_end{1.0};
     
     juce::SmoothedValue<float> m_mute_gain{1.0f}; // Smooth mute ramp (10ms)
+    AudioEventLog* m_event_log{nullptr};
     
     // Private helper to advance playhead
     bool advance_playhead();
+
+    void process_block(const TapeLoop::View& tape, float* output, int num_samples, WrapInfo& wrap_info);
+
+    // Mono read of a multichannel tape: the channel average
+    void read_block_downmix(const TapeLoop::View& tape, const float* positions, float* output, int num_samples) const;
+    void update_level_meter(const float* const* outputs, int num_channels, int num_samples);
     
     float interpolate_sample(float position) const;
 };
@@ -13,36 +13,157 @@
 LooperTrackEngine::LooperTrackEngine()
 {
     m_format_manager.registerBasicFormats();
+    m_track_state.m_write_head.set_event_log(&m_event_log);
+    m_track_state.m_read_head.set_event_log(&m_event_log);
 }
 
 void LooperTrackEngine::initialize(double sample_rate, double max_buffer_duration_seconds)
 {
-    m_track_state.m_tape_loop.allocate_buffer(sample_rate, max_buffer_duration_seconds);
     m_max_buffer_duration_seconds = max_buffer_duration_seconds;
+    allocate_tape(sample_rate);
+    allocate_scratch(kDefaultMaxBlockSize, kDefaultNumOutputChannels);
 }
 
-void LooperTrackEngine::audio_device_about_to_start(double sample_rate)
+void LooperTrackEngine::allocate_scratch(int max_block_size, int num_output_channels)
 {
-    m_track_state.m_tape_loop.allocate_buffer(sample_rate, m_max_buffer_duration_seconds);
+    // One plane per possible tape channel, so changing the channel count
+    // never resizes anything the audio thread uses
+    m_scratch_block_size = max_block_size;
+    m_playback_buffer.assign(static_cast<size_t>(max_block_size) * TapeLoop::kMaxChannels, 0.0f);
+    m_pre_fader_buffer.assign(static_cast<size_t>(max_block_size), 0.0f);
+    m_slice_outputs.assign(static_cast<size_t>(num_output_channels), nullptr);
+}
+
+void LooperTrackEngine::audio_device_about_to_start(double sample_rate, int max_block_size, int num_output_channels)
+{
+    max_block_size = juce::jmax(1, max_block_size);
+    allocate_scratch(max_block_size, juce::jmax(1, num_output_channels));
+
     m_track_state.m_write_head.set_sample_rate(sample_rate);
     m_track_state.m_read_head.prepare(sample_rate);
-    m_track_state.m_write_head.reset();
-    m_track_state.m_read_head.reset();
+    prepare_tape(sample_rate);
     
-    // Prepare filter and peak meter for new sample rate
-    m_low_pass_filter.prepare(sample_rate, 512);
+    // Prepare filters and peak meter for new sample rate
+    for (auto& filter : m_low_pass_filters)
+        filter.prepare(sample_rate, max_block_size);
     m_peak_meter.prepare();
 }
 
+void LooperTrackEngine::prepare_tape(double sample_rate)
+{
+    auto& tape = m_track_state.m_tape_loop;
+    const double tape_rate = m_tape_sample_rate.load();
+    const auto capacity = static_cast<size_t>(sample_rate * m_max_buffer_duration_seconds);
+
+    // A restart at the rate the tape already has keeps everything as it is
+    if (tape_rate == sample_rate && tape.get_buffer_size() == capacity)
+    {
+        if (m_tape_resampler.is_busy())
+            m_tape_resampler.cancel();
+        return;
+    }
+
+    // A file still decoding was converted for the old rate
+    if (m_file_loader.is_loading())
+    {
+        DBG("LooperTrackEngine: sample rate changed, cancelling file load");
+        m_file_loader.cancel();
+    }
+
+    // Nothing worth keeping: start over with an empty tape of the new size
+    if (tape.m_recorded_length.load() == 0)
+    {
+        m_tape_resampler.cancel();
+        allocate_tape(sample_rate);
+        m_track_state.m_write_head.reset();
+        m_track_state.m_read_head.reset();
+        return;
+    }
+
+    // Convert the loop in the background; process_block stays silent until
+    // the resampled tape is published, so startup does not wait for it
+    DBG("LooperTrackEngine: resampling loop from " << tape_rate << " Hz to " << sample_rate << " Hz");
+    m_tape_resampler.start(tape, tape_rate, sample_rate, m_max_buffer_duration_seconds,
+                           [this, sample_rate](double ratio) { rescale_positions(ratio, sample_rate); });
+}
+
+void LooperTrackEngine::rescale_positions(double ratio, double sample_rate)
+{
+    // Loop points and playheads keep their place in the music
+    const size_t capacity = m_track_state.m_tape_loop.get_buffer_size();
+    auto scale = [ratio, capacity](double position)
+    {
+        return juce::jlimit(0.0, static_cast<double>(capacity), position * ratio);
+    };
+
+    auto& write_head = m_track_state.m_write_head;
+    auto& read_head = m_track_state.m_read_head;
+    write_head.set_loop_end(static_cast<size_t>(std::llround(scale(static_cast<double>(write_head.get_loop_end())))));
+    write_head.set_pos(static_cast<size_t>(std::llround(scale(static_cast<double>(write_head.get_pos())))));
+    read_head.set_loop_end(static_cast<float>(scale(read_head.get_loop_end())));
+    read_head.set_loop_start(static_cast<float>(scale(read_head.get_loop_start())));
+    read_head.set_pos(static_cast<float>(scale(read_head.get_pos())));
+
+    m_tape_sample_rate.store(sample_rate);
+}
+
+void LooperTrackEngine::set_chunk_pool(std::shared_ptr<TapeChunkPool> pool, double sample_rate, double max_buffer_duration_seconds)
+{
+    m_tape_resampler.cancel();
+    m_chunk_pool = std::move(pool);
+    m_max_buffer_duration_seconds = max_buffer_duration_seconds;
+    allocate_tape(sample_rate);
+    m_track_state.m_write_head.reset();
+    m_track_state.m_read_head.reset();
+}
+
+void LooperTrackEngine::set_num_channels(int num_channels)
+{
+    num_channels = juce::jlimit(1, TapeLoop::kMaxChannels, num_channels);
+    if (num_channels == m_num_channels && get_num_channels() == num_channels)
+        return;
+
+    m_tape_resampler.cancel();
+    m_file_loader.cancel();
+    m_num_channels = num_channels;
+
+    double sample_rate = m_tape_sample_rate.load();
+    if (sample_rate <= 0.0)
+        sample_rate = m_track_state.m_write_head.get_sample_rate();
+    allocate_tape(sample_rate);
+    m_track_state.m_write_head.reset();
+    m_track_state.m_read_head.reset();
+}
+
+void LooperTrackEngine::allocate_tape(double sample_rate)
+{
+    m_tape_sample_rate.store(sample_rate);
+    if (m_chunk_pool != nullptr)
+        m_track_state.m_tape_loop.allocate_chunked(m_chunk_pool, sample_rate, m_max_buffer_duration_seconds, m_num_channels);
+    else
+        m_track_state.m_tape_loop.allocate_buffer(sample_rate, m_max_buffer_duration_seconds, m_num_channels);
+}
+
 void LooperTrackEngine::audio_device_stopped()
 {
     m_track_state.m_is_playing.store(false);
     m_track_state.m_read_head.set_playing(false);
 }
 
+void LooperTrackEngine::set_pre_fader_tap(PreFaderTap* tap)
+{
+    m_pre_fader_tap.store(tap);
+
+    // The audio thread flags itself before loading the tap, so once the flag
+    // drops nobody can still be calling the previous one.
+    while (m_pre_fader_tap_in_use.load())
+        juce::Thread::yield();
+}
+
 void LooperTrackEngine::set_filter_cutoff(float cutoff_hz)
 {
-    m_low_pass_filter.set_cutoff(cutoff_hz);
+    for (auto& filter : m_low_pass_filters)
+        filter.set_cutoff(cutoff_hz);
 }
 
 void LooperTrackEngine::set_loop_end(size_t loop_end)
@@ -58,7 +179,7 @@ void LooperTrackEngine::reset()
     m_track_state.m_write_head.reset();
 }
 
-bool LooperTrackEngine::load_from_file(const juce::File& audio_file)
+bool LooperTrackEngine::load_from_file(const juce::File& audio_file, std::function<void(bool)> on_loaded)
 {
     if (!audio_file.existsAsFile())
     {
@@ -66,7 +187,7 @@ bool LooperTrackEngine::load_from_file(const juce::File& audio_file)
         return false;
     }
 
-    // Create reader for the audio file
+    // Create reader for the audio file (parses the header only; decoding is in the background)
     std::unique_ptr<juce::AudioFormatReader> reader(m_format_manager.createReaderFor(audio_file));
     if (reader == nullptr)
     {
@@ -74,78 +195,61 @@ bool LooperTrackEngine::load_from_file(const juce::File& audio_file)
         return false;
     }
 
-    const juce::ScopedLock sl(m_track_state.m_tape_loop.m_lock);
-    auto& buffer = m_track_state.m_tape_loop.get_buffer();
-    
-    if (buffer.empty())
+    // A new file replaces the loop a pending resample was converting
+    const double sample_rate = m_track_state.m_write_head.get_sample_rate();
+    if (m_tape_resampler.is_busy())
     {
-        DBG("TapeLoop buffer not allocated. Call initialize() first.");
-        return false;
+        m_tape_resampler.cancel();
+        allocate_tape(sample_rate);
     }
 
-    // Clear the buffer first
-    m_track_state.m_tape_loop.clear_buffer();
-
-    // Determine how many samples to read (limited by buffer size)
-    juce::int64 num_samples_to_read = juce::jmin(reader->lengthInSamples, static_cast<juce::int64>(buffer.size()));
+    const size_t buffer_size = m_track_state.m_tape_loop.get_buffer_size();
     
-    if (num_samples_to_read <= 0)
+    if (buffer_size == 0)
     {
-        DBG("Audio file has no samples or buffer is empty");
-        return false;
-    }
-
-    // Read audio data
-    // If multi-channel, we'll mix down to mono by averaging channels
-    juce::AudioBuffer<float> temp_buffer(static_cast<int>(reader->numChannels), static_cast<int>(num_samples_to_read));
-    
-    if (!reader->read(&temp_buffer, 0, static_cast<int>(num_samples_to_read), 0, true, true))
-    {
-        DBG("Failed to read audio data from file");
+        DBG("TapeLoop buffer not allocated. Call initialize() first.");
         return false;
     }
 
-    // Convert to mono and write to TapeLoop buffer
-    // If single channel, just copy. If multi-channel, average them.
-    if (temp_buffer.getNumChannels() == 1)
-    {
-        // Direct copy
-        const float* source = temp_buffer.getReadPointer(0);
-        for (int i = 0; i < static_cast<int>(num_samples_to_read); ++i)
-        {
-            buffer[i] = source[i];
-        }
-    }
-    else
+    // Decode, convert to the tape's rate and downmix on the loader's threads;
+    // the audio thread keeps playing the old loop until the new one is published
+    AudioFileLoader::Request request;
+    request.reader = std::move(reader);
+    request.target_sample_rate = m_tape_sample_rate.load();
+    request.max_length = buffer_size;
+    request.capacity = buffer_size;
+    request.num_channels = get_num_channels();
+
+    const auto file_name = audio_file.getFileName();
+    m_file_loader.load(std::move(request), [this, file_name, on_loaded](AudioFileLoader::Result& result)
     {
-        // Mix down to mono by averaging all channels
-        for (int i = 0; i < static_cast<int>(num_samples_to_read); ++i)
+        if (!result.ok)
         {
-            float sum = 0.0f;
-            for (int channel = 0; channel < temp_buffer.getNumChannels(); ++channel)
-            {
-                sum += temp_buffer.getSample(channel, i);
-            }
-            buffer[i] = sum / static_cast<float>(temp_buffer.getNumChannels());
+            DBG("Failed to load " << file_name << ": " << result.error);
+            if (on_loaded)
+                on_loaded(false);
+            return;
         }
-    }
 
-    // Update wrapPos to reflect the loaded audio length
-    size_t loaded_length = static_cast<size_t>(num_samples_to_read);
-    set_loop_end(loaded_length);
-    m_track_state.m_write_head.set_pos(loaded_length);
-    
-    // Update TapeLoop metadata
-    m_track_state.m_tape_loop.m_recorded_length.store(loaded_length);
-    m_track_state.m_tape_loop.m_has_recorded.store(true);
-    
-    // Reset read head to start
-    m_track_state.m_read_head.reset();
-    m_track_state.m_read_head.set_pos(0.0f);
+        // Swap the new buffer and TapeLoop metadata in atomically
+        const size_t loaded_length = result.length;
+        m_track_state.m_tape_loop.publish_buffer(std::move(result.channels), loaded_length, true);
+
+        // Update wrapPos to reflect the loaded audio length
+        set_loop_end(loaded_length);
+        m_track_state.m_write_head.set_pos(loaded_length);
 
-    DBG("Loaded audio file: " << audio_file.getFileName() 
-        << " (" << num_samples_to_read << " samples, "
-        << (num_samples_to_read / reader->sampleRate) << " seconds)");
+        // Reset read head to start
+        m_track_state.m_read_head.reset();
+        m_track_state.m_read_head.set_pos(0.0f);
+
+        DBG("Loaded audio file: " << file_name
+            << " (" << static_cast<juce::int64>(loaded_length) << " samples at " << m_tape_sample_rate.load()
+            << " Hz, source " << result.source_sample_rate << " Hz)");
+
+        if (on_loaded)
+            on_loaded(true);
+    });
 
     return true;
 }
@@ -157,9 +261,9 @@ bool LooperTrackEngine::process_block(const float* const* input_channel_data,
                                      int num_samples,
                                      bool should_debug)
 {
-    static int call_count = 0;
-    call_count++;
-    bool is_first_call = (call_count == 1);
+    // Shared by every track; tracks may render on different worker threads.
+    static std::atomic<int> call_count{0};
+    bool is_first_call = (call_count.fetch_add(1, std::memory_order_relaxed) == 0);
     
     if (is_first_call)
         DBG_SEGFAULT("ENTRY: LooperTrackEngine::process_block, num_samples=" + juce::String(num_samples));
@@ -168,26 +272,33 @@ bool LooperTrackEngine::process_block(const float* const* input_channel_data,
     if (is_first_call)
         DBG_SEGFAULT("Got track reference");
 
+    // The tape is being converted to a new sample rate; stay silent until it is swapped in
+    if (m_tape_resampler.is_busy())
+        return false;
+
+    // Pin the tape storage for the whole block; reads and writes below are lock-free
+    // and all go through the scope's view, so a swap mid-block is never half seen
+    const TapeLoop::ReadScope tape_scope(track.m_tape_loop);
+    const auto& tape = tape_scope.get_view();
+
     // Safety check: if buffer is not allocated, return early
-    {
-        const juce::ScopedLock sl(track.m_tape_loop.m_lock);
-        if (is_first_call)
-            DBG_SEGFAULT("Checking if buffer is empty");
-        if (track.m_tape_loop.get_buffer().empty()) {
-            juce::Logger::writeToLog("WARNING: TapeLoop buffer is empty in process_block");
-            if (is_first_call)
-                DBG_SEGFAULT("Buffer is empty, returning false");
-            return false;
-        }
+    if (is_first_call)
+        DBG_SEGFAULT("Checking if buffer is empty");
+    if (tape.get_buffer_size() == 0) {
+        m_event_log.push(AudioEvent::TapeBufferEmpty);
         if (is_first_call)
-            DBG_SEGFAULT("Buffer is not empty, size=" + juce::String(track.m_tape_loop.get_buffer().size()));
+            DBG_SEGFAULT("Buffer is empty, returning false");
+        return false;
     }
+    if (is_first_call)
+        DBG_SEGFAULT("Buffer is not empty, size=" + juce::String(tape.get_buffer_size()));
 
     bool is_playing = track.m_is_playing.load();
     bool has_existing_audio = track.m_tape_loop.m_has_recorded.load();
     
     if (is_first_call && should_debug)
     {
+        const AudioAllocationGuard::ScopedAllow allow_debug_logging;
         DBG("[LooperTrackEngine] Track state check:");
         DBG("  is_playing: " << (is_playing ? "YES" : "NO"));
         DBG("  has_existing_audio: " << (has_existing_audio ? "YES" : "NO"));
@@ -200,6 +311,7 @@ bool LooperTrackEngine::process_block(const float* const* input_channel_data,
     // Debug output
     if (should_debug)
     {
+        const AudioAllocationGuard::ScopedAllow allow_debug_logging;
         float input_level = 0.0f;
         float max_input = 0.0f;
         if (input_channel_data[0] != nullptr && num_input_channels > 0 && num_samples > 0)
@@ -223,7 +335,7 @@ bool LooperTrackEngine::process_block(const float* const* input_channel_data,
             + "\t InputChannels: " + juce::String(num_input_channels)
             + "\t NumSamples: " + juce::String(num_samples)
             + "\t WrapPos: " + juce::String(track.m_write_head.get_loop_end())
-            + "\t LoopEnd: " + juce::String(track.m_tape_loop.get_buffer_size())
+            + "\t LoopEnd: " + juce::String(tape.get_buffer_size())
         );
     }
 
@@ -244,80 +356,121 @@ bool LooperTrackEngine::process_block(const float* const* input_channel_data,
         // If we just started recording, reset everything to 0 BEFORE processing
         if (this_block_is_first_time_recording) // REC_INIT state
         {
-            const juce::ScopedLock sl(track.m_tape_loop.m_lock);
-            track.m_tape_loop.clear_buffer(); // TODO: should NOT be in callback.
+            track.m_tape_loop.clear_in_place(); // TODO: zeroing a long tape should NOT be in callback.
             track.m_write_head.reset();
             track.m_read_head.reset();
-            juce::Logger::writeToLog("~~~ Reset playhead for new recording");
+            m_event_log.push(AudioEvent::RecordingStarted);
         }
 
         // Update read head state
         track.m_read_head.set_playing(true);
 
-        // Allocate temporary mono buffer for playback samples
-        juce::HeapBlock<float> mono_buffer(num_samples);
-        const float* mono_input_channel_data[1] = { mono_buffer.getData() };
+        // One pre-fader plane per tape channel
+        const int num_channels = tape.get_num_channels();
+        std::array<float*, TapeLoop::kMaxChannels> channel_buffers{};
+        for (int channel = 0; channel < num_channels; ++channel)
+            channel_buffers[static_cast<size_t>(channel)] = m_playback_buffer.data()
+                                                          + static_cast<size_t>(channel) * static_cast<size_t>(m_scratch_block_size);
+
+        m_pre_fader_tap_in_use.store(true);
+        PreFaderTap* pre_fader_tap = m_pre_fader_tap.load();
 
         if (is_first_call)
             DBG_SEGFAULT("Entering sample loop, num_samples=" + juce::String(num_samples));
-        
-        // First pass: collect playback samples and handle recording
-        float max_mono_level = 0.0f;
-        for (int sample = 0; sample < num_samples; ++sample)
+
+        // Scratch is sized for the device's block; a larger block than it promised
+        // is rendered in scratch-sized slices rather than growing scratch here.
+        std::array<float, kPlaybackChunkSize> positions;
+        std::array<float*, TapeLoop::kMaxChannels> chunk_outputs{};
+        for (int slice_start = 0; slice_start < num_samples; slice_start += m_scratch_block_size)
         {
-            if (is_first_call && sample == 0)
-                DBG_SEGFAULT("First sample iteration");
-            
-            float current_position = track.m_read_head.get_pos();
-
-            // Handle recording (overdub or new)
-            process_recording(track, input_channel_data, num_input_channels, current_position, sample, is_first_call && sample == 0);
-
-            // Get raw sample value BEFORE level gain/mute (pre-fader) for onset detection
-            // Must hold lock since get_raw_sample() accesses tape loop buffer
-            float raw_sample_value = 0.0f;
-            if (track.m_is_playing.load() && track.m_read_head.get_playing())
+            const int slice_size = juce::jmin(m_scratch_block_size, num_samples - slice_start);
+
+            // Playback runs in chunks: positions for the chunk are computed once,
+            // recording writes at those positions, then the chunk is read back.
+            for (int offset = 0; offset < slice_size; offset += kPlaybackChunkSize)
             {
-                const juce::ScopedLock sl(track.m_tape_loop.m_lock);
-                raw_sample_value = track.m_read_head.get_raw_sample();
+                const int chunk_size = juce::jmin(kPlaybackChunkSize, slice_size - offset);
+                for (int channel = 0; channel < num_channels; ++channel)
+                    chunk_outputs[static_cast<size_t>(channel)] = channel_buffers[static_cast<size_t>(channel)] + offset;
+
+                WrapInfo wrap_info;
+                track.m_read_head.advance_block(positions.data(), chunk_size, wrap_info);
+
+                // A first recording stops on the sample whose advance wraps the loop.
+                const bool stop_recording_on_wrap = wrap_info.wrapped() && !has_existing_audio;
+                const int record_count = stop_recording_on_wrap ? wrap_info.first_wrap_index + 1 : chunk_size;
+                const int input_offset = slice_start + offset;
+                for (int sample = 0; sample < record_count; ++sample)
+                    process_recording(track, tape, input_channel_data, num_input_channels, positions[static_cast<size_t>(sample)],
+                                      input_offset + sample, is_first_call && input_offset == 0 && sample == 0);
+
+                if (stop_recording_on_wrap && track.m_write_head.get_record_enable())
+                {
+                    track.m_write_head.set_record_enable(false); // Stop recording
+                    m_event_log.push(AudioEvent::RecordingWrapped, static_cast<double>(track.m_write_head.get_pos()));
+                }
+
+                track.m_read_head.read_block(tape, positions.data(), chunk_outputs.data(), num_channels, chunk_size);
+
+                // Keep the raw pre-fader samples for the tap (onset detection, etc.)
+                // before any level control or filtering is applied. The tap is
+                // mono, so a multichannel tape hands it the channel average.
+                if (pre_fader_tap != nullptr)
+                {
+                    float* tap_output = m_pre_fader_buffer.data() + offset;
+                    if (track.m_is_playing.load() && track.m_read_head.get_playing())
+                    {
+                        juce::FloatVectorOperations::copy(tap_output, chunk_outputs[0], chunk_size);
+                        for (int channel = 1; channel < num_channels; ++channel)
+                            juce::FloatVectorOperations::add(tap_output, chunk_outputs[static_cast<size_t>(channel)], chunk_size);
+                        if (num_channels > 1)
+                            juce::FloatVectorOperations::multiply(tap_output, 1.0f / static_cast<float>(num_channels), chunk_size);
+                    }
+                    else
+                    {
+                        juce::FloatVectorOperations::clear(tap_output, chunk_size);
+                    }
+                }
+
+                // Level gain, mute ramp and VU meter
+                track.m_read_head.apply_output_gain(chunk_outputs.data(), num_channels, chunk_size);
             }
-            
-            // Feed raw pre-fader sample to callback if set (for onset detection, etc.)
-            // This ensures onset detection happens before any level control or filtering
-            if (m_audio_sample_callback)
+
+            // One call per slice instead of one per sample
+            if (pre_fader_tap != nullptr)
+                pre_fader_tap->process_pre_fader_block(m_pre_fader_buffer.data(), slice_size,
+                                                       track.m_write_head.get_sample_rate());
+
+            // Apply low pass filter to each channel
+            for (int channel = 0; channel < num_channels; ++channel)
+                m_low_pass_filters[static_cast<size_t>(channel)].process_block(channel_buffers[static_cast<size_t>(channel)], slice_size);
+
+            // Update peak meter (peak hold, so the loudest channel wins)
+            for (int channel = 0; channel < num_channels; ++channel)
+                m_peak_meter.process_block(channel_buffers[static_cast<size_t>(channel)], slice_size);
+
+            jassert(track.m_panner != nullptr);
+            // Use panner to distribute the track's channels to all output channels with proper gains
+            if (slice_size == num_samples)
             {
-                m_audio_sample_callback(raw_sample_value);
+                track.m_panner->process_block(channel_buffers.data(), num_channels, output_channel_data, num_output_channels, slice_size);
             }
-            
-            // Playback (read head processes the sample AND advances) - applies level gain and mute
-            bool wrapped = false;
-            float sample_value = process_playback(track, wrapped, is_first_call && sample == 0);
-            
-            // Store sample in mono buffer for panner processing
-            mono_buffer[sample] = sample_value;
-            
-            // Track peak level for visualization
-            max_mono_level = juce::jmax(max_mono_level, std::abs(sample_value));
-
-            // Check for wrap and finalize recording if needed
-            if (wrapped && !has_existing_audio)
+            else
             {
-                track.m_write_head.set_record_enable(false); // Stop recording
-                juce::Logger::writeToLog("~~~ WRAPPED! Finalized recording");
+                // Sized for the output count promised in audio_device_about_to_start
+                jassert(num_output_channels <= static_cast<int>(m_slice_outputs.size()));
+                const int num_slice_outputs = juce::jmin(num_output_channels, static_cast<int>(m_slice_outputs.size()));
+                for (int channel = 0; channel < num_slice_outputs; ++channel)
+                    m_slice_outputs[static_cast<size_t>(channel)] = output_channel_data[channel] + slice_start;
+                track.m_panner->process_block(channel_buffers.data(), num_channels, m_slice_outputs.data(), num_slice_outputs, slice_size);
             }
         }
-        
-        // Apply low pass filter to mono buffer
-        m_low_pass_filter.process_block(mono_buffer.getData(), num_samples);
-        
-        // Update peak meter
-        m_peak_meter.process_block(mono_buffer.getData(), num_samples);
-        
 
-        jassert(track.m_panner != nullptr);
-        // Use panner to distribute mono audio to all output channels with proper gains
-        track.m_panner->process_block(mono_input_channel_data, 1, output_channel_data, num_output_channels, num_samples);
-        
+        // Tell the prefetcher where playback is heading
+        track.m_tape_loop.set_hot_position(static_cast<size_t>(juce::jmax(0.0f, track.m_read_head.get_pos())));
+        m_pre_fader_tap_in_use.store(false);
+
         if (is_first_call && should_debug)
         {
             DBG("[LooperTrackEngine] Panner applied - routing to all " << num_output_channels << " channels");
@@ -336,7 +489,7 @@ bool LooperTrackEngine::process_block(const float* const* input_channel_data,
             set_loop_end(track.m_write_head.get_pos());
             recording_finalized = true;
             // Record enable is on but playback just stopped - prepare for new recording
-            juce::Logger::writeToLog("WARNING: ActuallyRecording but not playing.");
+            m_event_log.push(AudioEvent::RecordingStoppedByTransport, static_cast<double>(track.m_write_head.get_pos()));
         }
     }
 
@@ -344,55 +497,36 @@ bool LooperTrackEngine::process_block(const float* const* input_channel_data,
 }
 
 // Helper method: Process recording for a single sample
-void LooperTrackEngine::process_recording(TrackState& track, const float* const* input_channel_data, 
+void LooperTrackEngine::process_recording(TrackState& track, const TapeLoop::View& tape, const float* const* input_channel_data, 
                                          int num_input_channels, float current_position, int sample, bool is_first_call)
 {
-    // Note: writeHead.processSample() locks the buffer internally, so we don't hold the lock here
+    // Note: process_block holds a TapeLoop::ReadScope, so the write head writes without locking
     if (track.m_write_head.get_record_enable() && num_input_channels > 0)
     {
         int input_channel = track.m_write_head.get_input_channel();
-        float input_sample = 0.0f;
+        std::array<float, TapeLoop::kMaxChannels> frame{};
+        int frame_channels = 1;
         
-        // Get input sample from selected channel
+        // Get input frame from selected channel(s)
         if (input_channel == -1)
         {
-            // All channels: use channel 0 (mono sum could be added later)
-            if (input_channel_data[0] != nullptr)
-                input_sample = input_channel_data[0][sample];
+            // All channels: tape channel c records input c (a mono tape records input 0)
+            frame_channels = juce::jmin(num_input_channels, tape.get_num_channels());
+            for (int channel = 0; channel < frame_channels; ++channel)
+                if (input_channel_data[channel] != nullptr)
+                    frame[static_cast<size_t>(channel)] = input_channel_data[channel][sample];
         }
         else if (input_channel >= 0 && input_channel < num_input_channels && input_channel_data[input_channel] != nullptr)
         {
-            input_sample = input_channel_data[input_channel][sample];
+            frame[0] = input_channel_data[input_channel][sample];
         }
         
-        DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("Calling writeHead.process_sample"); });
-        track.m_write_head.process_sample(input_sample, current_position);
-        DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("writeHead.process_sample completed"); });
+        DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("Calling writeHead.process_frame"); });
+        track.m_write_head.process_frame(tape, frame.data(), frame_channels, current_position);
+        DBG_AUDIO_RATE(2000, { DBG_SEGFAULT("writeHead.process_frame completed"); });
     }
 }
 
-// Helper method: Process playback for a single sample
-float LooperTrackEngine::process_playback(TrackState& track, bool& wrapped, bool is_first_call)
-{
-    const juce::ScopedLock sl(track.m_tape_loop.m_lock);
-    
-    DBG_AUDIO_RATE(2000, {
-        DBG_SEGFAULT("Calling readHead.process_sample");
-        DBG("[LooperTrackEngine] Track playback state:");
-        DBG("  is_playing: " << (track.m_is_playing.load() ? "YES" : "NO"));
-        DBG("  has_recorded_audio: " << (track.m_tape_loop.m_recorded_length.load() > 0 ? "YES" : "NO"));
-        DBG("  recorded_length: " << track.m_tape_loop.m_recorded_length.load());
-        DBG("  readHead position: " << track.m_read_head.get_pos());
-    });
-    float sample_value = track.m_read_head.process_sample(wrapped);
-    DBG_AUDIO_RATE(2000, {
-        DBG_SEGFAULT("readHead.process_sample completed, value=" + juce::String(sample_value) + ", wrapped=" + juce::String(wrapped ? "YES" : "NO"));
-        DBG("[LooperTrackEngine] Track sample_value: " << sample_value);
-    });
-    
-    return sample_value;
-}
-
 // Helper method: Check if recording should be finalized
 bool LooperTrackEngine::finalize_recording_if_needed(TrackState& track, bool was_recording, bool is_playing, 
                                                    bool has_existing_audio, bool& recording_finalized)
@@ -402,7 +536,7 @@ bool LooperTrackEngine::finalize_recording_if_needed(TrackState& track, bool was
     {
         track.m_write_head.finalize_recording(track.m_write_head.get_pos());
         recording_finalized = true;
-        juce::Logger::writeToLog("~~~ Finalized initial recording (it was needed)");
+        m_event_log.push(AudioEvent::RecordingFinalized, static_cast<double>(track.m_write_head.get_pos()));
         return true;
     }
     return false;
@@ -4,14 +4,19 @@
 #include <juce_audio_formats/juce_audio_formats.h>
 #include <juce_dsp/juce_dsp.h>
 #include "TapeLoop.h"
+#include "TapeResampler.h"
+#include "AudioFileLoader.h"
 #include "LooperWriteHead.h"
 #include "LooperReadHead.h"
 #include "OutputBus.h"
 #include <flowerjuce/Panners/Panner.h>
 #include <flowerjuce/DSP/LowPassFilter.h>
 #include <flowerjuce/DSP/PeakMeter.h>
+#include <array>
 #include <atomic>
 #include <functional>
+#include <memory>
+#include <vector>
 
 // LooperTrackEngine handles processing for a single looper track
 class LooperTrackEngine
@@ -23,6 +28,18 @@ public:
     // Initialize the track with sample rate and buffer duration
     void initialize(double sample_rate, double max_buffer_duration_seconds);
 
+    // Record into chunks drawn from pool instead of one contiguous buffer, so
+    // the tape only takes memory for what has been recorded. nullptr goes back
+    // to a contiguous buffer. Reallocates (and clears) the tape; non-realtime.
+    void set_chunk_pool(std::shared_ptr<TapeChunkPool> pool, double sample_rate, double max_buffer_duration_seconds);
+    TapeChunkPool* get_chunk_pool() const { return m_chunk_pool.get(); }
+
+    // Channels the tape records and plays (1 = mono, up to TapeLoop::kMaxChannels).
+    // Every channel goes through its own filter into the panner, which spreads
+    // them around the pan position. Reallocates (and clears) the tape; non-realtime.
+    void set_num_channels(int num_channels);
+    int get_num_channels() const { return m_track_state.m_tape_loop.get_num_channels(); }
+
     // Process a block of audio samples for this track
     // Returns true if recording was finalized during this block
     bool process_block(const float* const* input_channel_data,
@@ -32,8 +49,15 @@ public:
                      int num_samples,
                      bool should_debug = false);
 
-    // Handle audio device starting (update sample rate)
-    void audio_device_about_to_start(double sample_rate);
+    // Handle audio device starting (update sample rate and size scratch buffers)
+    // max_block_size is the largest num_samples process_block will be called with,
+    // num_output_channels the largest num_output_channels it will be called with.
+    // The loop survives: a restart at the tape's rate leaves it untouched, and a
+    // new rate resamples it in the background (the track is silent meanwhile).
+    static constexpr int kDefaultMaxBlockSize = 512;
+    static constexpr int kDefaultNumOutputChannels = 2;
+    void audio_device_about_to_start(double sample_rate, int max_block_size = kDefaultMaxBlockSize,
+                                     int num_output_channels = kDefaultNumOutputChannels);
 
     // Handle audio device stopping
     void audio_device_stopped();
@@ -41,12 +65,30 @@ public:
     // Reset playhead to start (resets both read and write heads)
     void reset();
 
-    // Load audio file into the loop
-    // Returns true if successful, false otherwise
-    bool load_from_file(const juce::File& audio_file);
+    // Load audio file into the loop in the background: it is decoded in
+    // slices, converted to the tape's sample rate and mapped to the tape's
+    // channels on the shared AudioFileLoader threads, then published in one swap. The old loop keeps
+    // playing until then. Returns false if the file cannot be opened; otherwise
+    // on_loaded(success) runs on a loader thread when the load finishes.
+    // A second load replaces one still in progress.
+    bool load_from_file(const juce::File& audio_file, std::function<void(bool)> on_loaded = {});
+    bool is_loading() const { return m_file_loader.is_loading(); }
+    float get_load_progress() const { return m_file_loader.get_progress(); } // 1 when idle
+    bool wait_for_load(int timeout_ms) { return m_file_loader.wait_until_done(timeout_ms); }
+
+    // Receives the raw pre-fader mono output once per block (for onset detection, etc.)
+    // A multichannel track hands over the average of its channels.
+    // Called on the audio thread; the span is only valid for the duration of the call.
+    class PreFaderTap
+    {
+    public:
+        virtual ~PreFaderTap() = default;
+        virtual void process_pre_fader_block(const float* samples, int num_samples, double sample_rate) = 0;
+    };
 
-    // Set callback for audio samples (for onset detection, etc.)
-    void set_audio_sample_callback(std::function<void(float)> callback) { m_audio_sample_callback = callback; }
+    // Install or remove (nullptr) the pre-fader tap. Returns once the audio
+    // thread has left the previous tap, so it may be destroyed afterwards.
+    void set_pre_fader_tap(PreFaderTap* tap);
     
     // Set panner for spatial audio distribution
     void set_panner(Panner* panner) { m_track_state.m_panner = panner; }
@@ -90,14 +132,30 @@ public:
     // TapeLoop access methods
     bool has_recorded() const { return m_track_state.m_tape_loop.m_has_recorded.load(); }
     size_t get_recorded_length() const { return m_track_state.m_tape_loop.m_recorded_length.load(); }
-    void clear_buffer() { const juce::ScopedLock sl(m_track_state.m_tape_loop.m_lock); m_track_state.m_tape_loop.clear_buffer(); }
+    void clear_buffer() { m_track_state.m_tape_loop.clear_buffer(); }
+    // UI-side lock keeping get_buffer() alive across a reallocation; the audio thread never takes it
     juce::CriticalSection& get_buffer_lock() { return m_track_state.m_tape_loop.m_lock; }
     const std::vector<float>& get_buffer() const { return m_track_state.m_tape_loop.get_buffer(); }
     std::vector<float>& get_buffer() { return m_track_state.m_tape_loop.get_buffer(); }
     size_t get_buffer_size() const { return m_track_state.m_tape_loop.get_buffer_size(); }
+    bool is_chunked() const { return m_track_state.m_tape_loop.is_chunked(); }
+    // Reads that work for chunked tapes too (get_buffer() is empty for those); hold get_buffer_lock()
+    float get_sample(size_t index, int channel = 0) const { return m_track_state.m_tape_loop.get_sample(index, channel); }
+    size_t read_buffer(size_t start, float* destination, size_t num_samples, int channel = 0) const { return m_track_state.m_tape_loop.read(start, destination, num_samples, channel); }
+    TapeLoop& get_tape_loop() { return m_track_state.m_tape_loop; }
     void set_recorded_length(size_t length) { m_track_state.m_tape_loop.m_recorded_length.store(length); }
     void set_has_recorded(bool has_recorded) { m_track_state.m_tape_loop.m_has_recorded.store(has_recorded); }
 
+    // Sample rate the tape content is at (differs from the device while resampling)
+    double get_tape_sample_rate() const { return m_tape_sample_rate.load(); }
+    bool is_resampling() const { return m_tape_resampler.is_busy(); }
+    float get_resample_progress() const { return m_tape_resampler.get_progress(); } // 1 when idle
+    bool wait_for_resample(int timeout_ms) { return m_tape_resampler.wait_until_done(timeout_ms); }
+
+    // State changes and warnings raised on the audio thread; drained by an AudioEventLogFlusher
+    AudioEventLog& get_event_log() { return m_event_log; }
+    const AudioEventLog& get_event_log() const { return m_event_log; }
+
 protected:
     // TrackState struct - protected so derived classes can use it
     struct TrackState
@@ -119,25 +177,44 @@ protected:
     };
     
     // Helper methods factored out for reuse by VampNetTrackEngine
-    void process_recording(TrackState& track, const float* const* input_channel_data, 
+    void process_recording(TrackState& track, const TapeLoop::View& tape, const float* const* input_channel_data, 
                          int num_input_channels, float current_position, int sample, bool is_first_call);
-    float process_playback(TrackState& track, bool& wrapped, bool is_first_call);
     bool finalize_recording_if_needed(TrackState& track, bool was_recording, bool is_playing, 
                                    bool has_existing_audio, bool& recording_finalized);
 
 private:
+    static constexpr int kPlaybackChunkSize = 64;
+
+    void allocate_tape(double sample_rate);
+    void allocate_scratch(int max_block_size, int num_output_channels);
+    void prepare_tape(double sample_rate);
+    void rescale_positions(double ratio, double sample_rate);
+
+    AudioEventLog m_event_log{"Track"};
     TrackState m_track_state;
+    std::vector<float> m_playback_buffer; // Pre-fader scratch, kMaxChannels planes of m_scratch_block_size
+    int m_scratch_block_size{0};
+    int m_num_channels{1};
+    std::vector<float> m_pre_fader_buffer; // Copy of the block handed to the tap
+    std::vector<float*> m_slice_outputs;   // Output pointers for one slice of an oversized block
     bool m_was_recording{false};
     bool m_was_playing{false};
     double m_max_buffer_duration_seconds{10.0};
+    std::shared_ptr<TapeChunkPool> m_chunk_pool; // Set for chunked tapes
+    std::atomic<double> m_tape_sample_rate{0.0};  // Rate the tape content was recorded/converted at
     
     juce::AudioFormatManager m_format_manager;
-    std::function<void(float)> m_audio_sample_callback; // Callback for audio samples (for onset detection)
+    std::atomic<PreFaderTap*> m_pre_fader_tap{nullptr};
+    std::atomic<bool> m_pre_fader_tap_in_use{false}; // Audio thread is inside the tap
     
-    // Low pass filter UGen
-    LowPassFilter m_low_pass_filter;
+    // Low pass filter UGens, one per tape channel
+    std::array<LowPassFilter, TapeLoop::kMaxChannels> m_low_pass_filters;
     
     // Peak meter UGen
     PeakMeter m_peak_meter;
+
+    // Declared last so their threads stop before the tape they write goes away
+    TapeResampler m_tape_resampler;
+    AudioFileLoader::Client m_file_loader;
 };
 
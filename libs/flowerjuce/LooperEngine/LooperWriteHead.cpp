@@ -8,20 +8,47 @@ LooperWriteHead::LooperWriteHead(TapeLoop& tape_loop)
 
 bool LooperWriteHead::process_sample(float input_sample, float current_position)
 {
+    return process_frame(&input_sample, 1, current_position);
+}
+
+bool LooperWriteHead::process_frame(const float* frame, int num_frame_channels, float current_position)
+{
+    return process_frame(m_tape_loop.get_view(), frame, num_frame_channels, current_position);
+}
+
+bool LooperWriteHead::process_frame(const TapeLoop::View& tape, const float* frame, int num_frame_channels,
+                                    float current_position)
+{
+    // Lock-free: the caller pins the tape storage with a TapeLoop::ReadScope for the block,
+    // and capacity, channels and chunks all come from the same view
+    const size_t buffer_size = tape.get_buffer_size();
     
-    const juce::ScopedLock sl(m_tape_loop.m_lock);
-    auto& buffer = m_tape_loop.get_buffer();
-    
-    if (buffer.empty())
+    if (buffer_size == 0 || num_frame_channels <= 0)
         return false;
     
     // Wrap position to buffer size
-    size_t record_pos = static_cast<size_t>(std::fmod(current_position, buffer.size()));
+    size_t record_pos = static_cast<size_t>(std::fmod(current_position, static_cast<double>(buffer_size)));
     
-    // Overdub: mix new input with existing audio
-    float existing_sample = buffer[record_pos];
     float mix = m_overdub_mix.load();
-    buffer[record_pos] = existing_sample * mix + input_sample * (1.0f - mix);
+    const int num_channels = tape.get_num_channels();
+    for (int channel = 0; channel < num_channels; ++channel)
+    {
+        // Chunked tapes map a chunk from the pool on the first write into it
+        float* sample = tape.get_writable_sample(record_pos, channel);
+        if (sample == nullptr)
+        {
+            // Reported once per run of dropped samples, not once per sample
+            if (!m_pool_exhausted && m_event_log != nullptr)
+                m_event_log->push(AudioEvent::TapePoolExhausted, static_cast<double>(record_pos));
+            m_pool_exhausted = true;
+            return false;
+        }
+
+        // Overdub: mix new input with existing audio
+        const float input_sample = frame[juce::jmin(channel, num_frame_channels - 1)];
+        *sample = *sample * mix + input_sample * (1.0f - mix);
+    }
+    m_pool_exhausted = false;
     m_tape_loop.m_recorded_length.store(std::max(m_tape_loop.m_recorded_length.load(), record_pos + 1));
 
     // Update record head to track maximum position written to
@@ -36,13 +63,15 @@ void LooperWriteHead::finalize_recording(float final_position)
     m_record_enable.store(false); // Turn off record enable so UI reflects the change
     
     set_loop_end(static_cast<size_t>(final_position));
-    juce::Logger::writeToLog("~~~ Finalized recording");
+    if (m_event_log != nullptr)
+        m_event_log->push(AudioEvent::WriteHeadFinalized, final_position);
 }
 
 void LooperWriteHead::reset()
 {
     m_pos.store(0);
-    juce::Logger::writeToLog("~~~ Reset write head");
     // set loop_end to the length of the tape loop
     set_loop_end(m_tape_loop.get_buffer_size());
+    if (m_event_log != nullptr)
+        m_event_log->push(AudioEvent::WriteHeadReset, static_cast<double>(get_loop_end()));
 }
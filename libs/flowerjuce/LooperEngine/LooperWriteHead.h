@@ -2,6 +2,7 @@
 
 #include <juce_core/juce_core.h>
 #include "TapeLoop.h"
+#include "../Debug/AudioEventLog.h"
 #include <atomic>
 
 // LooperWriteHead handles recording to a TapeLoop
@@ -21,7 +22,15 @@ public:
     
     // Process recording for a single sample
     // Returns true if a sample was written
+    // The caller must hold a TapeLoop::ReadScope on the tape loop
+    // A multichannel tape records the sample on every channel.
     bool process_sample(float input_sample, float current_position);
+
+    // Record one frame: tape channel c takes frame[c], and channels past
+    // num_frame_channels repeat the last one. Same rules as process_sample.
+    // The overload taking a view writes through the caller's block snapshot.
+    bool process_frame(const float* frame, int num_frame_channels, float current_position);
+    bool process_frame(const TapeLoop::View& tape, const float* frame, int num_frame_channels, float current_position);
     
     // Finalize recording (set recorded_length when recording stops)
     void finalize_recording(float final_position);
@@ -41,8 +50,12 @@ public:
     double get_sample_rate() const { return m_sample_rate.load(); }
     
     // Input channel selection (-1 = all channels, 0+ = specific channel)
+    // With -1 a mono tape records the first input and an N-channel tape the first N
     void set_input_channel(int channel) { m_input_channel.store(channel); }
     int get_input_channel() const { return m_input_channel.load(); }
+
+    // Realtime-safe sink for state-change messages (nullptr = silent)
+    void set_event_log(AudioEventLog* event_log) { m_event_log = event_log; }
     
 private:
     // Write position tracking
@@ -55,4 +68,6 @@ private:
     std::atomic<float> m_overdub_mix{0.5f};
     std::atomic<double> m_sample_rate{44100.0}; // Current sample rate
     std::atomic<int> m_input_channel{-1}; // -1 = all channels, 0+ = specific channel
+    AudioEventLog* m_event_log{nullptr};
+    bool m_pool_exhausted{false}; // Audio thread only
 };
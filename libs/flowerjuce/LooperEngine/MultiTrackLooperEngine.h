@@ -4,8 +4,14 @@
 #include <juce_audio_devices/juce_audio_devices.h>
 #include <flowerjuce/DSP/MultiChannelLoudnessMeter.h>
 #include <flowerjuce/Debug/DebugAudioRate.h>
+#include <flowerjuce/Debug/AudioAllocationGuard.h>
+#include <flowerjuce/Debug/AudioEventLog.h>
+#include "TrackWorkerPool.h"
+#include "TapeChunkPool.h"
+#include "TapePrefetcher.h"
 #include <array>
 #include <atomic>
+#include <memory>
 
 // Forward declarations
 class LooperTrackEngine;
@@ -39,6 +45,14 @@ public:
             DBG_SEGFAULT("Initializing track engine " + juce::String(i));
             m_track_engines[i].initialize(44100.0, m_max_buffer_duration_seconds);
             DBG_SEGFAULT("Track engine " + juce::String(i) + " initialized");
+
+            // Audio-thread messages are formatted and logged on the flusher thread
+            auto& event_log = m_track_engines[i].get_event_log();
+            event_log.set_source_name("Track " + juce::String(static_cast<int>(i)));
+            m_event_log_flusher.add_log(event_log);
+
+            // Keeps chunked tapes resident around their playheads (idle for contiguous tapes)
+            m_tape_prefetcher.add_tape(m_track_engines[i].get_tape_loop());
         }
         DBG_SEGFAULT("EXIT: MultiTrackLooperEngineTemplate::MultiTrackLooperEngineTemplate");
     }
@@ -66,14 +80,22 @@ public:
                 << " OutputChannels: " << device->getActiveOutputChannels().countNumberOfSetBits());
 
             // Reallocate buffers with correct sample rate
+            prepare_chunk_pool(sample_rate);
             DBG_SEGFAULT("Calling audioDeviceAboutToStart on track engines");
+            const int max_block_size = device->getCurrentBufferSizeSamples();
+            const int num_output_channels = device->getActiveOutputChannels().countNumberOfSetBits();
             for (size_t i = 0; i < m_track_engines.size(); ++i)
             {
                 DBG_SEGFAULT("Calling audioDeviceAboutToStart on track " + juce::String(i));
-                m_track_engines[i].audio_device_about_to_start(sample_rate);
+                m_track_engines[i].audio_device_about_to_start(sample_rate, max_block_size, num_output_channels);
                 DBG_SEGFAULT("audioDeviceAboutToStart completed for track " + juce::String(i));
             }
             DBG_SEGFAULT("All track engines notified");
+
+            allocate_track_buses(device->getActiveOutputChannels().countNumberOfSetBits(),
+                                 device->getCurrentBufferSizeSamples());
+
+            m_channel_meter.prepare(sample_rate, device->getActiveOutputChannels().countNumberOfSetBits());
         }
         else
         {
@@ -98,6 +120,9 @@ public:
                                          int num_samples,
                                          const juce::AudioIODeviceCallbackContext& context) override
     {
+        // Debug builds count any heap allocation made while rendering the block
+        const AudioAllocationGuard allocation_guard;
+
         DBG_AUDIO_RATE(10000, {
             DBG_SEGFAULT("ENTRY: audioDeviceIOCallbackWithContext (periodic)");
             juce::Logger::writeToLog("*** Audio callback running! InputChannels: " + juce::String(num_input_channels)
@@ -135,15 +160,35 @@ public:
         });
 
         DBG_SEGFAULT("Processing tracks, m_num_tracks=" + juce::String(m_num_tracks));
-        
-        for (int i = 0; i < m_num_tracks; ++i)
+
+        if (can_render_in_parallel(num_output_channels, num_samples))
         {
-            DBG_SEGFAULT("Processing track " + juce::String(i));
-            bool debug_this_track = should_debug && i == 0;
-            m_track_engines[i].process_block(input_channel_data, num_input_channels,
-                                        output_channel_data, num_output_channels,
-                                        num_samples, debug_this_track);
-            DBG_SEGFAULT("Track " + juce::String(i) + " processed");
+            // Each track renders into its own bus on the pool, then the buses
+            // are summed in track order so the mix matches the serial path.
+            m_parallel_block = { input_channel_data, num_input_channels, num_output_channels, num_samples, should_debug };
+            m_worker_pool.run(&MultiTrackLooperEngineTemplate::render_track_job, this, m_num_tracks);
+
+            for (int i = 0; i < m_num_tracks; ++i)
+            {
+                const auto& bus = m_track_buses[static_cast<size_t>(i)];
+                for (int channel = 0; channel < num_output_channels; ++channel)
+                {
+                    if (output_channel_data[channel] != nullptr)
+                        juce::FloatVectorOperations::add(output_channel_data[channel], bus.getReadPointer(channel), num_samples);
+                }
+            }
+        }
+        else
+        {
+            for (int i = 0; i < m_num_tracks; ++i)
+            {
+                DBG_SEGFAULT("Processing track " + juce::String(i));
+                bool debug_this_track = should_debug && i == 0;
+                m_track_engines[i].process_block(input_channel_data, num_input_channels,
+                                            output_channel_data, num_output_channels,
+                                            num_samples, debug_this_track);
+                DBG_SEGFAULT("Track " + juce::String(i) + " processed");
+            }
         }
         
         // Update channel level meters using UGen
@@ -160,6 +205,28 @@ public:
 
     int get_num_tracks() const { return m_num_tracks; }
 
+    // Tracks render on this many worker threads plus the device thread.
+    // 0 (the default) keeps everything on the device thread. Can be changed
+    // while audio is running; the callback renders serially while the pool
+    // is being rebuilt.
+    void set_num_render_threads(int num_threads)
+    {
+        m_worker_pool.set_num_threads(juce::jlimit(0, m_num_tracks - 1, num_threads));
+    }
+    int get_num_render_threads() const { return m_worker_pool.get_num_threads(); }
+
+    // Sizes the per-track buses used by the worker pool. The device callback
+    // calls this from audioDeviceAboutToStart; call it yourself when driving
+    // audioDeviceIOCallbackWithContext without a device (e.g. offline or in
+    // tests). Blocks larger than this fall back to serial rendering.
+    void allocate_track_buses(int num_output_channels, int max_block_size)
+    {
+        const int num_channels = juce::jmax(1, num_output_channels);
+        const int num_samples = juce::jmax(1, max_block_size);
+        for (auto& bus : m_track_buses)
+            bus.setSize(num_channels, num_samples, false, true, false);
+    }
+
     void set_num_tracks(int num)
     {
         // For now, we keep it at 8 tracks as specified
@@ -261,11 +328,14 @@ public:
                 << " OutputChannels: " << device->getActiveOutputChannels().countNumberOfSetBits());
 
             // Update buffers with actual device sample rate
+            prepare_chunk_pool(sample_rate);
             DBG_SEGFAULT("Calling audio_device_about_to_start on track engines");
+            const int max_block_size = device->getCurrentBufferSizeSamples();
+            const int num_output_channels = device->getActiveOutputChannels().countNumberOfSetBits();
             for (size_t i = 0; i < m_track_engines.size(); ++i)
             {
                 DBG_SEGFAULT("Calling audio_device_about_to_start on track " + juce::String(i));
-                m_track_engines[i].audio_device_about_to_start(sample_rate);
+                m_track_engines[i].audio_device_about_to_start(sample_rate, max_block_size, num_output_channels);
                 DBG_SEGFAULT("audio_device_about_to_start completed for track " + juce::String(i));
             }
             DBG_SEGFAULT("All track engines notified");
@@ -288,15 +358,132 @@ public:
         DBG_SEGFAULT("EXIT: start_audio");
     }
 
+    // Record long loops into chunked tapes: each track can hold up to
+    // max_loop_seconds, but all tracks share one pool of pool_seconds, so memory
+    // follows what was actually recorded instead of 8 x the maximum. With a
+    // spill_directory the pool is a memory-mapped file there and cold chunks
+    // can leave RAM. pool_seconds <= 0 goes back to contiguous tapes.
+    // Opt-in: tracks are contiguous until an app calls this. Message thread;
+    // clears every track.
+    void use_chunked_tapes(double max_loop_seconds, double pool_seconds, const juce::File& spill_directory = {})
+    {
+        m_max_buffer_duration_seconds = max_loop_seconds;
+        m_chunk_pool_seconds = pool_seconds;
+        m_spill_directory = spill_directory;
+        m_chunk_pool.reset();
+
+        const double sample_rate = m_current_sample_rate.load();
+        prepare_chunk_pool(sample_rate);
+        if (m_chunk_pool == nullptr)
+        {
+            for (auto& track_engine : m_track_engines)
+                track_engine.set_chunk_pool(nullptr, sample_rate, m_max_buffer_duration_seconds);
+        }
+    }
+
+    // Loops kept across a device restart at a new sample rate are resampled in
+    // the background; a track stays silent until its loop is converted.
+    bool is_resampling() const
+    {
+        for (const auto& track_engine : m_track_engines)
+            if (track_engine.is_resampling())
+                return true;
+        return false;
+    }
+
+    // Overall progress of those conversions, 1 when none is running
+    float get_resample_progress() const
+    {
+        float progress = 1.0f;
+        for (const auto& track_engine : m_track_engines)
+            progress = juce::jmin(progress, track_engine.get_resample_progress());
+        return progress;
+    }
+
+    // Shared tape pool, nullptr while tapes are contiguous
+    TapeChunkPool* get_chunk_pool() const { return m_chunk_pool.get(); }
+
     // Get channel levels for visualization (16 channels)
     std::array<std::atomic<float>, 16>& get_channel_levels() { return m_channel_meter.get_channel_levels(); }
     const std::array<std::atomic<float>, 16>& get_channel_levels() const { return m_channel_meter.get_channel_levels(); }
 
+    // Output peak/RMS/LUFS per channel and summed (message thread)
+    const MultiChannelLoudnessMeter::Snapshot& get_loudness_snapshot() { return m_channel_meter.get_snapshot(); }
+    void reset_integrated_loudness() { m_channel_meter.reset_integrated(); }
+
 private:
+    struct ParallelBlock
+    {
+        const float* const* input_channel_data{nullptr};
+        int num_input_channels{0};
+        int num_output_channels{0};
+        int num_samples{0};
+        bool should_debug{false};
+    };
+
+    bool can_render_in_parallel(int num_output_channels, int num_samples) const
+    {
+        const auto& bus = m_track_buses.front();
+        return m_worker_pool.get_num_threads() > 0
+            && num_output_channels <= bus.getNumChannels()
+            && num_samples <= bus.getNumSamples();
+    }
+
+    // Build the tape pool and hand it to every track. The pool is kept across
+    // device restarts (tracks resample into it), so its duration is measured
+    // at the rate it was built for.
+    void prepare_chunk_pool(double sample_rate)
+    {
+        if (m_chunk_pool_seconds <= 0.0 || m_chunk_pool != nullptr)
+            return;
+
+        const size_t num_chunks = TapeChunkPool::chunks_for_duration(sample_rate, m_chunk_pool_seconds);
+        // A fresh file name: the previous pool keeps its file until its last tape lets go
+        if (m_spill_directory != juce::File() && m_spill_directory.createDirectory())
+            m_chunk_pool = std::make_shared<TapeChunkPool>(num_chunks, m_spill_directory.getNonexistentChildFile("tape_pool", ".spill", false));
+        else
+            m_chunk_pool = std::make_shared<TapeChunkPool>(num_chunks);
+
+        DBG("Tape chunk pool: " << static_cast<int>(num_chunks) << " chunks ("
+            << m_chunk_pool_seconds << " s)" << (m_chunk_pool->is_spilling_to_disk() ? ", spilling to disk" : ""));
+
+        for (auto& track_engine : m_track_engines)
+            track_engine.set_chunk_pool(m_chunk_pool, sample_rate, m_max_buffer_duration_seconds);
+    }
+
+    static void render_track_job(void* context, int track_index)
+    {
+        const AudioAllocationGuard allocation_guard; // Worker threads are audio threads too
+        auto& engine = *static_cast<MultiTrackLooperEngineTemplate*>(context);
+        const auto& block = engine.m_parallel_block;
+        auto& bus = engine.m_track_buses[static_cast<size_t>(track_index)];
+
+        // Panners accumulate, so the bus starts silent every block.
+        for (int channel = 0; channel < block.num_output_channels; ++channel)
+            bus.clear(channel, 0, block.num_samples);
+
+        engine.m_track_engines[static_cast<size_t>(track_index)].process_block(
+            block.input_channel_data, block.num_input_channels,
+            bus.getArrayOfWritePointers(), block.num_output_channels,
+            block.num_samples, block.should_debug && track_index == 0);
+    }
+
     static constexpr int m_num_tracks = 8;
-    static constexpr double m_max_buffer_duration_seconds = 10.0;
+    double m_max_buffer_duration_seconds{10.0};
+
+    // Chunked tapes (use_chunked_tapes); the pool outlives the tracks that use it
+    std::shared_ptr<TapeChunkPool> m_chunk_pool;
+    double m_chunk_pool_seconds{0.0};
+    juce::File m_spill_directory;
 
     std::array<TrackEngineType, 8> m_track_engines;
+    AudioEventLogFlusher m_event_log_flusher; // Declared after the tracks so it stops first
+    TapePrefetcher m_tape_prefetcher;         // Likewise
+
+    // Parallel rendering: one private output bus per track.
+    TrackWorkerPool m_worker_pool;
+    std::array<juce::AudioBuffer<float>, 8> m_track_buses;
+    ParallelBlock m_parallel_block;
     juce::AudioDeviceManager m_audio_device_manager;
     std::atomic<double> m_current_sample_rate{44100.0};
     
@@ -0,0 +1,433 @@
+#include "ReadHeadKernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace ReadHeadKernels
+{
+    namespace
+    {
+        // Per-sample recurrence, used when a batch could wrap more than once
+        // (loop shorter than kBatchSize steps) or the playhead starts outside
+        // the loop and has to walk back in one fold per sample.
+        float advance_positions_scalar(float pos,
+                                       float step,
+                                       float loop_start,
+                                       float loop_end,
+                                       float* positions,
+                                       int num_samples,
+                                       WrapInfo& wrap_info)
+        {
+            const float loop_len = loop_end - loop_start;
+            for (int sample = 0; sample < num_samples; ++sample)
+            {
+                positions[sample] = pos;
+                pos += step;
+
+                bool wrapped = false;
+                if (pos < loop_start)
+                {
+                    pos += loop_len;
+                    wrapped = true;
+                }
+                else if (pos >= loop_end)
+                {
+                    pos -= loop_len;
+                    wrapped = true;
+                }
+
+                if (wrapped)
+                {
+                    if (wrap_info.first_wrap_index < 0)
+                        wrap_info.first_wrap_index = sample;
+                    ++wrap_info.num_wraps;
+                }
+            }
+            return pos;
+        }
+
+        bool can_batch(float pos, float step, float loop_start, float loop_end)
+        {
+            const float loop_len = loop_end - loop_start;
+            return pos >= loop_start
+                && pos < loop_end
+                && std::abs(step) * static_cast<float>(kBatchSize) < loop_len;
+        }
+
+        // Computes the positions of one batch and returns the playhead after it.
+        // Within a batch the playhead is monotonic and spans less than one loop
+        // length, so at most one fold happens and the wrapped lanes are a suffix.
+        float advance_batch(float pos,
+                            float step,
+                            float loop_start,
+                            float loop_end,
+                            float* lanes,
+                            int count,
+                            int batch_offset,
+                            WrapInfo& wrap_info)
+        {
+            const bool forward = step >= 0.0f;
+            const float fold = forward ? (loop_end - loop_start) : (loop_start - loop_end);
+
+            float raw[kBatchSize + 1];
+            for (int lane = 0; lane <= kBatchSize; ++lane)
+                raw[lane] = pos + step * static_cast<float>(lane);
+
+            int wrapped_lanes = 0;
+            for (int lane = 0; lane <= kBatchSize; ++lane)
+            {
+                const bool outside = forward ? raw[lane] >= loop_end : raw[lane] < loop_start;
+                lanes[lane] = outside ? raw[lane] - fold : raw[lane];
+                wrapped_lanes += (outside && lane <= count) ? 1 : 0;
+            }
+
+            if (wrapped_lanes > 0)
+            {
+                // Lane (count + 1 - wrapped_lanes) is the first folded one, so the
+                // sample before it is the one whose advance wrapped.
+                if (wrap_info.first_wrap_index < 0)
+                    wrap_info.first_wrap_index = batch_offset + count - wrapped_lanes;
+                ++wrap_info.num_wraps;
+            }
+
+            return lanes[count];
+        }
+
+        void interpolate_batch(const float* buffer,
+                               size_t buffer_size,
+                               const float* positions,
+                               float* output,
+                               int count)
+        {
+            size_t index0[kBatchSize];
+            float fraction[kBatchSize];
+            size_t max_index = 0;
+            for (int lane = 0; lane < count; ++lane)
+            {
+                const float position = std::max(0.0f, positions[lane]);
+                index0[lane] = static_cast<size_t>(position);
+                fraction[lane] = position - static_cast<float>(index0[lane]);
+                max_index = std::max(max_index, index0[lane]);
+            }
+
+            // Rare: a lane reads the last sample or past the end, so its
+            // neighbour wraps to the start of the buffer.
+            if (max_index + 1 >= buffer_size)
+            {
+                for (int lane = 0; lane < count; ++lane)
+                    output[lane] = interpolate_sample(buffer, buffer_size, positions[lane]);
+                return;
+            }
+
+            for (int lane = 0; lane < count; ++lane)
+            {
+                const float a = buffer[index0[lane]];
+                const float b = buffer[index0[lane] + 1];
+                output[lane] = a * (1.0f - fraction[lane]) + b * fraction[lane];
+            }
+        }
+
+        float chunked_sample(const std::atomic<float*>* chunks, int chunk_size_log2, size_t index)
+        {
+            const float* chunk = chunks[index >> chunk_size_log2].load(std::memory_order_relaxed);
+            const size_t mask = (size_t{1} << chunk_size_log2) - 1;
+            return chunk != nullptr ? chunk[index & mask] : 0.0f;
+        }
+    } // namespace
+
+    float interpolate_sample(const float* buffer, size_t buffer_size, float position)
+    {
+        if (buffer == nullptr || buffer_size == 0)
+            return 0.0f;
+
+        position = std::max(0.0f, position);
+        const size_t index0 = static_cast<size_t>(position) % buffer_size;
+        const size_t index1 = (index0 + 1) % buffer_size;
+        const float fraction = position - std::floor(position);
+        return buffer[index0] * (1.0f - fraction) + buffer[index1] * fraction;
+    }
+
+    float advance_positions(float start_pos,
+                            float step,
+                            float loop_start,
+                            float loop_end,
+                            float* positions,
+                            int num_samples,
+                            WrapInfo& wrap_info)
+    {
+        if (num_samples <= 0)
+            return start_pos;
+
+        // Invalid loop: hold the playhead like LooperReadHead::advance_playhead.
+        if (loop_end <= loop_start)
+        {
+            std::fill(positions, positions + num_samples, start_pos);
+            return start_pos;
+        }
+
+        if (!can_batch(start_pos, step, loop_start, loop_end))
+            return advance_positions_scalar(start_pos, step, loop_start, loop_end,
+                                            positions, num_samples, wrap_info);
+
+        float pos = start_pos;
+        float lanes[kBatchSize + 1];
+        for (int offset = 0; offset < num_samples; offset += kBatchSize)
+        {
+            const int count = std::min(kBatchSize, num_samples - offset);
+            pos = advance_batch(pos, step, loop_start, loop_end, lanes, count, offset, wrap_info);
+            std::copy(lanes, lanes + count, positions + offset);
+        }
+        return pos;
+    }
+
+    void interpolate_positions(const float* buffer,
+                               size_t buffer_size,
+                               const float* positions,
+                               float* output,
+                               int num_samples)
+    {
+        if (buffer == nullptr || buffer_size == 0)
+        {
+            std::fill(output, output + std::max(0, num_samples), 0.0f);
+            return;
+        }
+
+        for (int offset = 0; offset < num_samples; offset += kBatchSize)
+        {
+            const int count = std::min(kBatchSize, num_samples - offset);
+            interpolate_batch(buffer, buffer_size, positions + offset, output + offset, count);
+        }
+    }
+
+    void interpolate_positions_chunked(const std::atomic<float*>* chunks,
+                                       int chunk_size_log2,
+                                       size_t buffer_size,
+                                       const float* positions,
+                                       float* output,
+                                       int num_samples)
+    {
+        if (chunks == nullptr || buffer_size == 0)
+        {
+            std::fill(output, output + std::max(0, num_samples), 0.0f);
+            return;
+        }
+
+        const size_t mask = (size_t{1} << chunk_size_log2) - 1;
+        for (int offset = 0; offset < num_samples; offset += kBatchSize)
+        {
+            const int count = std::min(kBatchSize, num_samples - offset);
+            const float* lanes = positions + offset;
+
+            size_t index0[kBatchSize];
+            float fraction[kBatchSize];
+            for (int lane = 0; lane < count; ++lane)
+            {
+                const float position = std::max(0.0f, lanes[lane]);
+                index0[lane] = static_cast<size_t>(position) % buffer_size;
+                fraction[lane] = position - std::floor(position);
+            }
+
+            // Playback moves a few samples per batch, so the whole batch nearly
+            // always sits in one chunk: look it up once and gather from it.
+            const size_t first_chunk = index0[0] >> chunk_size_log2;
+            bool same_chunk = true;
+            for (int lane = 0; lane < count; ++lane)
+                same_chunk = same_chunk && (index0[lane] >> chunk_size_log2) == first_chunk
+                                        && (index0[lane] & mask) != mask
+                                        && index0[lane] + 1 < buffer_size;
+
+            if (same_chunk)
+            {
+                const float* chunk = chunks[first_chunk].load(std::memory_order_relaxed);
+                if (chunk == nullptr)
+                {
+                    std::fill(output + offset, output + offset + count, 0.0f);
+                    continue;
+                }
+                for (int lane = 0; lane < count; ++lane)
+                {
+                    const size_t local = index0[lane] & mask;
+                    output[offset + lane] = chunk[local] * (1.0f - fraction[lane]) + chunk[local + 1] * fraction[lane];
+                }
+                continue;
+            }
+
+            for (int lane = 0; lane < count; ++lane)
+            {
+                const size_t index1 = (index0[lane] + 1) % buffer_size;
+                const float a = chunked_sample(chunks, chunk_size_log2, index0[lane]);
+                const float b = chunked_sample(chunks, chunk_size_log2, index1);
+                output[offset + lane] = a * (1.0f - fraction[lane]) + b * fraction[lane];
+            }
+        }
+    }
+
+    void interpolate_positions_planar(const float* const* planes,
+                                      int num_planes,
+                                      size_t buffer_size,
+                                      const float* positions,
+                                      float* const* outputs,
+                                      int num_samples)
+    {
+        if (num_planes == 1)
+        {
+            interpolate_positions(planes[0], buffer_size, positions, outputs[0], num_samples);
+            return;
+        }
+
+        if (buffer_size == 0)
+        {
+            for (int plane = 0; plane < num_planes; ++plane)
+                std::fill(outputs[plane], outputs[plane] + std::max(0, num_samples), 0.0f);
+            return;
+        }
+
+        for (int offset = 0; offset < num_samples; offset += kBatchSize)
+        {
+            const int count = std::min(kBatchSize, num_samples - offset);
+
+            // Read every lane before any plane is written (outputs[0] may be positions)
+            float lanes[kBatchSize];
+            size_t index0[kBatchSize];
+            float fraction[kBatchSize];
+            size_t max_index = 0;
+            for (int lane = 0; lane < count; ++lane)
+            {
+                lanes[lane] = std::max(0.0f, positions[offset + lane]);
+                index0[lane] = static_cast<size_t>(lanes[lane]);
+                fraction[lane] = lanes[lane] - static_cast<float>(index0[lane]);
+                max_index = std::max(max_index, index0[lane]);
+            }
+
+            // Same rare wrap fallback as interpolate_batch
+            if (max_index + 1 >= buffer_size)
+            {
+                for (int plane = 0; plane < num_planes; ++plane)
+                    for (int lane = 0; lane < count; ++lane)
+                        outputs[plane][offset + lane] = interpolate_sample(planes[plane], buffer_size, lanes[lane]);
+                continue;
+            }
+
+            for (int plane = 0; plane < num_planes; ++plane)
+            {
+                const float* buffer = planes[plane];
+                float* output = outputs[plane] + offset;
+                for (int lane = 0; lane < count; ++lane)
+                {
+                    const float a = buffer[index0[lane]];
+                    const float b = buffer[index0[lane] + 1];
+                    output[lane] = a * (1.0f - fraction[lane]) + b * fraction[lane];
+                }
+            }
+        }
+    }
+
+    void interpolate_positions_chunked_planar(const std::atomic<float*>* const* chunk_tables,
+                                              int num_planes,
+                                              int chunk_size_log2,
+                                              size_t buffer_size,
+                                              const float* positions,
+                                              float* const* outputs,
+                                              int num_samples)
+    {
+        if (num_planes == 1)
+        {
+            interpolate_positions_chunked(chunk_tables[0], chunk_size_log2, buffer_size,
+                                          positions, outputs[0], num_samples);
+            return;
+        }
+
+        if (buffer_size == 0)
+        {
+            for (int plane = 0; plane < num_planes; ++plane)
+                std::fill(outputs[plane], outputs[plane] + std::max(0, num_samples), 0.0f);
+            return;
+        }
+
+        const size_t mask = (size_t{1} << chunk_size_log2) - 1;
+        for (int offset = 0; offset < num_samples; offset += kBatchSize)
+        {
+            const int count = std::min(kBatchSize, num_samples - offset);
+
+            // Read every lane before any plane is written (outputs[0] may be positions)
+            size_t index0[kBatchSize];
+            float fraction[kBatchSize];
+            for (int lane = 0; lane < count; ++lane)
+            {
+                const float position = std::max(0.0f, positions[offset + lane]);
+                index0[lane] = static_cast<size_t>(position) % buffer_size;
+                fraction[lane] = position - std::floor(position);
+            }
+
+            // Every plane is chunked the same way, so one check covers them all
+            const size_t first_chunk = index0[0] >> chunk_size_log2;
+            bool same_chunk = true;
+            for (int lane = 0; lane < count; ++lane)
+                same_chunk = same_chunk && (index0[lane] >> chunk_size_log2) == first_chunk
+                                        && (index0[lane] & mask) != mask
+                                        && index0[lane] + 1 < buffer_size;
+
+            for (int plane = 0; plane < num_planes; ++plane)
+            {
+                const std::atomic<float*>* chunks = chunk_tables[plane];
+                float* output = outputs[plane] + offset;
+                if (same_chunk)
+                {
+                    const float* chunk = chunks[first_chunk].load(std::memory_order_relaxed);
+                    if (chunk == nullptr)
+                    {
+                        std::fill(output, output + count, 0.0f);
+                        continue;
+                    }
+                    for (int lane = 0; lane < count; ++lane)
+                    {
+                        const size_t local = index0[lane] & mask;
+                        output[lane] = chunk[local] * (1.0f - fraction[lane]) + chunk[local + 1] * fraction[lane];
+                    }
+                    continue;
+                }
+
+                for (int lane = 0; lane < count; ++lane)
+                {
+                    const size_t index1 = (index0[lane] + 1) % buffer_size;
+                    const float a = chunked_sample(chunks, chunk_size_log2, index0[lane]);
+                    const float b = chunked_sample(chunks, chunk_size_log2, index1);
+                    output[lane] = a * (1.0f - fraction[lane]) + b * fraction[lane];
+                }
+            }
+        }
+    }
+
+    float render_block(const float* buffer,
+                       size_t buffer_size,
+                       float start_pos,
+                       float step,
+                       float loop_start,
+                       float loop_end,
+                       float* output,
+                       int num_samples,
+                       WrapInfo& wrap_info)
+    {
+        if (num_samples <= 0)
+            return start_pos;
+
+        const bool has_buffer = buffer != nullptr && buffer_size > 0;
+        if (!has_buffer || loop_end <= loop_start || !can_batch(start_pos, step, loop_start, loop_end))
+        {
+            // Slow path reuses the output buffer as position scratch.
+            const float end_pos = advance_positions(start_pos, step, loop_start, loop_end,
+                                                    output, num_samples, wrap_info);
+            interpolate_positions(buffer, buffer_size, output, output, num_samples);
+            return end_pos;
+        }
+
+        float pos = start_pos;
+        float lanes[kBatchSize + 1];
+        for (int offset = 0; offset < num_samples; offset += kBatchSize)
+        {
+            const int count = std::min(kBatchSize, num_samples - offset);
+            pos = advance_batch(pos, step, loop_start, loop_end, lanes, count, offset, wrap_info);
+            interpolate_batch(buffer, buffer_size, lanes, output + offset, count);
+        }
+        return pos;
+    }
+}
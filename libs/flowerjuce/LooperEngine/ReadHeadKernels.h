@@ -0,0 +1,84 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// WrapInfo reports where a read head wrapped around its loop during a block.
+struct WrapInfo
+{
+    int num_wraps{0};
+    int first_wrap_index{-1}; // Sample whose advance wrapped first, -1 if none
+
+    bool wrapped() const noexcept { return num_wraps > 0; }
+};
+
+// Stateless playback kernels shared by LooperReadHead and GrainVoice.
+// Positions and gathers run in fixed batches of kBatchSize lanes held in
+// plain arrays, so the compiler keeps them in SSE/NEON registers (and emits
+// gathers where the target has them) without per-platform intrinsics.
+namespace ReadHeadKernels
+{
+    constexpr int kBatchSize = 8;
+
+    // Linear interpolation at a single position. Indices wrap at buffer_size.
+    // This is the scalar reference the batched kernels are checked against.
+    float interpolate_sample(const float* buffer, size_t buffer_size, float position);
+
+    // Fill positions with the read position of each sample (taken before that
+    // sample's advance) and return the playhead after the block. Wrapping
+    // follows the per-sample rule: step, then fold back by one loop length.
+    float advance_positions(float start_pos,
+                            float step,
+                            float loop_start,
+                            float loop_end,
+                            float* positions,
+                            int num_samples,
+                            WrapInfo& wrap_info);
+
+    // Linearly interpolate buffer at every position.
+    void interpolate_positions(const float* buffer,
+                               size_t buffer_size,
+                               const float* positions,
+                               float* output,
+                               int num_samples);
+
+    // interpolate_positions over chunked storage: sample i lives at
+    // chunks[i >> chunk_size_log2][i & mask], and null chunks read as silence.
+    void interpolate_positions_chunked(const std::atomic<float*>* chunks,
+                                       int chunk_size_log2,
+                                       size_t buffer_size,
+                                       const float* positions,
+                                       float* output,
+                                       int num_samples);
+
+    // interpolate_positions over planar multichannel storage: plane c is read
+    // into outputs[c]. Indices and fractions are computed once per batch and
+    // reused for every plane. outputs[0] may alias positions.
+    void interpolate_positions_planar(const float* const* planes,
+                                      int num_planes,
+                                      size_t buffer_size,
+                                      const float* positions,
+                                      float* const* outputs,
+                                      int num_samples);
+
+    // Chunked counterpart: chunk_tables[c] is the chunk table of plane c.
+    void interpolate_positions_chunked_planar(const std::atomic<float*>* const* chunk_tables,
+                                              int num_planes,
+                                              int chunk_size_log2,
+                                              size_t buffer_size,
+                                              const float* positions,
+                                              float* const* outputs,
+                                              int num_samples);
+
+    // Fused advance + interpolate. Produces the same samples as calling
+    // advance_positions then interpolate_positions, without a positions buffer.
+    float render_block(const float* buffer,
+                       size_t buffer_size,
+                       float start_pos,
+                       float step,
+                       float loop_start,
+                       float loop_end,
+                       float* output,
+                       int num_samples,
+                       WrapInfo& wrap_info);
+}
@@ -0,0 +1,191 @@
+#include "TapeChunkPool.h"
+#include <algorithm>
+#include <cmath>
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+ #include <sys/mman.h>
+#endif
+
+namespace
+{
+constexpr size_t kPageFloats = 4096 / sizeof(float);
+}
+
+TapeChunkPool::TapeChunkPool(size_t num_chunks)
+    : m_num_chunks(num_chunks)
+{
+    allocate_heap();
+    build_free_list();
+}
+
+TapeChunkPool::TapeChunkPool(size_t num_chunks, const juce::File& spill_file)
+    : m_num_chunks(num_chunks)
+{
+    const auto bytes = static_cast<juce::int64>(num_chunks * kChunkSize * sizeof(float));
+    if (bytes > 0 && spill_file != juce::File())
+    {
+        // Extend the file sparsely: no disk blocks are used until chunks are written
+        spill_file.deleteFile();
+        bool sized = false;
+        {
+            juce::FileOutputStream stream(spill_file);
+            if (stream.openedOk() && stream.setPosition(bytes - 1))
+                sized = stream.writeByte(0);
+        }
+
+        if (sized)
+        {
+            // Shared, not exclusive: a private mapping would lose evicted dirty pages
+            auto mapped = std::make_unique<juce::MemoryMappedFile>(spill_file, juce::MemoryMappedFile::readWrite, false);
+            if (mapped->getData() != nullptr && mapped->getSize() >= static_cast<size_t>(bytes))
+            {
+                m_mapped_file = std::move(mapped);
+                m_spill_file = spill_file;
+                m_base = static_cast<float*>(m_mapped_file->getData());
+            }
+        }
+
+        if (m_mapped_file == nullptr)
+        {
+            DBG("TapeChunkPool: could not map spill file " << spill_file.getFullPathName() << ", using heap");
+            spill_file.deleteFile();
+        }
+    }
+
+    if (m_base == nullptr)
+        allocate_heap();
+    build_free_list();
+}
+
+TapeChunkPool::~TapeChunkPool()
+{
+    // Every TapeLoop storage keeps its pool alive, so nothing is in use here
+    jassert(m_num_in_use.load() == 0);
+
+    m_mapped_file.reset();
+    if (m_spill_file != juce::File())
+        m_spill_file.deleteFile();
+}
+
+size_t TapeChunkPool::chunks_for_duration(double sample_rate, double seconds)
+{
+    const auto samples = static_cast<size_t>(std::ceil(juce::jmax(0.0, sample_rate * seconds)));
+    return (samples + kChunkSize - 1) / kChunkSize;
+}
+
+void TapeChunkPool::allocate_heap()
+{
+    // Default-initialised on purpose: pages stay uncommitted until a chunk is
+    // first zeroed or written
+    m_heap.reset(new float[juce::jmax<size_t>(1, m_num_chunks * kChunkSize)]);
+    m_base = m_heap.get();
+}
+
+void TapeChunkPool::build_free_list()
+{
+    m_next.reset(new std::atomic<std::uint32_t>[juce::jmax<size_t>(1, m_num_chunks)]);
+    jassert(m_num_chunks < 0xffffffffu);
+
+    // Contents are unknown until zeroed, so everything starts dirty
+    for (size_t index = m_num_chunks; index-- > 0;)
+        push(m_dirty_head, static_cast<std::uint32_t>(index));
+}
+
+void TapeChunkPool::push(std::atomic<std::uint64_t>& head, std::uint32_t index)
+{
+    std::uint64_t old_head = head.load();
+    for (;;)
+    {
+        m_next[index].store(static_cast<std::uint32_t>(old_head), std::memory_order_relaxed);
+        const std::uint64_t new_head = (old_head & 0xffffffff00000000ull) | (index + 1);
+        if (head.compare_exchange_weak(old_head, new_head))
+            return;
+    }
+}
+
+std::uint32_t TapeChunkPool::pop(std::atomic<std::uint64_t>& head)
+{
+    std::uint64_t old_head = head.load();
+    for (;;)
+    {
+        const auto link = static_cast<std::uint32_t>(old_head);
+        if (link == kEmpty)
+            return kEmpty;
+
+        // A stale next read is harmless: the tag makes the exchange fail
+        const std::uint64_t tag = (old_head >> 32) + 1;
+        const std::uint64_t new_head = (tag << 32) | m_next[link - 1].load(std::memory_order_relaxed);
+        if (head.compare_exchange_weak(old_head, new_head))
+            return link;
+    }
+}
+
+float* TapeChunkPool::acquire()
+{
+    std::uint32_t link = pop(m_clean_head);
+    if (link != kEmpty)
+    {
+        m_num_clean.fetch_sub(1);
+    }
+    else
+    {
+        // Reserve ran dry: clear a released chunk here (256 KB memset)
+        link = pop(m_dirty_head);
+        if (link == kEmpty)
+            return nullptr;
+        std::fill_n(chunk_data(link - 1), kChunkSize, 0.0f);
+        m_inline_clears.fetch_add(1);
+    }
+
+    m_num_in_use.fetch_add(1);
+    return chunk_data(link - 1);
+}
+
+void TapeChunkPool::release(float* chunk)
+{
+    if (chunk == nullptr)
+        return;
+
+    const auto offset = static_cast<size_t>(chunk - m_base);
+    jassert(chunk >= m_base && offset % kChunkSize == 0 && offset / kChunkSize < m_num_chunks);
+    push(m_dirty_head, static_cast<std::uint32_t>(offset / kChunkSize));
+    m_num_in_use.fetch_sub(1);
+}
+
+void TapeChunkPool::service()
+{
+    while (m_num_clean.load() < kCleanReserve)
+    {
+        const std::uint32_t link = pop(m_dirty_head);
+        if (link == kEmpty)
+            return;
+
+        std::fill_n(chunk_data(link - 1), kChunkSize, 0.0f);
+        push(m_clean_head, link - 1);
+        m_num_clean.fetch_add(1);
+    }
+}
+
+void TapeChunkPool::prefetch(const float* chunk) const
+{
+    if (chunk == nullptr)
+        return;
+
+    // One read per page is enough to fault it in
+    float sum = 0.0f;
+    for (size_t index = 0; index < kChunkSize; index += kPageFloats)
+        sum += reinterpret_cast<const volatile float*>(chunk)[index];
+    juce::ignoreUnused(sum);
+}
+
+void TapeChunkPool::evict(float* chunk) const
+{
+    if (chunk == nullptr || m_mapped_file == nullptr)
+        return;
+
+#if JUCE_LINUX || JUCE_MAC || JUCE_BSD
+    // Shared file mapping: dirty pages are already in the page cache, so the
+    // next access reads them back from there (or from the file)
+    ::madvise(chunk, kChunkSize * sizeof(float), MADV_DONTNEED);
+#endif
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+// TapeChunkPool holds fixed-size blocks of tape samples shared by many TapeLoops
+//
+// All chunks live in one reservation made up front: either heap memory or a
+// memory-mapped spill file. Untouched chunks cost address space but no RAM,
+// so a tape only grows its resident set as recording actually reaches new
+// chunks. With a spill file, cold chunks can be dropped from RAM (their
+// samples stay in the file) and are paged back in on access.
+//
+// acquire() and release() are lock-free and realtime safe. Released chunks
+// are zeroed off the audio thread by service(), which keeps a small reserve
+// of clean chunks ready; acquire() only clears a chunk itself if that reserve
+// has run dry.
+class TapeChunkPool
+{
+public:
+    static constexpr int kChunkSizeLog2 = 16;
+    static constexpr size_t kChunkSize = size_t{1} << kChunkSizeLog2; // ~1.4 s at 48 kHz
+    static constexpr size_t kChunkMask = kChunkSize - 1;
+    static constexpr int kCleanReserve = 8;
+
+    // Heap-backed pool
+    explicit TapeChunkPool(size_t num_chunks);
+
+    // Pool backed by a memory-mapped spill file (overwritten, deleted with the
+    // pool). Falls back to the heap if the file cannot be mapped.
+    TapeChunkPool(size_t num_chunks, const juce::File& spill_file);
+
+    ~TapeChunkPool();
+
+    TapeChunkPool(const TapeChunkPool&) = delete;
+    TapeChunkPool& operator=(const TapeChunkPool&) = delete;
+
+    // Chunks needed to hold the given duration
+    static size_t chunks_for_duration(double sample_rate, double seconds);
+
+    // A zeroed chunk, or nullptr when the pool is exhausted (realtime safe)
+    float* acquire();
+
+    // Return a chunk to the pool (realtime safe)
+    void release(float* chunk);
+
+    // Zero released chunks until kCleanReserve are ready (background thread)
+    void service();
+
+    // Fault the pages of a chunk in, so the audio thread does not have to
+    void prefetch(const float* chunk) const;
+
+    // Drop the resident pages of a chunk; its samples stay in the spill file.
+    // Does nothing for heap-backed pools, where dropping pages would lose data.
+    void evict(float* chunk) const;
+
+    size_t get_num_chunks() const { return m_num_chunks; }
+    size_t get_num_in_use() const { return static_cast<size_t>(m_num_in_use.load()); }
+    size_t get_num_free() const { return m_num_chunks - get_num_in_use(); }
+    size_t get_bytes_in_use() const { return get_num_in_use() * kChunkSize * sizeof(float); }
+    bool is_spilling_to_disk() const { return m_mapped_file != nullptr; }
+
+    // Times acquire() had to clear a chunk on the calling (audio) thread
+    std::uint32_t get_inline_clear_count() const { return m_inline_clears.load(); }
+
+private:
+    static constexpr std::uint32_t kEmpty = 0; // Stack links are index + 1
+
+    void allocate_heap();
+    void build_free_list();
+    void push(std::atomic<std::uint64_t>& head, std::uint32_t index);
+    std::uint32_t pop(std::atomic<std::uint64_t>& head);
+    float* chunk_data(std::uint32_t index) const { return m_base + static_cast<size_t>(index) * kChunkSize; }
+
+    size_t m_num_chunks{0};
+    float* m_base{nullptr};
+    std::unique_ptr<float[]> m_heap;
+    std::unique_ptr<juce::MemoryMappedFile> m_mapped_file;
+    juce::File m_spill_file;
+
+    // Treiber stacks of chunk indices; the high 32 bits of each head are an
+    // ABA tag bumped on every pop.
+    std::unique_ptr<std::atomic<std::uint32_t>[]> m_next;
+    std::atomic<std::uint64_t> m_clean_head{0}; // Zeroed, ready for acquire()
+    std::atomic<std::uint64_t> m_dirty_head{0}; // Released or never used
+    std::atomic<int> m_num_clean{0};
+    std::atomic<int> m_num_in_use{0};
+    std::atomic<std::uint32_t> m_inline_clears{0};
+};
@@ -1,23 +1,372 @@
 #include "TapeLoop.h"
 
+TapeLoop::Storage::~Storage()
+{
+    if (pool == nullptr)
+        return;
+
+    const size_t table_size = num_chunks * static_cast<size_t>(num_channels);
+    for (size_t index = 0; index < table_size; ++index)
+        pool->release(chunks[index].load());
+}
+
+namespace
+{
+int clamp_channels(int num_channels)
+{
+    return juce::jlimit(1, TapeLoop::kMaxChannels, num_channels);
+}
+} // namespace
+
 TapeLoop::TapeLoop()
+    : m_storage(std::make_unique<Storage>())
 {
     // Buffer will be allocated when sample rate is known from audio device
+    m_current.store(m_storage.get());
 }
 
-void TapeLoop::allocate_buffer(double sample_rate, double max_duration_seconds)
+void TapeLoop::allocate_buffer(double sample_rate, double max_duration_seconds, int num_channels)
 {
-    const juce::ScopedLock sl(m_lock);
     size_t buffer_size = static_cast<size_t>(sample_rate * max_duration_seconds);
-    m_buffer.resize(buffer_size, 0.0f);
-    m_recorded_length.store(0);
+    num_channels = clamp_channels(num_channels);
+
+    // Always contiguous, also when replacing chunked storage
+    auto storage = std::make_unique<Storage>();
+    storage->planes.resize(static_cast<size_t>(num_channels));
+    for (auto& plane : storage->planes)
+        plane.assign(buffer_size, 0.0f);
+    storage->capacity = buffer_size;
+    storage->num_channels = num_channels;
+    publish_storage(std::move(storage), 0, false);
+}
+
+void TapeLoop::allocate_chunked(std::shared_ptr<TapeChunkPool> pool, double sample_rate, double max_duration_seconds,
+                                int num_channels)
+{
+    jassert(pool != nullptr);
+    const auto capacity = static_cast<size_t>(sample_rate * max_duration_seconds);
+    publish_storage(make_chunked_storage(std::move(pool), capacity, clamp_channels(num_channels)), 0, false);
+}
+
+std::unique_ptr<TapeLoop::Storage> TapeLoop::make_chunked_storage(std::shared_ptr<TapeChunkPool> pool, size_t capacity,
+                                                                  int num_channels)
+{
+    auto storage = std::make_unique<Storage>();
+    storage->pool = std::move(pool);
+    storage->capacity = capacity;
+    storage->num_channels = num_channels;
+    storage->planes.resize(static_cast<size_t>(num_channels)); // Left empty
+    storage->num_chunks = (capacity + TapeChunkPool::kChunkSize - 1) / TapeChunkPool::kChunkSize;
+
+    const size_t table_size = storage->num_chunks * static_cast<size_t>(num_channels);
+    storage->chunks.reset(new std::atomic<float*>[juce::jmax<size_t>(1, table_size)]);
+    for (size_t index = 0; index < table_size; ++index)
+        storage->chunks[index].store(nullptr);
+    return storage;
+}
+
+void TapeLoop::publish_buffer(std::vector<float>&& samples, size_t recorded_length, bool has_recorded)
+{
+    std::vector<std::vector<float>> channels(1);
+    channels[0] = std::move(samples);
+    publish_buffer(std::move(channels), recorded_length, has_recorded);
+}
+
+void TapeLoop::publish_buffer(std::vector<std::vector<float>>&& channels, size_t recorded_length, bool has_recorded)
+{
+    const juce::ScopedLock sl(m_lock);
+    if (channels.empty())
+        channels.resize(1);
+    if (channels.size() > static_cast<size_t>(kMaxChannels))
+        channels.resize(static_cast<size_t>(kMaxChannels));
+
+    const int num_channels = static_cast<int>(channels.size());
+    const size_t capacity = channels[0].size();
+    for (auto& plane : channels)
+    {
+        jassert(plane.size() == capacity);
+        plane.resize(capacity, 0.0f);
+    }
+    recorded_length = juce::jmin(recorded_length, capacity);
+
+    std::unique_ptr<Storage> storage;
+    if (auto pool = get_storage().pool)
+    {
+        // Copy only the recorded part; the rest stays unmapped
+        storage = make_chunked_storage(std::move(pool), capacity, num_channels);
+        for (size_t start = 0; start < recorded_length; start += TapeChunkPool::kChunkSize)
+        {
+            const size_t count = juce::jmin(TapeChunkPool::kChunkSize, recorded_length - start);
+            bool exhausted = false;
+            for (int channel = 0; channel < num_channels && !exhausted; ++channel)
+            {
+                float* chunk = storage->pool->acquire();
+                if (chunk == nullptr)
+                {
+                    exhausted = true;
+                    break;
+                }
+                const auto& plane = channels[static_cast<size_t>(channel)];
+                std::copy(plane.begin() + static_cast<std::ptrdiff_t>(start),
+                          plane.begin() + static_cast<std::ptrdiff_t>(start + count), chunk);
+                storage->chunks[static_cast<size_t>(channel) * storage->num_chunks + start / TapeChunkPool::kChunkSize].store(chunk);
+            }
+
+            if (exhausted)
+            {
+                DBG("TapeLoop::publish_buffer: chunk pool exhausted, truncating to " << start << " samples");
+                recorded_length = start;
+                break;
+            }
+        }
+    }
+    else
+    {
+        storage = std::make_unique<Storage>();
+        storage->planes = std::move(channels);
+        storage->capacity = capacity;
+        storage->num_channels = num_channels;
+    }
+
+    publish_storage(std::move(storage), recorded_length, has_recorded);
+}
+
+void TapeLoop::publish_storage(std::unique_ptr<Storage> storage, size_t recorded_length, bool has_recorded)
+{
+    const juce::ScopedLock sl(m_lock);
+    const size_t clamped_length = juce::jmin(recorded_length, storage->capacity);
+
+    // Hide the old content before the swap so no reader trusts a stale length
     m_has_recorded.store(false);
+    m_recorded_length.store(0);
+    swap_storage(std::move(storage));
+    m_recorded_length.store(clamped_length);
+    m_has_recorded.store(has_recorded);
 }
 
 void TapeLoop::clear_buffer()
 {
     const juce::ScopedLock sl(m_lock);
-    std::fill(m_buffer.begin(), m_buffer.end(), 0.0f);
+    const auto& storage = get_storage();
+    if (storage.pool != nullptr)
+    {
+        publish_storage(make_chunked_storage(storage.pool, storage.capacity, storage.num_channels), 0, false);
+        return;
+    }
+
+    clear_in_place();
+}
+
+void TapeLoop::clear_in_place()
+{
+    auto& storage = get_storage();
+    if (storage.pool != nullptr)
+    {
+        const size_t table_size = storage.num_chunks * static_cast<size_t>(storage.num_channels);
+        for (size_t index = 0; index < table_size; ++index)
+        {
+            if (float* chunk = storage.chunks[index].load())
+                std::fill(chunk, chunk + TapeChunkPool::kChunkSize, 0.0f);
+        }
+    }
+    else
+    {
+        for (auto& plane : storage.planes)
+            std::fill(plane.begin(), plane.end(), 0.0f);
+    }
     m_recorded_length.store(0);
     m_has_recorded.store(false);
 }
+
+int TapeLoop::View::get_num_channels() const
+{
+    return m_storage->num_channels;
+}
+
+size_t TapeLoop::View::get_buffer_size() const
+{
+    return m_storage->capacity;
+}
+
+bool TapeLoop::View::is_chunked() const
+{
+    return m_storage->pool != nullptr;
+}
+
+size_t TapeLoop::View::get_num_chunks() const
+{
+    return m_storage->num_chunks;
+}
+
+const float* TapeLoop::View::get_plane(int channel) const
+{
+    const auto& storage = *m_storage;
+    if (storage.pool != nullptr || channel < 0 || channel >= storage.num_channels)
+        return nullptr;
+    return storage.planes[static_cast<size_t>(channel)].data();
+}
+
+const std::atomic<float*>* TapeLoop::View::get_chunk_table(int channel) const
+{
+    const auto& storage = *m_storage;
+    if (storage.chunks == nullptr || channel < 0 || channel >= storage.num_channels)
+        return nullptr;
+    return storage.chunks.get() + static_cast<size_t>(channel) * storage.num_chunks;
+}
+
+float TapeLoop::View::get_sample(size_t index, int channel) const
+{
+    const auto& storage = *m_storage;
+    if (index >= storage.capacity || channel < 0 || channel >= storage.num_channels)
+        return 0.0f;
+    if (storage.pool == nullptr)
+        return storage.planes[static_cast<size_t>(channel)][index];
+
+    const auto* table = storage.chunks.get() + static_cast<size_t>(channel) * storage.num_chunks;
+    const float* chunk = table[index >> TapeChunkPool::kChunkSizeLog2].load(std::memory_order_acquire);
+    return chunk != nullptr ? chunk[index & TapeChunkPool::kChunkMask] : 0.0f;
+}
+
+size_t TapeLoop::View::read(size_t start, float* destination, size_t num_samples, int channel) const
+{
+    const auto& storage = *m_storage;
+    if (start >= storage.capacity || channel < 0 || channel >= storage.num_channels)
+        return 0;
+    num_samples = juce::jmin(num_samples, storage.capacity - start);
+
+    if (storage.pool == nullptr)
+    {
+        std::copy_n(storage.planes[static_cast<size_t>(channel)].data() + start, num_samples, destination);
+        return num_samples;
+    }
+
+    const auto* table = storage.chunks.get() + static_cast<size_t>(channel) * storage.num_chunks;
+    for (size_t done = 0; done < num_samples;)
+    {
+        const size_t index = start + done;
+        const size_t count = juce::jmin(num_samples - done, TapeChunkPool::kChunkSize - (index & TapeChunkPool::kChunkMask));
+        const float* chunk = table[index >> TapeChunkPool::kChunkSizeLog2].load(std::memory_order_acquire);
+        if (chunk != nullptr)
+            std::copy_n(chunk + (index & TapeChunkPool::kChunkMask), count, destination + done);
+        else
+            std::fill_n(destination + done, count, 0.0f);
+        done += count;
+    }
+    return num_samples;
+}
+
+float* TapeLoop::View::get_writable_sample(size_t index, int channel) const
+{
+    auto& storage = *m_storage;
+    if (index >= storage.capacity || channel < 0 || channel >= storage.num_channels)
+        return nullptr;
+    if (storage.pool == nullptr)
+        return storage.planes[static_cast<size_t>(channel)].data() + index;
+
+    // Only the audio thread that records into this tape maps chunks
+    auto& slot = storage.chunks[static_cast<size_t>(channel) * storage.num_chunks + (index >> TapeChunkPool::kChunkSizeLog2)];
+    float* chunk = slot.load(std::memory_order_relaxed);
+    if (chunk == nullptr)
+    {
+        chunk = storage.pool->acquire();
+        if (chunk == nullptr)
+            return nullptr;
+        slot.store(chunk, std::memory_order_release);
+    }
+    return chunk + (index & TapeChunkPool::kChunkMask);
+}
+
+size_t TapeLoop::get_num_mapped_chunks() const
+{
+    const auto& storage = get_storage();
+    size_t mapped = 0;
+    const size_t table_size = storage.num_chunks * static_cast<size_t>(storage.num_channels);
+    for (size_t index = 0; index < table_size; ++index)
+        mapped += storage.chunks[index].load(std::memory_order_relaxed) != nullptr ? 1 : 0;
+    return mapped;
+}
+
+void TapeLoop::maintain_residency(size_t chunks_behind, size_t chunks_ahead)
+{
+    const auto& storage = get_storage();
+    if (storage.pool == nullptr || storage.num_chunks == 0)
+        return;
+
+    // Keep clean chunks ready for the next write into unmapped tape
+    storage.pool->service();
+
+    // Playback wraps at the recorded length (the whole tape while recording)
+    const size_t length = m_has_recorded.load() ? m_recorded_length.load() : storage.capacity;
+    const size_t loop_chunks = juce::jlimit<size_t>(1, storage.num_chunks,
+                                                    (length + TapeChunkPool::kChunkSize - 1) / TapeChunkPool::kChunkSize);
+    const size_t hot_chunk = juce::jmin(get_hot_position() >> TapeChunkPool::kChunkSizeLog2, storage.num_chunks - 1);
+
+    // Every channel's row follows the same playhead
+    const size_t table_size = storage.num_chunks * static_cast<size_t>(storage.num_channels);
+    for (size_t slot = 0; slot < table_size; ++slot)
+    {
+        float* chunk = storage.chunks[slot].load(std::memory_order_acquire);
+        if (chunk == nullptr)
+            continue;
+
+        const size_t index = slot % storage.num_chunks;
+
+        bool is_hot = false;
+        if (index < loop_chunks && hot_chunk < loop_chunks)
+        {
+            const size_t ahead = (index + loop_chunks - hot_chunk) % loop_chunks;
+            is_hot = ahead <= chunks_ahead || loop_chunks - ahead <= chunks_behind;
+        }
+        else
+        {
+            is_hot = index + chunks_behind >= hot_chunk && index <= hot_chunk + chunks_ahead;
+        }
+
+        if (is_hot)
+            storage.pool->prefetch(chunk);
+        else
+            storage.pool->evict(chunk);
+    }
+}
+
+int TapeLoop::enter_read()
+{
+    // Register in the current epoch before loading the pointer; a publisher that
+    // swaps after this increment will wait for us before freeing what we load.
+    // Retry if a publisher flipped the epoch between the load and the increment,
+    // otherwise we could sit in a slot nobody is going to wait on.
+    for (;;)
+    {
+        const unsigned int epoch = m_epoch.load();
+        auto& readers = m_epoch_readers[epoch & 1u];
+        readers.fetch_add(1);
+        if (m_epoch.load() == epoch)
+            return static_cast<int>(epoch & 1u);
+        readers.fetch_sub(1);
+    }
+}
+
+void TapeLoop::exit_read(int epoch_slot)
+{
+    m_epoch_readers[static_cast<size_t>(epoch_slot)].fetch_sub(1);
+}
+
+void TapeLoop::swap_storage(std::unique_ptr<Storage> storage)
+{
+    m_current.store(storage.get());
+
+    // New readers now land in the other slot, so the old slot drains in at most
+    // one audio block even with several render threads pinning this loop.
+    const unsigned int previous_epoch = m_epoch.fetch_add(1);
+    auto& previous_readers = m_epoch_readers[previous_epoch & 1u];
+    for (int spins = 0; previous_readers.load() != 0; ++spins)
+    {
+        if (spins < 64)
+            juce::Thread::yield();
+        else
+            juce::Thread::sleep(1);
+    }
+
+    // Frees the old storage, returning its chunks to the pool
+    m_storage = std::move(storage);
+}
@@ -1,33 +1,198 @@
 #pragma once
 
 #include <juce_core/juce_core.h>
+#include "TapeChunkPool.h"
 #include <vector>
+#include <array>
 #include <atomic>
+#include <memory>
 
 // TapeLoop represents a recorded audio loop
 // It holds the buffer and metadata about the recording
+//
+// The sample storage is swapped with an epoch scheme so the audio thread never
+// locks: it pins the current storage with a ReadScope (one atomic increment per
+// block) and reads/writes it in place. Reallocation and loading build a new
+// storage elsewhere, publish it with a single atomic pointer store, and free the
+// old one once every reader pinned in the previous epoch has left.
+//
+// Storage is either one contiguous vector (allocate_buffer) or a table of
+// TapeChunkPool chunks (allocate_chunked). A chunked tape addresses the full
+// duration but only takes a chunk from the pool when a write first reaches
+// it, so long loops cost memory for what was recorded, not for the maximum.
+// get_buffer() is the contiguous vector and is empty for chunked tapes; use
+// get_sample()/read() to read either kind.
+//
+// A tape holds 1 to kMaxChannels channels, stored planar: each channel is its
+// own contiguous plane (or row of chunks) of get_buffer_size() samples. Read
+// heads compute one batch of positions and gather it from every plane, so
+// each gather stays a unit-stride load from one array whatever the channel
+// count. Mono callers (channel 0 defaults) are unchanged.
+//
+// m_lock only serialises those non-realtime publishers against each other and
+// against UI code that wants a stable view of get_buffer(). The audio thread
+// must never take it, and must never publish while holding a ReadScope.
+//
+// Audio-thread code reads through a View: one load of the published storage
+// that every plane, chunk table, capacity and channel count of a block comes
+// from. The TapeLoop accessors below each load the storage again, so a swap
+// between two of them can mix old and new storage; they are for UI and other
+// non-realtime callers holding m_lock.
 class TapeLoop
 {
+private:
+    struct Storage;
+
 public:
+    static constexpr int kMaxChannels = 8;
+
     TapeLoop();
     ~TapeLoop() = default;
-    
-    // Buffer management
-    void allocate_buffer(double sample_rate, double max_duration_seconds = 60.0);
+
+    // One consistent snapshot of the published storage. Valid while the
+    // ReadScope (or m_lock) that was held when it was taken is held.
+    class View
+    {
+    public:
+        int get_num_channels() const;
+        size_t get_buffer_size() const; // Addressable samples per channel
+        bool is_chunked() const;
+        size_t get_num_chunks() const;
+
+        // Contiguous plane of one channel (nullptr for chunked storage or a missing channel)
+        const float* get_plane(int channel = 0) const;
+        // Chunk table of one channel (nullptr for contiguous storage or a missing channel)
+        const std::atomic<float*>* get_chunk_table(int channel = 0) const;
+
+        float get_sample(size_t index, int channel = 0) const;
+        size_t read(size_t start, float* destination, size_t num_samples, int channel = 0) const;
+        float* get_writable_sample(size_t index, int channel = 0) const;
+
+    private:
+        friend class TapeLoop;
+        explicit View(Storage* storage) : m_storage(storage) {}
+
+        Storage* m_storage;
+    };
+
+    // Pins the published storage for the lifetime of the scope (audio thread)
+    // and takes the View the block reads through.
+    class ReadScope
+    {
+    public:
+        explicit ReadScope(TapeLoop& tape_loop)
+            : m_tape_loop(tape_loop), m_epoch_slot(tape_loop.enter_read()), m_view(tape_loop.get_view()) {}
+        ~ReadScope() { m_tape_loop.exit_read(m_epoch_slot); }
+
+        ReadScope(const ReadScope&) = delete;
+        ReadScope& operator=(const ReadScope&) = delete;
+
+        const View& get_view() const { return m_view; }
+
+    private:
+        TapeLoop& m_tape_loop;
+        int m_epoch_slot;
+        View m_view;
+    };
+
+    // Loads the published storage once (see View for how long it stays valid)
+    View get_view() const { return View(m_current.load(std::memory_order_acquire)); }
+
+    // Contiguous buffer management (non-realtime: may block until readers drain)
+    void allocate_buffer(double sample_rate, double max_duration_seconds = 60.0, int num_channels = 1);
+
+    // Chunked storage of max_duration_seconds drawing on pool (non-realtime).
+    // Every channel takes its own chunks.
+    void allocate_chunked(std::shared_ptr<TapeChunkPool> pool, double sample_rate, double max_duration_seconds,
+                          int num_channels = 1);
+
+    // Atomically replace the storage and recording metadata. A chunked tape
+    // stays chunked (copying the recorded part into chunks from its pool).
+    // The planar overload takes one equally sized vector per channel.
+    void publish_buffer(std::vector<float>&& samples, size_t recorded_length, bool has_recorded);
+    void publish_buffer(std::vector<std::vector<float>>&& channels, size_t recorded_length, bool has_recorded);
+
+    // Empty the tape (non-realtime). A contiguous tape is zeroed in place. A
+    // chunked tape publishes fresh, unmapped storage; its old chunks go back to
+    // the pool only once every reader has drained, so a chunk the audio thread
+    // may still hold is never handed to another tape.
     void clear_buffer();
-    
-    // Buffer access
-    std::vector<float>& get_buffer() { return m_buffer; }
-    const std::vector<float>& get_buffer() const { return m_buffer; }
-    size_t get_buffer_size() const { return m_buffer.size(); }
-    
+
+    // Zero the current storage in place (realtime safe: nothing is freed or
+    // allocated). Mapped chunks stay with this tape.
+    void clear_in_place();
+
+    // Low-level epoch API for callers that cannot use ReadScope (e.g. pinning
+    // a variable number of loops). Every enter_read must be paired with exit_read.
+    int enter_read();
+    void exit_read(int epoch_slot);
+
+    // Buffer access (one plane). The reference stays valid while a ReadScope
+    // is held or while m_lock is held.
+    std::vector<float>& get_buffer(int channel = 0) { return get_storage().planes[static_cast<size_t>(channel)]; }
+    const std::vector<float>& get_buffer(int channel = 0) const { return get_storage().planes[static_cast<size_t>(channel)]; }
+
+    // Single-call shortcuts through a fresh View (non-realtime; see above).
+    // Unwritten chunks read as silence; get_writable_sample takes a chunk from
+    // the pool if needed and returns nullptr when the pool is exhausted.
+    size_t get_buffer_size() const { return get_view().get_buffer_size(); }
+    int get_num_channels() const { return get_view().get_num_channels(); }
+    bool is_chunked() const { return get_view().is_chunked(); }
+    float get_sample(size_t index, int channel = 0) const { return get_view().get_sample(index, channel); }
+    size_t read(size_t start, float* destination, size_t num_samples, int channel = 0) const
+    {
+        return get_view().read(start, destination, num_samples, channel);
+    }
+    float* get_writable_sample(size_t index, int channel = 0) { return get_view().get_writable_sample(index, channel); }
+    const std::atomic<float*>* get_chunk_table(int channel = 0) const { return get_view().get_chunk_table(channel); }
+    size_t get_num_chunks() const { return get_view().get_num_chunks(); }
+    size_t get_num_mapped_chunks() const; // All channels
+
+    // Where playback currently is; the prefetcher keeps chunks around it resident
+    void set_hot_position(size_t position) { m_hot_position.store(position, std::memory_order_relaxed); }
+    size_t get_hot_position() const { return m_hot_position.load(std::memory_order_relaxed); }
+
+    // Fault in the chunks from chunks_behind before to chunks_ahead after the
+    // hot position (wrapping at the recorded length) and, when the pool spills
+    // to disk, evict the others. Also tops up the pool's clean chunks.
+    // Background thread, with a ReadScope held.
+    void maintain_residency(size_t chunks_behind, size_t chunks_ahead);
+
     // Recording metadata
     std::atomic<size_t> m_recorded_length{0}; // Actual length of recorded audio
     std::atomic<bool> m_has_recorded{false};  // Whether any audio has been recorded
-    
-    // Thread safety
+
+    // Serialises non-realtime publishers and UI readers (never taken on the audio thread)
     juce::CriticalSection m_lock;
-    
+
 private:
-    std::vector<float> m_buffer;
+    struct Storage
+    {
+        Storage() = default;
+        ~Storage();
+
+        std::vector<std::vector<float>> planes{ 1 };   // Contiguous storage, one plane per channel
+        std::shared_ptr<TapeChunkPool> pool;           // Set for chunked storage
+        std::unique_ptr<std::atomic<float*>[]> chunks; // Chunk table (channel-major), nullptr = unwritten
+        size_t num_chunks{0};                          // Per channel
+        size_t capacity{0};
+        int num_channels{1};
+    };
+
+    static std::unique_ptr<Storage> make_chunked_storage(std::shared_ptr<TapeChunkPool> pool, size_t capacity,
+                                                         int num_channels);
+
+    Storage& get_storage() { return *m_current.load(std::memory_order_acquire); }
+    const Storage& get_storage() const { return *m_current.load(std::memory_order_acquire); }
+
+    void publish_storage(std::unique_ptr<Storage> storage, size_t recorded_length, bool has_recorded);
+
+    // Publish a new storage and wait for readers of the previous epoch. Caller holds m_lock.
+    void swap_storage(std::unique_ptr<Storage> storage);
+
+    std::unique_ptr<Storage> m_storage; // Owns the published storage
+    std::atomic<Storage*> m_current{nullptr};
+    std::atomic<unsigned int> m_epoch{0};
+    std::array<std::atomic<int>, 2> m_epoch_readers{};
+    std::atomic<size_t> m_hot_position{0};
 };
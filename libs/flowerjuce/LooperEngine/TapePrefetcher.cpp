@@ -0,0 +1,47 @@
+#include "TapePrefetcher.h"
+#include <algorithm>
+
+TapePrefetcher::TapePrefetcher(int interval_ms)
+    : juce::Thread("TapePrefetcher"),
+      m_interval_ms(juce::jmax(1, interval_ms))
+{
+    startThread(juce::Thread::Priority::low);
+}
+
+TapePrefetcher::~TapePrefetcher()
+{
+    stopThread(1000);
+}
+
+void TapePrefetcher::add_tape(TapeLoop& tape)
+{
+    const juce::ScopedLock sl(m_tapes_lock);
+    if (std::find(m_tapes.begin(), m_tapes.end(), &tape) == m_tapes.end())
+        m_tapes.push_back(&tape);
+}
+
+void TapePrefetcher::remove_tape(TapeLoop& tape)
+{
+    const juce::ScopedLock sl(m_tapes_lock);
+    m_tapes.erase(std::remove(m_tapes.begin(), m_tapes.end(), &tape), m_tapes.end());
+}
+
+void TapePrefetcher::prefetch()
+{
+    const juce::ScopedLock sl(m_tapes_lock);
+    for (auto* tape : m_tapes)
+    {
+        // Pinned like a reader, so a reallocation cannot free chunks under us
+        const TapeLoop::ReadScope scope(*tape);
+        tape->maintain_residency(kChunksBehind, kChunksAhead);
+    }
+}
+
+void TapePrefetcher::run()
+{
+    while (!threadShouldExit())
+    {
+        prefetch();
+        wait(m_interval_ms);
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "TapeLoop.h"
+#include <vector>
+
+// Background thread that keeps chunked TapeLoops ready for the audio thread:
+// it faults in the chunks around each tape's hot position (and evicts the
+// rest when the pool spills to disk), and zeroes released chunks so writes
+// into new tape find a clean one. Contiguous tapes are skipped.
+class TapePrefetcher : private juce::Thread
+{
+public:
+    static constexpr size_t kChunksBehind = 1;
+    static constexpr size_t kChunksAhead = 2;
+
+    explicit TapePrefetcher(int interval_ms = 20);
+    ~TapePrefetcher() override;
+
+    // Setup thread; the tape must outlive the prefetcher or be removed first
+    void add_tape(TapeLoop& tape);
+    void remove_tape(TapeLoop& tape);
+
+    // One pass over every tape now (also run periodically)
+    void prefetch();
+
+private:
+    void run() override;
+
+    const int m_interval_ms;
+    juce::CriticalSection m_tapes_lock;
+    std::vector<TapeLoop*> m_tapes;
+};
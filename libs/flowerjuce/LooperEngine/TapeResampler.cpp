@@ -0,0 +1,107 @@
+#include "TapeResampler.h"
+#include <flowerjuce/DSP/PolyphaseResampler.h>
+#include <vector>
+
+TapeResampler::TapeResampler()
+    : juce::Thread("TapeResampler")
+{
+}
+
+TapeResampler::~TapeResampler()
+{
+    cancel();
+}
+
+void TapeResampler::start(TapeLoop& tape, double source_rate, double target_rate,
+                          double max_duration_seconds, PublishedCallback on_published)
+{
+    cancel();
+
+    m_tape = &tape;
+    m_source_rate = source_rate;
+    m_target_rate = target_rate;
+    m_max_duration_seconds = max_duration_seconds;
+    m_on_published = std::move(on_published);
+
+    m_progress.store(0.0f);
+    m_busy.store(true);
+    startThread(juce::Thread::Priority::low);
+}
+
+void TapeResampler::cancel()
+{
+    stopThread(10000);
+    m_busy.store(false);
+    m_progress.store(1.0f);
+}
+
+bool TapeResampler::wait_until_done(int timeout_ms)
+{
+    waitForThreadToExit(timeout_ms);
+    return !is_busy();
+}
+
+void TapeResampler::run()
+{
+    auto& tape = *m_tape;
+
+    // Snapshot the recording (every channel); m_lock keeps other publishers out while we read
+    std::vector<std::vector<float>> sources;
+    bool has_recorded = false;
+    {
+        const juce::ScopedLock sl(tape.m_lock);
+        has_recorded = tape.m_has_recorded.load();
+        sources.resize(static_cast<size_t>(tape.get_num_channels()));
+        for (size_t channel = 0; channel < sources.size(); ++channel)
+        {
+            sources[channel].resize(tape.m_recorded_length.load());
+            tape.read(0, sources[channel].data(), sources[channel].size(), static_cast<int>(channel));
+        }
+    }
+
+    const size_t source_length = sources[0].size();
+    const PolyphaseResampler resampler(m_source_rate, m_target_rate);
+    const auto capacity = static_cast<size_t>(m_target_rate * m_max_duration_seconds);
+    const size_t length = juce::jmin(resampler.get_output_length(source_length), capacity);
+    std::vector<std::vector<float>> resampled(sources.size());
+    for (auto& plane : resampled)
+        plane.resize(capacity, 0.0f);
+
+    // A finished loop is periodic, so the filter reads across its seam
+    const size_t total = length * sources.size();
+    size_t converted = 0;
+    for (size_t channel = 0; channel < sources.size(); ++channel)
+    {
+        const auto& source = sources[channel];
+        for (size_t done = 0; done < length; done += kSliceSize)
+        {
+            if (threadShouldExit())
+                return;
+
+            const size_t count = juce::jmin(kSliceSize, length - done);
+            resampler.process(source.data(), source.size(), resampled[channel].data() + done, done, count, has_recorded);
+            converted += count;
+            m_progress.store(static_cast<float>(converted) / static_cast<float>(total));
+        }
+    }
+
+    {
+        const juce::ScopedLock sl(tape.m_lock);
+        if (threadShouldExit())
+            return;
+
+        // Hand the old chunks back first so the pool can hold the new copy
+        if (tape.is_chunked())
+            tape.clear_buffer();
+        tape.publish_buffer(std::move(resampled), length, has_recorded);
+
+        if (m_on_published)
+            m_on_published(m_target_rate / m_source_rate);
+    }
+
+    DBG("TapeResampler: " << static_cast<int>(source_length) << " samples at " << m_source_rate
+        << " Hz -> " << static_cast<int>(length) << " at " << m_target_rate << " Hz");
+
+    m_progress.store(1.0f);
+    m_busy.store(false);
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "TapeLoop.h"
+#include <atomic>
+#include <functional>
+
+// Background thread that converts a TapeLoop's recording to a new sample rate,
+// so a device restart at another rate keeps the loop without stalling audio
+// startup. The worker snapshots the recorded part of every channel, resamples it in slices with
+// a PolyphaseResampler (reading across the loop seam), and publishes a buffer
+// of the new capacity in one swap. The tape keeps its old storage until then;
+// keep the audio thread off the tape while is_busy().
+class TapeResampler : private juce::Thread
+{
+public:
+    // Runs on the worker right after the swap, with ratio = target / source rate
+    using PublishedCallback = std::function<void(double ratio)>;
+
+    TapeResampler();
+    ~TapeResampler() override;
+
+    // Start converting tape to target_rate with room for max_duration_seconds.
+    // Cancels a job in progress first. Non-realtime.
+    void start(TapeLoop& tape, double source_rate, double target_rate,
+               double max_duration_seconds, PublishedCallback on_published);
+
+    // Abandon the running job; the tape keeps whatever storage it has now
+    void cancel();
+
+    // True from start() until the new storage is published (audio thread safe)
+    bool is_busy() const { return m_busy.load(); }
+
+    // 0..1 through the running job, 1 when idle
+    float get_progress() const { return m_progress.load(); }
+
+    // Block until the job has finished; false on timeout
+    bool wait_until_done(int timeout_ms);
+
+private:
+    static constexpr size_t kSliceSize = 32768; // Output samples between progress updates
+
+    void run() override;
+
+    TapeLoop* m_tape{nullptr};
+    double m_source_rate{0.0};
+    double m_target_rate{0.0};
+    double m_max_duration_seconds{0.0};
+    PublishedCallback m_on_published;
+
+    std::atomic<bool> m_busy{false};
+    std::atomic<float> m_progress{1.0f};
+};
@@ -0,0 +1,158 @@
+#include "TrackWorkerPool.h"
+
+class TrackWorkerPool::Worker : public juce::Thread
+{
+public:
+    Worker(TrackWorkerPool& pool, int index)
+        : juce::Thread("TrackWorker " + juce::String(index)),
+          m_pool(pool)
+    {
+    }
+
+    void run() override
+    {
+        juce::uint32 seen_generation = static_cast<juce::uint32>(
+            m_pool.m_batch_state.load() >> kGenerationShift);
+
+        while (!threadShouldExit())
+        {
+            if (m_pool.wait_for_batch(seen_generation, *this))
+                m_pool.run_jobs(seen_generation);
+        }
+    }
+
+private:
+    TrackWorkerPool& m_pool;
+};
+
+TrackWorkerPool::TrackWorkerPool() = default;
+
+TrackWorkerPool::~TrackWorkerPool()
+{
+    const juce::SpinLock::ScopedLockType lock(m_config_lock);
+    stop_workers();
+}
+
+void TrackWorkerPool::set_num_threads(int num_threads)
+{
+    num_threads = juce::jlimit(0, kMaxThreads, num_threads);
+
+    // Held for the whole resize so run() falls back to the calling thread.
+    const juce::SpinLock::ScopedLockType lock(m_config_lock);
+    if (num_threads == static_cast<int>(m_workers.size()))
+        return;
+
+    stop_workers();
+
+    for (int index = 0; index < num_threads; ++index)
+    {
+        auto worker = std::make_unique<Worker>(*this, index);
+        if (!worker->startRealtimeThread(juce::Thread::RealtimeOptions{}.withPriority(9)))
+        {
+            DBG("TrackWorkerPool: realtime priority unavailable for worker " + juce::String(index));
+            worker->startThread(juce::Thread::Priority::highest);
+        }
+        m_workers.push_back(std::move(worker));
+    }
+
+    m_num_threads.store(num_threads, std::memory_order_relaxed);
+    DBG("TrackWorkerPool: " + juce::String(num_threads) + " worker threads");
+}
+
+void TrackWorkerPool::stop_workers()
+{
+    for (auto& worker : m_workers)
+        worker->signalThreadShouldExit();
+    for (auto& worker : m_workers)
+        worker->stopThread(1000);
+    m_workers.clear();
+    m_num_threads.store(0, std::memory_order_relaxed);
+}
+
+void TrackWorkerPool::run(JobFunction job, void* context, int num_jobs)
+{
+    if (job == nullptr || num_jobs <= 0)
+        return;
+
+    const juce::SpinLock::ScopedTryLockType lock(m_config_lock);
+    if (!lock.isLocked() || m_workers.empty())
+    {
+        for (int index = 0; index < num_jobs; ++index)
+            job(context, index);
+        return;
+    }
+
+    // Every job of the previous batch finished before the last run()
+    // returned, so nobody is reading these while they change.
+    m_job.store(job);
+    m_context.store(context);
+    m_num_jobs.store(num_jobs);
+    m_jobs_done.store(0);
+
+    const auto generation = static_cast<juce::uint32>((m_batch_state.load() >> kGenerationShift) + 1);
+    m_batch_state.store(static_cast<juce::uint64>(generation) << kGenerationShift);
+
+    if (m_num_sleeping.load() > 0)
+    {
+        for (auto& worker : m_workers)
+            worker->notify();
+    }
+
+    run_jobs(generation);
+
+    while (m_jobs_done.load(std::memory_order_acquire) < num_jobs)
+        juce::Thread::yield();
+}
+
+void TrackWorkerPool::run_jobs(juce::uint32 generation)
+{
+    for (;;)
+    {
+        juce::uint64 state = m_batch_state.load();
+        if (static_cast<juce::uint32>(state >> kGenerationShift) != generation)
+            return;
+
+        const JobFunction job = m_job.load();
+        void* context = m_context.load();
+        const int index = static_cast<int>(state & kJobIndexMask);
+        if (index >= m_num_jobs.load())
+            return;
+
+        // The claim only succeeds while the batch is still this generation,
+        // so job and context above belong to it.
+        if (!m_batch_state.compare_exchange_weak(state, state + 1))
+            continue;
+
+        job(context, index);
+        m_jobs_done.fetch_add(1, std::memory_order_release);
+    }
+}
+
+bool TrackWorkerPool::wait_for_batch(juce::uint32& seen_generation, juce::Thread& thread)
+{
+    auto current_generation = [this]() {
+        return static_cast<juce::uint32>(m_batch_state.load() >> kGenerationShift);
+    };
+
+    for (int spin = 0; spin < kSpinIterations; ++spin)
+    {
+        if (current_generation() != seen_generation)
+        {
+            seen_generation = current_generation();
+            return true;
+        }
+    }
+
+    // Announce the sleep before the final check so a batch published in
+    // between still signals us.
+    m_num_sleeping.fetch_add(1);
+    if (current_generation() == seen_generation && !thread.threadShouldExit())
+        thread.wait(-1);
+    m_num_sleeping.fetch_sub(1);
+
+    if (current_generation() == seen_generation)
+        return false;
+
+    seen_generation = current_generation();
+    return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Pre-spawned worker threads that run a fixed batch of jobs for one audio
+// block. The calling (device) thread publishes the batch, claims jobs itself
+// alongside the workers and spins until the last job is done, so the block
+// never waits on a worker that hasn't woken up yet.
+//
+// Workers spin for a short while after each batch, then sleep until the
+// next one wakes them. run() never allocates, and if the pool is being
+// resized it runs the whole batch on the calling thread. It is not entirely
+// lock-free: waking a sleeping worker signals its juce::WaitableEvent, which
+// briefly takes that event's mutex. Only done when some worker is asleep
+// (a batch that finds them all spinning signals nothing), and the caller
+// never waits for a worker to wake before running jobs itself.
+class TrackWorkerPool
+{
+public:
+    using JobFunction = void (*)(void* context, int job_index);
+
+    static constexpr int kMaxThreads = 15;
+
+    TrackWorkerPool();
+    ~TrackWorkerPool();
+
+    // Spawns num_threads workers (0 = run everything on the caller). Call
+    // from a non-audio thread; safe while the device is running.
+    void set_num_threads(int num_threads);
+    int get_num_threads() const { return m_num_threads.load(std::memory_order_relaxed); }
+
+    // Runs job(context, i) for every i in [0, num_jobs) and returns once
+    // they have all finished. Audio thread only; not re-entrant.
+    void run(JobFunction job, void* context, int num_jobs);
+
+private:
+    class Worker;
+
+    // Batch state: the generation lives in the top 32 bits, the next job
+    // index in the bottom 32, so a worker can only claim a job from the
+    // batch it woke up for.
+    static constexpr int kGenerationShift = 32;
+    static constexpr juce::uint64 kJobIndexMask = 0xffffffffull;
+    static constexpr int kSpinIterations = 4000;
+
+    void stop_workers();
+    void run_jobs(juce::uint32 generation);
+    bool wait_for_batch(juce::uint32& seen_generation, juce::Thread& thread);
+
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::atomic<int> m_num_threads{0};
+    juce::SpinLock m_config_lock;
+
+    std::atomic<juce::uint64> m_batch_state{0};
+    std::atomic<JobFunction> m_job{nullptr};
+    std::atomic<void*> m_context{nullptr};
+    std::atomic<int> m_num_jobs{0};
+    std::atomic<int> m_jobs_done{0};
+    std::atomic<int> m_num_sleeping{0};
+};
@@ -14,6 +14,7 @@ CLEATPanner::CLEATPanner()
     m_smooth_y.reset(default_sample_rate, ramp_time_ms / 1000.0);
     m_smooth_x.setCurrentAndTargetValue(0.5f);
     m_smooth_y.setCurrentAndTargetValue(0.5f);
+    reset_control_gains();
 }
 
 void CLEATPanner::prepare(double sample_rate)
@@ -26,6 +27,15 @@ void CLEATPanner::prepare(double sample_rate)
     // Set current values to match atomic values
     m_smooth_x.setCurrentAndTargetValue(m_pan_x.load());
     m_smooth_y.setCurrentAndTargetValue(m_pan_y.load());
+    reset_control_gains();
+}
+
+void CLEATPanner::reset_control_gains()
+{
+    m_control_gain_power = m_gain_power.load();
+    m_control_gains = PanningUtils::compute_cleat_gains(m_smooth_x.getCurrentValue(),
+                                                        m_smooth_y.getCurrentValue(),
+                                                        m_control_gain_power);
 }
 
 void CLEATPanner::set_pan(float x, float y)
@@ -57,6 +67,11 @@ void CLEATPanner::set_gain_power(float power)
     m_gain_power.store(power);
 }
 
+void CLEATPanner::set_gain_update_interval(int num_samples)
+{
+    m_gain_update_interval.store(juce::jlimit(1, kMaxGainUpdateInterval, num_samples));
+}
+
 void CLEATPanner::process_block(const float* const* input_channel_data,
                                int num_input_channels,
                                float* const* output_channel_data,
@@ -67,12 +82,37 @@ void CLEATPanner::process_block(const float* const* input_channel_data,
     if (num_input_channels < 1 || num_output_channels < 16)
         return;
 
-    // Get input channel (mono)
-    const float* input = input_channel_data[0];
-    
     // Get current gain power factor
     float gain_power = m_gain_power.load();
-    
+
+    const int interval = m_gain_update_interval.load();
+    if (num_input_channels > 1)
+    {
+        process_multichannel(input_channel_data, juce::jmin(num_input_channels, kMaxSourceChannels),
+                             output_channel_data, num_samples, gain_power, interval);
+        return;
+    }
+
+    // Coming back from a multichannel source: start from the current position
+    if (m_num_sources != 1)
+    {
+        m_num_sources = 1;
+        reset_control_gains();
+    }
+
+    // Get input channel (mono)
+    const float* input = input_channel_data[0];
+
+    if (interval <= 1)
+        process_per_sample(input, output_channel_data, num_samples, gain_power);
+    else
+        process_control_rate(input, output_channel_data, num_samples, gain_power, interval);
+}
+
+void CLEATPanner::process_per_sample(const float* input, float* const* output_channel_data, int num_samples, float gain_power)
+{
+    std::array<float, 16> gains = m_control_gains;
+
     // Process samples with per-sample smoothing (matching Max/MSP line~ behavior)
     for (int sample = 0; sample < num_samples; ++sample)
     {
@@ -81,7 +121,7 @@ void CLEATPanner::process_block(const float* const* input_channel_data,
         float y = m_smooth_y.getNextValue();
         
         // Compute panning gains using smoothed positions (16 channels, row-major)
-        auto gains = PanningUtils::compute_cleat_gains(x, y, gain_power);
+        gains = PanningUtils::compute_cleat_gains(x, y, gain_power);
         
         float input_sample = input[sample];
         
@@ -94,5 +134,114 @@ void CLEATPanner::process_block(const float* const* input_channel_data,
             }
         }
     }
+
+    // Keep the control-rate path continuous if the interval is raised later
+    m_control_gains = gains;
+    m_control_gain_power = gain_power;
+}
+
+void CLEATPanner::process_control_rate(const float* input, float* const* output_channel_data, int num_samples,
+                                       float gain_power, int interval)
+{
+    // A gain power change jumps like the per-sample path instead of ramping
+    if (gain_power != m_control_gain_power)
+    {
+        m_control_gain_power = gain_power;
+        m_control_gains = PanningUtils::compute_cleat_gains(m_smooth_x.getCurrentValue(),
+                                                            m_smooth_y.getCurrentValue(),
+                                                            gain_power);
+    }
+
+    std::array<float*, 16> outputs{};
+    int sample = 0;
+    while (sample < num_samples)
+    {
+        const int remaining = num_samples - sample;
+        for (int channel = 0; channel < 16; ++channel)
+            outputs[static_cast<size_t>(channel)] = output_channel_data[channel] != nullptr
+                                                  ? output_channel_data[channel] + sample
+                                                  : nullptr;
+
+        // Settled pan: the gains are constant for the rest of the block
+        if (!m_smooth_x.isSmoothing() && !m_smooth_y.isSmoothing())
+        {
+            PanningUtils::fan_out_gain_ramp(input + sample, outputs.data(), 16,
+                                            m_control_gains.data(), m_control_gains.data(), remaining);
+            return;
+        }
+
+        // Moving pan: evaluate the gains at the end of the segment (where the
+        // per-sample path would be) and ramp to them from the previous point
+        const int segment = juce::jmin(interval, remaining);
+        const float x = m_smooth_x.skip(segment);
+        const float y = m_smooth_y.skip(segment);
+        const auto target = PanningUtils::compute_cleat_gains(x, y, gain_power);
+
+        PanningUtils::fan_out_gain_ramp(input + sample, outputs.data(), 16,
+                                        m_control_gains.data(), target.data(), segment);
+
+        m_control_gains = target;
+        sample += segment;
+    }
+}
+
+void CLEATPanner::reset_source_gains(int num_sources, float gain_power)
+{
+    m_num_sources = num_sources;
+    m_control_gain_power = gain_power;
+    m_source_gain_width = m_source_width.load();
+    const float x = m_smooth_x.getCurrentValue();
+    const float y = m_smooth_y.getCurrentValue();
+    for (int source = 0; source < num_sources; ++source)
+    {
+        const float source_x = juce::jlimit(0.0f, 1.0f, x + PanningUtils::source_offset(source, num_sources, m_source_gain_width));
+        m_source_gains[static_cast<size_t>(source)] = PanningUtils::compute_cleat_gains(source_x, y, gain_power);
+    }
 }
 
+void CLEATPanner::process_multichannel(const float* const* inputs, int num_sources, float* const* output_channel_data,
+                                       int num_samples, float gain_power, int interval)
+{
+    // A new source layout, gain power or width jumps instead of ramping
+    if (num_sources != m_num_sources || gain_power != m_control_gain_power
+        || m_source_width.load() != m_source_gain_width)
+        reset_source_gains(num_sources, gain_power);
+
+    std::array<float*, 16> outputs{};
+    int sample = 0;
+    while (sample < num_samples)
+    {
+        const int remaining = num_samples - sample;
+        for (int channel = 0; channel < 16; ++channel)
+            outputs[static_cast<size_t>(channel)] = output_channel_data[channel] != nullptr
+                                                  ? output_channel_data[channel] + sample
+                                                  : nullptr;
+
+        // Settled pan: every source keeps its gains for the rest of the block
+        if (!m_smooth_x.isSmoothing() && !m_smooth_y.isSmoothing())
+        {
+            for (int source = 0; source < num_sources; ++source)
+            {
+                const auto& gains = m_source_gains[static_cast<size_t>(source)];
+                PanningUtils::fan_out_gain_ramp(inputs[source] + sample, outputs.data(), 16,
+                                                gains.data(), gains.data(), remaining);
+            }
+            break;
+        }
+
+        // Moving pan: one position per segment, shared by every source
+        const int segment = juce::jmin(juce::jmax(1, interval), remaining);
+        const float x = m_smooth_x.skip(segment);
+        const float y = m_smooth_y.skip(segment);
+        for (int source = 0; source < num_sources; ++source)
+        {
+            auto& gains = m_source_gains[static_cast<size_t>(source)];
+            const float source_x = juce::jlimit(0.0f, 1.0f, x + PanningUtils::source_offset(source, num_sources, m_source_gain_width));
+            const auto target = PanningUtils::compute_cleat_gains(source_x, y, gain_power);
+            PanningUtils::fan_out_gain_ramp(inputs[source] + sample, outputs.data(), 16,
+                                            gains.data(), target.data(), segment);
+            gains = target;
+        }
+        sample += segment;
+    }
+}
@@ -3,6 +3,7 @@
 #include "Panner.h"
 #include "PanningUtils.h"
 #include <juce_dsp/juce_dsp.h>
+#include <array>
 #include <atomic>
 
 // CLEAT panner: processes mono input to 16-channel output (4x4 grid)
@@ -10,6 +11,8 @@
 // x: 0.0 = left, 1.0 = right
 // y: 0.0 = bottom, 1.0 = top
 // Channels are arranged row-major: channels 0-3 = bottom row left-to-right
+// Multichannel input is spread along x (see Panner) and always runs at
+// control rate, one gain ramp per source channel.
 class CLEATPanner : public Panner
 {
 public:
@@ -42,7 +45,24 @@ public:
     void set_gain_power(float power);
     float get_gain_power() const { return m_gain_power.load(); }
 
+    // Gain update interval in samples. 1 recomputes the 16 gains every sample
+    // (the reference path). Larger values recompute them at control rate while
+    // the pan is moving and ramp linearly in between; a settled pan reuses the
+    // last gains for the whole block.
+    static constexpr int kDefaultGainUpdateInterval = 16;
+    static constexpr int kMaxGainUpdateInterval = 256;
+    void set_gain_update_interval(int num_samples);
+    int get_gain_update_interval() const { return m_gain_update_interval.load(); }
+
 private:
+    void process_per_sample(const float* input, float* const* output_channel_data, int num_samples, float gain_power);
+    void process_control_rate(const float* input, float* const* output_channel_data, int num_samples,
+                              float gain_power, int interval);
+    void process_multichannel(const float* const* inputs, int num_sources, float* const* output_channel_data,
+                              int num_samples, float gain_power, int interval);
+    void reset_control_gains();
+    void reset_source_gains(int num_sources, float gain_power);
+
     std::atomic<float> m_pan_x{0.5f}; // Default to center
     std::atomic<float> m_pan_y{0.5f}; // Default to center
     
@@ -50,5 +70,15 @@ private:
     juce::SmoothedValue<float> m_smooth_y{0.5f}; // Smoothed y position
     
     std::atomic<float> m_gain_power{1.0f}; // Gain power factor (default 1.0 = no change)
+    std::atomic<int> m_gain_update_interval{kDefaultGainUpdateInterval};
+
+    // Gains at the last control point (audio thread only)
+    std::array<float, 16> m_control_gains{};
+    float m_control_gain_power{1.0f};
+
+    // Per-source gains at the last control point for multichannel input
+    std::array<std::array<float, 16>, kMaxSourceChannels> m_source_gains{};
+    int m_num_sources{1};
+    float m_source_gain_width{1.0f};
 };
 
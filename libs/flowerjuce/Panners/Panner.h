@@ -1,12 +1,20 @@
 #pragma once
 
 #include <juce_core/juce_core.h>
+#include <atomic>
 
 // Base interface for audio panners (UGens)
 // A Panner processes audio blocks with N input channels and M output channels
+//
+// Panners are written for a mono source. Given more input channels (a stereo
+// tape, say) they place each one as its own source, spread evenly across
+// source_width around the pan position along x, so a stereo source at the
+// centre with width 1 keeps its left and right sides.
 class Panner
 {
 public:
+    static constexpr int kMaxSourceChannels = 8; // Further input channels are ignored
+
     virtual ~Panner() = default;
 
     // Process a block of audio samples
@@ -26,5 +34,12 @@ public:
 
     // Get the number of output channels this panner produces
     virtual int get_num_output_channels() const = 0;
+
+    // Spread of multichannel sources in pan units (0 = all at the pan position, 1 = full width)
+    void set_source_width(float width) { m_source_width.store(juce::jlimit(0.0f, 1.0f, width)); }
+    float get_source_width() const { return m_source_width.load(); }
+
+protected:
+    std::atomic<float> m_source_width{1.0f};
 };
 
@@ -439,6 +439,30 @@ void Panner2DComponent::advance_trajectory_onset()
     update_pan_position_with_smoothing(offset_x, offset_y);
 }
 
+void Panner2DComponent::advance_trajectory_onset(juce::int64 onset_sample_position, double sample_rate)
+{
+    if (m_has_onset_position && onset_sample_position <= m_last_onset_position)
+        return;
+    
+    const bool has_previous = m_has_onset_position;
+    const double interval_seconds = (has_previous && sample_rate > 0.0)
+        ? static_cast<double>(onset_sample_position - m_last_onset_position) / sample_rate
+        : 0.0;
+    m_last_onset_position = onset_sample_position;
+    m_has_onset_position = true;
+    
+    // Land the previous glide before starting the next one
+    if (has_previous && m_smoothing_time > 0.0 && interval_seconds < m_smoothing_time)
+    {
+        m_smoothed_pan_x.setCurrentAndTargetValue(m_smoothed_pan_x.getTargetValue());
+        m_smoothed_pan_y.setCurrentAndTargetValue(m_smoothed_pan_y.getTargetValue());
+        m_pan_x = m_smoothed_pan_x.getCurrentValue();
+        m_pan_y = m_smoothed_pan_y.getCurrentValue();
+    }
+    
+    advance_trajectory_onset();
+}
+
 void Panner2DComponent::advance_trajectory_timer()
 {
     if (m_recording_state != Playing || m_trajectory.empty())
@@ -52,6 +52,14 @@ public:
     // Advance trajectory playback by one step (called when onset detected with [o] enabled)
     void advance_trajectory_onset();
     
+    // Advance by one step for an onset at a sample-accurate stream position
+    // (e.g. SpectralFluxOnsetDetector::Onset::stream_position). Positions at or
+    // before the last consumed onset are ignored, so each onset advances once
+    // however the notifications are batched. When onsets come faster than the
+    // smoothing time, the previous glide is completed first so the pan stays
+    // locked to the onsets instead of lagging behind them.
+    void advance_trajectory_onset(juce::int64 onset_sample_position, double sample_rate);
+    
     // Advance trajectory playback by one step (for timer-based playback)
     void advance_trajectory_timer();
     
@@ -117,6 +125,10 @@ private:
     juce::SmoothedValue<float> m_smoothed_pan_y{0.5f};
     double m_last_sample_rate{44100.0};
     
+    // Last onset consumed by advance_trajectory_onset(position, sample_rate)
+    juce::int64 m_last_onset_position{0};
+    bool m_has_onset_position{false};
+    
     // Counter for periodic repaints when onset triggering is enabled
     int m_repaint_counter{0};
     
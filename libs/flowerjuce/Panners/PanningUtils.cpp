@@ -193,6 +193,57 @@ namespace PanningUtils
         
         return gains;
     }
+
+    float source_offset(int channel, int num_channels, float width)
+    {
+        if (num_channels <= 1)
+            return 0.0f;
+        return (static_cast<float>(channel) / static_cast<float>(num_channels - 1) - 0.5f) * width;
+    }
+
+    void fan_out_gain_ramp(const float* input,
+                           float* const* outputs,
+                           int num_outputs,
+                           const float* start_gains,
+                           const float* end_gains,
+                           int num_samples)
+    {
+        if (input == nullptr || num_samples <= 0)
+            return;
+
+        // Ramp fractions are shared by every channel; build them in batches
+        // so the scratch stays on the stack for any block size.
+        constexpr int kRampBatch = 64;
+        float ramp[kRampBatch];
+        const float inv_samples = 1.0f / static_cast<float>(num_samples);
+
+        for (int offset = 0; offset < num_samples; offset += kRampBatch)
+        {
+            const int count = std::min(kRampBatch, num_samples - offset);
+            for (int k = 0; k < count; ++k)
+                ramp[k] = static_cast<float>(offset + k + 1) * inv_samples;
+
+            const float* in = input + offset;
+            for (int channel = 0; channel < num_outputs; ++channel)
+            {
+                if (outputs[channel] == nullptr)
+                    continue;
+
+                float* out = outputs[channel] + offset;
+                const float start = start_gains[channel];
+                const float delta = end_gains[channel] - start;
+                if (delta == 0.0f)
+                {
+                    if (start != 0.0f)
+                        juce::FloatVectorOperations::addWithMultiply(out, in, start, count);
+                    continue;
+                }
+
+                for (int k = 0; k < count; ++k)
+                    out[k] += in[k] * (start + delta * ramp[k]);
+            }
+        }
+    }
     
     //==============================================================================
     // Path generation functions
@@ -46,6 +46,22 @@ namespace PanningUtils
     // gain_power: power factor for gain differences (default 1.0 = no change, higher = more contrast)
     // Returns: array of 16 gains (row-major: channels 0-3 = bottom row left-to-right)
     std::array<float, 16> compute_cleat_gains(float x, float y, float gain_power = 1.0f);
+
+    // Pan offset of source channel of num_channels spread evenly across width
+    // (first channel leftmost). A single channel sits at the pan position.
+    float source_offset(int channel, int num_channels, float width);
+
+    // Accumulate a mono signal into num_outputs channels with gains that ramp
+    // linearly from start_gains to end_gains: sample k uses
+    // start + (k + 1) / num_samples * (end - start), so the last sample lands
+    // exactly on end_gains. Null output channels are skipped. Each output
+    // channel is written in one pass over its contiguous samples.
+    void fan_out_gain_ramp(const float* input,
+                           float* const* outputs,
+                           int num_outputs,
+                           const float* start_gains,
+                           const float* end_gains,
+                           int num_samples);
     
     // Path generation functions for panner trajectories
     // All functions generate points in normalized 0-1 space (x, y)
@@ -38,6 +38,22 @@ void QuadPanner::process_block(const float* const* input_channel_data,
     // Get current pan position
     float x = m_pan_x.load();
     float y = m_pan_y.load();
+
+    if (num_input_channels > 1)
+    {
+        // Multichannel source: pan each channel on its own, spread along x
+        const int num_sources = juce::jmin(num_input_channels, kMaxSourceChannels);
+        const float width = m_source_width.load();
+        for (int source = 0; source < num_sources; ++source)
+        {
+            const float source_x = juce::jlimit(0.0f, 1.0f, x + PanningUtils::source_offset(source, num_sources, width));
+            const auto source_gains = PanningUtils::compute_quad_gains(source_x, y);
+            for (int channel = 0; channel < 4; ++channel)
+                juce::FloatVectorOperations::addWithMultiply(output_channel_data[channel], input_channel_data[source],
+                                                             source_gains[static_cast<size_t>(channel)], num_samples);
+        }
+        return;
+    }
     
     // Compute panning gains [FL, FR, BL, BR]
     auto gains = PanningUtils::compute_quad_gains(x, y);
@@ -29,6 +29,21 @@ void StereoPanner::process_block(const float* const* input_channel_data,
 
     // Get current pan position
     float pan = m_pan_position.load();
+
+    if (num_input_channels > 1)
+    {
+        // Multichannel source: pan each channel on its own around the pan position
+        const int num_sources = juce::jmin(num_input_channels, kMaxSourceChannels);
+        const float width = m_source_width.load();
+        for (int source = 0; source < num_sources; ++source)
+        {
+            const float source_pan = juce::jlimit(0.0f, 1.0f, pan + PanningUtils::source_offset(source, num_sources, width));
+            const auto [source_left, source_right] = PanningUtils::compute_stereo_gains(source_pan);
+            juce::FloatVectorOperations::addWithMultiply(output_channel_data[0], input_channel_data[source], source_left, num_samples);
+            juce::FloatVectorOperations::addWithMultiply(output_channel_data[1], input_channel_data[source], source_right, num_samples);
+        }
+        return;
+    }
     
     // Compute panning gains
     auto [left_gain, right_gain] = PanningUtils::compute_stereo_gains(pan);
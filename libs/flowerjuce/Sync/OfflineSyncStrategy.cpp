@@ -0,0 +1,71 @@
+#include "OfflineSyncStrategy.h"
+#include <cmath>
+
+namespace flower
+{
+
+OfflineSyncStrategy::OfflineSyncStrategy(double bpm)
+{
+    set_tempo(bpm);
+}
+
+void OfflineSyncStrategy::prepare(double sample_rate, int block_size)
+{
+    juce::ignoreUnused(block_size);
+    if (sample_rate > 0.0)
+        m_sample_rate = sample_rate;
+}
+
+double OfflineSyncStrategy::get_current_beat()
+{
+    return static_cast<double>(m_block_start_sample) * (m_bpm / 60.0) / m_sample_rate;
+}
+
+double OfflineSyncStrategy::get_tempo() const
+{
+    return m_bpm;
+}
+
+void OfflineSyncStrategy::set_tempo(double bpm)
+{
+    m_bpm = juce::jlimit(10.0, 999.0, bpm);
+}
+
+bool OfflineSyncStrategy::is_playing() const
+{
+    return m_playing;
+}
+
+void OfflineSyncStrategy::set_playing(bool playing)
+{
+    m_playing = playing;
+}
+
+void OfflineSyncStrategy::request_reset()
+{
+    m_block_start_sample = 0;
+    m_next_block_sample = 0;
+}
+
+void OfflineSyncStrategy::process(int num_samples, double sample_rate)
+{
+    if (!m_playing)
+        return;
+
+    if (sample_rate > 0.0)
+        m_sample_rate = sample_rate;
+
+    // The engine calls this before reading the beat, so the block that is
+    // about to run starts where the previous one ended.
+    m_block_start_sample = m_next_block_sample;
+    m_next_block_sample += num_samples;
+}
+
+double OfflineSyncStrategy::get_phase(double quantum) const
+{
+    if (quantum <= 0.0) return 0.0;
+    const double beat = static_cast<double>(m_block_start_sample) * (m_bpm / 60.0) / m_sample_rate;
+    return std::fmod(beat, quantum);
+}
+
+} // namespace flower
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "SyncInterface.h"
+#include <juce_core/juce_core.h>
+
+namespace flower
+{
+
+// Deterministic transport for offline renders. The beat is computed from a
+// sample count instead of being accumulated per block or read from Link, so
+// during a block get_current_beat() is the beat of that block's first sample
+// and a render sees the same timeline whatever block size it uses.
+// Single-threaded: only the thread driving the render should touch it.
+class OfflineSyncStrategy : public SyncInterface
+{
+public:
+    explicit OfflineSyncStrategy(double bpm);
+    ~OfflineSyncStrategy() override = default;
+
+    void prepare(double sample_rate, int block_size) override;
+    double get_current_beat() override;
+    double get_tempo() const override;
+    void set_tempo(double bpm) override;
+    bool is_playing() const override;
+    void set_playing(bool playing) override;
+    void request_reset() override;
+    void process(int num_samples, double sample_rate) override;
+    double get_phase(double quantum) const override;
+
+private:
+    double m_bpm{120.0};
+    double m_sample_rate{44100.0};
+    bool m_playing{true};
+    juce::int64 m_block_start_sample{0};
+    juce::int64 m_next_block_sample{0};
+};
+
+} // namespace flower
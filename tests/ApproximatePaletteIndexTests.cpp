@@ -0,0 +1,326 @@
+#include <juce_core/juce_core.h>
+#include <CLAP/ApproximatePaletteIndex.h>
+#include "TestUtils.h"
+#include <chrono>
+#include <random>
+
+using Unsound4All::ApproximatePaletteIndex;
+using Unsound4All::PaletteIndex;
+
+// The IVF-PQ index must agree with the exact scan when it probes every list
+// and reranks every row, survive a save/load round trip, refuse files that do
+// not belong to the palette, and reach high recall at a fraction of the exact
+// scan's cost. The benchmark sweeps probes and rerank depth on synthetic
+// clustered palettes and records recall@10 against latency.
+class ApproximatePaletteIndexTests : public juce::UnitTest
+{
+public:
+    ApproximatePaletteIndexTests() : juce::UnitTest("ApproximatePaletteIndexTests") {}
+
+    void runTest() override
+    {
+        beginTest("Probing everything matches the exact search");
+        testExhaustiveMatchesExact();
+
+        beginTest("Default options reach high recall");
+        testRecall();
+
+        beginTest("Save, load and palette integration");
+        testSaveLoad();
+
+        beginTest("Benchmark recall against latency");
+        benchmarkRecallLatency();
+    }
+
+private:
+    static constexpr int topK = 10;
+
+    juce::File tempDirectory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("ApproximatePaletteIndexTests");
+
+    // Embeddings form clusters (as sounds from the same source do): each row
+    // is a random cluster centre plus noise
+    static std::vector<float> clusteredEmbeddings(int numRows, int dimension, int numClusters, unsigned int seed)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::uniform_int_distribution<int> pickCluster(0, numClusters - 1);
+
+        std::vector<float> centres(static_cast<size_t>(numClusters) * static_cast<size_t>(dimension));
+        for (auto& value : centres)
+            value = normal(rng);
+
+        std::vector<float> rows(static_cast<size_t>(numRows) * static_cast<size_t>(dimension));
+        for (int row = 0; row < numRows; ++row)
+        {
+            const float* centre = centres.data() + static_cast<size_t>(pickCluster(rng)) * static_cast<size_t>(dimension);
+            float* values = rows.data() + static_cast<size_t>(row) * static_cast<size_t>(dimension);
+            for (int i = 0; i < dimension; ++i)
+                values[i] = centre[i] + 0.7f * normal(rng);
+        }
+        return rows;
+    }
+
+    // Queries near existing rows, like a text prompt close to a few sounds
+    static std::vector<std::vector<float>> makeQueries(const std::vector<float>& rows, int dimension, int count, unsigned int seed)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::uniform_int_distribution<int> pickRow(0, static_cast<int>(rows.size()) / dimension - 1);
+
+        std::vector<std::vector<float>> queries;
+        for (int q = 0; q < count; ++q)
+        {
+            const float* row = rows.data() + static_cast<size_t>(pickRow(rng)) * static_cast<size_t>(dimension);
+            std::vector<float> query(static_cast<size_t>(dimension));
+            for (int i = 0; i < dimension; ++i)
+                query[static_cast<size_t>(i)] = row[i] + 0.5f * normal(rng);
+            queries.push_back(query);
+        }
+        return queries;
+    }
+
+    static double recallAt(const std::vector<PaletteIndex::Match>& expected, const std::vector<PaletteIndex::Match>& found)
+    {
+        int hits = 0;
+        for (const auto& match : expected)
+            for (const auto& candidate : found)
+                if (candidate.chunkIndex == match.chunkIndex)
+                {
+                    ++hits;
+                    break;
+                }
+        return expected.empty() ? 1.0 : static_cast<double>(hits) / static_cast<double>(expected.size());
+    }
+
+    static ApproximatePaletteIndex::BuildOptions smallBuild()
+    {
+        ApproximatePaletteIndex::BuildOptions options;
+        options.maxTrainingRows = 4096;
+        return options;
+    }
+
+    void testExhaustiveMatchesExact()
+    {
+        // 37 is not a multiple of the subspace size, so the last subspace is padded
+        for (const int dimension : { 64, 37 })
+        {
+            const int numRows = 3000;
+            const auto rows = clusteredEmbeddings(numRows, dimension, 40, 1);
+            const PaletteIndex exact(rows.data(), numRows, dimension);
+            const auto approximate = ApproximatePaletteIndex::build(exact, smallBuild());
+            expect(approximate != nullptr);
+            if (approximate == nullptr)
+                return;
+            expectEquals(approximate->getNumSubspaces(), (dimension + 7) / 8);
+
+            ApproximatePaletteIndex::SearchOptions everything;
+            everything.probes = approximate->getNumLists();
+            everything.rerank = numRows;
+
+            bool same = true;
+            float maxError = 0.0f;
+            for (const auto& query : makeQueries(rows, dimension, 10, 2))
+            {
+                const auto expected = exact.search(query, topK);
+                const auto found = approximate->search(exact, query, topK, everything);
+                same = same && found.size() == expected.size();
+                for (size_t i = 0; same && i < found.size(); ++i)
+                {
+                    same = found[i].chunkIndex == expected[i].chunkIndex;
+                    maxError = juce::jmax(maxError, std::abs(found[i].similarity - expected[i].similarity));
+                }
+            }
+            expect(same, "same rows in the same order, dim " + juce::String(dimension));
+            expectLessThan(maxError, 1.0e-5f);
+        }
+    }
+
+    void testRecall()
+    {
+        const int numRows = 20000;
+        const int dimension = 64;
+        const auto rows = clusteredEmbeddings(numRows, dimension, 200, 3);
+        const PaletteIndex exact(rows.data(), numRows, dimension);
+        const auto approximate = ApproximatePaletteIndex::build(exact, smallBuild());
+        if (approximate == nullptr)
+        {
+            expect(false, "build failed");
+            return;
+        }
+
+        double recall = 0.0;
+        const auto queries = makeQueries(rows, dimension, 50, 4);
+        for (const auto& query : queries)
+            recall += recallAt(exact.search(query, topK), approximate->search(exact, query, topK, {}));
+        recall /= static_cast<double>(queries.size());
+        expectGreaterThan(recall, 0.9, "recall@10 with default options");
+
+        // Bad queries return nothing, as with the exact search
+        expect(approximate->search(exact, std::vector<float>(dimension - 1, 1.0f), topK, {}).empty());
+        expect(approximate->search(exact, std::vector<float>(dimension, 0.0f), topK, {}).empty());
+    }
+
+    static void writePalette(const juce::File& paletteDir, const std::vector<float>& rows, int numRows, int dimension)
+    {
+        paletteDir.deleteRecursively();
+        paletteDir.createDirectory();
+
+        juce::var metadata(new juce::DynamicObject());
+        juce::Array<juce::var> chunks;
+        for (int i = 0; i < numRows; ++i)
+        {
+            juce::var chunkInfo(new juce::DynamicObject());
+            chunkInfo.getDynamicObject()->setProperty("index", i);
+            chunkInfo.getDynamicObject()->setProperty("filename", "chunk_" + juce::String(i) + ".wav");
+            chunkInfo.getDynamicObject()->setProperty("sourceFileIndex", -1);
+            chunks.add(chunkInfo);
+        }
+        metadata.getDynamicObject()->setProperty("chunks", juce::var(chunks));
+        paletteDir.getChildFile("metadata.json").replaceWithText(juce::JSON::toString(metadata));
+
+        juce::FileOutputStream stream(paletteDir.getChildFile("embeddings.bin"));
+        const int32_t header[2] = { numRows, dimension };
+        stream.write(header, sizeof(header));
+        stream.write(rows.data(), rows.size() * sizeof(float));
+    }
+
+    void testSaveLoad()
+    {
+        const int numRows = 5000;
+        const int dimension = 64;
+        const auto rows = clusteredEmbeddings(numRows, dimension, 50, 5);
+        auto paletteDir = tempDirectory.getChildFile("ann_SOUND_PALETTE");
+        writePalette(paletteDir, rows, numRows, dimension);
+
+        // No index file yet: approximate requests fall back to the exact scan
+        auto withoutIndex = PaletteIndex::load(paletteDir);
+        expect(withoutIndex != nullptr && !withoutIndex->hasApproximateIndex());
+
+        const PaletteIndex exact(rows.data(), numRows, dimension);
+        const auto built = ApproximatePaletteIndex::build(exact, smallBuild());
+        auto indexFile = paletteDir.getChildFile(ApproximatePaletteIndex::kFileName);
+        expect(built != nullptr && built->save(indexFile));
+        expect(built->save(indexFile), "saving again replaces the file");
+
+        auto loaded = ApproximatePaletteIndex::load(indexFile, exact);
+        expect(loaded != nullptr);
+        if (loaded == nullptr)
+            return;
+        expectEquals(loaded->getNumLists(), built->getNumLists());
+
+        bool same = true;
+        const auto queries = makeQueries(rows, dimension, 10, 6);
+        for (const auto& query : queries)
+        {
+            const auto a = built->search(exact, query, topK, {});
+            const auto b = loaded->search(exact, query, topK, {});
+            same = same && a.size() == b.size();
+            for (size_t i = 0; same && i < a.size(); ++i)
+                same = a[i].chunkIndex == b[i].chunkIndex && a[i].similarity == b[i].similarity;
+        }
+        expect(same, "loaded index answers like the built one");
+
+        // The palette index picks the file up and uses it on request
+        auto palette = PaletteIndex::load(paletteDir);
+        expect(palette != nullptr && palette->hasApproximateIndex());
+        if (palette != nullptr)
+        {
+            const auto viaPalette = palette->search(queries[0], topK, PaletteIndex::SearchMode::Approximate);
+            const auto direct = built->search(exact, queries[0], topK, {});
+            expectEquals(static_cast<int>(viaPalette.size()), topK);
+            for (size_t i = 0; i < viaPalette.size() && i < direct.size(); ++i)
+                expectEquals(viaPalette[i].chunkIndex, direct[i].chunkIndex);
+        }
+
+        // Files for another palette, or cut short, are refused
+        const auto otherRows = clusteredEmbeddings(numRows - 1, dimension, 50, 7);
+        const PaletteIndex other(otherRows.data(), numRows - 1, dimension);
+        expect(ApproximatePaletteIndex::load(indexFile, other) == nullptr, "row count mismatch");
+
+        juce::MemoryBlock contents;
+        indexFile.loadFileAsData(contents);
+        indexFile.replaceWithData(contents.getData(), contents.getSize() / 2);
+        expect(ApproximatePaletteIndex::load(indexFile, exact) == nullptr, "truncated file");
+        auto fallback = PaletteIndex::load(paletteDir);
+        expect(fallback != nullptr && !fallback->hasApproximateIndex(), "unusable index is ignored");
+
+        tempDirectory.deleteRecursively();
+    }
+
+    void benchmarkPalette(TestUtils::CsvWriter& writer, int numRows, int dimension, double minDefaultRecall)
+    {
+        using Clock = std::chrono::steady_clock;
+        auto elapsedMs = [](Clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        };
+
+        const int numQueries = 100;
+        const auto rows = clusteredEmbeddings(numRows, dimension, numRows / 100, 8);
+        const auto queries = makeQueries(rows, dimension, numQueries, 9);
+        const PaletteIndex exact(rows.data(), numRows, dimension);
+
+        std::vector<std::vector<PaletteIndex::Match>> truth;
+        auto start = Clock::now();
+        for (const auto& query : queries)
+            truth.push_back(exact.search(query, topK));
+        const double exactMs = elapsedMs(start) / numQueries;
+        writer.writeRow(numRows, dimension, "exact", 0, 0, 1.0, exactMs, 0.0);
+
+        start = Clock::now();
+        const auto approximate = ApproximatePaletteIndex::build(exact, {});
+        const double buildSeconds = elapsedMs(start) / 1000.0;
+        if (approximate == nullptr)
+        {
+            expect(false, "build failed");
+            return;
+        }
+
+        juce::String summary = juce::String(numRows) + " x " + juce::String(dimension) + ": exact "
+                             + juce::String(exactMs, 2) + " ms, build " + juce::String(buildSeconds, 1) + " s";
+        // Probes 0 is the default, which scales with the number of lists
+        for (const int rerank : { 128, 512 })
+        {
+            for (const int probes : { 0, 1, 2, 4, 8, 16, 32, 64, 128 })
+            {
+                ApproximatePaletteIndex::SearchOptions options;
+                options.probes = probes;
+                options.rerank = rerank;
+
+                double recall = 0.0;
+                start = Clock::now();
+                for (size_t q = 0; q < queries.size(); ++q)
+                    recall += recallAt(truth[q], approximate->search(exact, queries[q], topK, options));
+                const double ms = elapsedMs(start) / numQueries;
+                recall /= numQueries;
+
+                const int probed = probes > 0 ? probes : approximate->getDefaultProbes();
+                writer.writeRow(numRows, dimension, probes > 0 ? "ivfpq" : "ivfpq_default", probed, rerank, recall, ms, buildSeconds);
+                summary << "\n  rerank " << rerank << ", probes " << probed << (probes > 0 ? "" : " (default)")
+                        << ": recall@10 " << juce::String(recall, 3) << ", " << juce::String(ms, 3) << " ms";
+                if (probes == 0 && rerank == ApproximatePaletteIndex::SearchOptions{}.rerank)
+                    expectGreaterThan(recall, minDefaultRecall, "default recall at " + juce::String(numRows) + " rows");
+            }
+        }
+        logMessage(summary);
+    }
+
+    void benchmarkRecallLatency()
+    {
+        TestUtils::CsvWriter writer("approximate_palette_search_benchmark",
+                                    {"Rows", "Dimension", "Method", "Probes", "Rerank", "Recall_at_10", "Ms_per_query", "Build_seconds"});
+
+        // CLAP-sized rows, then a million rows at a dimension that fits in memory here
+        benchmarkPalette(writer, 100000, 512, 0.95);
+        benchmarkPalette(writer, 1000000, 64, 0.8);
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    ApproximatePaletteIndexTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
@@ -0,0 +1,351 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <flowerjuce/LooperEngine/LooperTrackEngine.h>
+#include <flowerjuce/LooperEngine/AudioFileLoader.h>
+#include <flowerjuce/Panners/CLEATPanner.h>
+#include "TestUtils.h"
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+// Files load off the audio thread: the loader decodes in chunks on its own
+// pool, downmixes and converts to the tape rate, and the track swaps the new
+// loop in whole. Checks the converted content, cancellation, and that the
+// audio callback keeps its timing while a long file decodes.
+class AudioFileLoaderTests : public juce::UnitTest
+{
+public:
+    AudioFileLoaderTests() : juce::UnitTest("AudioFileLoaderTests") {}
+
+    void runTest() override
+    {
+        beginTest("Stereo file is downmixed");
+        testDownmix();
+
+        beginTest("File is converted to the tape rate");
+        testRateConversion();
+
+        beginTest("A new load cancels the previous one");
+        testCancellation();
+
+        beginTest("Missing or unreadable files fail straight away");
+        testBadFiles();
+
+        beginTest("Audio callback keeps running during a load");
+        testCallbackDuringLoad();
+
+        beginTest("Benchmark load throughput");
+        benchmarkLoading();
+    }
+
+private:
+    static constexpr int blockSize = 256;
+    static constexpr int numOutputs = 16;
+    static constexpr double leftFrequency = 441.0;
+    static constexpr double rightFrequency = 1000.0;
+
+    static float leftSample(double time) { return static_cast<float>(0.5 * std::sin(juce::MathConstants<double>::twoPi * leftFrequency * time)); }
+    static float rightSample(double time) { return static_cast<float>(0.3 * std::sin(juce::MathConstants<double>::twoPi * rightFrequency * time)); }
+    static float monoSample(double time) { return 0.5f * (leftSample(time) + rightSample(time)); }
+
+    juce::File tempDirectory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("AudioFileLoaderTests");
+
+    // Stereo 32-bit float WAV, so decoding is exact
+    juce::File writeStereoFile(const juce::String& name, double sampleRate, double seconds)
+    {
+        tempDirectory.createDirectory();
+        auto file = tempDirectory.getChildFile(name);
+        file.deleteFile();
+
+        const int length = static_cast<int>(seconds * sampleRate);
+        juce::AudioBuffer<float> audio(2, length);
+        for (int i = 0; i < length; ++i)
+        {
+            const double time = static_cast<double>(i) / sampleRate;
+            audio.setSample(0, i, leftSample(time));
+            audio.setSample(1, i, rightSample(time));
+        }
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::OutputStream> stream = std::make_unique<juce::FileOutputStream>(file);
+        auto options = juce::AudioFormatWriterOptions{}.withSampleRate(sampleRate)
+                                                       .withNumChannels(2)
+                                                       .withBitsPerSample(32);
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream, options));
+        expect(writer != nullptr);
+        if (writer != nullptr)
+            writer->writeFromAudioSampleBuffer(audio, 0, length);
+        return file;
+    }
+
+    // Generated mono reader that sleeps on every read, so a load is still
+    // running when the test acts on it
+    class SlowReader : public juce::AudioFormatReader
+    {
+    public:
+        SlowReader(float value, juce::int64 length, int sleepMs)
+            : juce::AudioFormatReader(nullptr, "SlowReader"), m_value(value), m_sleep_ms(sleepMs)
+        {
+            sampleRate = 48000.0;
+            bitsPerSample = 32;
+            lengthInSamples = length;
+            numChannels = 1;
+            usesFloatingPointData = true;
+        }
+
+        bool readSamples(int* const* destChannels, int numDestChannels, int startOffsetInDestBuffer,
+                         juce::int64, int numSamples) override
+        {
+            juce::Thread::sleep(m_sleep_ms);
+            for (int channel = 0; channel < numDestChannels; ++channel)
+                if (destChannels[channel] != nullptr)
+                    juce::FloatVectorOperations::fill(reinterpret_cast<float*>(destChannels[channel]) + startOffsetInDestBuffer,
+                                                      m_value, numSamples);
+            return true;
+        }
+
+    private:
+        float m_value;
+        int m_sleep_ms;
+    };
+
+    struct Track
+    {
+        LooperTrackEngine engine;
+        CLEATPanner panner;
+        juce::AudioBuffer<float> input{1, blockSize};
+        juce::AudioBuffer<float> output{numOutputs, blockSize};
+
+        explicit Track(double sampleRate, double seconds = 10.0)
+        {
+            engine.initialize(sampleRate, seconds);
+            engine.audio_device_about_to_start(sampleRate, blockSize);
+            panner.prepare(sampleRate);
+            engine.set_panner(&panner);
+            input.clear();
+        }
+
+        void process()
+        {
+            output.clear();
+            engine.process_block(input.getArrayOfReadPointers(), 1, output.getArrayOfWritePointers(), numOutputs, blockSize);
+        }
+    };
+
+    void testDownmix()
+    {
+        const auto file = writeStereoFile("downmix.wav", 48000.0, 2.0);
+        Track track(48000.0);
+
+        std::atomic<int> calls{0};
+        std::atomic<bool> succeeded{false};
+        expect(track.engine.load_from_file(file, [&](bool ok) { succeeded = ok; ++calls; }));
+        expect(track.engine.wait_for_load(5000));
+        expectEquals(calls.load(), 1);
+        expect(succeeded.load());
+        expectEquals(track.engine.get_load_progress(), 1.0f);
+
+        expectEquals(track.engine.get_recorded_length(), static_cast<size_t>(96000));
+        expectEquals(track.engine.get_loop_end(), static_cast<size_t>(96000));
+        expect(track.engine.has_recorded());
+
+        float maxError = 0.0f;
+        for (size_t i = 0; i < 96000; ++i)
+            maxError = juce::jmax(maxError, std::abs(track.engine.get_sample(i) - monoSample(static_cast<double>(i) / 48000.0)));
+        expectLessThan(maxError, 1.0e-6f);
+        expectEquals(track.engine.get_sample(96000), 0.0f);
+    }
+
+    void testRateConversion()
+    {
+        const auto file = writeStereoFile("convert.wav", 44100.0, 2.0);
+        Track track(48000.0);
+        expect(track.engine.load_from_file(file));
+        expect(track.engine.wait_for_load(5000));
+
+        expectEquals(track.engine.get_recorded_length(), static_cast<size_t>(96000));
+
+        // Away from the zero-padded edges the loop is the same music at 48 kHz
+        float maxError = 0.0f;
+        for (size_t i = 200; i < 96000 - 200; ++i)
+            maxError = juce::jmax(maxError, std::abs(track.engine.get_sample(i) - monoSample(static_cast<double>(i) / 48000.0)));
+        expectLessThan(maxError, 1.0e-3f);
+
+        // A file longer than the tape is cut at the tape length, still converted
+        const auto longFile = writeStereoFile("long.wav", 44100.0, 3.0);
+        Track shortTrack(48000.0, 1.0);
+        expect(shortTrack.engine.load_from_file(longFile));
+        expect(shortTrack.engine.wait_for_load(5000));
+        expectEquals(shortTrack.engine.get_recorded_length(), static_cast<size_t>(48000));
+        maxError = 0.0f;
+        for (size_t i = 200; i < 48000; ++i)
+            maxError = juce::jmax(maxError, std::abs(shortTrack.engine.get_sample(i) - monoSample(static_cast<double>(i) / 48000.0)));
+        expectLessThan(maxError, 1.0e-3f, "decoded past the cut, so no edge at the end");
+    }
+
+    void testCancellation()
+    {
+        AudioFileLoader::Client client;
+        std::atomic<int> firstCalls{0};
+        std::atomic<int> secondCalls{0};
+        std::vector<float> loaded;
+
+        // 100 chunks at 10 ms each: about a second if it were left to run
+        AudioFileLoader::Request first;
+        first.reader = std::make_unique<SlowReader>(0.25f, 100 * AudioFileLoader::kDecodeChunkFrames, 10);
+        first.target_sample_rate = 48000.0;
+        first.max_length = first.capacity = static_cast<size_t>(first.reader->lengthInSamples);
+        client.load(std::move(first), [&](AudioFileLoader::Result&) { ++firstCalls; });
+
+        juce::Thread::sleep(30);
+        expect(client.is_loading());
+        const float midProgress = client.get_progress();
+        expect(midProgress > 0.0f && midProgress < 1.0f, "progress while decoding: " + juce::String(midProgress));
+
+        AudioFileLoader::Request second;
+        second.reader = std::make_unique<SlowReader>(0.75f, 1000, 0);
+        second.target_sample_rate = 48000.0;
+        second.max_length = second.capacity = 2000;
+        const auto start = std::chrono::steady_clock::now();
+        client.load(std::move(second), [&](AudioFileLoader::Result& result)
+        {
+            ++secondCalls;
+            expect(result.ok);
+            loaded = std::move(result.channels[0]);
+        });
+        const double switchMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        logMessage("Switching loads took " + juce::String(switchMs, 1) + " ms");
+        expectLessThan(switchMs, 500.0);
+
+        expect(client.wait_until_done(5000));
+        expectEquals(firstCalls.load(), 0);
+        expectEquals(secondCalls.load(), 1);
+        expectEquals(static_cast<int>(loaded.size()), 2000);
+        expectEquals(loaded[999], 0.75f);
+        expectEquals(loaded[1000], 0.0f);
+        expectEquals(client.get_progress(), 1.0f);
+
+        // Dropping the client mid-load cancels without running the completion
+        {
+            AudioFileLoader::Client doomed;
+            AudioFileLoader::Request request;
+            request.reader = std::make_unique<SlowReader>(0.5f, 100 * AudioFileLoader::kDecodeChunkFrames, 10);
+            request.target_sample_rate = 48000.0;
+            request.max_length = request.capacity = static_cast<size_t>(request.reader->lengthInSamples);
+            doomed.load(std::move(request), [&](AudioFileLoader::Result&) { ++firstCalls; });
+            juce::Thread::sleep(20);
+        }
+        expectEquals(firstCalls.load(), 0);
+    }
+
+    void testBadFiles()
+    {
+        Track track(48000.0);
+        expect(!track.engine.load_from_file(tempDirectory.getChildFile("missing.wav")));
+
+        tempDirectory.createDirectory();
+        auto junk = tempDirectory.getChildFile("junk.wav");
+        junk.replaceWithText("not audio");
+        expect(!track.engine.load_from_file(junk));
+        expect(!track.engine.is_loading());
+    }
+
+    struct CallbackStats
+    {
+        double maxMs{0.0};
+        int blocks{0};
+        bool sawOldLoop{false};
+    };
+
+    // Runs the audio callback in real time on a thread while file loads into the track
+    CallbackStats runCallbackDuringLoad(Track& track, const juce::File& file, double& loadMs)
+    {
+        // Start from an existing loop so the old one must keep playing until the swap
+        auto& tape = track.engine.get_tape_loop();
+        for (size_t i = 0; i < 48000; ++i)
+            *tape.get_writable_sample(i) = 0.1f;
+        track.engine.set_recorded_length(48000);
+        track.engine.set_has_recorded(true);
+        track.engine.set_loop_end(48000);
+        track.engine.set_playing(true);
+
+        CallbackStats stats;
+        std::atomic<bool> running{true};
+        std::thread audio([&]
+        {
+            const auto blockDuration = std::chrono::duration<double>(blockSize / 48000.0);
+            auto next = std::chrono::steady_clock::now();
+            while (running.load())
+            {
+                const auto start = std::chrono::steady_clock::now();
+                track.process();
+                const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                stats.maxMs = juce::jmax(stats.maxMs, ms);
+                ++stats.blocks;
+                stats.sawOldLoop = stats.sawOldLoop || track.output.getMagnitude(0, blockSize) > 0.0f;
+                next += std::chrono::duration_cast<std::chrono::steady_clock::duration>(blockDuration);
+                std::this_thread::sleep_until(next);
+            }
+        });
+
+        juce::Thread::sleep(20);
+        const auto start = std::chrono::steady_clock::now();
+        expect(track.engine.load_from_file(file));
+        expect(track.engine.wait_for_load(20000));
+        loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        juce::Thread::sleep(20);
+        running = false;
+        audio.join();
+        return stats;
+    }
+
+    void testCallbackDuringLoad()
+    {
+        const auto file = writeStereoFile("realtime.wav", 44100.0, 30.0);
+        Track track(48000.0, 30.0);
+        double loadMs = 0.0;
+        const auto stats = runCallbackDuringLoad(track, file, loadMs);
+
+        logMessage("30 s file loaded in " + juce::String(loadMs, 1) + " ms; " + juce::String(stats.blocks)
+                   + " callbacks, slowest " + juce::String(stats.maxMs, 3) + " ms");
+        expectGreaterThan(stats.blocks, 0);
+        expect(stats.sawOldLoop, "old loop played while the file decoded");
+        expectLessThan(stats.maxMs, 1000.0 * blockSize / 48000.0, "callback stayed within its block period");
+        expectEquals(track.engine.get_recorded_length(), static_cast<size_t>(30 * 48000));
+    }
+
+    void benchmarkLoading()
+    {
+        TestUtils::CsvWriter writer("file_load_benchmark",
+                                    {"Source_rate", "Tape_rate", "Audio_seconds", "Load_ms", "Realtime_factor",
+                                     "Callbacks_during_load", "Max_callback_ms"});
+
+        const std::array<std::pair<double, double>, 3> rates{ { { 48000.0, 48000.0 }, { 44100.0, 48000.0 }, { 96000.0, 48000.0 } } };
+        const double seconds = 60.0;
+        for (const auto& [source, target] : rates)
+        {
+            const auto file = writeStereoFile("benchmark.wav", source, seconds);
+            Track track(target, seconds);
+            double loadMs = 0.0;
+            const auto stats = runCallbackDuringLoad(track, file, loadMs);
+
+            const double factor = seconds * 1000.0 / loadMs;
+            writer.writeRow(source, target, seconds, loadMs, factor, stats.blocks, stats.maxMs);
+            logMessage(juce::String(source) + " -> " + juce::String(target) + ": " + juce::String(loadMs, 1)
+                       + " ms for " + juce::String(seconds, 0) + " s (" + juce::String(factor, 0)
+                       + "x realtime), slowest callback " + juce::String(stats.maxMs, 3) + " ms");
+        }
+
+        tempDirectory.deleteRecursively();
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    AudioFileLoaderTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
@@ -0,0 +1,455 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <flowerjuce/LayerCakeEngine/LayerCakeEngine.h>
+#include <flowerjuce/Sync/InternalSyncStrategy.h>
+#include <flowerjuce/Debug/AudioAllocationGuard.h>
+#include "TestUtils.h"
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+// Engine-level LayerCake checks: grain scheduling, the voice pool, LFO handoff,
+// the modulation matrix and offline rendering.
+class LayerCakeEngineTests : public juce::UnitTest
+{
+public:
+    LayerCakeEngineTests() : juce::UnitTest("LayerCakeEngineTests") {}
+
+    void runTest() override
+    {
+        beginTest("Immediate grain starts at block start");
+        testImmediateGrain();
+
+        beginTest("Sample-timestamped grain starts on its sample");
+        testSampleScheduledGrain();
+
+        beginTest("Beat-timestamped grain starts on its beat");
+        testBeatScheduledGrain();
+
+        beginTest("Late timestamp starts at next block");
+        testLateGrain();
+
+        beginTest("Voice pool size");
+        testVoicePoolSize();
+
+        beginTest("Steal fades instead of cutting");
+        testStealFade();
+
+        beginTest("Same-layer steal policy");
+        testSameLayerPolicy();
+
+        beginTest("Steals per second");
+        testStealRate();
+
+        beginTest("LFO config handoff");
+        testLfoHandoff();
+
+        beginTest("LFO copies and steps do not allocate");
+        testLfoCopyDoesNotAllocate();
+
+        beginTest("Modulation law");
+        testModulationLaw();
+
+        beginTest("Headless modulation of manual grains");
+        testHeadlessModulation();
+
+        beginTest("Offline render is deterministic");
+        testOfflineRenderDeterminism();
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 1024;
+
+    void prepareEngine(LayerCakeEngine& engine, bool transportPlaying)
+    {
+        auto sync = std::make_unique<flower::InternalSyncStrategy>();
+        sync->set_tempo(120.0);
+        sync->set_playing(transportPlaying);
+        engine.set_sync_strategy(std::move(sync));
+        engine.prepare(sampleRate, blockSize, 2);
+
+        // Constant layers so any active grain shows up as non-zero output.
+        LayerBufferSnapshot snapshot;
+        snapshot.samples.assign(static_cast<size_t>(sampleRate), 1.0f);
+        snapshot.recorded_length = snapshot.samples.size();
+        snapshot.has_audio = true;
+        engine.apply_layer_snapshot(0, snapshot);
+        engine.apply_layer_snapshot(1, snapshot);
+    }
+
+    GrainState makeGrain(float durationMs = 100.0f)
+    {
+        GrainState state;
+        state.loop_start_seconds = 0.0f;
+        state.duration_ms = durationMs;
+        state.env_attack_ms = 1.0f;
+        state.env_release_ms = durationMs; // decay stage sets how long the grain rings
+        state.layer = 0;
+        state.pan = 0.5f;
+        return state;
+    }
+
+    // Runs num_blocks blocks and returns the first sample with output, or -1.
+    int renderAndFindOnset(LayerCakeEngine& engine, int numBlocks)
+    {
+        juce::AudioBuffer<float> output(2, blockSize);
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            engine.process_block(nullptr, 0, output.getArrayOfWritePointers(), 2, blockSize);
+            const float* left = output.getReadPointer(0);
+            for (int i = 0; i < blockSize; ++i)
+            {
+                if (std::abs(left[i]) > 0.0f)
+                    return block * blockSize + i;
+            }
+        }
+        return -1;
+    }
+
+    void testImmediateGrain()
+    {
+        LayerCakeEngine engine;
+        prepareEngine(engine, false);
+
+        engine.trigger_grain(makeGrain());
+        expectEquals(renderAndFindOnset(engine, 2), 0);
+    }
+
+    void testSampleScheduledGrain()
+    {
+        LayerCakeEngine engine;
+        prepareEngine(engine, false);
+
+        // Spans a block boundary to make sure the grain is held across blocks.
+        const int target = blockSize + 437;
+        auto state = makeGrain();
+        state.start_sample = engine.get_sample_clock() + target;
+        engine.trigger_grain(state);
+
+        expectEquals(renderAndFindOnset(engine, 4), target);
+    }
+
+    void testBeatScheduledGrain()
+    {
+        LayerCakeEngine engine;
+        prepareEngine(engine, true);
+
+        // 120 bpm at 48 kHz: beat 0.25 is 6000 samples in. The internal clock
+        // advances before the engine reads it, so the first block already
+        // reports one block of beats.
+        auto state = makeGrain();
+        state.start_beat = 0.25;
+        engine.trigger_grain(state);
+
+        const int onset = renderAndFindOnset(engine, 8);
+        expectWithinAbsoluteError(onset, 6000 - blockSize, 1);
+    }
+
+    void testLateGrain()
+    {
+        LayerCakeEngine engine;
+        prepareEngine(engine, false);
+
+        juce::AudioBuffer<float> output(2, blockSize);
+        engine.process_block(nullptr, 0, output.getArrayOfWritePointers(), 2, blockSize);
+
+        auto state = makeGrain();
+        state.start_sample = 10; // already played
+        engine.trigger_grain(state);
+
+        expectEquals(renderAndFindOnset(engine, 2), 0);
+    }
+
+    void renderBlocks(LayerCakeEngine& engine, int numBlocks)
+    {
+        juce::AudioBuffer<float> output(2, blockSize);
+        for (int block = 0; block < numBlocks; ++block)
+            engine.process_block(nullptr, 0, output.getArrayOfWritePointers(), 2, blockSize);
+    }
+
+    void testVoicePoolSize()
+    {
+        LayerCakeEngine engine;
+        prepareEngine(engine, false);
+        engine.set_num_voices(64);
+
+        for (int i = 0; i < 64; ++i)
+            engine.trigger_grain(makeGrain(500.0f));
+        renderBlocks(engine, 1);
+
+        std::vector<GrainVisualState> grains;
+        engine.get_active_grains(grains);
+        expectEquals(static_cast<int>(grains.size()), 64);
+        expectEquals(static_cast<int>(engine.get_total_steals()), 0);
+
+        engine.trigger_grain(makeGrain(500.0f));
+        renderBlocks(engine, 1);
+        engine.get_active_grains(grains);
+        expectEquals(static_cast<int>(grains.size()), 64);
+        expectEquals(static_cast<int>(engine.get_total_steals()), 1);
+    }
+
+    void testStealFade()
+    {
+        LayerCakeEngine engine;
+        prepareEngine(engine, false);
+        engine.set_num_voices(1);
+
+        engine.trigger_grain(makeGrain(500.0f));
+        renderBlocks(engine, 2);
+
+        // The new grain starts at zero, so a hard stop would drop the output
+        // to almost nothing on the first sample of the block.
+        engine.trigger_grain(makeGrain(500.0f));
+        juce::AudioBuffer<float> output(2, blockSize);
+        engine.process_block(nullptr, 0, output.getArrayOfWritePointers(), 2, blockSize);
+
+        const float* left = output.getReadPointer(0);
+        float minimum = left[0];
+        for (int i = 0; i < GrainVoice::kStealFadeSamples; ++i)
+            minimum = juce::jmin(minimum, left[i]);
+
+        expectEquals(static_cast<int>(engine.get_total_steals()), 1);
+        expectGreaterThan(minimum, 0.3f);
+    }
+
+    void testSameLayerPolicy()
+    {
+        for (auto policy : { VoiceStealPolicy::Oldest, VoiceStealPolicy::SameLayer })
+        {
+            LayerCakeEngine engine;
+            prepareEngine(engine, false);
+            engine.set_num_voices(2);
+            engine.set_steal_policy(policy);
+
+            auto first = makeGrain(500.0f);
+            first.layer = 0;
+            auto second = makeGrain(500.0f);
+            second.layer = 1;
+            engine.trigger_grain(first);
+            engine.trigger_grain(second);
+            renderBlocks(engine, 1);
+
+            auto third = makeGrain(500.0f);
+            third.layer = 1;
+            engine.trigger_grain(third);
+            renderBlocks(engine, 1);
+
+            std::vector<GrainVisualState> grains;
+            engine.get_active_grains(grains);
+            int layerZeroGrains = 0;
+            for (const auto& grain : grains)
+                layerZeroGrains += grain.layer == 0 ? 1 : 0;
+
+            // Oldest steals the layer 0 grain; SameLayer keeps it and replaces layer 1.
+            expectEquals(static_cast<int>(grains.size()), 2);
+            expectEquals(layerZeroGrains, policy == VoiceStealPolicy::SameLayer ? 1 : 0);
+        }
+    }
+
+    void testStealRate()
+    {
+        LayerCakeEngine engine;
+        prepareEngine(engine, false);
+        engine.set_num_voices(1);
+
+        // One steal per block for a bit over a second.
+        const int numBlocks = static_cast<int>(sampleRate) / blockSize + 2;
+        engine.trigger_grain(makeGrain(5000.0f));
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            engine.trigger_grain(makeGrain(5000.0f));
+            renderBlocks(engine, 1);
+        }
+
+        const float expectedRate = static_cast<float>(sampleRate / blockSize);
+        expectWithinAbsoluteError(engine.get_steals_per_second(), expectedRate, 2.0f);
+    }
+
+    void testLfoHandoff()
+    {
+        LayerCakeEngine engine;
+        prepareEngine(engine, true);
+
+        flower::LayerCakeLfoUGen generator;
+        generator.set_mode(flower::LfoWaveform::Square);
+        generator.set_clock_division(1.0f);
+        generator.set_level(1.0f);
+
+        // Hammer the handoff from another thread while the audio side consumes.
+        std::atomic<bool> running{true};
+        std::thread writer([&]() {
+            flower::LayerCakeLfoUGen local = generator;
+            int iteration = 0;
+            while (running.load())
+            {
+                local.set_level(static_cast<float>(iteration++ % 10) * 0.1f);
+                engine.update_lfo_slot(0, local, true);
+            }
+        });
+        renderBlocks(engine, 200);
+        running.store(false);
+        writer.join();
+
+        // Last write wins once the audio thread has had a block to pick it up.
+        engine.update_lfo_slot(0, generator, false);
+        renderBlocks(engine, 1);
+        expectEquals(engine.get_lfo_visual_value(0), 0.0f);
+
+        engine.update_lfo_slot(0, generator, true);
+        renderBlocks(engine, 1);
+        expectWithinAbsoluteError(std::abs(engine.get_lfo_visual_value(0)), 1.0f, 1.0e-4f);
+    }
+
+    void testLfoCopyDoesNotAllocate()
+    {
+        expect(AudioAllocationGuard::is_enabled(), "AudioAllocationHooks.cpp is not linked in");
+        if (!AudioAllocationGuard::is_enabled())
+            return;
+
+        LayerCakeEngine engine;
+        prepareEngine(engine, true);
+
+        flower::LayerCakeLfoUGen generator;
+        generator.set_mode(flower::LfoWaveform::Random);
+        generator.set_pattern_length(16);
+        generator.set_pattern_buffer(std::vector<float>(16, 0.25f));
+
+        // A generative run steps well past the reserved cache length.
+        flower::LayerCakeLfoUGen generative;
+        generative.set_mode(flower::LfoWaveform::Random);
+        generative.set_clock_division(4.0f);
+
+        AudioAllocationGuard::reset_violation_count();
+        {
+            const AudioAllocationGuard guard;
+            engine.apply_lfo_slot_from_audio_thread(0, generator, true);
+            engine.apply_lfo_slot_from_audio_thread(1, generative, true);
+            for (int beat = 0; beat < 2 * flower::LayerCakeLfoUGen::kMaxPatternSteps; ++beat)
+                generative.advance_clocked(static_cast<double>(beat) * 0.5);
+        }
+        expectEquals(static_cast<int>(AudioAllocationGuard::get_violation_count()), 0, "LFO copy or step allocated");
+    }
+
+    void testModulationLaw()
+    {
+        const ModulationRange range{ -24.0f, 6.0f };
+        expectWithinAbsoluteError(ModulationMatrix::apply(0.0f, range, 0.0f), 0.0f, 1.0e-5f);
+        expectWithinAbsoluteError(ModulationMatrix::apply(0.0f, range, 1.0f), 6.0f, 1.0e-5f);   // clamped at max
+        expectWithinAbsoluteError(ModulationMatrix::apply(-9.0f, range, -1.0f), -24.0f, 1.0e-5f);
+        expectWithinAbsoluteError(ModulationMatrix::apply(-9.0f, range, 0.5f), -1.5f, 1.0e-5f);
+    }
+
+    void testHeadlessModulation()
+    {
+        // No UI anywhere: bases, routes and triggers all go straight to the engine.
+        LayerCakeEngine engine;
+        prepareEngine(engine, true);
+
+        flower::LayerCakeLfoUGen generator;
+        generator.set_mode(flower::LfoWaveform::Square);
+        generator.set_clock_division(1.0f);
+        generator.set_level(1.0f);
+        engine.update_lfo_slot(0, generator, true);
+
+        engine.set_modulation_base(ModulationTarget::Pan, 0.5f);
+        engine.set_modulation_base(ModulationTarget::Direction, 0.0f);
+        engine.set_modulation_route(ModulationTarget::Pan, 0);
+        renderBlocks(engine, 1);
+
+        engine.request_manual_trigger();
+        renderBlocks(engine, 1);
+
+        std::vector<GrainVisualState> grains;
+        engine.get_active_grains(grains);
+        expectEquals(static_cast<int>(grains.size()), 1);
+        if (!grains.empty())
+        {
+            // Square LFO at +/-1 pushes the centred pan hard to one side.
+            expectWithinAbsoluteError(std::abs(grains.front().pan - 0.5f), 0.5f, 1.0e-4f);
+            expectEquals(grains.front().layer, 0);
+        }
+
+        engine.set_modulation_route(ModulationTarget::Pan, -1);
+        engine.request_manual_trigger();
+        renderBlocks(engine, 1);
+        engine.get_active_grains(grains);
+        bool foundCentred = false;
+        for (const auto& grain : grains)
+            foundCentred = foundCentred || std::abs(grain.pan - 0.5f) < 1.0e-4f;
+        expect(foundCentred, "unrouted grain keeps the base pan");
+    }
+
+    // Renders a few beats of a random-LFO-triggered scene into an in-memory
+    // WAV and returns the file bytes.
+    juce::MemoryBlock renderOffline(juce::int64 seed, int renderBlockSize)
+    {
+        LayerCakeEngine engine;
+        prepareEngine(engine, true);
+
+        flower::LayerCakeLfoUGen trigger;
+        trigger.set_mode(flower::LfoWaveform::Square);
+        trigger.set_clock_division(4.0f);
+        engine.update_lfo_slot(0, trigger, true);
+        engine.set_trigger_lfo_index(0);
+
+        flower::LayerCakeLfoUGen wander;
+        wander.set_mode(flower::LfoWaveform::SmoothRandom);
+        wander.set_clock_division(2.0f);
+        engine.update_lfo_slot(1, wander, true);
+        engine.set_modulation_route(ModulationTarget::Pan, 1);
+        engine.set_modulation_base(ModulationTarget::Duration, 80.0f);
+
+        juce::MemoryBlock wavData;
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::OutputStream> stream = std::make_unique<juce::MemoryOutputStream>(wavData, false);
+        auto options = juce::AudioFormatWriterOptions{}.withSampleRate(sampleRate)
+                                                       .withNumChannels(2)
+                                                       .withBitsPerSample(32);
+        std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream, options));
+        expect(writer != nullptr);
+        if (writer == nullptr)
+            return wavData;
+
+        LayerCakeEngine::OfflineRenderSettings settings;
+        settings.bpm = 120.0;
+        settings.block_size = renderBlockSize;
+        settings.random_seed = seed;
+        expect(engine.render_offline(settings, 8.0, *writer));
+        writer.reset();
+        return wavData;
+    }
+
+    void testOfflineRenderDeterminism()
+    {
+        const auto first = renderOffline(7, LayerCakeEngine::kOfflineBlockSize);
+        const auto second = renderOffline(7, LayerCakeEngine::kOfflineBlockSize);
+        const auto reseeded = renderOffline(8, LayerCakeEngine::kOfflineBlockSize);
+
+        // 8 beats at 120 bpm, 2 channels of 32-bit float plus the header.
+        expectGreaterThan(static_cast<int>(first.getSize()), 4 * 48000 * 2 * 4);
+        expect(first == second, "same seed renders the same bytes");
+        expect(first != reseeded, "a different seed changes the render");
+
+        juce::WavAudioFormat wav;
+        std::unique_ptr<juce::AudioFormatReader> reader(wav.createReaderFor(new juce::MemoryInputStream(first, false), true));
+        expect(reader != nullptr);
+        if (reader != nullptr)
+        {
+            expectEquals(static_cast<int>(reader->lengthInSamples), 4 * 48000);
+            juce::AudioBuffer<float> audio(2, static_cast<int>(reader->lengthInSamples));
+            reader->read(&audio, 0, audio.getNumSamples(), 0, true, true);
+            expectGreaterThan(audio.getMagnitude(0, audio.getNumSamples()), 0.1f);
+        }
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    LayerCakeEngineTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
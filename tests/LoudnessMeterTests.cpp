@@ -0,0 +1,293 @@
+#include <juce_core/juce_core.h>
+#include <flowerjuce/DSP/MultiChannelLoudnessMeter.h>
+#include <flowerjuce/Debug/AudioAllocationGuard.h>
+#include "TestUtils.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+
+// MultiChannelLoudnessMeter: BS.1770 reference levels, channel summing,
+// integrated gating, block-size independent ballistics, channel counts
+// beyond the legacy 16, snapshots read while the meter is re-prepared, and a
+// 32-channel throughput benchmark.
+class LoudnessMeterTests : public juce::UnitTest
+{
+public:
+    LoudnessMeterTests() : juce::UnitTest("LoudnessMeterTests") {}
+
+    void runTest() override
+    {
+        beginTest("Reference sine reads the expected LUFS");
+        testReferenceLevel();
+
+        beginTest("Summed loudness adds channel power");
+        testChannelSum();
+
+        beginTest("Integrated loudness ignores gated silence");
+        testIntegratedGating();
+
+        beginTest("Ballistics do not depend on block size");
+        testBlockSizeIndependence();
+
+        beginTest("More than 16 channels are metered");
+        testManyChannels();
+
+        beginTest("Snapshots stay readable across prepare()");
+        testPrepareWhileReading();
+
+        beginTest("Benchmark 32-channel metering");
+        benchmarkThroughput();
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+
+    static std::vector<float> makeSine(double frequency, float amplitude, double seconds)
+    {
+        std::vector<float> samples(static_cast<size_t>(seconds * sampleRate));
+        for (size_t i = 0; i < samples.size(); ++i)
+            samples[i] = amplitude * static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * frequency * static_cast<double>(i) / sampleRate));
+        return samples;
+    }
+
+    // Feed the same mono signal to every channel, block by block (without allocating)
+    static void feed(MultiChannelLoudnessMeter& meter, const std::vector<float>& samples, int numChannels, int blockSize)
+    {
+        std::array<const float*, 64> channels{};
+        jassert(numChannels <= static_cast<int>(channels.size()));
+        for (size_t start = 0; start < samples.size(); start += static_cast<size_t>(blockSize))
+        {
+            const int count = static_cast<int>(std::min(samples.size() - start, static_cast<size_t>(blockSize)));
+            for (int channel = 0; channel < numChannels; ++channel)
+                channels[static_cast<size_t>(channel)] = samples.data() + start;
+            meter.process_block(channels.data(), numChannels, count);
+        }
+    }
+
+    void testReferenceLevel()
+    {
+        // BS.1770: a 0 dBFS 997 Hz sine in one channel reads -3.01 LUFS
+        MultiChannelLoudnessMeter meter;
+        meter.prepare(sampleRate, 1);
+        feed(meter, makeSine(997.0, 1.0f, 3.0), 1, 512);
+
+        const auto& snapshot = meter.get_snapshot();
+        expectWithinAbsoluteError(snapshot.channels[0].momentary_lufs, -3.01f, 0.05f, "0 dBFS momentary");
+        expectWithinAbsoluteError(snapshot.channels[0].short_term_lufs, -3.01f, 0.05f, "0 dBFS short-term");
+        expectWithinAbsoluteError(snapshot.channels[0].integrated_lufs, -3.01f, 0.1f, "0 dBFS integrated");
+        expectWithinAbsoluteError(snapshot.channels[0].peak, 1.0f, 0.01f, "peak");
+        expectWithinAbsoluteError(snapshot.channels[0].rms, 0.7071f, 0.01f, "RMS");
+
+        // A 1 kHz sine at amplitude 0.1 sits 20 dB lower
+        MultiChannelLoudnessMeter quiet;
+        quiet.prepare(sampleRate, 1);
+        feed(quiet, makeSine(1000.0, 0.1f, 3.0), 1, 512);
+        expectWithinAbsoluteError(quiet.get_snapshot().channels[0].momentary_lufs, -23.0f, 0.1f, "-20 dBFS momentary");
+
+        // The filters are designed per sample rate
+        MultiChannelLoudnessMeter at44k;
+        at44k.prepare(44100.0, 1);
+        std::vector<float> sine(static_cast<size_t>(3.0 * 44100.0));
+        for (size_t i = 0; i < sine.size(); ++i)
+            sine[i] = static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * 997.0 * static_cast<double>(i) / 44100.0));
+        feed(at44k, sine, 1, 441);
+        expectWithinAbsoluteError(at44k.get_snapshot().channels[0].momentary_lufs, -3.01f, 0.05f, "44.1 kHz momentary");
+    }
+
+    void testChannelSum()
+    {
+        MultiChannelLoudnessMeter meter;
+        meter.prepare(sampleRate, 2);
+        feed(meter, makeSine(1000.0, 0.1f, 2.0), 2, 256);
+
+        const auto& snapshot = meter.get_snapshot();
+        expectWithinAbsoluteError(snapshot.sum.momentary_lufs - snapshot.channels[0].momentary_lufs, 3.01f, 0.02f,
+                                  "two identical channels sum 3 dB louder");
+        expectWithinAbsoluteError(snapshot.channels[0].momentary_lufs, snapshot.channels[1].momentary_lufs, 1.0e-4f);
+    }
+
+    void testIntegratedGating()
+    {
+        MultiChannelLoudnessMeter meter;
+        meter.prepare(sampleRate, 1);
+        feed(meter, makeSine(1000.0, 0.1f, 5.0), 1, 512);
+        const float before = meter.get_snapshot().channels[0].integrated_lufs;
+
+        // Silence falls under the absolute gate and must not pull the value down;
+        // only the three 400 ms blocks that overlap the fade count
+        feed(meter, std::vector<float>(static_cast<size_t>(5.0 * sampleRate), 0.0f), 1, 512);
+        const auto& snapshot = meter.get_snapshot();
+        const float afterSilence = snapshot.channels[0].integrated_lufs;
+        expectWithinAbsoluteError(afterSilence, before, 0.25f, "silence is gated out");
+        expectEquals(snapshot.channels[0].momentary_lufs, MultiChannelLoudnessMeter::kSilenceLufs);
+
+        // A quiet passage more than 10 LU down is removed by the relative gate
+        feed(meter, makeSine(1000.0, 0.005f, 5.0), 1, 512);
+        expectWithinAbsoluteError(meter.get_snapshot().channels[0].integrated_lufs, afterSilence, 0.01f, "relative gate");
+
+        meter.reset_integrated();
+        feed(meter, makeSine(1000.0, 0.005f, 2.0), 1, 512);
+        expectWithinAbsoluteError(meter.get_snapshot().channels[0].integrated_lufs, -49.0f, 0.2f, "after reset");
+    }
+
+    void testBlockSizeIndependence()
+    {
+        // A burst followed by silence exercises attack, peak decay and RMS release
+        auto signal = makeSine(440.0, 0.5f, 1.0);
+        signal.resize(1024 * 102, 0.0f); // A multiple of both block sizes below
+        const float silenceSeconds = static_cast<float>((signal.size() - static_cast<size_t>(sampleRate)) / sampleRate);
+
+        MultiChannelLoudnessMeter small;
+        small.prepare(sampleRate, 2);
+        MultiChannelLoudnessMeter large;
+        large.prepare(sampleRate, 2);
+
+        AudioAllocationGuard::reset_violation_count();
+        {
+            const AudioAllocationGuard guard;
+            feed(small, signal, 2, 32);
+            feed(large, signal, 2, 1024);
+        }
+        expectEquals(static_cast<int>(AudioAllocationGuard::get_violation_count()), 0, "process_block allocated");
+
+        const auto& a = small.get_snapshot();
+        const auto& b = large.get_snapshot();
+        expectEquals(a.samples_processed, b.samples_processed);
+        expectWithinAbsoluteError(a.channels[0].momentary_lufs, b.channels[0].momentary_lufs, 1.0e-3f);
+        expectWithinAbsoluteError(a.channels[0].short_term_lufs, b.channels[0].short_term_lufs, 1.0e-3f);
+        expectWithinAbsoluteError(a.channels[0].integrated_lufs, b.channels[0].integrated_lufs, 1.0e-3f);
+        expectWithinAbsoluteError(a.channels[0].rms, b.channels[0].rms, 1.0e-3f, "RMS release");
+
+        // 19 dB/s from 0.5 over the silence, whatever the callback size (to within
+        // the one block of decay that separates the last peaks)
+        const float expectedPeak = 0.5f * std::pow(10.0f, -MultiChannelLoudnessMeter::kPeakDecayDbPerSecond * silenceSeconds / 20.0f);
+        expectWithinAbsoluteError(a.channels[0].peak, expectedPeak, expectedPeak * 0.05f, "peak decay, block 32");
+        expectWithinAbsoluteError(b.channels[0].peak, expectedPeak, expectedPeak * 0.05f, "peak decay, block 1024");
+    }
+
+    void testManyChannels()
+    {
+        constexpr int numChannels = 24;
+        MultiChannelLoudnessMeter meter;
+        meter.prepare(sampleRate, numChannels);
+
+        // Channel n carries a sine (n + 1) dB below full scale, except channel 20, which is silent
+        const auto sine = makeSine(1000.0, 1.0f, 1.0);
+        std::vector<std::vector<float>> buffers(numChannels);
+        std::vector<const float*> pointers(numChannels);
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            buffers[static_cast<size_t>(channel)] = sine;
+            const float gain = channel == 20 ? 0.0f : juce::Decibels::decibelsToGain(-static_cast<float>(channel + 1));
+            for (auto& sample : buffers[static_cast<size_t>(channel)])
+                sample *= gain;
+        }
+        for (int start = 0; start < static_cast<int>(sine.size()); start += 480)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                pointers[static_cast<size_t>(channel)] = buffers[static_cast<size_t>(channel)].data() + start;
+            meter.process_block(pointers.data(), numChannels, 480);
+        }
+
+        const auto& snapshot = meter.get_snapshot();
+        expectEquals(static_cast<int>(snapshot.channels.size()), numChannels);
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            const auto& levels = snapshot.channels[static_cast<size_t>(channel)];
+            if (channel == 20)
+            {
+                expectEquals(levels.momentary_lufs, MultiChannelLoudnessMeter::kSilenceLufs, "silent channel");
+                continue;
+            }
+            expectWithinAbsoluteError(levels.momentary_lufs, -3.0f - static_cast<float>(channel + 1), 0.1f,
+                                      "channel " + juce::String(channel));
+        }
+
+        // Only the first 16 peaks are mirrored for the Sinks view
+        expectWithinAbsoluteError(meter.get_channel_levels()[15].load(), juce::Decibels::decibelsToGain(-16.0f), 0.01f);
+    }
+
+    // The UI may read a snapshot while the device restarts with a different
+    // channel count: every snapshot it gets must be one whole, live set.
+    void testPrepareWhileReading()
+    {
+        MultiChannelLoudnessMeter meter;
+        const auto sine = makeSine(1000.0, 0.5f, 0.05);
+
+        std::atomic<bool> done{false};
+        std::atomic<int> badReads{0};
+        std::atomic<int> numReads{0};
+        std::thread reader([&] {
+            while (!done.load())
+            {
+                const auto& snapshot = meter.get_snapshot();
+                const auto numChannels = static_cast<int>(snapshot.channels.size());
+                if (numChannels < 1 || numChannels > 40)
+                    badReads.fetch_add(1);
+                for (const auto& levels : snapshot.channels)
+                    if (!std::isfinite(levels.peak) || levels.peak < 0.0f || levels.peak > 1.0f)
+                        badReads.fetch_add(1);
+                numReads.fetch_add(1);
+            }
+        });
+
+        for (int round = 0; round < 400; ++round)
+        {
+            const int numChannels = 1 + (round * 7) % 40;
+            meter.prepare(sampleRate, numChannels);
+            feed(meter, sine, numChannels, 480);
+        }
+        done.store(true);
+        reader.join();
+
+        expectEquals(badReads.load(), 0);
+        expectGreaterThan(numReads.load(), 0);
+    }
+
+    void benchmarkThroughput()
+    {
+        constexpr int numChannels = 32;
+        const double seconds = 20.0;
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+        std::vector<float> signal(static_cast<size_t>(seconds * sampleRate));
+        for (auto& sample : signal)
+            sample = noise(rng);
+
+        TestUtils::CsvWriter writer("loudness_meter_benchmark",
+                                    {"Channels", "BlockSize", "NsPerChannelSample", "RealtimeFactor"});
+
+        for (int blockSize : { 32, 256, 1024 })
+        {
+            MultiChannelLoudnessMeter meter;
+            meter.prepare(sampleRate, numChannels);
+
+            const auto start = std::chrono::steady_clock::now();
+            feed(meter, signal, numChannels, blockSize);
+            const auto end = std::chrono::steady_clock::now();
+
+            const double elapsed = std::chrono::duration<double>(end - start).count();
+            const double channelSamples = static_cast<double>(signal.size()) * numChannels;
+            const double nsPerChannelSample = 1.0e9 * elapsed / channelSamples;
+            const double realtimeFactor = seconds / elapsed;
+
+            writer.writeRow(numChannels, blockSize, nsPerChannelSample, realtimeFactor);
+            logMessage(juce::String(numChannels) + " channels, block " + juce::String(blockSize) + ": "
+                       + juce::String(nsPerChannelSample, 2) + " ns/channel-sample, "
+                       + juce::String(realtimeFactor, 0) + "x realtime");
+            expectGreaterThan(realtimeFactor, 1.0);
+        }
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    LoudnessMeterTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
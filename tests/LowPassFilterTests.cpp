@@ -0,0 +1,264 @@
+#include <juce_core/juce_core.h>
+#include <flowerjuce/DSP/LowPassFilter.h>
+#include <flowerjuce/Debug/AudioAllocationGuard.h>
+#include "TestUtils.h"
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+// LowPassFilter: Butterworth response, click-free cutoff jumps, audio-rate
+// modulation, cross-thread set_cutoff, and a throughput benchmark.
+class LowPassFilterTests : public juce::UnitTest
+{
+public:
+    LowPassFilterTests() : juce::UnitTest("LowPassFilterTests") {}
+
+    void runTest() override
+    {
+        beginTest("Frequency response matches a Butterworth low pass");
+        testFrequencyResponse();
+
+        beginTest("Cutoff jumps glide without clicks");
+        testCutoffGlide();
+
+        beginTest("Audio-rate modulation stays stable");
+        testAudioRateModulation();
+
+        beginTest("set_cutoff from another thread while processing");
+        testConcurrentCutoff();
+
+        beginTest("Benchmark filter throughput");
+        benchmarkThroughput();
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 256;
+
+    // Steady-state gain of a sine through the filter, in dB
+    static float measureGainDb(LowPassFilter& filter, double frequency)
+    {
+        std::vector<float> block(blockSize);
+        double phase = 0.0;
+        const double increment = 2.0 * juce::MathConstants<double>::pi * frequency / sampleRate;
+        double sumSquares = 0.0;
+        int count = 0;
+        for (int b = 0; b < 200; ++b)
+        {
+            for (auto& sample : block)
+            {
+                sample = static_cast<float>(std::sin(phase));
+                phase += increment;
+            }
+            filter.process_block(block.data(), blockSize);
+            if (b >= 150)
+            {
+                for (auto sample : block)
+                    sumSquares += static_cast<double>(sample) * sample;
+                count += blockSize;
+            }
+        }
+        // A unit sine has an RMS of 1/sqrt(2)
+        return static_cast<float>(10.0 * std::log10(2.0 * sumSquares / count));
+    }
+
+    void testFrequencyResponse()
+    {
+        for (float cutoff : { 200.0f, 1000.0f, 5000.0f })
+        {
+            for (double ratio : { 0.25, 1.0, 4.0 })
+            {
+                LowPassFilter filter;
+                filter.set_cutoff(cutoff);
+                filter.prepare(sampleRate);
+
+                // Bilinear Butterworth: |H|^2 = 1 / (1 + (w/wc)^4) with prewarped frequencies
+                const double w = std::tan(juce::MathConstants<double>::pi * cutoff * ratio / sampleRate);
+                const double wc = std::tan(juce::MathConstants<double>::pi * cutoff / sampleRate);
+                const auto expected = static_cast<float>(-10.0 * std::log10(1.0 + std::pow(w / wc, 4.0)));
+
+                expectWithinAbsoluteError(measureGainDb(filter, cutoff * ratio), expected, 0.1f,
+                                          "cutoff " + juce::String(cutoff) + " x" + juce::String(ratio));
+            }
+        }
+    }
+
+    void testCutoffGlide()
+    {
+        // A DC input makes any discontinuity in the output a click
+        LowPassFilter filter;
+        filter.set_cutoff(8000.0f);
+        filter.prepare(sampleRate);
+        std::vector<float> block(blockSize);
+
+        float previous = 0.0f;
+        float largestStep = 0.0f;
+        AudioAllocationGuard::reset_violation_count();
+        {
+            const AudioAllocationGuard guard;
+            for (int b = 0; b < 400; ++b)
+            {
+                if (b % 40 == 20)
+                    filter.set_cutoff(b % 80 == 20 ? 100.0f : 8000.0f);
+
+                std::fill(block.begin(), block.end(), 0.5f);
+                filter.process_block(block.data(), blockSize);
+                for (auto sample : block)
+                {
+                    if (b > 10)
+                        largestStep = juce::jmax(largestStep, std::abs(sample - previous));
+                    previous = sample;
+                }
+            }
+        }
+        expectEquals(static_cast<int>(AudioAllocationGuard::get_violation_count()), 0, "process_block allocated");
+        expectLessThan(largestStep, 1.0e-3f, "DC output moved abruptly during cutoff jumps");
+
+        // The glide reaches the target
+        filter.set_cutoff(1000.0f);
+        for (int b = 0; b < 100; ++b)
+            filter.process_block(block.data(), blockSize);
+        expectWithinAbsoluteError(filter.get_current_cutoff(), 1000.0f, 1.0f);
+
+        // Out-of-range targets clamp instead of going unstable
+        filter.set_cutoff(1.0e6f);
+        filter.set_smoothing_time_ms(0.0f);
+        filter.process_block(block.data(), blockSize);
+        expectLessThan(filter.get_current_cutoff(), static_cast<float>(sampleRate * 0.5));
+        filter.set_cutoff(0.0f);
+        expectEquals(filter.get_cutoff(), LowPassFilter::kMinCutoffHz);
+    }
+
+    void testAudioRateModulation()
+    {
+        // +/-4 octaves around 1 kHz at 2 kHz modulation rate on white-ish input
+        LowPassFilter filter;
+        filter.set_cutoff(1000.0f);
+        filter.prepare(sampleRate);
+        juce::Random random(3);
+        std::vector<float> block(blockSize);
+        std::vector<float> octaves(blockSize);
+
+        double phase = 0.0;
+        float peak = 0.0f;
+        bool finite = true;
+        AudioAllocationGuard::reset_violation_count();
+        {
+            const AudioAllocationGuard guard;
+            for (int b = 0; b < 2000; ++b)
+            {
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    block[static_cast<size_t>(i)] = random.nextFloat() * 2.0f - 1.0f;
+                    octaves[static_cast<size_t>(i)] = 4.0f * static_cast<float>(std::sin(phase));
+                    phase += 2.0 * juce::MathConstants<double>::pi * 2000.0 / sampleRate;
+                }
+                filter.process_block(block.data(), octaves.data(), blockSize);
+                for (auto sample : block)
+                {
+                    finite = finite && std::isfinite(sample);
+                    peak = juce::jmax(peak, std::abs(sample));
+                }
+            }
+        }
+        expectEquals(static_cast<int>(AudioAllocationGuard::get_violation_count()), 0, "modulated process_block allocated");
+        expect(finite, "output stays finite");
+        expectLessThan(peak, 4.0f, "output stays bounded");
+
+        // Zero modulation matches the unmodulated path
+        LowPassFilter a;
+        LowPassFilter b;
+        a.prepare(sampleRate);
+        b.prepare(sampleRate);
+        a.set_cutoff(500.0f);
+        b.set_cutoff(500.0f);
+        std::fill(octaves.begin(), octaves.end(), 0.0f);
+        float difference = 0.0f;
+        for (int n = 0; n < 50; ++n)
+        {
+            std::vector<float> x(blockSize);
+            for (auto& sample : x)
+                sample = random.nextFloat() * 2.0f - 1.0f;
+            auto y = x;
+            a.process_block(x.data(), blockSize);
+            b.process_block(y.data(), octaves.data(), blockSize);
+            // The glide from the default cutoff interpolates differently; compare once settled
+            for (int i = 0; i < blockSize && n >= 20; ++i)
+                difference = juce::jmax(difference, std::abs(x[static_cast<size_t>(i)] - y[static_cast<size_t>(i)]));
+        }
+        expectLessThan(difference, 1.0e-3f, "modulated path with zero offset");
+    }
+
+    void testConcurrentCutoff()
+    {
+        LowPassFilter filter;
+        filter.prepare(sampleRate);
+        std::atomic<bool> running{true};
+
+        std::thread ui([&] {
+            juce::Random random(11);
+            while (running.load())
+                filter.set_cutoff(20.0f + random.nextFloat() * 20000.0f);
+        });
+
+        std::vector<float> block(blockSize);
+        juce::Random random(5);
+        bool finite = true;
+        for (int b = 0; b < 5000; ++b)
+        {
+            for (auto& sample : block)
+                sample = random.nextFloat() * 2.0f - 1.0f;
+            filter.process_block(block.data(), blockSize);
+            for (auto sample : block)
+                finite = finite && std::isfinite(sample) && std::abs(sample) < 4.0f;
+        }
+        running.store(false);
+        ui.join();
+        expect(finite, "output stays finite and bounded");
+    }
+
+    void benchmarkThroughput()
+    {
+        TestUtils::CsvWriter writer("lowpass_filter_benchmark", {"Mode", "BlockSize", "NsPerSample"});
+        constexpr int totalSamples = 48000 * 20;
+
+        for (bool modulated : { false, true })
+        {
+            for (int size : { 64, 512 })
+            {
+                LowPassFilter filter;
+                filter.prepare(sampleRate);
+                filter.set_cutoff(2000.0f);
+                std::vector<float> block(static_cast<size_t>(size), 0.25f);
+                std::vector<float> octaves(static_cast<size_t>(size));
+                for (int i = 0; i < size; ++i)
+                    octaves[static_cast<size_t>(i)] = std::sin(static_cast<float>(i) * 0.1f);
+
+                const auto start = std::chrono::steady_clock::now();
+                for (int done = 0; done < totalSamples; done += size)
+                {
+                    if (modulated)
+                        filter.process_block(block.data(), octaves.data(), size);
+                    else
+                        filter.process_block(block.data(), size);
+                }
+                const auto end = std::chrono::steady_clock::now();
+
+                const double nsPerSample = 1.0e9 * std::chrono::duration<double>(end - start).count() / totalSamples;
+                const juce::String mode = modulated ? "AudioRate" : "Smoothed";
+                writer.writeRow(mode.toStdString(), size, nsPerSample);
+                logMessage(mode + " block " + juce::String(size) + ": " + juce::String(nsPerSample, 2) + " ns/sample");
+                expectLessThan(nsPerSample, 1.0e9 / sampleRate, "slower than realtime");
+            }
+        }
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    LowPassFilterTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
@@ -0,0 +1,498 @@
+#include <juce_core/juce_core.h>
+#include <flowerjuce/LooperEngine/MultiTrackLooperEngine.h>
+#include <flowerjuce/Panners/CLEATPanner.h>
+#include <flowerjuce/Panners/StereoPanner.h>
+#include <flowerjuce/Debug/AudioAllocationGuard.h>
+#include <flowerjuce/Debug/AudioEventLog.h>
+#include "TestUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+
+// Parallel track rendering: the worker pool must mix the same audio as the
+// serial device-thread path, and the benchmark shows callback time against
+// the number of worker threads at a 64-sample CLEAT block. Tape storage swaps
+// are checked against concurrent lock-free readers, and state changes raised
+// on the audio thread must reach the logger only through the event log.
+class MultiTrackLooperEngineTests : public juce::UnitTest
+{
+public:
+    MultiTrackLooperEngineTests() : juce::UnitTest("MultiTrackLooperEngineTests") {}
+
+    void runTest() override
+    {
+        beginTest("Parallel render matches serial");
+        testParallelMatchesSerial();
+
+        beginTest("No allocations in audio callback");
+        testNoAllocationsInCallback();
+
+        beginTest("Tape swap while reading");
+        testTapeSwapWhileReading();
+
+        beginTest("Audio events are logged off the audio thread");
+        testAudioEventsLoggedOffAudioThread();
+
+        beginTest("Pre-fader tap receives whole blocks");
+        testPreFaderTap();
+
+        beginTest("Oversized blocks render in scratch-sized slices");
+        testOversizedBlock();
+
+        beginTest("Benchmark callback time vs threads");
+        benchmarkCallbackTime();
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int numOutputs = 16;
+    static constexpr int loopSamples = 96000;
+    static inline int* volatile allocationProbe = nullptr;
+
+    // One engine with every track playing a different noise loop through
+    // its own CLEAT panner.
+    struct Rig
+    {
+        MultiTrackLooperEngine engine;
+        std::array<CLEATPanner, 8> panners;
+        juce::AudioBuffer<float> input{2, 1};
+        juce::AudioBuffer<float> output{numOutputs, 1};
+
+        void prepare(int blockSize)
+        {
+            std::mt19937 rng(1234);
+            std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+
+            for (int track = 0; track < engine.get_num_tracks(); ++track)
+            {
+                auto& trackEngine = engine.get_track_engine(track);
+                trackEngine.audio_device_about_to_start(sampleRate, blockSize, numOutputs);
+
+                auto& buffer = trackEngine.get_buffer();
+                for (int i = 0; i < loopSamples; ++i)
+                    buffer[static_cast<size_t>(i)] = noise(rng);
+                trackEngine.set_recorded_length(loopSamples);
+                trackEngine.set_has_recorded(true);
+                trackEngine.set_loop_end(loopSamples);
+                trackEngine.set_speed(0.5f + 0.1f * static_cast<float>(track));
+
+                auto& panner = panners[static_cast<size_t>(track)];
+                panner.prepare(sampleRate);
+                panner.set_pan(static_cast<float>(track) / 7.0f, 1.0f - static_cast<float>(track) / 7.0f);
+                trackEngine.set_panner(&panner);
+                trackEngine.set_playing(true);
+            }
+
+            engine.allocate_track_buses(numOutputs, blockSize);
+            input.setSize(2, blockSize);
+            input.clear();
+            output.setSize(numOutputs, blockSize);
+        }
+
+        void processBlock(int blockSize)
+        {
+            engine.audioDeviceIOCallbackWithContext(input.getArrayOfReadPointers(), input.getNumChannels(),
+                                                    output.getArrayOfWritePointers(), numOutputs,
+                                                    blockSize, {});
+        }
+    };
+
+    void testParallelMatchesSerial()
+    {
+        const int blockSize = 256;
+        auto serial = std::make_unique<Rig>();
+        auto parallel = std::make_unique<Rig>();
+        serial->prepare(blockSize);
+        parallel->prepare(blockSize);
+        parallel->engine.set_num_render_threads(3);
+        expectEquals(parallel->engine.get_num_render_threads(), 3);
+
+        float maxError = 0.0f;
+        float peak = 0.0f;
+        for (int block = 0; block < 200; ++block)
+        {
+            serial->processBlock(blockSize);
+            parallel->processBlock(blockSize);
+            for (int channel = 0; channel < numOutputs; ++channel)
+            {
+                const float* a = serial->output.getReadPointer(channel);
+                const float* b = parallel->output.getReadPointer(channel);
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    maxError = std::max(maxError, std::abs(a[i] - b[i]));
+                    peak = std::max(peak, std::abs(a[i]));
+                }
+            }
+        }
+
+        expectGreaterThan(peak, 0.01f);
+        expectLessThan(maxError, 1.0e-6f);
+    }
+
+    // The device callback (and its render workers) must not touch the heap
+    // once the tracks have been prepared (counted by the allocation hooks).
+    void testNoAllocationsInCallback()
+    {
+        // The hooks are linked into this test; without them nothing would be counted
+        expect(AudioAllocationGuard::is_enabled(), "AudioAllocationHooks.cpp is not linked in");
+        if (!AudioAllocationGuard::is_enabled())
+            return;
+
+        // The guard itself must see an allocation made inside it
+        AudioAllocationGuard::reset_violation_count();
+        {
+            const AudioAllocationGuard guard;
+            allocationProbe = new int(1); // volatile store keeps the new from being elided
+            delete allocationProbe;
+        }
+        expectEquals(static_cast<int>(AudioAllocationGuard::get_violation_count()), 1);
+
+        const int blockSize = 32;
+        for (int threads : { 0, 3 })
+        {
+            auto rig = std::make_unique<Rig>();
+            rig->prepare(blockSize);
+            rig->engine.set_num_render_threads(threads);
+
+            // First-call diagnostics may log once; steady state must not allocate
+            for (int block = 0; block < 10; ++block)
+                rig->processBlock(blockSize);
+
+            AudioAllocationGuard::reset_violation_count();
+            for (int block = 0; block < 2000; ++block)
+                rig->processBlock(blockSize);
+
+            expectEquals(static_cast<int>(AudioAllocationGuard::get_violation_count()), 0,
+                         juce::String(threads) + " render threads");
+        }
+    }
+
+    // Publishing new tape storage must never hand a pinned reader a freed or
+    // half-written buffer: every pinned view is one whole published buffer.
+    void testTapeSwapWhileReading()
+    {
+        TapeLoop loop;
+        loop.allocate_buffer(sampleRate, 1.0);
+        std::atomic<bool> done{false};
+        std::atomic<int> inconsistentReads{0};
+        std::atomic<int> pinnedBlocks{0};
+
+        std::vector<std::thread> readers;
+        for (int thread = 0; thread < 3; ++thread)
+        {
+            readers.emplace_back([&] {
+                while (!done.load())
+                {
+                    const TapeLoop::ReadScope scope(loop);
+                    const auto& buffer = loop.get_buffer();
+                    const float first = buffer.empty() ? 0.0f : buffer.front();
+                    for (float sample : buffer)
+                        if (sample != first)
+                            inconsistentReads.fetch_add(1);
+                    pinnedBlocks.fetch_add(1);
+                }
+            });
+        }
+
+        while (pinnedBlocks.load() == 0)
+            std::this_thread::yield();
+
+        const int numSwaps = 200;
+        for (int swap = 0; swap < numSwaps; ++swap)
+        {
+            const size_t size = static_cast<size_t>(sampleRate) / 2 + static_cast<size_t>(swap % 7) * 1000;
+            loop.publish_buffer(std::vector<float>(size, static_cast<float>(swap)), size, true);
+        }
+
+        done.store(true);
+        for (auto& reader : readers)
+            reader.join();
+
+        expectEquals(inconsistentReads.load(), 0);
+        expectGreaterThan(pinnedBlocks.load(), 0);
+        expectEquals(loop.m_recorded_length.load(), loop.get_buffer_size());
+        expectEquals(loop.get_buffer().front(), static_cast<float>(numSwaps - 1));
+    }
+
+    // Collects messages together with the thread that wrote them
+    struct RecordingLogger : public juce::Logger
+    {
+        void logMessage(const juce::String& message) override
+        {
+            const juce::ScopedLock sl(lock);
+            messages.add(message);
+            threads.push_back(std::this_thread::get_id());
+        }
+
+        int count_from(std::thread::id thread, const juce::String& text)
+        {
+            const juce::ScopedLock sl(lock);
+            int count = 0;
+            for (int i = 0; i < messages.size(); ++i)
+                if (messages[i].contains(text) && threads[static_cast<size_t>(i)] == thread)
+                    ++count;
+            return count;
+        }
+
+        int count_not_from(std::thread::id thread, const juce::String& text)
+        {
+            const juce::ScopedLock sl(lock);
+            int count = 0;
+            for (int i = 0; i < messages.size(); ++i)
+                if (messages[i].contains(text) && threads[static_cast<size_t>(i)] != thread)
+                    ++count;
+            return count;
+        }
+
+        juce::CriticalSection lock;
+        juce::StringArray messages;
+        std::vector<std::thread::id> threads;
+    };
+
+    // Record a first loop on track 0 until it wraps: the callback must only
+    // count and queue the events, the flusher thread writes them to the logger.
+    void testAudioEventsLoggedOffAudioThread()
+    {
+        const int blockSize = 512;
+        auto rig = std::make_unique<Rig>();
+        rig->prepare(blockSize);
+
+        auto& track = rig->engine.get_track_engine(0);
+        track.set_has_recorded(false);
+        track.set_recorded_length(0);
+        track.set_record_enable(true);
+        for (int channel = 0; channel < rig->input.getNumChannels(); ++channel)
+            juce::FloatVectorOperations::fill(rig->input.getWritePointer(channel), 0.25f, blockSize);
+
+        auto& eventLog = track.get_event_log();
+        eventLog.reset_counts();
+
+        RecordingLogger logger;
+        juce::Logger::setCurrentLogger(&logger);
+
+        AudioAllocationGuard::reset_violation_count();
+        const auto audioThread = std::this_thread::get_id();
+        const int maxBlocks = static_cast<int>(sampleRate * 10.0) / blockSize + 2;
+        for (int block = 0; block < maxBlocks && track.get_record_enable(); ++block)
+            rig->processBlock(blockSize);
+        rig->processBlock(blockSize); // Finalizes the stopped recording
+
+        // Give the flusher a few polls to pick the events up
+        for (int attempt = 0; attempt < 100 && logger.count_not_from(audioThread, "WRAPPED") == 0; ++attempt)
+            juce::Thread::sleep(10);
+
+        juce::Logger::setCurrentLogger(nullptr);
+
+        expect(!track.get_record_enable(), "recording stops at the wrap");
+        expect(track.has_recorded());
+        expectEquals(static_cast<int>(eventLog.get_count(AudioEvent::RecordingStarted)), 1);
+        expectEquals(static_cast<int>(eventLog.get_count(AudioEvent::RecordingWrapped)), 1);
+        expectEquals(static_cast<int>(eventLog.get_count(AudioEvent::RecordingFinalized)), 1);
+        expectEquals(static_cast<int>(eventLog.get_count(AudioEvent::TapeBufferEmpty)), 0);
+        expectEquals(static_cast<int>(eventLog.get_dropped_count()), 0);
+
+        expectEquals(logger.count_not_from(audioThread, "[Track 0] ~~~ WRAPPED"), 1);
+        expectEquals(logger.count_from(audioThread, "~~~"), 0);
+        expectEquals(logger.count_from(audioThread, "WARNING"), 0);
+        if (AudioAllocationGuard::is_enabled())
+            expectEquals(static_cast<int>(AudioAllocationGuard::get_violation_count()), 0);
+
+        // A full ring drops records but keeps counting
+        AudioEventLog smallLog("Small", 4);
+        for (int i = 0; i < 10; ++i)
+            smallLog.push(AudioEvent::ReadBufferEmpty, i);
+        expectEquals(static_cast<int>(smallLog.get_count(AudioEvent::ReadBufferEmpty)), 10);
+        expectEquals(static_cast<int>(smallLog.get_dropped_count()), 7);
+        std::vector<double> drained;
+        smallLog.drain([&](const AudioEventRecord& record) { drained.push_back(record.value); });
+        expectEquals(static_cast<int>(drained.size()), 3);
+        expect(!drained.empty() && drained.front() == 0.0, "oldest records are kept");
+    }
+
+    // Captures what a track hands to its pre-fader tap
+    struct CapturingTap : public LooperTrackEngine::PreFaderTap
+    {
+        void process_pre_fader_block(const float* samples, int num_samples, double sample_rate) override
+        {
+            ++calls;
+            lastSampleRate = sample_rate;
+            const int toCopy = std::min(num_samples, static_cast<int>(captured.size()) - numCaptured);
+            std::copy(samples, samples + toCopy, captured.begin() + numCaptured);
+            numCaptured += toCopy;
+        }
+
+        std::vector<float> captured;
+        int numCaptured{0};
+        int calls{0};
+        double lastSampleRate{0.0};
+    };
+
+    // One tap call per block with the raw read-head output: the fader and
+    // filter are applied after the tap, and the call must not allocate.
+    void testPreFaderTap()
+    {
+        const int blockSize = 256;
+        const int numBlocks = 40;
+        auto rig = std::make_unique<Rig>();
+        rig->prepare(blockSize);
+
+        // Track 5 plays at unity speed, so the tap must see the tape verbatim
+        auto& track = rig->engine.get_track_engine(5);
+        track.set_level_db(-12.0f);
+        track.set_filter_cutoff(200.0f);
+
+        CapturingTap tap;
+        tap.captured.assign(static_cast<size_t>(blockSize * numBlocks), 0.0f);
+        track.set_pre_fader_tap(&tap);
+
+        AudioAllocationGuard::reset_violation_count();
+        for (int block = 0; block < numBlocks; ++block)
+            rig->processBlock(blockSize);
+        track.set_pre_fader_tap(nullptr);
+        rig->processBlock(blockSize);
+
+        expectEquals(tap.calls, numBlocks);
+        expectEquals(tap.numCaptured, blockSize * numBlocks);
+        expectEquals(tap.lastSampleRate, sampleRate);
+        if (AudioAllocationGuard::is_enabled())
+            expectEquals(static_cast<int>(AudioAllocationGuard::get_violation_count()), 0);
+
+        const auto& tape = track.get_buffer();
+        float maxError = 0.0f;
+        for (int i = 0; i < tap.numCaptured; ++i)
+            maxError = std::max(maxError, std::abs(tap.captured[static_cast<size_t>(i)] - tape[static_cast<size_t>(i)]));
+        expectLessThan(maxError, 1.0e-6f);
+    }
+
+    // A device that hands over more samples than it promised must get the same
+    // audio as one that promised the larger block, without growing scratch.
+    void testOversizedBlock()
+    {
+        const int preparedBlockSize = 256;
+        const int blockSize = 1000;
+        const int numBlocks = 20;
+
+        std::mt19937 rng(99);
+        std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+        std::vector<float> loop(static_cast<size_t>(loopSamples));
+        for (auto& sample : loop)
+            sample = noise(rng);
+
+        struct Track
+        {
+            LooperTrackEngine engine;
+            StereoPanner panner;
+        };
+        auto prepareTrack = [&](Track& track, int maxBlockSize)
+        {
+            track.engine.audio_device_about_to_start(sampleRate, maxBlockSize);
+            std::copy(loop.begin(), loop.end(), track.engine.get_buffer().begin());
+            track.engine.set_recorded_length(loopSamples);
+            track.engine.set_has_recorded(true);
+            track.engine.set_loop_end(loopSamples);
+            track.engine.set_speed(0.75f);
+            track.engine.set_filter_cutoff(2000.0f);
+            track.engine.set_panner(&track.panner);
+            track.engine.set_playing(true);
+        };
+
+        auto sliced = std::make_unique<Track>();
+        auto whole = std::make_unique<Track>();
+        prepareTrack(*sliced, preparedBlockSize);
+        prepareTrack(*whole, blockSize);
+
+        juce::AudioBuffer<float> input(1, blockSize);
+        input.clear();
+        juce::AudioBuffer<float> slicedOutput(2, blockSize);
+        juce::AudioBuffer<float> wholeOutput(2, blockSize);
+
+        float maxError = 0.0f;
+        float peak = 0.0f;
+        AudioAllocationGuard::reset_violation_count();
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            slicedOutput.clear();
+            wholeOutput.clear();
+            {
+                const AudioAllocationGuard guard;
+                sliced->engine.process_block(input.getArrayOfReadPointers(), 1,
+                                             slicedOutput.getArrayOfWritePointers(), 2, blockSize, false);
+            }
+            whole->engine.process_block(input.getArrayOfReadPointers(), 1,
+                                        wholeOutput.getArrayOfWritePointers(), 2, blockSize, false);
+
+            for (int channel = 0; channel < 2; ++channel)
+            {
+                const float* a = slicedOutput.getReadPointer(channel);
+                const float* b = wholeOutput.getReadPointer(channel);
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    maxError = std::max(maxError, std::abs(a[i] - b[i]));
+                    peak = std::max(peak, std::abs(b[i]));
+                }
+            }
+        }
+
+        expectGreaterThan(peak, 0.01f);
+        expectLessThan(maxError, 1.0e-6f);
+        if (AudioAllocationGuard::is_enabled())
+            expectEquals(static_cast<int>(AudioAllocationGuard::get_violation_count()), 0);
+    }
+
+    void benchmarkCallbackTime()
+    {
+        const int blockSize = 64;
+        const int numBlocks = 20000;
+        const int maxThreads = 7;
+
+        TestUtils::CsvWriter writer("multitrack_pool_benchmark",
+                                    {"Threads", "Mean_us", "P99_us", "Max_us", "Budget_us"});
+        const double budgetUs = 1.0e6 * blockSize / sampleRate;
+
+        for (int threads = 0; threads <= maxThreads; ++threads)
+        {
+            auto rig = std::make_unique<Rig>();
+            rig->prepare(blockSize);
+            rig->engine.set_num_render_threads(threads);
+
+            // Warm up caches and let the workers settle.
+            for (int block = 0; block < 500; ++block)
+                rig->processBlock(blockSize);
+
+            std::vector<double> times;
+            times.reserve(static_cast<size_t>(numBlocks));
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                const auto start = std::chrono::steady_clock::now();
+                rig->processBlock(blockSize);
+                const auto end = std::chrono::steady_clock::now();
+                times.push_back(std::chrono::duration<double, std::micro>(end - start).count());
+            }
+
+            double sum = 0.0;
+            for (double t : times)
+                sum += t;
+            std::sort(times.begin(), times.end());
+            const double mean = sum / static_cast<double>(times.size());
+            const double p99 = times[static_cast<size_t>(0.99 * static_cast<double>(times.size() - 1))];
+            const double worst = times.back();
+
+            writer.writeRow(threads, mean, p99, worst, budgetUs);
+            logMessage(juce::String(threads) + " threads: mean " + juce::String(mean, 1)
+                       + " us, p99 " + juce::String(p99, 1)
+                       + " us, max " + juce::String(worst, 1)
+                       + " us (budget " + juce::String(budgetUs, 1) + " us)");
+        }
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    MultiTrackLooperEngineTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
@@ -0,0 +1,517 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <flowerjuce/LooperEngine/LooperTrackEngine.h>
+#include <flowerjuce/LooperEngine/ReadHeadKernels.h>
+#include <flowerjuce/LooperEngine/TapeChunkPool.h>
+#include <flowerjuce/Panners/StereoPanner.h>
+#include <flowerjuce/Panners/CLEATPanner.h>
+#include "TestUtils.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+// Tapes hold one plane per channel. Checks that the planar kernels match the
+// mono ones plane by plane, that a stereo track records and plays back both
+// sides (panned as two sources), that mono reads of a stereo tape are the
+// channel average, that loading and rate conversion keep every channel, and
+// that a block read through one view survives the tape changing channel
+// count, capacity and storage kind underneath it.
+// The benchmark compares stereo and mono read cost.
+class MultichannelTapeTests : public juce::UnitTest
+{
+public:
+    MultichannelTapeTests() : juce::UnitTest("MultichannelTapeTests") {}
+
+    void runTest() override
+    {
+        beginTest("Planar kernels match the mono kernel per plane");
+        testPlanarKernels();
+
+        beginTest("Stereo track records both inputs");
+        testStereoRecording(false);
+
+        beginTest("Chunked stereo track records both inputs");
+        testStereoRecording(true);
+
+        beginTest("Stereo playback keeps its image at the centre");
+        testStereoPlayback();
+
+        beginTest("Mono read of a stereo tape is the channel average");
+        testMonoDownmix();
+
+        beginTest("Stereo file and rate change keep both channels");
+        testLoadAndResample();
+
+        beginTest("Block reads see one storage across channel and capacity swaps");
+        testSwapWhileReading();
+
+        beginTest("Benchmark stereo read cost");
+        benchmarkPlanarRead();
+    }
+
+private:
+    static constexpr int blockSize = 256;
+    static constexpr double sampleRate = 48000.0;
+
+    static float leftValue(size_t i) { return static_cast<float>(0.5 * std::sin(0.01 * static_cast<double>(i))); }
+    static float rightValue(size_t i) { return static_cast<float>(0.3 * std::cos(0.023 * static_cast<double>(i))); }
+
+    static std::vector<float> makePositions(size_t bufferSize, int count, float start, float step)
+    {
+        std::vector<float> positions(static_cast<size_t>(count));
+        float position = start;
+        for (auto& value : positions)
+        {
+            value = position;
+            position += step;
+            if (position >= static_cast<float>(bufferSize))
+                position -= static_cast<float>(bufferSize);
+        }
+        return positions;
+    }
+
+    void testPlanarKernels()
+    {
+        const size_t bufferSize = 1000;
+        std::vector<std::vector<float>> planes(3, std::vector<float>(bufferSize));
+        for (size_t i = 0; i < bufferSize; ++i)
+        {
+            planes[0][i] = leftValue(i);
+            planes[1][i] = rightValue(i);
+            planes[2][i] = static_cast<float>(i % 7) * 0.1f;
+        }
+
+        const int count = 301;
+        // Crosses the end of the buffer so the wrap fallback runs too
+        const auto positions = makePositions(bufferSize, count, 850.25f, 0.73f);
+
+        std::array<const float*, 3> planePointers{ planes[0].data(), planes[1].data(), planes[2].data() };
+        std::vector<std::vector<float>> outputs(3, std::vector<float>(static_cast<size_t>(count)));
+        std::array<float*, 3> outputPointers{ outputs[0].data(), outputs[1].data(), outputs[2].data() };
+        ReadHeadKernels::interpolate_positions_planar(planePointers.data(), 3, bufferSize, positions.data(),
+                                                      outputPointers.data(), count);
+
+        bool matches = true;
+        std::vector<float> expected(static_cast<size_t>(count));
+        for (size_t plane = 0; plane < planes.size(); ++plane)
+        {
+            ReadHeadKernels::interpolate_positions(planes[plane].data(), bufferSize, positions.data(), expected.data(), count);
+            matches = matches && expected == outputs[plane];
+        }
+        expect(matches, "contiguous planes");
+
+        // Positions may share storage with the first output
+        std::vector<float> inPlace = positions;
+        std::array<float*, 3> inPlacePointers{ inPlace.data(), outputs[1].data(), outputs[2].data() };
+        ReadHeadKernels::interpolate_positions_planar(planePointers.data(), 3, bufferSize, inPlace.data(),
+                                                      inPlacePointers.data(), count);
+        expect(inPlace == outputs[0], "positions aliased with the first output");
+
+        // Chunked planes, crossing a chunk boundary and the end of the tape
+        auto pool = std::make_shared<TapeChunkPool>(TapeChunkPool::chunks_for_duration(sampleRate, 8.0));
+        TapeLoop tape;
+        tape.allocate_chunked(pool, sampleRate, 2.0, 2);
+        const size_t tapeSize = tape.get_buffer_size();
+        for (size_t i = 0; i < tapeSize; ++i)
+        {
+            *tape.get_writable_sample(i, 0) = leftValue(i);
+            *tape.get_writable_sample(i, 1) = rightValue(i);
+        }
+
+        for (const float start : { static_cast<float>(TapeChunkPool::kChunkSize) - 100.3f, static_cast<float>(tapeSize) - 100.3f })
+        {
+            const auto chunkPositions = makePositions(tapeSize, count, start, 0.73f);
+            std::array<const std::atomic<float*>*, 2> tables{ tape.get_chunk_table(0), tape.get_chunk_table(1) };
+            std::array<float*, 2> chunkedPointers{ outputs[0].data(), outputs[1].data() };
+            ReadHeadKernels::interpolate_positions_chunked_planar(tables.data(), 2, TapeChunkPool::kChunkSizeLog2, tapeSize,
+                                                                  chunkPositions.data(), chunkedPointers.data(), count);
+            bool chunkedMatches = true;
+            for (int plane = 0; plane < 2; ++plane)
+            {
+                ReadHeadKernels::interpolate_positions_chunked(tables[static_cast<size_t>(plane)], TapeChunkPool::kChunkSizeLog2,
+                                                               tapeSize, chunkPositions.data(), expected.data(), count);
+                chunkedMatches = chunkedMatches && expected == outputs[static_cast<size_t>(plane)];
+            }
+            expect(chunkedMatches, "chunked planes from " + juce::String(start));
+        }
+    }
+
+    struct Track
+    {
+        LooperTrackEngine engine;
+        StereoPanner panner;
+        juce::AudioBuffer<float> input{2, blockSize};
+        juce::AudioBuffer<float> output{2, blockSize};
+
+        explicit Track(std::shared_ptr<TapeChunkPool> pool = nullptr)
+        {
+            engine.initialize(sampleRate, 4.0);
+            engine.audio_device_about_to_start(sampleRate, blockSize);
+            if (pool != nullptr)
+                engine.set_chunk_pool(std::move(pool), sampleRate, 4.0);
+            engine.set_num_channels(2);
+            engine.set_overdub_mix(0.0f); // Record the input as is
+            engine.set_panner(&panner);
+            input.clear();
+        }
+
+        void process()
+        {
+            output.clear();
+            engine.process_block(input.getArrayOfReadPointers(), input.getNumChannels(),
+                                 output.getArrayOfWritePointers(), output.getNumChannels(), blockSize);
+        }
+
+        // A stereo loop of length samples, written straight to the tape
+        void fillLoop(size_t length)
+        {
+            auto& tape = engine.get_tape_loop();
+            for (size_t i = 0; i < length; ++i)
+            {
+                *tape.get_writable_sample(i, 0) = leftValue(i);
+                *tape.get_writable_sample(i, 1) = rightValue(i);
+            }
+            engine.set_recorded_length(length);
+            engine.set_has_recorded(true);
+            engine.set_loop_end(length);
+            engine.set_write_pos(length);
+            engine.set_pos(0.0f);
+        }
+    };
+
+    void testStereoRecording(bool chunked)
+    {
+        auto pool = chunked ? std::make_shared<TapeChunkPool>(TapeChunkPool::chunks_for_duration(sampleRate, 8.0)) : nullptr;
+        Track track(pool);
+        expectEquals(track.engine.get_num_channels(), 2);
+        expect(track.engine.is_chunked() == chunked);
+
+        juce::FloatVectorOperations::fill(track.input.getWritePointer(0), 0.25f, blockSize);
+        juce::FloatVectorOperations::fill(track.input.getWritePointer(1), -0.5f, blockSize);
+
+        track.engine.set_loop_end(track.engine.get_buffer_size());
+        track.engine.set_playing(true);
+        track.engine.set_record_enable(true);
+        const int numBlocks = 20;
+        for (int block = 0; block < numBlocks; ++block)
+            track.process();
+        track.engine.set_record_enable(false);
+        track.process(); // Finalizes the recording
+
+        expect(track.engine.has_recorded());
+        const size_t recorded = track.engine.get_recorded_length();
+        expectEquals(recorded, static_cast<size_t>(numBlocks * blockSize));
+
+        bool leftOk = true;
+        bool rightOk = true;
+        for (size_t i = 0; i < recorded; ++i)
+        {
+            leftOk = leftOk && track.engine.get_sample(i, 0) == 0.25f;
+            rightOk = rightOk && track.engine.get_sample(i, 1) == -0.5f;
+        }
+        expect(leftOk, "left plane holds input 0");
+        expect(rightOk, "right plane holds input 1");
+
+        // A single selected input fills every plane
+        Track selected(pool != nullptr ? std::make_shared<TapeChunkPool>(TapeChunkPool::chunks_for_duration(sampleRate, 8.0)) : nullptr);
+        juce::FloatVectorOperations::fill(selected.input.getWritePointer(0), 0.25f, blockSize);
+        juce::FloatVectorOperations::fill(selected.input.getWritePointer(1), -0.5f, blockSize);
+        selected.engine.set_input_channel(1);
+        selected.engine.set_loop_end(selected.engine.get_buffer_size());
+        selected.engine.set_playing(true);
+        selected.engine.set_record_enable(true);
+        selected.process();
+        selected.engine.set_record_enable(false);
+        selected.process();
+        expectEquals(selected.engine.get_sample(10, 0), -0.5f);
+        expectEquals(selected.engine.get_sample(10, 1), -0.5f);
+    }
+
+    void testStereoPlayback()
+    {
+        // Constant sides, so the low pass settles within the first block
+        Track track;
+        track.fillLoop(static_cast<size_t>(sampleRate));
+        auto& tape = track.engine.get_tape_loop();
+        for (size_t i = 0; i < static_cast<size_t>(sampleRate); ++i)
+        {
+            *tape.get_writable_sample(i, 0) = 0.25f;
+            *tape.get_writable_sample(i, 1) = -0.5f;
+        }
+        track.engine.set_playing(true);
+        track.process();
+        track.process();
+
+        // At the centre with full width the two planes land on their own sides
+        expectWithinAbsoluteError(track.output.getSample(0, blockSize - 1), 0.25f, 1.0e-3f);
+        expectWithinAbsoluteError(track.output.getSample(1, blockSize - 1), -0.5f, 1.0e-3f);
+
+        // Zero width collapses both sources onto the pan position
+        track.panner.set_source_width(0.0f);
+        track.process();
+        const float centre = PanningUtils::compute_stereo_gains(0.5f).first;
+        expectWithinAbsoluteError(track.output.getSample(0, blockSize - 1), -0.25f * centre, 1.0e-3f);
+        expectWithinAbsoluteError(track.output.getSample(1, blockSize - 1), -0.25f * centre, 1.0e-3f);
+
+        // The CLEAT panner takes the stereo source too, ramping per source
+        CLEATPanner cleat;
+        cleat.prepare(sampleRate);
+        std::array<float, blockSize> left{};
+        std::array<float, blockSize> right{};
+        for (int i = 0; i < blockSize; ++i)
+        {
+            left[static_cast<size_t>(i)] = 1.0f;
+            right[static_cast<size_t>(i)] = 1.0f;
+        }
+        std::array<const float*, 2> sources{ left.data(), right.data() };
+        juce::AudioBuffer<float> grid(16, blockSize);
+        grid.clear();
+        cleat.process_block(sources.data(), 2, grid.getArrayOfWritePointers(), 16, blockSize);
+        const auto leftGains = PanningUtils::compute_cleat_gains(0.0f, 0.5f);
+        const auto rightGains = PanningUtils::compute_cleat_gains(1.0f, 0.5f);
+        float maxError = 0.0f;
+        for (int channel = 0; channel < 16; ++channel)
+            maxError = juce::jmax(maxError, std::abs(grid.getSample(channel, blockSize - 1)
+                                                     - leftGains[static_cast<size_t>(channel)]
+                                                     - rightGains[static_cast<size_t>(channel)]));
+        expectLessThan(maxError, 1.0e-5f);
+    }
+
+    void testMonoDownmix()
+    {
+        Track track;
+        track.fillLoop(static_cast<size_t>(sampleRate));
+
+        auto& tape = track.engine.get_tape_loop();
+        LooperReadHead head(tape);
+        head.prepare(sampleRate);
+        head.set_loop_start(0.0f);
+        head.set_loop_end(static_cast<float>(sampleRate));
+        head.set_pos(100.5f);
+        head.set_speed(1.0f);
+        head.set_playing(true);
+
+        std::array<float, blockSize> mono{};
+        WrapInfo wrap;
+        head.process_block(mono.data(), blockSize, wrap);
+
+        float maxError = 0.0f;
+        for (int i = 0; i < blockSize; ++i)
+        {
+            const auto index = static_cast<size_t>(100 + i);
+            const float left = 0.5f * (leftValue(index) + leftValue(index + 1));
+            const float right = 0.5f * (rightValue(index) + rightValue(index + 1));
+            maxError = juce::jmax(maxError, std::abs(mono[static_cast<size_t>(i)] - 0.5f * (left + right)));
+        }
+        expectLessThan(maxError, 1.0e-5f);
+    }
+
+    void testLoadAndResample()
+    {
+        // Two channels of different constants, so any mixing shows
+        auto directory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("MultichannelTapeTests");
+        directory.createDirectory();
+        auto file = directory.getChildFile("stereo.wav");
+        file.deleteFile();
+        {
+            juce::AudioBuffer<float> audio(2, 24000);
+            juce::FloatVectorOperations::fill(audio.getWritePointer(0), 0.25f, 24000);
+            juce::FloatVectorOperations::fill(audio.getWritePointer(1), -0.5f, 24000);
+            juce::WavAudioFormat wav;
+            std::unique_ptr<juce::OutputStream> stream = std::make_unique<juce::FileOutputStream>(file);
+            auto options = juce::AudioFormatWriterOptions{}.withSampleRate(sampleRate).withNumChannels(2).withBitsPerSample(32);
+            std::unique_ptr<juce::AudioFormatWriter> writer(wav.createWriterFor(stream, options));
+            expect(writer != nullptr);
+            if (writer != nullptr)
+                writer->writeFromAudioSampleBuffer(audio, 0, 24000);
+        }
+
+        Track track;
+        expect(track.engine.load_from_file(file));
+        expect(track.engine.wait_for_load(5000));
+        expectEquals(track.engine.get_recorded_length(), static_cast<size_t>(24000));
+        expectEquals(track.engine.get_sample(12000, 0), 0.25f);
+        expectEquals(track.engine.get_sample(12000, 1), -0.5f);
+
+        // A mono track takes the average
+        LooperTrackEngine mono;
+        mono.initialize(sampleRate, 4.0);
+        mono.audio_device_about_to_start(sampleRate, blockSize);
+        expect(mono.load_from_file(file));
+        expect(mono.wait_for_load(5000));
+        expectEquals(mono.get_num_channels(), 1);
+        expectEquals(mono.get_sample(12000), -0.125f);
+
+        // A device rate change converts each plane on its own
+        track.engine.audio_device_about_to_start(44100.0, blockSize);
+        expect(track.engine.wait_for_resample(5000));
+        expectEquals(track.engine.get_num_channels(), 2);
+        expectEquals(track.engine.get_recorded_length(), static_cast<size_t>(22050));
+        expectWithinAbsoluteError(track.engine.get_sample(11000, 0), 0.25f, 1.0e-3f);
+        expectWithinAbsoluteError(track.engine.get_sample(11000, 1), -0.5f, 1.0e-3f);
+
+        file.deleteFile();
+    }
+
+    // A publisher cycles the tape through stereo, mono (larger) and chunked
+    // storage, each filled with one constant. Readers pin a block, read it
+    // planar and downmixed through the scope's view, and must see a single
+    // constant: planes, chunk tables and capacity all from the same storage.
+    void testSwapWhileReading()
+    {
+        TapeLoop tape;
+        tape.allocate_buffer(sampleRate, 0.25, 2);
+        auto pool = std::make_shared<TapeChunkPool>(TapeChunkPool::chunks_for_duration(sampleRate, 8.0));
+
+        std::atomic<bool> done{false};
+        std::atomic<int> mixedBlocks{0};
+        std::atomic<int> readBlocks{0};
+        std::vector<std::thread> readers;
+        for (int thread = 0; thread < 2; ++thread)
+        {
+            readers.emplace_back([&] {
+                LooperReadHead head(tape);
+                std::array<float, blockSize> positions{};
+                std::array<float, blockSize> left{};
+                std::array<float, blockSize> right{};
+                std::array<float, blockSize> mono{};
+                std::array<float*, 2> outputs{ left.data(), right.data() };
+                while (!done.load())
+                {
+                    const TapeLoop::ReadScope scope(tape);
+                    const auto& view = scope.get_view();
+                    const size_t capacity = view.get_buffer_size();
+                    if (capacity < 2)
+                        continue;
+
+                    // Spread over the whole tape, so a stale capacity would read past it
+                    const float step = static_cast<float>(capacity - 2) / static_cast<float>(blockSize);
+                    for (int i = 0; i < blockSize; ++i)
+                        positions[static_cast<size_t>(i)] = step * static_cast<float>(i);
+
+                    head.read_block(view, positions.data(), outputs.data(), 2, blockSize);
+                    head.read_block(view, positions.data(), mono.data(), blockSize);
+
+                    bool same = true;
+                    for (int i = 0; i < blockSize; ++i)
+                        same = same && left[static_cast<size_t>(i)] == left[0] && right[static_cast<size_t>(i)] == left[0]
+                               && mono[static_cast<size_t>(i)] == left[0];
+                    if (!same)
+                        mixedBlocks.fetch_add(1);
+                    readBlocks.fetch_add(1);
+                }
+            });
+        }
+
+        while (readBlocks.load() == 0)
+            std::this_thread::yield();
+
+        auto constantPlanes = [](int numChannels, size_t size, float value) {
+            return std::vector<std::vector<float>>(static_cast<size_t>(numChannels), std::vector<float>(size, value));
+        };
+
+        const int numSwaps = 150;
+        for (int swap = 0; swap < numSwaps; ++swap)
+        {
+            const float value = static_cast<float>(swap + 1);
+            const size_t size = static_cast<size_t>(sampleRate) / 4 + static_cast<size_t>(swap % 5) * 3000;
+            switch (swap % 3)
+            {
+                case 0:
+                    tape.allocate_buffer(sampleRate, 0.25, 2);
+                    tape.publish_buffer(constantPlanes(2, size, value), size, true);
+                    break;
+                case 1:
+                    tape.publish_buffer(constantPlanes(1, size * 2, value), size * 2, true);
+                    break;
+                default:
+                    tape.allocate_chunked(pool, sampleRate, 0.5, 1);
+                    tape.publish_buffer(constantPlanes(2, size, value), size, true);
+                    break;
+            }
+        }
+
+        done.store(true);
+        for (auto& reader : readers)
+            reader.join();
+
+        expectEquals(mixedBlocks.load(), 0);
+        expectGreaterThan(readBlocks.load(), 0);
+        expect(tape.is_chunked());
+        expectEquals(tape.get_num_channels(), 2);
+        expectEquals(tape.get_sample(100, 1), static_cast<float>(numSwaps));
+    }
+
+    void benchmarkPlanarRead()
+    {
+        TestUtils::CsvWriter writer("multichannel_read_benchmark",
+                                    {"Storage", "Channels", "Ns_per_frame", "Ns_per_sample"});
+
+        const size_t bufferSize = static_cast<size_t>(sampleRate * 4.0);
+        const int frames = 4096;
+        const int iterations = 2000;
+        const auto positions = makePositions(bufferSize, frames, 123.4f, 1.37f);
+
+        std::vector<std::vector<float>> planes(2, std::vector<float>(bufferSize));
+        for (size_t i = 0; i < bufferSize; ++i)
+        {
+            planes[0][i] = leftValue(i);
+            planes[1][i] = rightValue(i);
+        }
+        std::vector<std::vector<float>> outputs(2, std::vector<float>(static_cast<size_t>(frames)));
+        std::array<const float*, 2> planePointers{ planes[0].data(), planes[1].data() };
+        std::array<float*, 2> outputPointers{ outputs[0].data(), outputs[1].data() };
+
+        auto pool = std::make_shared<TapeChunkPool>(TapeChunkPool::chunks_for_duration(sampleRate, 8.0));
+        TapeLoop chunked;
+        chunked.allocate_chunked(pool, sampleRate, 4.0, 2);
+        std::array<const std::atomic<float*>*, 2> tables{ chunked.get_chunk_table(0), chunked.get_chunk_table(1) };
+
+        float sink = 0.0f;
+        auto time = [&](const juce::String& storage, int channels, auto&& read)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (int iteration = 0; iteration < iterations; ++iteration)
+            {
+                read();
+                sink += outputs[0][static_cast<size_t>(iteration % frames)];
+            }
+            const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count()
+                            / (static_cast<double>(iterations) * frames);
+            writer.writeRow(storage, channels, ns, ns / channels);
+            logMessage(storage + " x" + juce::String(channels) + ": " + juce::String(ns, 2) + " ns/frame, "
+                       + juce::String(ns / channels, 2) + " ns/sample");
+        };
+
+        time("contiguous", 1, [&] {
+            ReadHeadKernels::interpolate_positions(planePointers[0], bufferSize, positions.data(), outputs[0].data(), frames);
+        });
+        time("contiguous_two_passes", 2, [&] {
+            ReadHeadKernels::interpolate_positions(planePointers[0], bufferSize, positions.data(), outputs[0].data(), frames);
+            ReadHeadKernels::interpolate_positions(planePointers[1], bufferSize, positions.data(), outputs[1].data(), frames);
+        });
+        time("contiguous_planar", 2, [&] {
+            ReadHeadKernels::interpolate_positions_planar(planePointers.data(), 2, bufferSize, positions.data(),
+                                                          outputPointers.data(), frames);
+        });
+        time("chunked_planar", 1, [&] {
+            ReadHeadKernels::interpolate_positions_chunked_planar(tables.data(), 1, TapeChunkPool::kChunkSizeLog2, bufferSize,
+                                                                  positions.data(), outputPointers.data(), frames);
+        });
+        time("chunked_planar", 2, [&] {
+            ReadHeadKernels::interpolate_positions_chunked_planar(tables.data(), 2, TapeChunkPool::kChunkSizeLog2, bufferSize,
+                                                                  positions.data(), outputPointers.data(), frames);
+        });
+        expect(std::isfinite(sink));
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    MultichannelTapeTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
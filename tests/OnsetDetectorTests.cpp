@@ -0,0 +1,292 @@
+#include <juce_core/juce_core.h>
+#include <flowerjuce/DSP/SpectralFluxOnsetDetector.h>
+#include <flowerjuce/Debug/AudioAllocationGuard.h>
+#include "TestUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+// Spectral-flux onset detection: accuracy against a labelled signal of loud
+// and soft transients over a sustained tone, block-size independence of the
+// reported positions, no false onset when the detection function changes
+// mid-stream, and a throughput benchmark.
+class OnsetDetectorTests : public juce::UnitTest
+{
+public:
+    OnsetDetectorTests() : juce::UnitTest("OnsetDetectorTests") {}
+
+    void runTest() override
+    {
+        beginTest("Labelled transients are detected");
+        testLabelledTransients();
+
+        beginTest("Positions do not depend on block size");
+        testBlockSizeIndependence();
+
+        beginTest("Each detector owns its FFT plan");
+        testOwnFft();
+
+        beginTest("Switching detection function does not fire");
+        testFunctionSwitch();
+
+        beginTest("Benchmark detector throughput");
+        benchmarkThroughput();
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int maxOnsetsPerBlock = 16;
+
+    struct LabelledSignal
+    {
+        std::vector<float> samples;
+        std::vector<juce::int64> onsets;
+    };
+
+    // Low noise floor plus a steady 220 Hz tone (should never trigger), with
+    // transients every 250-400 ms alternating loud noise bursts, soft
+    // (-30 dB) plucks and soft clicks.
+    static LabelledSignal makeLabelledSignal(double seconds)
+    {
+        std::mt19937 rng(42);
+        std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+        std::uniform_int_distribution<int> gap(static_cast<int>(0.25 * sampleRate), static_cast<int>(0.4 * sampleRate));
+
+        LabelledSignal signal;
+        const auto length = static_cast<size_t>(seconds * sampleRate);
+        signal.samples.resize(length);
+        for (size_t i = 0; i < length; ++i)
+        {
+            const double t = static_cast<double>(i) / sampleRate;
+            signal.samples[i] = 0.001f * noise(rng)
+                              + 0.1f * static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * 220.0 * t));
+        }
+
+        int kind = 0;
+        for (juce::int64 position = gap(rng); position < static_cast<juce::int64>(length) - 24000; position += gap(rng))
+        {
+            signal.onsets.push_back(position);
+            const auto start = static_cast<size_t>(position);
+            for (size_t i = 0; i < 12000 && start + i < length; ++i)
+            {
+                const double t = static_cast<double>(i) / sampleRate;
+                float value = 0.0f;
+                switch (kind % 3)
+                {
+                    case 0: value = 0.8f * noise(rng) * static_cast<float>(std::exp(-t / 0.03)); break;
+                    case 1: value = 0.03f * static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * 880.0 * t) * std::exp(-t / 0.08)); break;
+                    default: value = 0.02f * noise(rng) * static_cast<float>(std::exp(-t / 0.01)); break;
+                }
+                signal.samples[start + i] += value;
+            }
+            ++kind;
+        }
+        return signal;
+    }
+
+    std::vector<SpectralFluxOnsetDetector::Onset> detect(SpectralFluxOnsetDetector& detector,
+                                                         const std::vector<float>& samples, int blockSize)
+    {
+        std::vector<SpectralFluxOnsetDetector::Onset> found;
+        std::array<SpectralFluxOnsetDetector::Onset, maxOnsetsPerBlock> onsets;
+        for (size_t start = 0; start < samples.size(); start += static_cast<size_t>(blockSize))
+        {
+            const int count = static_cast<int>(std::min(samples.size() - start, static_cast<size_t>(blockSize)));
+            const int numOnsets = detector.process_block(samples.data() + start, count, onsets.data(), maxOnsetsPerBlock);
+            for (int i = 0; i < numOnsets; ++i)
+            {
+                // Reported offsets must lie inside the block that produced them
+                const int offset = onsets[static_cast<size_t>(i)].sample_offset;
+                expect(offset >= 0 && offset < count, "sample offset " + juce::String(offset));
+                found.push_back(onsets[static_cast<size_t>(i)]);
+            }
+        }
+        return found;
+    }
+
+    struct Score
+    {
+        double precision{0.0};
+        double recall{0.0};
+        double fMeasure{0.0};
+        double meanErrorMs{0.0};
+    };
+
+    // Greedy one-to-one matching within +/- toleranceMs
+    static Score score(const std::vector<juce::int64>& labels,
+                       const std::vector<SpectralFluxOnsetDetector::Onset>& detected, double toleranceMs)
+    {
+        const auto tolerance = static_cast<juce::int64>(toleranceMs * 0.001 * sampleRate);
+        std::vector<bool> used(detected.size(), false);
+        int hits = 0;
+        double errorSum = 0.0;
+        for (auto label : labels)
+        {
+            for (size_t i = 0; i < detected.size(); ++i)
+            {
+                const auto error = std::abs(detected[i].stream_position - label);
+                if (!used[i] && error <= tolerance)
+                {
+                    used[i] = true;
+                    ++hits;
+                    errorSum += 1000.0 * static_cast<double>(error) / sampleRate;
+                    break;
+                }
+            }
+        }
+
+        Score result;
+        result.precision = detected.empty() ? 0.0 : static_cast<double>(hits) / static_cast<double>(detected.size());
+        result.recall = labels.empty() ? 0.0 : static_cast<double>(hits) / static_cast<double>(labels.size());
+        const double sum = result.precision + result.recall;
+        result.fMeasure = sum > 0.0 ? 2.0 * result.precision * result.recall / sum : 0.0;
+        result.meanErrorMs = hits > 0 ? errorSum / hits : 0.0;
+        return result;
+    }
+
+    void testLabelledTransients()
+    {
+        const auto signal = makeLabelledSignal(30.0);
+        TestUtils::CsvWriter writer("spectral_flux_accuracy",
+                                    {"Function", "Labels", "Detected", "Precision", "Recall", "F", "MeanErrorMs"});
+
+        for (auto function : { SpectralFluxOnsetDetector::DetectionFunction::SpectralFlux,
+                               SpectralFluxOnsetDetector::DetectionFunction::HighFrequencyContent })
+        {
+            const bool isFlux = function == SpectralFluxOnsetDetector::DetectionFunction::SpectralFlux;
+            SpectralFluxOnsetDetector detector;
+            detector.prepare(sampleRate);
+            detector.set_detection_function(function);
+
+            AudioAllocationGuard::reset_violation_count();
+            std::vector<SpectralFluxOnsetDetector::Onset> detected;
+            {
+                const AudioAllocationGuard guard;
+                std::array<SpectralFluxOnsetDetector::Onset, maxOnsetsPerBlock> onsets;
+                for (size_t start = 0; start + 256 <= signal.samples.size(); start += 256)
+                {
+                    const int numOnsets = detector.process_block(signal.samples.data() + start, 256, onsets.data(), maxOnsetsPerBlock);
+                    for (int i = 0; i < numOnsets; ++i)
+                    {
+                        const AudioAllocationGuard::ScopedAllow allowCollecting;
+                        detected.push_back(onsets[static_cast<size_t>(i)]);
+                    }
+                }
+            }
+            expectEquals(static_cast<int>(AudioAllocationGuard::get_violation_count()), 0, "process_block allocated");
+
+            const auto result = score(signal.onsets, detected, 25.0);
+            const juce::String name = isFlux ? "SpectralFlux" : "HFC";
+            writer.writeRow(name.toStdString(), signal.onsets.size(), detected.size(),
+                            result.precision, result.recall, result.fMeasure, result.meanErrorMs);
+            logMessage(name + ": " + juce::String(detected.size()) + " detected / " + juce::String(static_cast<int>(signal.onsets.size()))
+                       + " labelled, P " + juce::String(result.precision, 3)
+                       + " R " + juce::String(result.recall, 3)
+                       + " F " + juce::String(result.fMeasure, 3)
+                       + ", mean error " + juce::String(result.meanErrorMs, 2) + " ms");
+
+            expectGreaterThan(result.fMeasure, 0.95, name + " F-measure");
+            expectLessThan(result.meanErrorMs, 5.0, name + " timing error");
+        }
+    }
+
+    void testBlockSizeIndependence()
+    {
+        const auto signal = makeLabelledSignal(10.0);
+        std::vector<juce::int64> reference;
+        for (int blockSize : { 256, 64, 37, 500, 4096 })
+        {
+            SpectralFluxOnsetDetector detector;
+            detector.prepare(sampleRate);
+            std::vector<juce::int64> positions;
+            for (const auto& onset : detect(detector, signal.samples, blockSize))
+                positions.push_back(onset.stream_position);
+
+            if (reference.empty())
+                reference = positions;
+            else
+                expect(positions == reference, "block size " + juce::String(blockSize));
+        }
+        expectGreaterThan(static_cast<int>(reference.size()), 0);
+    }
+
+    // Detectors on different render threads must not queue on one plan's lock
+    void testOwnFft()
+    {
+        SpectralFluxOnsetDetector a;
+        SpectralFluxOnsetDetector b;
+        expect(a.get_fft() != nullptr);
+        expect(a.get_fft() != b.get_fft(), "detectors do not share an FFT plan");
+    }
+
+    void testFunctionSwitch()
+    {
+        // A steady tone over a noise floor: nothing here is an onset
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+        std::vector<float> tone(static_cast<size_t>(sampleRate));
+        for (size_t i = 0; i < tone.size(); ++i)
+            tone[i] = 0.3f * static_cast<float>(std::sin(2.0 * juce::MathConstants<double>::pi * 220.0 * static_cast<double>(i) / sampleRate))
+                    + 0.001f * noise(rng);
+
+        SpectralFluxOnsetDetector detector;
+        detector.prepare(sampleRate);
+        detect(detector, tone, 256); // Settle on the tone
+
+        for (auto function : { SpectralFluxOnsetDetector::DetectionFunction::HighFrequencyContent,
+                               SpectralFluxOnsetDetector::DetectionFunction::SpectralFlux,
+                               SpectralFluxOnsetDetector::DetectionFunction::HighFrequencyContent })
+        {
+            detector.set_detection_function(function);
+            const auto onsets = detect(detector, tone, 256);
+            expectEquals(static_cast<int>(onsets.size()), 0,
+                         function == SpectralFluxOnsetDetector::DetectionFunction::SpectralFlux ? "switch to flux" : "switch to HFC");
+        }
+    }
+
+    void benchmarkThroughput()
+    {
+        const auto signal = makeLabelledSignal(20.0);
+        TestUtils::CsvWriter writer("spectral_flux_benchmark",
+                                    {"Function", "BlockSize", "NsPerSample", "RealtimeFactor"});
+
+        for (auto function : { SpectralFluxOnsetDetector::DetectionFunction::SpectralFlux,
+                               SpectralFluxOnsetDetector::DetectionFunction::HighFrequencyContent })
+        {
+            for (int blockSize : { 64, 256, 1024 })
+            {
+                SpectralFluxOnsetDetector detector;
+                detector.prepare(sampleRate);
+                detector.set_detection_function(function);
+                std::array<SpectralFluxOnsetDetector::Onset, maxOnsetsPerBlock> onsets;
+
+                int totalOnsets = 0;
+                const auto start = std::chrono::steady_clock::now();
+                for (size_t offset = 0; offset + static_cast<size_t>(blockSize) <= signal.samples.size(); offset += static_cast<size_t>(blockSize))
+                    totalOnsets += detector.process_block(signal.samples.data() + offset, blockSize, onsets.data(), maxOnsetsPerBlock);
+                const auto end = std::chrono::steady_clock::now();
+
+                const double seconds = std::chrono::duration<double>(end - start).count();
+                const double nsPerSample = 1.0e9 * seconds / static_cast<double>(signal.samples.size());
+                const double realtimeFactor = (static_cast<double>(signal.samples.size()) / sampleRate) / seconds;
+                const juce::String name = function == SpectralFluxOnsetDetector::DetectionFunction::SpectralFlux ? "SpectralFlux" : "HFC";
+
+                writer.writeRow(name.toStdString(), blockSize, nsPerSample, realtimeFactor);
+                logMessage(name + " block " + juce::String(blockSize) + ": " + juce::String(nsPerSample, 2)
+                           + " ns/sample, " + juce::String(realtimeFactor, 0) + "x realtime ("
+                           + juce::String(totalOnsets) + " onsets)");
+                expectGreaterThan(realtimeFactor, 1.0);
+            }
+        }
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    OnsetDetectorTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
@@ -0,0 +1,388 @@
+#include <juce_core/juce_core.h>
+#include <juce_audio_formats/juce_audio_formats.h>
+#include <CLAP/PaletteBuildPipeline.h>
+#include "TestUtils.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+using Unsound4All::PaletteBuildPipeline;
+using Unsound4All::PaletteFile;
+
+// The build pipeline must chunk exactly what the serial path did (48 kHz
+// mono, zero-padded chunks, silent ones skipped), produce the same contents
+// whatever the number of decode threads, keep chunks and features paired
+// when a chunk fails, and stop when cancelled. The benchmark compares its
+// throughput with the serial chunk-to-WAV, re-read and embed path it replaces.
+class PaletteBuildPipelineTests : public juce::UnitTest
+{
+public:
+    PaletteBuildPipelineTests() : juce::UnitTest("PaletteBuildPipelineTests") {}
+
+    void runTest() override
+    {
+        tempDirectory.deleteRecursively();
+        tempDirectory.createDirectory();
+
+        beginTest("Chunks, silence, rate conversion and source order");
+        testChunking();
+
+        beginTest("Chunk WAVs are optional");
+        testChunkFiles();
+
+        beginTest("Failed files and chunks, cancellation");
+        testFailuresAndCancel();
+
+        beginTest("Benchmark throughput against the serial build");
+        benchmarkThroughput();
+
+        tempDirectory.deleteRecursively();
+    }
+
+private:
+    static constexpr int chunkSeconds = 10;
+    static constexpr int chunkSamples = chunkSeconds * 48000;
+
+    juce::File tempDirectory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("PaletteBuildPipelineTests");
+
+    // A 16-bit WAV of a sine (amplitude 0 for silence) plus optional noise
+    static juce::File writeWav(const juce::File& file, double sampleRate, int numChannels, double seconds,
+                               float amplitude, float noise = 0.0f, unsigned int seed = 1)
+    {
+        const int numSamples = static_cast<int>(seconds * sampleRate);
+        juce::AudioBuffer<float> buffer(numChannels, numSamples);
+        std::mt19937 rng(seed);
+        std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+        for (int channel = 0; channel < numChannels; ++channel)
+            for (int i = 0; i < numSamples; ++i)
+                buffer.setSample(channel, i, amplitude * std::sin(2.0f * juce::MathConstants<float>::pi * 220.0f * static_cast<float>(i / sampleRate))
+                                             + noise * dist(rng));
+
+        juce::WavAudioFormat wavFormat;
+        std::unique_ptr<juce::OutputStream> stream = std::make_unique<juce::FileOutputStream>(file);
+        std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(stream,
+            juce::AudioFormatWriterOptions{}.withSampleRate(sampleRate).withNumChannels(numChannels).withBitsPerSample(16)));
+        writer->writeFromAudioSampleBuffer(buffer, 0, numSamples);
+        return file;
+    }
+
+    // RMS of the chunk and of its first second, then its first four samples
+    static std::vector<std::vector<float>> summaryFeatures(const std::vector<const float*>& waveforms, int numSamples)
+    {
+        std::vector<std::vector<float>> features;
+        for (const float* waveform : waveforms)
+        {
+            double sum = 0.0, head = 0.0;
+            for (int i = 0; i < numSamples; ++i)
+            {
+                sum += static_cast<double>(waveform[i]) * waveform[i];
+                if (i < 48000)
+                    head += static_cast<double>(waveform[i]) * waveform[i];
+            }
+            features.push_back({ static_cast<float>(std::sqrt(sum / numSamples)), static_cast<float>(std::sqrt(head / 48000.0)),
+                                 waveform[0], waveform[1], waveform[2], waveform[3] });
+        }
+        return features;
+    }
+
+    static PaletteBuildPipeline::Options makeOptions(int numDecodeThreads, bool writeChunkFiles)
+    {
+        PaletteBuildPipeline::Options options;
+        options.chunkSizeSeconds = chunkSeconds;
+        options.numDecodeThreads = numDecodeThreads;
+        options.maxQueuedChunks = 2; // Keeps the decode threads waiting on the queue
+        options.batchSize = 2;
+        options.writeChunkFiles = writeChunkFiles;
+        return options;
+    }
+
+    juce::File makeDir(const juce::String& name)
+    {
+        auto dir = tempDirectory.getChildFile(name);
+        dir.deleteRecursively();
+        dir.createDirectory();
+        return dir;
+    }
+
+    void testChunking()
+    {
+        const auto audioDir = makeDir("chunking_audio");
+        juce::Array<juce::File> files;
+        files.add(writeWav(audioDir.getChildFile("tone.wav"), 48000.0, 1, 25.0, 0.5f));   // 10 + 10 + 5 s
+        files.add(writeWav(audioDir.getChildFile("silent.wav"), 48000.0, 1, 12.0, 0.0f)); // Skipped
+        files.add(writeWav(audioDir.getChildFile("noise.wav"), 44100.0, 2, 12.0, 0.0f, 0.5f)); // Converted, 10 + 2 s
+
+        const auto paletteDir = makeDir("chunking_SOUND_PALETTE");
+        const auto result = PaletteBuildPipeline::run(files, paletteDir, makeOptions(3, false), summaryFeatures);
+        expect(result.ok);
+
+        const auto& contents = result.contents;
+        expectEquals(contents.getNumChunks(), 5);
+        expectEquals(result.stats.silentChunks, 2);
+        expectEquals(result.stats.failedFiles, 0);
+        expectEquals(contents.embeddingSize, 6);
+        if (contents.getNumChunks() != 5)
+            return;
+
+        // Only sources with chunks are listed, in the order given
+        expectEquals(contents.sourceFiles.size(), 2);
+        expect(contents.sourceFiles[0] == files[0].getFullPathName() && contents.sourceFiles[1] == files[2].getFullPathName());
+        const std::vector<int> expectedSources{ 0, 0, 0, 1, 1 };
+        const std::vector<double> expectedRanges{ 0.0, 10.0, 10.0, 10.0, 20.0, 5.0, 0.0, 10.0, 10.0, 2.0 };
+        expect(contents.chunkSources == expectedSources, "chunk sources");
+        bool rangesMatch = contents.chunkRanges.size() == expectedRanges.size();
+        for (size_t i = 0; rangesMatch && i < expectedRanges.size(); ++i)
+            rangesMatch = std::abs(contents.chunkRanges[i] - expectedRanges[i]) < 1.0e-3;
+        expect(rangesMatch, "chunk ranges");
+        expect(contents.chunkPaths.joinIntoString("").isEmpty(), "no chunk files written");
+
+        // A sine of amplitude 0.5 everywhere but in the padding of the last chunk
+        auto feature = [&](int chunk, int index) { return contents.embeddings[static_cast<size_t>(chunk * contents.embeddingSize + index)]; };
+        expectWithinAbsoluteError(feature(0, 0), 0.5f / std::sqrt(2.0f), 1.0e-3f);
+        expectWithinAbsoluteError(feature(2, 0), 0.5f / std::sqrt(2.0f) * std::sqrt(0.5f), 1.0e-3f);
+        expectWithinAbsoluteError(feature(2, 1), 0.5f / std::sqrt(2.0f), 1.0e-3f);
+        // Two independent uniform noises averaged, then linearly interpolated to
+        // 48k, which scales white noise by sqrt(2/3)
+        expectWithinAbsoluteError(feature(4, 1), 0.5f / std::sqrt(6.0f) * std::sqrt(2.0f / 3.0f), 0.01f);
+
+        // Same contents whatever the number of decode threads
+        const auto serial = PaletteBuildPipeline::run(files, paletteDir, makeOptions(1, false), summaryFeatures);
+        expect(serial.contents.embeddings == contents.embeddings && serial.contents.chunkRanges == contents.chunkRanges,
+               "one decode thread gives the same contents");
+
+        // And it is a valid palette whose chunks play from their sources
+        auto toWrite = contents;
+        toWrite.embeddingType = "STFT";
+        expect(PaletteFile::write(paletteDir, toWrite));
+        auto palette = PaletteFile::open(paletteDir);
+        expect(palette != nullptr && palette->hasChunkRanges());
+        if (palette != nullptr && palette->hasChunkRanges())
+        {
+            expect(palette->getChunkFile(2) == juce::File(), "no chunk file");
+            expect(palette->getSourceFile(2) == files[0]);
+            expect(palette->getChunkRange(2) == juce::Range<double>(20.0, 25.0));
+        }
+    }
+
+    void testChunkFiles()
+    {
+        const auto audioDir = makeDir("files_audio");
+        juce::Array<juce::File> files;
+        files.add(writeWav(audioDir.getChildFile("tone.wav"), 48000.0, 1, 15.0, 0.5f, 0.1f));
+
+        const auto paletteDir = makeDir("files_SOUND_PALETTE");
+        const auto result = PaletteBuildPipeline::run(files, paletteDir, makeOptions(2, true), summaryFeatures);
+        expect(result.ok);
+        expectEquals(result.contents.getNumChunks(), 2);
+        if (result.contents.getNumChunks() != 2)
+            return;
+
+        expectEquals(result.contents.chunkPaths[1], juce::String("tone_chunk0001.wav"));
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(paletteDir.getChildFile(result.contents.chunkPaths[1])));
+        expect(reader != nullptr);
+        if (reader == nullptr)
+            return;
+
+        // Full-length, 16-bit copy of what the features saw
+        expectEquals(static_cast<int>(reader->lengthInSamples), chunkSamples);
+        expectEquals(reader->sampleRate, 48000.0);
+        juce::AudioBuffer<float> buffer(1, 4);
+        reader->read(&buffer, 0, 4, 0, true, false);
+        for (int i = 0; i < 4; ++i)
+            expectWithinAbsoluteError(buffer.getSample(0, i), result.contents.embeddings[static_cast<size_t>(6 + 2 + i)], 1.0e-4f);
+    }
+
+    void testFailuresAndCancel()
+    {
+        const auto audioDir = makeDir("failures_audio");
+        juce::Array<juce::File> files;
+        files.add(writeWav(audioDir.getChildFile("tone.wav"), 48000.0, 1, 40.0, 0.5f));
+        audioDir.getChildFile("broken.wav").replaceWithText("not audio");
+        files.add(audioDir.getChildFile("broken.wav"));
+
+        // Every other chunk fails: its features are dropped along with it
+        const auto paletteDir = makeDir("failures_SOUND_PALETTE");
+        int calls = 0;
+        const auto result = PaletteBuildPipeline::run(files, paletteDir, makeOptions(2, false),
+            [&calls](const std::vector<const float*>& waveforms, int numSamples)
+            {
+                auto features = summaryFeatures(waveforms, numSamples);
+                for (auto& feature : features)
+                    if (calls++ % 2 == 1)
+                        feature.clear();
+                return features;
+            });
+        expect(result.ok);
+        expectEquals(result.stats.failedFiles, 1);
+        expectEquals(result.stats.failedChunks, 2);
+        expectEquals(result.contents.getNumChunks(), 2);
+        expectEquals(static_cast<int>(result.contents.embeddings.size()), 2 * 6);
+        expect(result.contents.chunkRanges.size() == 4 && result.contents.chunkRanges[2] == 20.0, "chunks 0 and 2 kept");
+
+        // Cancelling after the first batch stops the build
+        std::atomic<int> batches{0};
+        const auto start = std::chrono::steady_clock::now();
+        const auto cancelled = PaletteBuildPipeline::run(files, paletteDir, makeOptions(2, false),
+            [&batches](const std::vector<const float*>& waveforms, int numSamples)
+            {
+                ++batches;
+                return summaryFeatures(waveforms, numSamples);
+            },
+            nullptr, [&batches] { return batches.load() > 0; });
+        expect(!cancelled.ok);
+        expectEquals(batches.load(), 1);
+        expect(std::chrono::steady_clock::now() - start < std::chrono::seconds(5), "stops promptly");
+    }
+
+    // The serial build this pipeline replaces: per file, read it whole,
+    // resample with a per-sample interpolator, downmix with getSample() and
+    // write every chunk as a WAV; then reopen each chunk, downmix it again and
+    // compute its features one at a time
+    static int legacyBuild(const juce::Array<juce::File>& files, const juce::File& paletteDir,
+                           const PaletteBuildPipeline::FeatureFunction& features)
+    {
+        juce::AudioFormatManager formatManager;
+        formatManager.registerBasicFormats();
+        const double targetSampleRate = 48000.0;
+        juce::Array<juce::File> chunkFiles;
+
+        for (const auto& audioFile : files)
+        {
+            std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(audioFile));
+            juce::AudioBuffer<float> audioBuffer(static_cast<int>(reader->numChannels), static_cast<int>(reader->lengthInSamples));
+            reader->read(&audioBuffer, 0, static_cast<int>(reader->lengthInSamples), 0, true, true);
+
+            if (std::abs(reader->sampleRate - targetSampleRate) > 1.0)
+            {
+                const int outputSize = static_cast<int>(reader->lengthInSamples * targetSampleRate / reader->sampleRate);
+                juce::AudioBuffer<float> resampledBuffer(audioBuffer.getNumChannels(), outputSize);
+                for (int channel = 0; channel < audioBuffer.getNumChannels(); ++channel)
+                {
+                    for (int i = 0; i < outputSize; ++i)
+                    {
+                        const double srcPos = i * reader->sampleRate / targetSampleRate;
+                        const int srcIndex = static_cast<int>(srcPos);
+                        const double frac = srcPos - srcIndex;
+                        if (srcIndex + 1 < audioBuffer.getNumSamples())
+                        {
+                            const float sample1 = audioBuffer.getSample(channel, srcIndex);
+                            const float sample2 = audioBuffer.getSample(channel, srcIndex + 1);
+                            resampledBuffer.setSample(channel, i, static_cast<float>(sample1 + frac * (sample2 - sample1)));
+                        }
+                        else if (srcIndex < audioBuffer.getNumSamples())
+                        {
+                            resampledBuffer.setSample(channel, i, audioBuffer.getSample(channel, srcIndex));
+                        }
+                    }
+                }
+                audioBuffer = std::move(resampledBuffer);
+            }
+
+            if (audioBuffer.getNumChannels() > 1)
+            {
+                juce::AudioBuffer<float> monoBuffer(1, audioBuffer.getNumSamples());
+                for (int sample = 0; sample < audioBuffer.getNumSamples(); ++sample)
+                {
+                    float sum = 0.0f;
+                    for (int channel = 0; channel < audioBuffer.getNumChannels(); ++channel)
+                        sum += audioBuffer.getSample(channel, sample);
+                    monoBuffer.setSample(0, sample, sum / static_cast<float>(audioBuffer.getNumChannels()));
+                }
+                audioBuffer = std::move(monoBuffer);
+            }
+
+            const int numChunks = static_cast<int>(std::ceil(static_cast<double>(audioBuffer.getNumSamples()) / chunkSamples));
+            for (int chunkIndex = 0; chunkIndex < numChunks; ++chunkIndex)
+            {
+                const int startSample = chunkIndex * chunkSamples;
+                const int numSamplesInChunk = juce::jmin(chunkSamples, audioBuffer.getNumSamples() - startSample);
+                juce::AudioBuffer<float> chunkBuffer(1, chunkSamples);
+                chunkBuffer.clear();
+                float rms = 0.0f;
+                for (int i = 0; i < numSamplesInChunk; ++i)
+                {
+                    chunkBuffer.setSample(0, i, audioBuffer.getSample(0, startSample + i));
+                    rms += chunkBuffer.getSample(0, i) * chunkBuffer.getSample(0, i);
+                }
+                if (std::sqrt(rms / static_cast<float>(numSamplesInChunk)) < 0.001f)
+                    continue;
+
+                const auto chunkFile = paletteDir.getChildFile(audioFile.getFileNameWithoutExtension() + "_chunk" + juce::String(chunkIndex).paddedLeft('0', 4) + ".wav");
+                juce::WavAudioFormat wavFormat;
+                std::unique_ptr<juce::OutputStream> stream = std::make_unique<juce::FileOutputStream>(chunkFile);
+                std::unique_ptr<juce::AudioFormatWriter> writer(wavFormat.createWriterFor(stream,
+                    juce::AudioFormatWriterOptions{}.withSampleRate(targetSampleRate).withNumChannels(1).withBitsPerSample(16)));
+                writer->writeFromAudioSampleBuffer(chunkBuffer, 0, chunkSamples);
+                chunkFiles.add(chunkFile);
+            }
+        }
+
+        int embedded = 0;
+        for (const auto& chunkFile : chunkFiles)
+        {
+            std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(chunkFile));
+            juce::AudioBuffer<float> audioBuffer(static_cast<int>(reader->numChannels), static_cast<int>(reader->lengthInSamples));
+            reader->read(&audioBuffer, 0, static_cast<int>(reader->lengthInSamples), 0, true, true);
+            std::vector<float> waveform(static_cast<size_t>(audioBuffer.getNumSamples()));
+            for (int j = 0; j < audioBuffer.getNumSamples(); ++j)
+                waveform[static_cast<size_t>(j)] = audioBuffer.getSample(0, j);
+            if (!features({ waveform.data() }, static_cast<int>(waveform.size()))[0].empty())
+                ++embedded;
+        }
+        return embedded;
+    }
+
+    void benchmarkThroughput()
+    {
+        TestUtils::CsvWriter writer("palette_build_benchmark",
+                                    {"Method", "Files", "Chunks", "Decode_threads", "Seconds", "Chunks_per_second"});
+
+        // 44.1 kHz stereo sources, so every file is converted and downmixed
+        const auto audioDir = makeDir("bench_audio");
+        juce::Array<juce::File> files;
+        const int numFiles = 8;
+        for (int i = 0; i < numFiles; ++i)
+            files.add(writeWav(audioDir.getChildFile("source_" + juce::String(i) + ".wav"), 44100.0, 2, 60.0, 0.3f, 0.1f, static_cast<unsigned int>(i + 1)));
+
+        auto elapsedSeconds = [](std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        };
+        auto record = [&](const juce::String& method, int chunks, int threads, double seconds)
+        {
+            writer.writeRow(method, numFiles, chunks, threads, seconds, chunks / seconds);
+            logMessage(method + ": " + juce::String(chunks) + " chunks in " + juce::String(seconds, 2) + " s, "
+                       + juce::String(chunks / seconds, 1) + " chunks/s (" + juce::String(threads) + " decode threads)");
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        const int legacyChunks = legacyBuild(files, makeDir("bench_legacy_SOUND_PALETTE"), summaryFeatures);
+        record("serial_chunk_files", legacyChunks, 1, elapsedSeconds(start));
+
+        const int defaultThreads = juce::jmax(1, juce::SystemStats::getNumCpus() - 1);
+        struct Run { const char* name; int threads; bool writeChunkFiles; };
+        for (const auto& run : { Run{ "pipeline_chunk_files", 1, true },
+                                 Run{ "pipeline_chunk_files", defaultThreads, true },
+                                 Run{ "pipeline_offsets_only", defaultThreads, false } })
+        {
+            auto options = makeOptions(run.threads, run.writeChunkFiles);
+            options.maxQueuedChunks = 32;
+            options.batchSize = 8;
+            const auto result = PaletteBuildPipeline::run(files, makeDir("bench_pipeline_SOUND_PALETTE"), options, summaryFeatures);
+            expectEquals(result.contents.getNumChunks(), legacyChunks);
+            record(run.name, result.contents.getNumChunks(), run.threads, result.stats.seconds);
+        }
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    PaletteBuildPipelineTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
@@ -0,0 +1,427 @@
+#include <juce_core/juce_core.h>
+#include <CLAP/PaletteFile.h>
+#include "TestUtils.h"
+#include <chrono>
+#include <cstring>
+#include <random>
+
+using Unsound4All::PaletteFile;
+
+// palette.bin must round-trip everything SoundPaletteCreator and
+// PaletteVisualization store, intern repeated strings, convert legacy
+// metadata.json + embeddings.bin palettes, and refuse files that are not
+// palettes, come from a newer version, or point outside themselves. The
+// benchmark compares opening a palette the old way (parse the JSON, read
+// every embedding) with mapping palette.bin.
+class PaletteFileTests : public juce::UnitTest
+{
+public:
+    PaletteFileTests() : juce::UnitTest("PaletteFileTests") {}
+
+    void runTest() override
+    {
+        tempDirectory.deleteRecursively();
+        tempDirectory.createDirectory();
+
+        beginTest("Contents round-trip through palette.bin");
+        testRoundTrip();
+
+        beginTest("Visualization data is optional and replaceable");
+        testVisualization();
+
+        beginTest("Legacy palettes are migrated on open");
+        testMigration();
+
+        beginTest("Malformed files are rejected");
+        testRejectsMalformed();
+
+        beginTest("Benchmark legacy JSON load against mapping");
+        benchmarkOpen();
+
+        tempDirectory.deleteRecursively();
+    }
+
+private:
+    static constexpr int dimension = 16;
+
+    juce::File tempDirectory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("PaletteFileTests");
+
+    static std::vector<float> randomEmbeddings(int numRows, int dim, unsigned int seed)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> dist(0.0f, 1.0f);
+        std::vector<float> embeddings(static_cast<size_t>(numRows) * static_cast<size_t>(dim));
+        for (auto& value : embeddings)
+            value = dist(rng);
+        return embeddings;
+    }
+
+    // numChunks chunks in subfolders, every fourth one from the same source
+    static PaletteFile::Contents makeContents(int numChunks, int dim, unsigned int seed)
+    {
+        PaletteFile::Contents contents;
+        contents.embeddingSize = dim;
+        contents.embeddings = randomEmbeddings(numChunks, dim, seed);
+        contents.embeddingType = "CLAP";
+        for (int i = 0; i < numChunks / 4 + 1; ++i)
+            contents.sourceFiles.add("/audio/source_" + juce::String(i) + ".wav");
+        for (int i = 0; i < numChunks; ++i)
+        {
+            contents.chunkPaths.add("source_" + juce::String(i / 4) + "/chunk_" + juce::String(i) + ".wav");
+            contents.chunkSources.push_back(i % 7 == 3 ? -1 : i / 4);
+        }
+        return contents;
+    }
+
+    juce::File makePaletteDir(const juce::String& name)
+    {
+        auto paletteDir = tempDirectory.getChildFile(name);
+        paletteDir.deleteRecursively();
+        paletteDir.createDirectory();
+        return paletteDir;
+    }
+
+    // The pair SoundPaletteCreator wrote before palette.bin, with t-SNE data
+    // the way PaletteVisualization added it
+    static void writeLegacyFiles(const juce::File& paletteDir, const PaletteFile::Contents& contents)
+    {
+        juce::var metadata(new juce::DynamicObject());
+        juce::Array<juce::var> chunks;
+        for (int i = 0; i < contents.getNumChunks(); ++i)
+        {
+            juce::var chunkInfo(new juce::DynamicObject());
+            chunkInfo.getDynamicObject()->setProperty("index", i);
+            chunkInfo.getDynamicObject()->setProperty("filename", contents.chunkPaths[i].fromLastOccurrenceOf("/", false, false));
+            chunkInfo.getDynamicObject()->setProperty("path", contents.chunkPaths[i]);
+            chunkInfo.getDynamicObject()->setProperty("sourceFileIndex", contents.chunkSources[static_cast<size_t>(i)]);
+            chunks.add(chunkInfo);
+        }
+        juce::Array<juce::var> sourceFiles;
+        for (const auto& sourceFile : contents.sourceFiles)
+            sourceFiles.add(sourceFile);
+        metadata.getDynamicObject()->setProperty("sourceFiles", juce::var(sourceFiles));
+        metadata.getDynamicObject()->setProperty("numChunks", contents.getNumChunks());
+        metadata.getDynamicObject()->setProperty("embeddingSize", contents.embeddingSize);
+        metadata.getDynamicObject()->setProperty("embeddingType", contents.embeddingType);
+        metadata.getDynamicObject()->setProperty("chunks", juce::var(chunks));
+
+        if (!contents.coordinates.empty())
+        {
+            juce::Array<juce::var> coordinates;
+            juce::Array<juce::var> clusters;
+            for (int i = 0; i < contents.getNumChunks(); ++i)
+            {
+                juce::Array<juce::var> point;
+                point.add(contents.coordinates[2 * static_cast<size_t>(i)]);
+                point.add(contents.coordinates[2 * static_cast<size_t>(i) + 1]);
+                coordinates.add(juce::var(point));
+                clusters.add(contents.clusters[static_cast<size_t>(i)]);
+            }
+            metadata.getDynamicObject()->setProperty("tsneCoordinates", juce::var(coordinates));
+            metadata.getDynamicObject()->setProperty("clusterAssignments", juce::var(clusters));
+        }
+        paletteDir.getChildFile("metadata.json").replaceWithText(juce::JSON::toString(metadata));
+
+        juce::FileOutputStream stream(paletteDir.getChildFile("embeddings.bin"));
+        const int32_t header[2] = { contents.getNumChunks(), contents.embeddingSize };
+        stream.write(header, sizeof(header));
+        stream.write(contents.embeddings.data(), contents.embeddings.size() * sizeof(float));
+        stream.flush();
+    }
+
+    void expectMatches(const PaletteFile& palette, const PaletteFile::Contents& contents)
+    {
+        expectEquals(palette.getNumChunks(), contents.getNumChunks());
+        expectEquals(palette.getEmbeddingSize(), contents.embeddingSize);
+        expectEquals(palette.getNumSources(), contents.sourceFiles.size());
+        expectEquals(juce::String(palette.getEmbeddingType()), contents.embeddingType);
+        expect(std::memcmp(palette.getEmbeddings(), contents.embeddings.data(), contents.embeddings.size() * sizeof(float)) == 0,
+               "embeddings are stored bit for bit");
+
+        bool same = true;
+        for (int i = 0; same && i < contents.getNumChunks(); ++i)
+        {
+            const int source = contents.chunkSources[static_cast<size_t>(i)];
+            same = juce::String(palette.getChunkPath(i)) == contents.chunkPaths[i]
+                && palette.getChunkSource(i) == source
+                && palette.getChunkFile(i) == palette.getPaletteDir().getChildFile(contents.chunkPaths[i])
+                && palette.getSourceFile(i) == (source < 0 ? juce::File() : juce::File(contents.sourceFiles[source]));
+        }
+        expect(same, "chunk paths and sources");
+    }
+
+    void testRoundTrip()
+    {
+        const auto paletteDir = makePaletteDir("round_trip_SOUND_PALETTE");
+        const auto contents = makeContents(40, dimension, 1);
+        expect(PaletteFile::write(paletteDir, contents));
+
+        auto palette = PaletteFile::open(paletteDir);
+        expect(palette != nullptr);
+        if (palette == nullptr)
+            return;
+
+        expectMatches(*palette, contents);
+        expect(!palette->hasVisualization());
+        expect(reinterpret_cast<juce::pointer_sized_uint>(palette->getEmbeddings()) % 64 == 0, "embeddings are 64-byte aligned");
+
+        // Chunk paths, source paths and the embedding type, each once
+        expectEquals(palette->getNumStrings(), contents.getNumChunks() + contents.sourceFiles.size() + 1);
+
+        // Repeated strings share one entry
+        auto repeated = contents;
+        for (int i = 0; i < repeated.getNumChunks(); ++i)
+            repeated.chunkPaths.set(i, "chunk_" + juce::String(i % 5) + ".wav");
+        repeated.sourceFiles.set(1, repeated.sourceFiles[0]);
+        expect(PaletteFile::write(paletteDir, repeated));
+        palette = PaletteFile::open(paletteDir);
+        expect(palette != nullptr);
+        if (palette == nullptr)
+            return;
+        expectEquals(palette->getNumStrings(), 5 + repeated.sourceFiles.size() - 1 + 1);
+        expectMatches(*palette, repeated);
+
+        const auto readBack = palette->readContents();
+        expect(readBack.embeddings == repeated.embeddings && readBack.chunkPaths == repeated.chunkPaths
+               && readBack.chunkSources == repeated.chunkSources && readBack.sourceFiles == repeated.sourceFiles,
+               "readContents copies everything");
+
+        // Inconsistent contents are not written
+        auto bad = contents;
+        bad.chunkSources.back() = bad.sourceFiles.size();
+        expect(!PaletteFile::write(paletteDir, bad), "source index out of range");
+        bad = contents;
+        bad.embeddings.pop_back();
+        expect(!PaletteFile::write(paletteDir, bad), "short embeddings");
+        expect(PaletteFile::open(tempDirectory.getChildFile("missing")) == nullptr);
+    }
+
+    void testVisualization()
+    {
+        const auto paletteDir = makePaletteDir("visualization_SOUND_PALETTE");
+        const auto contents = makeContents(25, dimension, 2);
+        expect(PaletteFile::write(paletteDir, contents));
+
+        std::vector<float> coordinates;
+        std::vector<int> clusters;
+        for (int i = 0; i < contents.getNumChunks(); ++i)
+        {
+            coordinates.push_back(static_cast<float>(i));
+            coordinates.push_back(-0.5f * static_cast<float>(i));
+            clusters.push_back(i % 3 - 1);
+        }
+
+        // Held across the rewrite: earlier readers keep their snapshot
+        auto before = PaletteFile::open(paletteDir);
+        expect(PaletteFile::writeVisualization(paletteDir, coordinates, clusters));
+        expect(!PaletteFile::writeVisualization(paletteDir, coordinates, std::vector<int>(3, 0)), "cluster count mismatch");
+
+        auto palette = PaletteFile::open(paletteDir);
+        expect(palette != nullptr && palette->hasVisualization());
+        if (palette == nullptr || !palette->hasVisualization())
+            return;
+
+        expectMatches(*palette, contents);
+        expect(std::equal(coordinates.begin(), coordinates.end(), palette->getCoordinates()), "coordinates");
+        expect(std::equal(clusters.begin(), clusters.end(), palette->getClusters()), "clusters");
+        expect(before != nullptr && !before->hasVisualization(), "earlier snapshot unchanged");
+    }
+
+    void testMigration()
+    {
+        const auto paletteDir = makePaletteDir("legacy_SOUND_PALETTE");
+        auto contents = makeContents(30, dimension, 3);
+        contents.embeddingType = "STFT";
+        for (int i = 0; i < contents.getNumChunks(); ++i)
+        {
+            contents.coordinates.push_back(0.25f * static_cast<float>(i));
+            contents.coordinates.push_back(1.0f - 0.125f * static_cast<float>(i));
+            contents.clusters.push_back(i % 4);
+        }
+        writeLegacyFiles(paletteDir, contents);
+        expect(PaletteFile::hasLegacyFiles(paletteDir));
+
+        auto palette = PaletteFile::open(paletteDir);
+        expect(palette != nullptr);
+        if (palette == nullptr)
+            return;
+
+        expect(paletteDir.getChildFile(PaletteFile::kFileName).existsAsFile(), "palette.bin written");
+        expect(PaletteFile::hasLegacyFiles(paletteDir), "legacy files left in place");
+        expectMatches(*palette, contents);
+        expect(palette->hasVisualization());
+        if (palette->hasVisualization())
+        {
+            expect(std::equal(contents.coordinates.begin(), contents.coordinates.end(), palette->getCoordinates()), "coordinates");
+            expect(std::equal(contents.clusters.begin(), contents.clusters.end(), palette->getClusters()), "clusters");
+        }
+
+        // Palettes that only recorded file names keep their chunks at the root
+        auto metadata = juce::JSON::parse(paletteDir.getChildFile("metadata.json"));
+        for (auto& chunk : *metadata["chunks"].getArray())
+            chunk.getDynamicObject()->removeProperty("path");
+        paletteDir.getChildFile("metadata.json").replaceWithText(juce::JSON::toString(metadata));
+        expect(PaletteFile::migrate(paletteDir));
+        palette = PaletteFile::open(paletteDir);
+        expect(palette != nullptr && palette->getChunkFile(5) == paletteDir.getChildFile("chunk_5.wav"), "filename fallback");
+
+        // Chunk and embedding counts must agree
+        const auto mismatched = makePaletteDir("mismatched_SOUND_PALETTE");
+        writeLegacyFiles(mismatched, makeContents(10, dimension, 4));
+        juce::FileOutputStream stream(mismatched.getChildFile("embeddings.bin"));
+        stream.setPosition(0);
+        const int32_t nine = 9;
+        stream.write(&nine, sizeof(nine));
+        stream.flush();
+        expect(PaletteFile::open(mismatched) == nullptr);
+        expect(!mismatched.getChildFile(PaletteFile::kFileName).exists(), "nothing written for a bad legacy palette");
+    }
+
+    // Overwrites 4 bytes of palette.bin at offset
+    static void patch(const juce::File& paletteDir, juce::int64 offset, juce::uint32 value)
+    {
+        juce::FileOutputStream stream(paletteDir.getChildFile(PaletteFile::kFileName));
+        stream.setPosition(offset);
+        stream.write(&value, sizeof(value));
+        stream.flush();
+    }
+
+    // Offset in the file of the section with the given id, from the section table
+    static juce::int64 sectionOffset(const juce::File& paletteDir, juce::uint32 id)
+    {
+        juce::MemoryBlock data;
+        paletteDir.getChildFile(PaletteFile::kFileName).loadFileAsData(data);
+        const auto* bytes = static_cast<const char*>(data.getData());
+        juce::uint32 numSections = 0;
+        juce::uint64 tableOffset = 0;
+        std::memcpy(&numSections, bytes + 12, sizeof(numSections));
+        std::memcpy(&tableOffset, bytes + 40, sizeof(tableOffset));
+        for (juce::uint32 i = 0; i < numSections; ++i)
+        {
+            const char* entry = bytes + tableOffset + i * 24;
+            juce::uint32 entryId = 0;
+            juce::uint64 offset = 0;
+            std::memcpy(&entryId, entry, sizeof(entryId));
+            std::memcpy(&offset, entry + 8, sizeof(offset));
+            if (entryId == id)
+                return static_cast<juce::int64>(offset);
+        }
+        return -1;
+    }
+
+    void testRejectsMalformed()
+    {
+        const auto paletteDir = makePaletteDir("malformed_SOUND_PALETTE");
+        const auto contents = makeContents(12, dimension, 5);
+        auto rewrite = [&] { expect(PaletteFile::write(paletteDir, contents)); };
+
+        rewrite();
+        expect(PaletteFile::open(paletteDir) != nullptr);
+
+        patch(paletteDir, 0, 0x12345678);
+        expect(PaletteFile::open(paletteDir) == nullptr, "bad magic");
+
+        rewrite();
+        patch(paletteDir, 4, PaletteFile::kVersion + 1);
+        expect(PaletteFile::open(paletteDir) == nullptr, "newer version");
+
+        rewrite();
+        patch(paletteDir, 16, 13);
+        expect(PaletteFile::open(paletteDir) == nullptr, "chunk count disagrees with section sizes");
+
+        rewrite();
+        patch(paletteDir, sectionOffset(paletteDir, 4), static_cast<juce::uint32>(contents.sourceFiles.size()));
+        expect(PaletteFile::open(paletteDir) == nullptr, "chunk source out of range");
+
+        rewrite();
+        patch(paletteDir, sectionOffset(paletteDir, 5), 100000);
+        expect(PaletteFile::open(paletteDir) == nullptr, "string id out of range");
+
+        rewrite();
+        const auto file = paletteDir.getChildFile(PaletteFile::kFileName);
+        juce::MemoryBlock data;
+        file.loadFileAsData(data);
+        file.replaceWithData(data.getData(), data.getSize() / 2);
+        expect(PaletteFile::open(paletteDir) == nullptr, "truncated");
+
+        file.replaceWithText("short");
+        expect(PaletteFile::open(paletteDir) == nullptr, "shorter than the header");
+    }
+
+    // What opening a palette cost before: parse metadata.json for the chunk
+    // paths, then read every embedding into memory
+    static int legacyOpen(const juce::File& paletteDir, std::vector<float>& embeddings, juce::Array<juce::File>& chunkFiles)
+    {
+        juce::var metadata = juce::JSON::parse(paletteDir.getChildFile("metadata.json"));
+        chunkFiles.clearQuick();
+        for (const auto& chunk : *metadata["chunks"].getArray())
+            chunkFiles.add(paletteDir.getChildFile(chunk["path"].toString()));
+
+        juce::FileInputStream stream(paletteDir.getChildFile("embeddings.bin"));
+        int32_t header[2] = { 0, 0 };
+        stream.read(header, sizeof(header));
+        embeddings.resize(static_cast<size_t>(header[0]) * static_cast<size_t>(header[1]));
+        stream.read(embeddings.data(), static_cast<int>(embeddings.size() * sizeof(float)));
+        return chunkFiles.size();
+    }
+
+    void benchmarkOpen()
+    {
+        TestUtils::CsvWriter writer("palette_open_benchmark",
+                                    {"Method", "Chunks", "Dimension", "Ms_per_open", "Bytes_on_disk"});
+
+        const int numChunks = 50000;
+        const int embeddingSize = 512;
+        const auto paletteDir = makePaletteDir("bench_SOUND_PALETTE");
+        const auto contents = makeContents(numChunks, embeddingSize, 6);
+        writeLegacyFiles(paletteDir, contents);
+        expect(PaletteFile::write(paletteDir, contents));
+
+        auto elapsedMs = [](std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        std::vector<float> embeddings;
+        juce::Array<juce::File> chunkFiles;
+        const int legacyOpens = 3;
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < legacyOpens; ++i)
+            expectEquals(legacyOpen(paletteDir, embeddings, chunkFiles), numChunks);
+        const double legacyMs = elapsedMs(start) / legacyOpens;
+
+        // Open, then touch what the legacy load produced: every chunk path
+        // and every embedding row
+        const int opens = 20;
+        double checksum = 0.0;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < opens; ++i)
+        {
+            auto palette = PaletteFile::open(paletteDir);
+            expect(palette != nullptr);
+            if (palette == nullptr)
+                return;
+            for (int chunk = 0; chunk < palette->getNumChunks(); ++chunk)
+                checksum += static_cast<double>(palette->getEmbedding(chunk)[0] + static_cast<float>(palette->getChunkPath(chunk).length()));
+        }
+        const double mappedMs = elapsedMs(start) / opens;
+        expect(checksum != 0.0);
+
+        const auto legacyBytes = paletteDir.getChildFile("metadata.json").getSize() + paletteDir.getChildFile("embeddings.bin").getSize();
+        const auto paletteBytes = paletteDir.getChildFile(PaletteFile::kFileName).getSize();
+        writer.writeRow("legacy_json_and_embeddings", numChunks, embeddingSize, legacyMs, legacyBytes);
+        writer.writeRow("palette_bin_mapped", numChunks, embeddingSize, mappedMs, paletteBytes);
+        logMessage("Open " + juce::String(numChunks) + " chunks: legacy " + juce::String(legacyMs, 1) + " ms, palette.bin "
+                   + juce::String(mappedMs, 2) + " ms (" + juce::String(juce::roundToInt(legacyMs / mappedMs)) + "x); "
+                   + juce::String(legacyBytes / 1024) + " KB -> " + juce::String(paletteBytes / 1024) + " KB");
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    PaletteFileTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
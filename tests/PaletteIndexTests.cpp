@@ -0,0 +1,394 @@
+#include <juce_core/juce_core.h>
+#include <juce_data_structures/juce_data_structures.h>
+#include <CLAP/PaletteIndex.h>
+#include <CLAP/PaletteFile.h>
+#include "TestUtils.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
+
+using Unsound4All::PaletteIndex;
+
+// The palette index must return exactly what a brute-force cosine scan
+// returns, load palettes written by SoundPaletteCreator, and hand every
+// caller the same instance until palette.bin changes. The benchmark
+// compares it with re-reading the palette and sorting every score per query.
+class PaletteIndexTests : public juce::UnitTest
+{
+public:
+    PaletteIndexTests() : juce::UnitTest("PaletteIndexTests") {}
+
+    void runTest() override
+    {
+        beginTest("Search matches a brute-force scan");
+        testMatchesBruteForce();
+
+        beginTest("Ties, bad queries and small palettes");
+        testEdgeCases();
+
+        beginTest("Palette files load and resolve result files");
+        testLoadFromFiles();
+
+        beginTest("Shared index is reused and reloaded on change");
+        testSharedCache();
+
+        beginTest("Concurrent searches agree");
+        testConcurrentSearch();
+
+        beginTest("Benchmark search");
+        benchmarkSearch();
+    }
+
+private:
+    static constexpr int dimension = 512;
+
+    juce::File tempDirectory = juce::File::getSpecialLocation(juce::File::tempDirectory).getChildFile("PaletteIndexTests");
+
+    static std::vector<float> randomEmbeddings(int numRows, int dim, unsigned int seed, bool normalise)
+    {
+        std::mt19937 rng(seed);
+        std::normal_distribution<float> normal(0.0f, 1.0f);
+        std::vector<float> values(static_cast<size_t>(numRows) * static_cast<size_t>(dim));
+        for (auto& value : values)
+            value = normal(rng);
+
+        if (normalise)
+        {
+            for (int row = 0; row < numRows; ++row)
+            {
+                float* begin = values.data() + static_cast<size_t>(row) * static_cast<size_t>(dim);
+                double sum = 0.0;
+                for (int i = 0; i < dim; ++i)
+                    sum += static_cast<double>(begin[i]) * begin[i];
+                const auto scale = static_cast<float>(1.0 / std::sqrt(sum));
+                for (int i = 0; i < dim; ++i)
+                    begin[i] *= scale;
+            }
+        }
+        return values;
+    }
+
+    // Cosine similarity of every row, computed the straightforward way
+    static std::vector<std::pair<float, int>> bruteForce(const std::vector<float>& embeddings, int dim,
+                                                         const std::vector<float>& query)
+    {
+        std::vector<std::pair<float, int>> scores;
+        const int numRows = static_cast<int>(embeddings.size()) / dim;
+        for (int row = 0; row < numRows; ++row)
+        {
+            double dot = 0.0, normRow = 0.0, normQuery = 0.0;
+            for (int i = 0; i < dim; ++i)
+            {
+                const float value = embeddings[static_cast<size_t>(row * dim + i)];
+                dot += static_cast<double>(value) * query[static_cast<size_t>(i)];
+                normRow += static_cast<double>(value) * value;
+                normQuery += static_cast<double>(query[static_cast<size_t>(i)]) * query[static_cast<size_t>(i)];
+            }
+            const double denom = std::sqrt(normRow) * std::sqrt(normQuery);
+            scores.push_back({ denom > 1e-8 ? static_cast<float>(dot / denom) : 0.0f, row });
+        }
+        std::sort(scores.begin(), scores.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+        return scores;
+    }
+
+    void testMatchesBruteForce()
+    {
+        // Unnormalised rows (like STFT features) and an odd dimension exercise padding
+        for (const int dim : { dimension, 37 })
+        {
+            const int numRows = 3001;
+            const auto embeddings = randomEmbeddings(numRows, dim, 1, false);
+            const PaletteIndex index(embeddings.data(), numRows, dim);
+            expectEquals(index.getNumRows(), numRows);
+            expectEquals(index.getDimension(), dim);
+            expect(reinterpret_cast<uintptr_t>(index.getRow(0)) % 64 == 0, "rows are 64-byte aligned");
+            expect(reinterpret_cast<uintptr_t>(index.getRow(1)) % 64 == 0, "stride keeps rows aligned");
+
+            bool sameRows = true;
+            float maxError = 0.0f;
+            for (unsigned int seed = 10; seed < 20; ++seed)
+            {
+                const auto query = randomEmbeddings(1, dim, seed, false);
+                const auto expected = bruteForce(embeddings, dim, query);
+                const auto matches = index.search(query, 10);
+                expectEquals(static_cast<int>(matches.size()), 10);
+                for (size_t i = 0; i < matches.size(); ++i)
+                {
+                    sameRows = sameRows && matches[i].chunkIndex == expected[i].second;
+                    maxError = juce::jmax(maxError, std::abs(matches[i].similarity - expected[i].first));
+                }
+            }
+            expect(sameRows, "same rows in the same order, dim " + juce::String(dim));
+            expectLessThan(maxError, 1.0e-5f);
+        }
+    }
+
+    void testEdgeCases()
+    {
+        // Two identical rows: the lower index ranks first
+        std::vector<float> rows(static_cast<size_t>(4 * 8), 0.0f);
+        rows[0] = 1.0f;       // Row 0 along x
+        rows[8 + 1] = 1.0f;   // Row 1 along y
+        rows[16] = 2.0f;      // Row 2 along x (normalises to row 0)
+        // Row 3 is all zeros
+        const PaletteIndex index(rows.data(), 4, 8);
+
+        std::vector<float> query(8, 0.0f);
+        query[0] = 3.0f;
+        auto matches = index.search(query, 4);
+        expectEquals(static_cast<int>(matches.size()), 4);
+        expectEquals(matches[0].chunkIndex, 0);
+        expectEquals(matches[1].chunkIndex, 2);
+        expectWithinAbsoluteError(matches[0].similarity, 1.0f, 1.0e-6f);
+        expectWithinAbsoluteError(matches[1].similarity, 1.0f, 1.0e-6f);
+        expectEquals(matches[2].similarity, 0.0f);
+        expectEquals(matches[2].chunkIndex, 1);
+        expectEquals(matches[3].chunkIndex, 3);
+
+        // More results than rows, wrong dimension, zero query
+        expectEquals(static_cast<int>(index.search(query, 100).size()), 4);
+        expect(index.search(std::vector<float>(7, 1.0f), 4).empty());
+        expect(index.search(std::vector<float>(8, 0.0f), 4).empty());
+        expect(index.search(query, 0).empty());
+        expect(!index.getResultFile(0).exists(), "no metadata, no files");
+    }
+
+    // Writes a palette the way SoundPaletteCreator::savePaletteData does
+    juce::File writePalette(const juce::String& name, const std::vector<float>& embeddings, int numRows, int dim,
+                            const juce::File& sourceFile)
+    {
+        auto paletteDir = tempDirectory.getChildFile(name);
+        paletteDir.deleteRecursively();
+        paletteDir.createDirectory();
+
+        Unsound4All::PaletteFile::Contents contents;
+        contents.embeddingSize = dim;
+        contents.embeddings = embeddings;
+        contents.embeddingType = "CLAP";
+        contents.sourceFiles.add(sourceFile.getFullPathName());
+        for (int i = 0; i < numRows; ++i)
+        {
+            contents.chunkPaths.add("chunk_" + juce::String(i) + ".wav");
+            contents.chunkSources.push_back(i == 0 ? 0 : -1);
+        }
+        Unsound4All::PaletteFile::write(paletteDir, contents);
+        return paletteDir;
+    }
+
+    // The metadata.json + embeddings.bin pair palettes used to be stored as
+    static void writeLegacyFiles(const juce::File& paletteDir, const std::vector<float>& embeddings, int numRows, int dim)
+    {
+        juce::var metadata(new juce::DynamicObject());
+        juce::Array<juce::var> chunks;
+        for (int i = 0; i < numRows; ++i)
+        {
+            juce::var chunkInfo(new juce::DynamicObject());
+            chunkInfo.getDynamicObject()->setProperty("index", i);
+            chunkInfo.getDynamicObject()->setProperty("filename", "chunk_" + juce::String(i) + ".wav");
+            chunkInfo.getDynamicObject()->setProperty("sourceFileIndex", -1);
+            chunks.add(chunkInfo);
+        }
+        metadata.getDynamicObject()->setProperty("numChunks", numRows);
+        metadata.getDynamicObject()->setProperty("embeddingSize", dim);
+        metadata.getDynamicObject()->setProperty("chunks", juce::var(chunks));
+        paletteDir.getChildFile("metadata.json").replaceWithText(juce::JSON::toString(metadata));
+
+        juce::FileOutputStream stream(paletteDir.getChildFile("embeddings.bin"));
+        const int32_t header[2] = { numRows, dim };
+        stream.write(header, sizeof(header));
+        stream.write(embeddings.data(), embeddings.size() * sizeof(float));
+        stream.flush();
+    }
+
+    void testLoadFromFiles()
+    {
+        tempDirectory.createDirectory();
+        auto sourceFile = tempDirectory.getChildFile("source.wav");
+        sourceFile.replaceWithText("not really audio");
+
+        const int numRows = 50;
+        const auto embeddings = randomEmbeddings(numRows, dimension, 2, true);
+        auto paletteDir = writePalette("files_SOUND_PALETTE", embeddings, numRows, dimension, sourceFile);
+        paletteDir.getChildFile("chunk_1.wav").replaceWithText("chunk");
+
+        auto index = PaletteIndex::load(paletteDir);
+        expect(index != nullptr);
+        if (index == nullptr)
+            return;
+        expectEquals(index->getNumRows(), numRows);
+
+        // A row's own embedding finds it first
+        const std::vector<float> query(embeddings.begin() + 7 * dimension, embeddings.begin() + 8 * dimension);
+        const auto matches = index->search(query, 4);
+        expectEquals(matches[0].chunkIndex, 7);
+        expectWithinAbsoluteError(matches[0].similarity, 1.0f, 1.0e-5f);
+
+        expect(index->getResultFile(0) == sourceFile, "source file");
+        expect(index->getResultFile(1) == paletteDir.getChildFile("chunk_1.wav"), "chunk fallback");
+        expect(!index->getResultFile(2).exists(), "neither file exists");
+        expect(!index->getResultFile(numRows).exists(), "out of range");
+
+        // Truncated or missing files fail to load
+        auto truncated = writePalette("truncated_SOUND_PALETTE", embeddings, numRows, dimension, sourceFile);
+        truncated.getChildFile(Unsound4All::PaletteFile::kFileName).replaceWithText("short");
+        expect(PaletteIndex::load(truncated) == nullptr);
+        expect(PaletteIndex::load(tempDirectory.getChildFile("missing")) == nullptr);
+    }
+
+    void testSharedCache()
+    {
+        const auto embeddings = randomEmbeddings(20, dimension, 3, true);
+        auto paletteDir = writePalette("shared_SOUND_PALETTE", embeddings, 20, dimension, juce::File());
+
+        auto first = PaletteIndex::getShared(paletteDir);
+        auto second = PaletteIndex::getShared(paletteDir);
+        expect(first != nullptr);
+        expect(first == second, "one instance per palette");
+
+        // Rewriting palette.bin (different size) reloads it
+        const auto more = randomEmbeddings(30, dimension, 4, true);
+        writePalette("shared_SOUND_PALETTE", more, 30, dimension, juce::File());
+        auto reloaded = PaletteIndex::getShared(paletteDir);
+        expect(reloaded != nullptr && reloaded != first);
+        if (reloaded != nullptr)
+            expectEquals(reloaded->getNumRows(), 30);
+        expectEquals(first->getNumRows(), 20, "earlier holders keep their snapshot");
+
+        PaletteIndex::releaseShared(paletteDir);
+        expect(PaletteIndex::getShared(paletteDir) != reloaded, "released indexes load again");
+        PaletteIndex::releaseShared(paletteDir);
+    }
+
+    void testConcurrentSearch()
+    {
+        const int numRows = 5000;
+        const auto embeddings = randomEmbeddings(numRows, dimension, 5, true);
+        const PaletteIndex index(embeddings.data(), numRows, dimension);
+
+        std::vector<std::vector<float>> queries;
+        std::vector<std::vector<PaletteIndex::Match>> expected;
+        for (unsigned int seed = 0; seed < 8; ++seed)
+        {
+            queries.push_back(randomEmbeddings(1, dimension, 100 + seed, true));
+            expected.push_back(index.search(queries.back(), 4));
+        }
+
+        std::atomic<int> mismatches{0};
+        std::vector<std::thread> threads;
+        for (int t = 0; t < 4; ++t)
+        {
+            threads.emplace_back([&, t]
+            {
+                for (int repeat = 0; repeat < 20; ++repeat)
+                {
+                    const auto q = static_cast<size_t>((t + repeat) % 8);
+                    const auto matches = index.search(queries[q], 4);
+                    for (size_t i = 0; i < matches.size(); ++i)
+                        if (matches[i].chunkIndex != expected[q][i].chunkIndex)
+                            ++mismatches;
+                }
+            });
+        }
+        for (auto& thread : threads)
+            thread.join();
+        expectEquals(mismatches.load(), 0);
+    }
+
+    // The search the worker used to run per query: read both files, allocate
+    // each row, recompute both norms, sort everything (twice)
+    static std::vector<int> legacySearch(const juce::File& paletteDir, const std::vector<float>& query, int topK)
+    {
+        juce::var metadata = juce::JSON::parse(paletteDir.getChildFile("metadata.json"));
+        juce::FileInputStream inputStream(paletteDir.getChildFile("embeddings.bin"));
+        int32_t numEmbeddings = 0, embeddingSize = 0;
+        inputStream.read(&numEmbeddings, sizeof(int32_t));
+        inputStream.read(&embeddingSize, sizeof(int32_t));
+
+        std::vector<std::pair<float, int>> similarities;
+        for (int32_t i = 0; i < numEmbeddings; ++i)
+        {
+            std::vector<float> embedding(static_cast<size_t>(embeddingSize));
+            inputStream.read(embedding.data(), static_cast<int>(sizeof(float)) * embeddingSize);
+            float dot = 0.0f, norm1 = 0.0f, norm2 = 0.0f;
+            for (size_t j = 0; j < query.size(); ++j)
+            {
+                dot += query[j] * embedding[j];
+                norm1 += query[j] * query[j];
+                norm2 += embedding[j] * embedding[j];
+            }
+            const float denom = std::sqrt(norm1) * std::sqrt(norm2);
+            similarities.push_back({ denom > 1e-8f ? dot / denom : 0.0f, i });
+        }
+        auto byScore = [](const auto& a, const auto& b) { return a.first > b.first; };
+        std::sort(similarities.begin(), similarities.end(), byScore);
+        std::sort(similarities.begin(), similarities.end(), byScore);
+
+        std::vector<int> rows;
+        for (int i = 0; i < juce::jmin(topK, static_cast<int>(similarities.size())); ++i)
+            rows.push_back(similarities[static_cast<size_t>(i)].second);
+        return rows;
+    }
+
+    void benchmarkSearch()
+    {
+        TestUtils::CsvWriter writer("palette_search_benchmark",
+                                    {"Method", "Rows", "Dimension", "Top_k", "Ms_per_query"});
+
+        const int numRows = 50000;
+        const int topK = 4;
+        const auto embeddings = randomEmbeddings(numRows, dimension, 6, true);
+        auto paletteDir = writePalette("bench_SOUND_PALETTE", embeddings, numRows, dimension, juce::File());
+        writeLegacyFiles(paletteDir, embeddings, numRows, dimension);
+        const auto query = randomEmbeddings(1, dimension, 7, true);
+
+        auto elapsedMs = [](std::chrono::steady_clock::time_point start)
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        std::vector<int> legacyRows;
+        const int legacyQueries = 3;
+        for (int i = 0; i < legacyQueries; ++i)
+            legacyRows = legacySearch(paletteDir, query, topK);
+        const double legacyMs = elapsedMs(start) / legacyQueries;
+
+        start = std::chrono::steady_clock::now();
+        auto index = PaletteIndex::load(paletteDir);
+        const double loadMs = elapsedMs(start);
+        expect(index != nullptr);
+        if (index == nullptr)
+            return;
+
+        std::vector<PaletteIndex::Match> matches;
+        const int queries = 200;
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < queries; ++i)
+            matches = index->search(query, topK);
+        const double searchMs = elapsedMs(start) / queries;
+
+        bool same = matches.size() == legacyRows.size();
+        for (size_t i = 0; same && i < matches.size(); ++i)
+            same = matches[i].chunkIndex == legacyRows[i];
+        expect(same, "index and legacy search agree");
+
+        writer.writeRow("reload_and_sort", numRows, dimension, topK, legacyMs);
+        writer.writeRow("index_load", numRows, dimension, topK, loadMs);
+        writer.writeRow("index_search", numRows, dimension, topK, searchMs);
+        logMessage("Per query: reload + sort " + juce::String(legacyMs, 1) + " ms, index search "
+                   + juce::String(searchMs, 3) + " ms (" + juce::String(juce::roundToInt(legacyMs / searchMs)) + "x); one-off load "
+                   + juce::String(loadMs, 1) + " ms");
+
+        tempDirectory.deleteRecursively();
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    PaletteIndexTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include "TestUtils.h"
 #include <random>
 #include <cmath>
+#include <chrono>
 
 // Simple Sine Wave Generator at -3dBFS
 class SineWave
@@ -63,6 +64,9 @@ public:
 
         beginTest("CLEAT Panner Random Checks");
         testCLEATPannerRandom();
+
+        beginTest("CLEAT Control-Rate Gains Match Per-Sample");
+        testCLEATControlRateMatchesPerSample();
     }
 
 private:
@@ -310,6 +314,88 @@ private:
                 "Closest speaker " + juce::String(closestIdx) + " should have max RMS (Pan: " + juce::String(x) + "," + juce::String(y) + ")");
         }
     }
+
+    // Control-rate gains (recomputed every N samples and ramped in between)
+    // must stay within kControlRateTolerance of the per-sample reference for a
+    // full-scale input while the pan keeps retargeting, at every interval.
+    // The error is largest where the gain curve kinks inside a segment (phase
+    // clipping, smoother landing) and grows roughly linearly with N: about
+    // 0.006 (-44 dBFS) at the default 16 and 0.015 at 32.
+    void testCLEATControlRateMatchesPerSample()
+    {
+        constexpr float kControlRateTolerance = 0.02f;
+        constexpr double sampleRate = 48000.0;
+        constexpr int blockSize = 64;
+        constexpr int numBlocks = 2000;
+
+        TestUtils::CsvWriter writer("cleat_control_rate", {"Interval", "Max_Error", "Reference_ns", "Control_ns"});
+
+        for (int interval : { 8, 16, 32 })
+        {
+            for (float gainPower : { 1.0f, 2.5f })
+            {
+                CLEATPanner reference;
+                CLEATPanner controlRate;
+                for (auto* panner : { &reference, &controlRate })
+                {
+                    panner->prepare(sampleRate);
+                    panner->set_gain_power(gainPower);
+                }
+                reference.set_gain_update_interval(1);
+                controlRate.set_gain_update_interval(interval);
+
+                std::mt19937 rng(static_cast<unsigned int>(interval));
+                std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+
+                juce::AudioBuffer<float> input(1, blockSize);
+                juce::AudioBuffer<float> refOut(16, blockSize);
+                juce::AudioBuffer<float> ctlOut(16, blockSize);
+                const float* in[] = { input.getReadPointer(0) };
+
+                float maxError = 0.0f;
+                double refSeconds = 0.0;
+                double ctlSeconds = 0.0;
+                for (int block = 0; block < numBlocks; ++block)
+                {
+                    // Retarget every 16 blocks so the smoother is mostly moving
+                    if (block % 16 == 0)
+                    {
+                        const float x = dist(rng);
+                        const float y = dist(rng);
+                        reference.set_pan(x, y);
+                        controlRate.set_pan(x, y);
+                    }
+
+                    for (int i = 0; i < blockSize; ++i)
+                        input.setSample(0, i, 2.0f * dist(rng) - 1.0f);
+                    refOut.clear();
+                    ctlOut.clear();
+
+                    const auto t0 = std::chrono::steady_clock::now();
+                    reference.process_block(in, 1, refOut.getArrayOfWritePointers(), 16, blockSize);
+                    const auto t1 = std::chrono::steady_clock::now();
+                    controlRate.process_block(in, 1, ctlOut.getArrayOfWritePointers(), 16, blockSize);
+                    const auto t2 = std::chrono::steady_clock::now();
+                    refSeconds += std::chrono::duration<double>(t1 - t0).count();
+                    ctlSeconds += std::chrono::duration<double>(t2 - t1).count();
+
+                    for (int channel = 0; channel < 16; ++channel)
+                        for (int i = 0; i < blockSize; ++i)
+                            maxError = juce::jmax(maxError, std::abs(refOut.getSample(channel, i) - ctlOut.getSample(channel, i)));
+                }
+
+                const double samples = static_cast<double>(numBlocks) * blockSize;
+                writer.writeRow(interval, maxError, 1.0e9 * refSeconds / samples, 1.0e9 * ctlSeconds / samples);
+                logMessage("interval " + juce::String(interval) + " power " + juce::String(gainPower, 1)
+                           + ": max error " + juce::String(maxError, 6)
+                           + ", per-sample " + juce::String(1.0e9 * refSeconds / samples, 1)
+                           + " ns/sample, control-rate " + juce::String(1.0e9 * ctlSeconds / samples, 1) + " ns/sample");
+
+                expectLessThan(maxError, kControlRateTolerance,
+                               "interval " + juce::String(interval) + " power " + juce::String(gainPower));
+            }
+        }
+    }
 };
 
 int main(int argc, char* argv[])
@@ -0,0 +1,178 @@
+#include <juce_core/juce_core.h>
+#include <flowerjuce/LooperEngine/LooperReadHead.h>
+#include <flowerjuce/LooperEngine/TapeLoop.h>
+#include "TestUtils.h"
+#include <chrono>
+#include <cmath>
+
+// Compares LooperReadHead::process_block against the per-sample
+// process_sample path and benchmarks both across playback speeds.
+class ReadHeadTests : public juce::UnitTest
+{
+public:
+    ReadHeadTests() : juce::UnitTest("ReadHeadTests") {}
+
+    void runTest() override
+    {
+        beginTest("Block matches scalar (forward)");
+        testBlockMatchesScalar(true);
+
+        beginTest("Block matches scalar (reverse)");
+        testBlockMatchesScalar(false);
+
+        beginTest("Wrap index");
+        testWrapIndex();
+
+        beginTest("Benchmark scalar vs block");
+        benchmarkScalarVsBlock();
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static inline volatile float benchmarkSink = 0.0f; // keeps the timed loops from being optimised away
+    const std::array<float, 6> speeds{ 0.25f, 0.5f, 1.0f, 1.5f, 2.0f, 4.0f };
+
+    void fillTape(TapeLoop& tape)
+    {
+        tape.allocate_buffer(sampleRate, 2.0);
+        auto& buffer = tape.get_buffer();
+        for (size_t i = 0; i < buffer.size(); ++i)
+            buffer[i] = std::sin(0.013f * static_cast<float>(i)) * 0.8f;
+        tape.m_recorded_length.store(buffer.size());
+        tape.m_has_recorded.store(true);
+    }
+
+    void configure(LooperReadHead& head, float speed, bool forward, float loopStart, float loopEnd)
+    {
+        head.prepare(sampleRate);
+        head.set_loop_start(loopStart);
+        head.set_loop_end(loopEnd);
+        head.set_pos(forward ? loopStart : loopEnd - 1.0f);
+        head.set_speed(speed);
+        head.set_direction_forward(forward);
+        head.set_playing(true);
+    }
+
+    void testBlockMatchesScalar(bool forward)
+    {
+        TapeLoop tape;
+        fillTape(tape);
+
+        const float loopStart = 1000.5f;
+        const float loopEnd = 31000.0f;
+        const int numSamples = 96000;
+        const int blockSize = 256;
+
+        for (float speed : speeds)
+        {
+            LooperReadHead scalarHead(tape);
+            LooperReadHead blockHead(tape);
+            configure(scalarHead, speed, forward, loopStart, loopEnd);
+            configure(blockHead, speed, forward, loopStart, loopEnd);
+
+            std::vector<float> block(static_cast<size_t>(blockSize));
+            float maxError = 0.0f;
+            int scalarWraps = 0;
+            int blockWraps = 0;
+
+            for (int offset = 0; offset < numSamples; offset += blockSize)
+            {
+                WrapInfo wrapInfo;
+                blockHead.process_block(block.data(), blockSize, wrapInfo);
+                blockWraps += wrapInfo.num_wraps;
+
+                for (int i = 0; i < blockSize; ++i)
+                {
+                    bool wrapped = false;
+                    const float expected = scalarHead.process_sample(wrapped);
+                    scalarWraps += wrapped ? 1 : 0;
+                    maxError = juce::jmax(maxError, std::abs(expected - block[static_cast<size_t>(i)]));
+                }
+            }
+
+            // Positions are generated as start + k * step instead of a running
+            // sum, so they drift from the scalar path by a few ulps at most.
+            expectLessThan(maxError, 1.0e-3f, "speed " + juce::String(speed));
+            expectEquals(blockWraps, scalarWraps, "wrap count at speed " + juce::String(speed));
+            expectWithinAbsoluteError(blockHead.get_pos(), scalarHead.get_pos(), 0.05f);
+        }
+    }
+
+    void testWrapIndex()
+    {
+        TapeLoop tape;
+        fillTape(tape);
+
+        LooperReadHead head(tape);
+        configure(head, 1.0f, true, 0.0f, 100.0f);
+        head.set_pos(90.0f);
+
+        std::vector<float> block(32);
+        WrapInfo wrapInfo;
+        head.process_block(block.data(), 32, wrapInfo);
+
+        // Sample 9 reads position 99 and its advance wraps back to 0.
+        expectEquals(wrapInfo.first_wrap_index, 9);
+        expectEquals(wrapInfo.num_wraps, 1);
+        expectWithinAbsoluteError(head.get_pos(), 22.0f, 1.0e-4f);
+    }
+
+    void benchmarkScalarVsBlock()
+    {
+        TapeLoop tape;
+        fillTape(tape);
+
+        const int numSamples = 480000;
+        const int blockSize = 256;
+        std::vector<float> block(static_cast<size_t>(blockSize));
+
+        TestUtils::CsvWriter writer("read_head_benchmark", {"Speed", "Scalar_ns_per_sample", "Block_ns_per_sample", "Speedup"});
+
+        for (float speed : speeds)
+        {
+            LooperReadHead scalarHead(tape);
+            configure(scalarHead, speed, true, 0.0f, 90000.0f);
+
+            float sink = 0.0f;
+            const auto scalarStart = std::chrono::steady_clock::now();
+            for (int i = 0; i < numSamples; ++i)
+            {
+                bool wrapped = false;
+                sink += scalarHead.process_sample(wrapped);
+            }
+            const auto scalarEnd = std::chrono::steady_clock::now();
+
+            LooperReadHead blockHead(tape);
+            configure(blockHead, speed, true, 0.0f, 90000.0f);
+
+            const auto blockStart = std::chrono::steady_clock::now();
+            for (int offset = 0; offset < numSamples; offset += blockSize)
+            {
+                WrapInfo wrapInfo;
+                blockHead.process_block(block.data(), blockSize, wrapInfo);
+                sink += block[0];
+            }
+            const auto blockEnd = std::chrono::steady_clock::now();
+
+            const double scalarNs = std::chrono::duration<double, std::nano>(scalarEnd - scalarStart).count() / numSamples;
+            const double blockNs = std::chrono::duration<double, std::nano>(blockEnd - blockStart).count() / numSamples;
+            const double speedup = blockNs > 0.0 ? scalarNs / blockNs : 0.0;
+
+            writer.writeRow(speed, scalarNs, blockNs, speedup);
+            logMessage("speed " + juce::String(speed, 2)
+                       + "x: scalar " + juce::String(scalarNs, 2) + " ns/sample"
+                       + ", block " + juce::String(blockNs, 2) + " ns/sample"
+                       + " (" + juce::String(speedup, 1) + "x)");
+            benchmarkSink = sink;
+        }
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    ReadHeadTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
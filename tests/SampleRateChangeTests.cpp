@@ -0,0 +1,269 @@
+#include <juce_core/juce_core.h>
+#include <flowerjuce/LooperEngine/MultiTrackLooperEngine.h>
+#include <flowerjuce/DSP/PolyphaseResampler.h>
+#include <flowerjuce/Panners/CLEATPanner.h>
+#include "TestUtils.h"
+#include <chrono>
+#include <cmath>
+
+// Device restarts must not lose loops: the same rate leaves the tape alone,
+// a new rate converts it in the background with the polyphase resampler and
+// rescales loop points. Resampler accuracy and alias rejection are checked
+// against analytic sines, and the benchmark reports conversion speed.
+class SampleRateChangeTests : public juce::UnitTest
+{
+public:
+    SampleRateChangeTests() : juce::UnitTest("SampleRateChangeTests") {}
+
+    void runTest() override
+    {
+        beginTest("Resampler reproduces sines");
+        testResamplerAccuracy();
+
+        beginTest("Downsampling rejects aliases");
+        testAliasRejection();
+
+        beginTest("Restart at the same rate keeps the loop");
+        testSameRateRestart();
+
+        beginTest("Rate change resamples the loop");
+        testRateChange(false);
+
+        beginTest("Rate change resamples a chunked loop");
+        testRateChange(true);
+
+        beginTest("Benchmark resampling speed");
+        benchmarkResampling();
+    }
+
+private:
+    static constexpr int blockSize = 256;
+    static constexpr int numOutputs = 16;
+
+    static std::vector<float> makeSine(double frequency, double sampleRate, size_t length)
+    {
+        std::vector<float> samples(length);
+        for (size_t i = 0; i < length; ++i)
+            samples[i] = static_cast<float>(0.5 * std::sin(juce::MathConstants<double>::twoPi * frequency * static_cast<double>(i) / sampleRate));
+        return samples;
+    }
+
+    static float rms(const float* samples, size_t length)
+    {
+        double sum = 0.0;
+        for (size_t i = 0; i < length; ++i)
+            sum += static_cast<double>(samples[i]) * samples[i];
+        return static_cast<float>(std::sqrt(sum / static_cast<double>(juce::jmax<size_t>(1, length))));
+    }
+
+    void testResamplerAccuracy()
+    {
+        const std::array<std::pair<double, double>, 4> rates{ { { 44100.0, 48000.0 }, { 48000.0, 44100.0 },
+                                                                { 96000.0, 44100.0 }, { 22050.0, 48000.0 } } };
+        for (const auto& [source, target] : rates)
+        {
+            const size_t length = static_cast<size_t>(source);
+            const auto input = makeSine(1000.0, source, length);
+            const PolyphaseResampler resampler(source, target);
+            const size_t outputLength = resampler.get_output_length(length);
+            expectEquals(outputLength, static_cast<size_t>(target));
+
+            std::vector<float> output(outputLength);
+            resampler.process(input.data(), length, output.data(), 0, outputLength, false);
+            const auto expected = makeSine(1000.0, target, outputLength);
+
+            // Away from the zero-padded edges the output is the same sine at the new rate
+            float maxError = 0.0f;
+            for (size_t i = 200; i < outputLength - 200; ++i)
+                maxError = juce::jmax(maxError, std::abs(output[i] - expected[i]));
+            expectLessThan(maxError, 1.0e-3f, juce::String(source) + " -> " + juce::String(target));
+
+            // Rendering in slices gives the same samples
+            std::vector<float> sliced(outputLength);
+            for (size_t start = 0; start < outputLength; start += 1000)
+                resampler.process(input.data(), length, sliced.data() + start, start,
+                                  juce::jmin<size_t>(1000, outputLength - start), false);
+            expect(sliced == output, "sliced rendering matches");
+        }
+
+        // A whole number of cycles wraps without a seam
+        const auto loop = makeSine(441.0, 44100.0, 44100);
+        const PolyphaseResampler resampler(44100.0, 48000.0);
+        std::vector<float> output(48000);
+        resampler.process(loop.data(), loop.size(), output.data(), 0, output.size(), true);
+        const auto expected = makeSine(441.0, 48000.0, 48000);
+        float maxError = 0.0f;
+        for (size_t i = 0; i < output.size(); ++i)
+            maxError = juce::jmax(maxError, std::abs(output[i] - expected[i]));
+        expectLessThan(maxError, 1.0e-3f, "wrapped loop");
+    }
+
+    void testAliasRejection()
+    {
+        // 30 kHz is above the 22.05 kHz target Nyquist and must be filtered out
+        const auto input = makeSine(30000.0, 96000.0, 96000);
+        const PolyphaseResampler resampler(96000.0, 44100.0);
+        std::vector<float> output(resampler.get_output_length(input.size()));
+        resampler.process(input.data(), input.size(), output.data(), 0, output.size(), false);
+
+        const float level = rms(output.data() + 500, output.size() - 1000) / rms(input.data(), input.size());
+        logMessage("30 kHz alias at 44.1 kHz: " + juce::String(juce::Decibels::gainToDecibels(level), 1) + " dB");
+        expectLessThan(juce::Decibels::gainToDecibels(level), -70.0f);
+    }
+
+    struct Track
+    {
+        LooperTrackEngine engine;
+        CLEATPanner panner;
+        juce::AudioBuffer<float> input{1, blockSize};
+        juce::AudioBuffer<float> output{numOutputs, blockSize};
+
+        Track(double sampleRate, std::shared_ptr<TapeChunkPool> pool)
+        {
+            engine.initialize(sampleRate, 10.0);
+            engine.audio_device_about_to_start(sampleRate, blockSize);
+            if (pool != nullptr)
+                engine.set_chunk_pool(std::move(pool), sampleRate, 10.0);
+            panner.prepare(sampleRate);
+            engine.set_panner(&panner);
+            input.clear();
+        }
+
+        // Two seconds of 441 Hz, finished as a loop
+        void recordLoop(double sampleRate)
+        {
+            const auto length = static_cast<size_t>(2.0 * sampleRate);
+            const auto sine = makeSine(441.0, sampleRate, length);
+            auto& tape = engine.get_tape_loop();
+            for (size_t i = 0; i < length; ++i)
+                *tape.get_writable_sample(i) = sine[i];
+            engine.set_recorded_length(length);
+            engine.set_has_recorded(true);
+            engine.set_loop_end(length);
+            engine.set_write_pos(length);
+            engine.set_loop_start(static_cast<float>(sampleRate * 0.5));
+            engine.set_pos(static_cast<float>(sampleRate));
+        }
+
+        float process()
+        {
+            output.clear();
+            engine.process_block(input.getArrayOfReadPointers(), 1, output.getArrayOfWritePointers(), numOutputs, blockSize);
+            float peak = 0.0f;
+            for (int channel = 0; channel < numOutputs; ++channel)
+                peak = juce::jmax(peak, output.getMagnitude(channel, 0, blockSize));
+            return peak;
+        }
+    };
+
+    void testSameRateRestart()
+    {
+        Track track(48000.0, nullptr);
+        track.recordLoop(48000.0);
+        const float* storage = track.engine.get_buffer().data();
+
+        track.engine.audio_device_stopped();
+        track.engine.audio_device_about_to_start(48000.0, 1024);
+
+        expect(!track.engine.is_resampling());
+        expect(track.engine.get_buffer().data() == storage, "no reallocation");
+        expect(track.engine.has_recorded());
+        expectEquals(track.engine.get_recorded_length(), static_cast<size_t>(96000));
+        expectEquals(track.engine.get_loop_end(), static_cast<size_t>(96000));
+        expectEquals(track.engine.get_loop_start(), 24000.0f);
+        expectEquals(track.engine.get_pos(), 48000.0f);
+
+        const auto sine = makeSine(441.0, 48000.0, 96000);
+        bool same = true;
+        for (size_t i = 0; i < sine.size(); i += 101)
+            same = same && track.engine.get_sample(i) == sine[i];
+        expect(same, "content untouched");
+
+        // An empty tape at a new rate is simply reallocated
+        Track empty(48000.0, nullptr);
+        empty.engine.audio_device_about_to_start(44100.0, blockSize);
+        expect(!empty.engine.is_resampling());
+        expectEquals(empty.engine.get_buffer_size(), static_cast<size_t>(441000));
+        expectEquals(empty.engine.get_tape_sample_rate(), 44100.0);
+    }
+
+    void testRateChange(bool chunked)
+    {
+        auto pool = chunked ? std::make_shared<TapeChunkPool>(TapeChunkPool::chunks_for_duration(48000.0, 6.0)) : nullptr;
+        Track track(44100.0, pool);
+        track.recordLoop(44100.0);
+        track.engine.set_playing(true);
+        track.process();
+
+        const auto start = std::chrono::steady_clock::now();
+        track.engine.audio_device_about_to_start(48000.0, blockSize);
+        const double startMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        logMessage("audio_device_about_to_start returned after " + juce::String(startMs, 2) + " ms");
+
+        // Silent (never reading half-converted tape) until the swap
+        bool silentWhileBusy = true;
+        while (track.engine.is_resampling())
+        {
+            silentWhileBusy = silentWhileBusy && track.process() == 0.0f;
+            juce::Thread::sleep(1);
+        }
+        expect(silentWhileBusy);
+        expect(track.engine.wait_for_resample(5000));
+        expectEquals(track.engine.get_resample_progress(), 1.0f);
+
+        expectEquals(track.engine.get_tape_sample_rate(), 48000.0);
+        expectEquals(track.engine.get_buffer_size(), static_cast<size_t>(480000));
+        expect(track.engine.is_chunked() == chunked);
+        expect(track.engine.has_recorded());
+        expectEquals(track.engine.get_recorded_length(), static_cast<size_t>(96000));
+        expectEquals(track.engine.get_loop_end(), static_cast<size_t>(96000));
+        expectEquals(track.engine.get_write_pos(), static_cast<size_t>(96000));
+        expectWithinAbsoluteError(track.engine.get_loop_start(), 24000.0f, 0.01f);
+        expectWithinAbsoluteError(track.engine.get_pos(), 48000.0f * (44100.0f + blockSize) / 44100.0f, 0.01f);
+        if (chunked)
+            expectEquals(static_cast<int>(pool->get_num_in_use()), 2);
+
+        // Same music at the new rate, seam included
+        const auto expected = makeSine(441.0, 48000.0, 96000);
+        float maxError = 0.0f;
+        for (size_t i = 0; i < expected.size(); ++i)
+            maxError = juce::jmax(maxError, std::abs(track.engine.get_sample(i) - expected[i]));
+        expectLessThan(maxError, 1.0e-3f);
+
+        expect(track.process() > 0.1f, "playing again after the swap");
+    }
+
+    void benchmarkResampling()
+    {
+        TestUtils::CsvWriter writer("resampler_benchmark",
+                                    {"Source_rate", "Target_rate", "Half_taps", "Audio_seconds", "Ms", "Realtime_factor"});
+
+        const double seconds = 60.0;
+        const std::array<std::pair<double, double>, 4> rates{ { { 44100.0, 48000.0 }, { 48000.0, 44100.0 },
+                                                                { 48000.0, 96000.0 }, { 96000.0, 44100.0 } } };
+        for (const auto& [source, target] : rates)
+        {
+            const auto input = makeSine(1000.0, source, static_cast<size_t>(seconds * source));
+            const PolyphaseResampler resampler(source, target);
+            std::vector<float> output(resampler.get_output_length(input.size()));
+
+            const auto start = std::chrono::steady_clock::now();
+            resampler.process(input.data(), input.size(), output.data(), 0, output.size(), true);
+            const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+            const double factor = seconds * 1000.0 / ms;
+            writer.writeRow(source, target, resampler.get_half_taps(), seconds, ms, factor);
+            logMessage(juce::String(source) + " -> " + juce::String(target) + ": " + juce::String(ms, 1)
+                       + " ms for " + juce::String(seconds, 0) + " s (" + juce::String(factor, 0) + "x realtime)");
+        }
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    SampleRateChangeTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}
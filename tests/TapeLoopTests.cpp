@@ -0,0 +1,426 @@
+#include <juce_core/juce_core.h>
+#include <flowerjuce/LooperEngine/MultiTrackLooperEngine.h>
+#include <flowerjuce/LooperEngine/TapeChunkPool.h>
+#include <flowerjuce/LooperEngine/TapePrefetcher.h>
+#include <flowerjuce/Panners/CLEATPanner.h>
+#include <flowerjuce/Debug/AudioAllocationGuard.h>
+#include "TestUtils.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <thread>
+
+// Chunked tapes: playback must match a contiguous tape sample for sample,
+// pool usage must follow the recorded length rather than the maximum, a
+// spill-file pool must read back what was written after its pages were
+// evicted, clearing must not return chunks a reader still holds, and running out of chunks must drop samples without crashing or
+// allocating. The benchmark compares memory and render time for 8 tracks
+// with a 5 minute maximum loop.
+class TapeLoopTests : public juce::UnitTest
+{
+public:
+    TapeLoopTests() : juce::UnitTest("TapeLoopTests") {}
+
+    void runTest() override
+    {
+        beginTest("Chunked playback matches contiguous");
+        testChunkedMatchesContiguous();
+
+        beginTest("Pool usage follows recorded length");
+        testPoolGrowsWithRecording();
+
+        beginTest("Clearing waits for pinned readers");
+        testClearWaitsForReaders();
+
+        beginTest("Spill file round trip");
+        testSpillFileRoundTrip();
+
+        beginTest("Pool exhaustion drops samples");
+        testPoolExhaustion();
+
+        beginTest("No allocations while recording into chunks");
+        testNoAllocationsWhileRecording();
+
+        beginTest("Benchmark memory and render time");
+        benchmarkMemoryAndRenderTime();
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+    static constexpr int blockSize = 256;
+    static constexpr int numOutputs = 16;
+
+    static float testSignal(size_t index)
+    {
+        return std::sin(0.0137f * static_cast<float>(index)) * 0.7f
+             + std::sin(0.00071f * static_cast<float>(index)) * 0.2f;
+    }
+
+    static void fillTape(TapeLoop& tape, size_t length)
+    {
+        for (size_t i = 0; i < length; ++i)
+            *tape.get_writable_sample(i) = testSignal(i);
+        tape.m_recorded_length.store(length);
+        tape.m_has_recorded.store(true);
+    }
+
+    // One engine track recording the input through a CLEAT panner
+    struct Track
+    {
+        LooperTrackEngine engine;
+        CLEATPanner panner;
+        juce::AudioBuffer<float> input{1, blockSize};
+        juce::AudioBuffer<float> output{numOutputs, blockSize};
+
+        Track(std::shared_ptr<TapeChunkPool> pool, double maxSeconds)
+        {
+            engine.initialize(sampleRate, maxSeconds);
+            engine.audio_device_about_to_start(sampleRate, blockSize);
+            if (pool != nullptr)
+                engine.set_chunk_pool(std::move(pool), sampleRate, maxSeconds);
+            panner.prepare(sampleRate);
+            engine.set_panner(&panner);
+
+            // Record straight over the whole tape
+            engine.set_overdub_mix(0.0f);
+            engine.set_loop_end(engine.get_buffer_size());
+        }
+
+        void record(int numBlocks, size_t& written)
+        {
+            engine.set_record_enable(true);
+            engine.set_playing(true);
+            for (int block = 0; block < numBlocks; ++block)
+            {
+                float* in = input.getWritePointer(0);
+                for (int i = 0; i < blockSize; ++i)
+                    in[i] = testSignal(written++);
+                process();
+            }
+        }
+
+        void process()
+        {
+            output.clear();
+            engine.process_block(input.getArrayOfReadPointers(), 1,
+                                 output.getArrayOfWritePointers(), numOutputs, blockSize);
+        }
+    };
+
+    void testChunkedMatchesContiguous()
+    {
+        const size_t length = TapeChunkPool::kChunkSize * 3 + 1234;
+        auto pool = std::make_shared<TapeChunkPool>(8);
+
+        TapeLoop contiguous;
+        TapeLoop chunked;
+        contiguous.allocate_buffer(sampleRate, 10.0);
+        chunked.allocate_chunked(pool, sampleRate, 10.0);
+        fillTape(contiguous, length);
+        fillTape(chunked, length);
+
+        expect(chunked.is_chunked());
+        expectEquals(chunked.get_buffer_size(), contiguous.get_buffer_size());
+        expectEquals(static_cast<int>(chunked.get_num_mapped_chunks()), 4);
+        expect(chunked.get_buffer().empty());
+
+        // Loop crossing chunk boundaries, at speeds that skip and repeat samples
+        for (float speed : { 0.37f, 1.0f, 1.5f, 3.0f })
+        {
+            for (bool forward : { true, false })
+            {
+                LooperReadHead a(contiguous);
+                LooperReadHead b(chunked);
+                for (auto* head : { &a, &b })
+                {
+                    head->prepare(sampleRate);
+                    head->set_loop_start(60000.5f);
+                    head->set_loop_end(static_cast<float>(length));
+                    head->set_pos(forward ? 60000.5f : static_cast<float>(length) - 1.0f);
+                    head->set_speed(speed);
+                    head->set_direction_forward(forward);
+                    head->set_playing(true);
+                }
+
+                std::vector<float> outA(blockSize), outB(blockSize);
+                float maxError = 0.0f;
+                for (int block = 0; block < 400; ++block)
+                {
+                    WrapInfo wrapA, wrapB;
+                    a.process_block(outA.data(), blockSize, wrapA);
+                    b.process_block(outB.data(), blockSize, wrapB);
+                    for (int i = 0; i < blockSize; ++i)
+                        maxError = juce::jmax(maxError, std::abs(outA[static_cast<size_t>(i)] - outB[static_cast<size_t>(i)]));
+                }
+
+                expectEquals(maxError, 0.0f, "speed " + juce::String(speed) + (forward ? " forward" : " reverse"));
+                expectEquals(a.get_pos(), b.get_pos());
+            }
+        }
+
+        // Bulk and single-sample reads agree across a chunk boundary
+        std::vector<float> span(1000);
+        const size_t start = TapeChunkPool::kChunkSize - 500;
+        expectEquals(static_cast<int>(chunked.read(start, span.data(), span.size())), 1000);
+        bool same = true;
+        for (size_t i = 0; i < span.size(); ++i)
+            same = same && span[i] == testSignal(start + i) && chunked.get_sample(start + i) == span[i];
+        expect(same);
+
+        // Unwritten tape reads as silence
+        expectEquals(chunked.get_sample(TapeChunkPool::kChunkSize * 6), 0.0f);
+    }
+
+    void testPoolGrowsWithRecording()
+    {
+        auto pool = std::make_shared<TapeChunkPool>(64);
+        Track track(pool, 60.0);
+        expect(track.engine.is_chunked());
+        expectEquals(track.engine.get_buffer_size(), static_cast<size_t>(sampleRate * 60.0));
+        expectEquals(static_cast<int>(pool->get_num_in_use()), 0);
+
+        // Three seconds of a sixty second tape
+        size_t written = 0;
+        const int numBlocks = static_cast<int>(3.0 * sampleRate) / blockSize;
+        track.record(numBlocks, written);
+
+        const auto expectedChunks = (written + TapeChunkPool::kChunkSize - 1) / TapeChunkPool::kChunkSize;
+        expectEquals(static_cast<int>(pool->get_num_in_use()), static_cast<int>(expectedChunks));
+        expectEquals(static_cast<int>(track.engine.get_tape_loop().get_num_mapped_chunks()), static_cast<int>(expectedChunks));
+
+        // What was recorded reads back through the chunks
+        bool same = true;
+        for (size_t i = 0; i < written; i += 97)
+            same = same && track.engine.get_sample(i) == testSignal(i);
+        expect(same);
+
+        // Clearing hands the chunks back; the prefetcher's service() cleans them
+        track.engine.clear_buffer();
+        expectEquals(static_cast<int>(pool->get_num_in_use()), 0);
+        pool->service();
+        expectEquals(track.engine.get_sample(100), 0.0f);
+
+        // Switching back to contiguous storage releases the pool as well
+        track.record(4, written);
+        expect(pool->get_num_in_use() > 0);
+        track.engine.set_chunk_pool(nullptr, sampleRate, 60.0);
+        expect(!track.engine.is_chunked());
+        expectEquals(static_cast<int>(pool->get_num_in_use()), 0);
+    }
+
+    // The pool is shared by every track, so a chunk the audio thread may
+    // still be reading must not go back to it until that reader is done.
+    void testClearWaitsForReaders()
+    {
+        auto pool = std::make_shared<TapeChunkPool>(64);
+        Track track(pool, 60.0);
+        size_t written = 0;
+        track.record(8, written);
+        const auto inUse = pool->get_num_in_use();
+        expect(inUse > 0);
+
+        auto& tape = track.engine.get_tape_loop();
+        std::atomic<bool> cleared{false};
+        std::thread clearer;
+        {
+            const TapeLoop::ReadScope scope(tape);
+            const float* chunk = scope.get_view().get_chunk_table(0)[0].load();
+            expect(chunk != nullptr);
+
+            clearer = std::thread([&] {
+                track.engine.clear_buffer();
+                cleared.store(true);
+            });
+            juce::Thread::sleep(50);
+
+            expect(!cleared.load(), "clear waited for the reader");
+            expectEquals(static_cast<int>(pool->get_num_in_use()), static_cast<int>(inUse));
+            expectEquals(chunk[100], testSignal(100));
+        }
+        clearer.join();
+
+        expect(cleared.load());
+        expectEquals(static_cast<int>(pool->get_num_in_use()), 0);
+        expect(!tape.m_has_recorded.load());
+        expectEquals(track.engine.get_sample(100), 0.0f);
+    }
+
+    void testSpillFileRoundTrip()
+    {
+        const auto spillFile = juce::File::getSpecialLocation(juce::File::tempDirectory)
+                                   .getNonexistentChildFile("tape_loop_tests", ".spill", false);
+        {
+            auto pool = std::make_shared<TapeChunkPool>(16, spillFile);
+            expect(pool->is_spilling_to_disk(), "spill file maps");
+            expect(spillFile.existsAsFile());
+
+            TapeLoop tape;
+            tape.allocate_chunked(pool, sampleRate, 20.0);
+            const size_t length = TapeChunkPool::kChunkSize * 5 + 77;
+            fillTape(tape, length);
+
+            // Hot at the start: chunks 2-4 are evicted, then read back from the file
+            tape.set_hot_position(0);
+            {
+                const TapeLoop::ReadScope scope(tape);
+                tape.maintain_residency(TapePrefetcher::kChunksBehind, TapePrefetcher::kChunksAhead);
+            }
+
+            bool same = true;
+            for (size_t i = 0; i < length; i += 31)
+                same = same && tape.get_sample(i) == testSignal(i);
+            expect(same, "evicted chunks read back from the spill file");
+
+            // The prefetcher thread keeps the tape consistent while it runs
+            {
+                TapePrefetcher prefetcher(1);
+                prefetcher.add_tape(tape);
+                for (size_t hot = 0; hot < length; hot += TapeChunkPool::kChunkSize / 2)
+                {
+                    tape.set_hot_position(hot);
+                    prefetcher.prefetch();
+                }
+                prefetcher.remove_tape(tape);
+            }
+
+            same = true;
+            for (size_t i = 0; i < length; i += 31)
+                same = same && tape.get_sample(i) == testSignal(i);
+            expect(same, "samples survive prefetch and eviction passes");
+        }
+        expect(!spillFile.exists(), "spill file is deleted with the pool");
+    }
+
+    void testPoolExhaustion()
+    {
+        auto pool = std::make_shared<TapeChunkPool>(2);
+        Track track(pool, 10.0);
+        auto& eventLog = track.engine.get_event_log();
+        eventLog.reset_counts();
+
+        // Four seconds into a pool that holds under three
+        size_t written = 0;
+        track.record(static_cast<int>(4.0 * sampleRate) / blockSize, written);
+
+        expectEquals(static_cast<int>(pool->get_num_in_use()), 2);
+        expectEquals(static_cast<int>(eventLog.get_count(AudioEvent::TapePoolExhausted)), 1);
+        expect(track.engine.get_record_enable(), "recording keeps running");
+        expectEquals(track.engine.get_sample(TapeChunkPool::kChunkSize + 10), testSignal(TapeChunkPool::kChunkSize + 10));
+        expectEquals(track.engine.get_sample(TapeChunkPool::kChunkSize * 2 + 10), 0.0f);
+
+        // Freed chunks let the next take record again
+        track.engine.set_record_enable(false);
+        track.engine.clear_buffer();
+        track.engine.reset();
+        written = 0;
+        track.record(8, written);
+        expectEquals(static_cast<int>(pool->get_num_in_use()), 1);
+        expectEquals(track.engine.get_sample(100), testSignal(100));
+    }
+
+    void testNoAllocationsWhileRecording()
+    {
+        // The hooks are linked into this test; without them nothing would be counted
+        expect(AudioAllocationGuard::is_enabled(), "AudioAllocationHooks.cpp is not linked in");
+        if (!AudioAllocationGuard::is_enabled())
+            return;
+
+        auto pool = std::make_shared<TapeChunkPool>(64);
+        Track track(pool, 30.0);
+        TapePrefetcher prefetcher;
+        prefetcher.add_tape(track.engine.get_tape_loop());
+
+        // First-call diagnostics may log once
+        size_t written = 0;
+        track.record(4, written);
+
+        AudioAllocationGuard::reset_violation_count();
+        for (int block = 0; block < static_cast<int>(5.0 * sampleRate) / blockSize; ++block)
+        {
+            const AudioAllocationGuard guard;
+            float* in = track.input.getWritePointer(0);
+            for (int i = 0; i < blockSize; ++i)
+                in[i] = testSignal(written++);
+            track.process();
+        }
+
+        expectEquals(static_cast<int>(AudioAllocationGuard::get_violation_count()), 0);
+        expect(pool->get_num_in_use() >= 3, "recording reached new chunks");
+        prefetcher.remove_tape(track.engine.get_tape_loop());
+    }
+
+    void benchmarkMemoryAndRenderTime()
+    {
+        const int numTracks = 8;
+        const double maxSeconds = 300.0;
+        const std::array<double, 8> loopSeconds{ 2.0, 4.0, 8.0, 8.0, 16.0, 30.0, 60.0, 120.0 };
+
+        double recordedSeconds = 0.0;
+        for (double seconds : loopSeconds)
+            recordedSeconds += seconds;
+
+        // Pool for the recorded total plus headroom, shared by all tracks
+        auto pool = std::make_shared<TapeChunkPool>(TapeChunkPool::chunks_for_duration(sampleRate, recordedSeconds + 30.0));
+
+        std::vector<std::unique_ptr<Track>> tracks;
+        for (int t = 0; t < numTracks; ++t)
+        {
+            tracks.push_back(std::make_unique<Track>(pool, maxSeconds));
+            auto& tape = tracks.back()->engine.get_tape_loop();
+            const auto length = static_cast<size_t>(loopSeconds[static_cast<size_t>(t)] * sampleRate);
+            fillTape(tape, length);
+            tracks.back()->engine.set_loop_end(length);
+            tracks.back()->engine.set_playing(true);
+        }
+
+        // A contiguous tape zeroes (and so commits) its whole capacity up front
+        const auto capacity = tracks.front()->engine.get_buffer_size();
+        const double contiguousMb = static_cast<double>(numTracks) * static_cast<double>(capacity) * sizeof(float) / (1024.0 * 1024.0);
+        const double chunkedMb = static_cast<double>(pool->get_bytes_in_use()) / (1024.0 * 1024.0);
+
+        // Render time: chunked vs contiguous tapes holding the same short loop
+        auto timeRender = [&](std::shared_ptr<TapeChunkPool> renderPool)
+        {
+            Track track(renderPool, 30.0);
+            fillTape(track.engine.get_tape_loop(), static_cast<size_t>(20.0 * sampleRate));
+            track.engine.set_loop_end(static_cast<size_t>(20.0 * sampleRate));
+            track.engine.set_speed(1.3f);
+            track.engine.set_playing(true);
+            for (int block = 0; block < 20; ++block)
+                track.process();
+
+            const int numBlocks = 4000;
+            const auto start = std::chrono::steady_clock::now();
+            for (int block = 0; block < numBlocks; ++block)
+                track.process();
+            const auto end = std::chrono::steady_clock::now();
+            return std::chrono::duration<double, std::micro>(end - start).count() / numBlocks;
+        };
+
+        const double contiguousUs = timeRender(nullptr);
+        const double chunkedUs = timeRender(std::make_shared<TapeChunkPool>(16));
+
+        TestUtils::CsvWriter writer("tape_memory_benchmark",
+                                    {"Mode", "Tracks", "Max_loop_seconds", "Recorded_seconds", "Tape_MB", "Block_us"});
+        writer.writeRow("contiguous", numTracks, maxSeconds, recordedSeconds, contiguousMb, contiguousUs);
+        writer.writeRow("chunked", numTracks, maxSeconds, recordedSeconds, chunkedMb, chunkedUs);
+
+        logMessage("8 tracks x " + juce::String(maxSeconds, 0) + " s max, " + juce::String(recordedSeconds, 0)
+                   + " s recorded: contiguous " + juce::String(contiguousMb, 1) + " MB, chunked "
+                   + juce::String(chunkedMb, 1) + " MB");
+        logMessage("Block render (" + juce::String(blockSize) + " samples): contiguous " + juce::String(contiguousUs, 2)
+                   + " us, chunked " + juce::String(chunkedUs, 2) + " us");
+
+        expect(chunkedMb < contiguousMb / 4.0);
+    }
+};
+
+int main(int argc, char* argv[])
+{
+    (void)argc; (void)argv;
+    TapeLoopTests tests;
+    juce::UnitTestRunner runner;
+    runner.runTests({&tests});
+    return 0;
+}